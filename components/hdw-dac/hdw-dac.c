@@ -3,8 +3,11 @@
 //==============================================================================
 
 #include <inttypes.h>
+#include <string.h>
 #include "freertos/FreeRTOS.h"
-#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
 #include "hdw-dac.h"
 
 //==============================================================================
@@ -14,6 +17,14 @@
 /** The number of buffers to use. The more buffers, the longer latency */
 #define DMA_DESCRIPTORS 4
 
+/** The stack size for the audio task, in bytes. MIDI playback may render percussion from this task */
+#define DAC_TASK_STACK_SIZE 4096
+
+/** How long the audio task waits for the audio lock before checking if it should exit, in milliseconds */
+#define DAC_LOCK_WAIT_MS 10
+
+_Static_assert(0 == (DAC_RING_DEPTH & (DAC_RING_DEPTH - 1)), "DAC_RING_DEPTH must be a power of two");
+
 //==============================================================================
 // Variables
 //==============================================================================
@@ -21,24 +32,61 @@
 /** The handle created for the DAC */
 static dac_continuous_handle_t dac_handle = NULL;
 
-/** A queue to move dac_event_data_t from the interrupt to the main loop*/
-static QueueHandle_t dacIsrQueue = NULL;
-
 /** A callback which will request DAC samples from the application */
 static fnDacCallback_t dacCb = NULL;
 
-/** A temporary buffer for the application to fill with audio samples before */
-static uint8_t tmpDacBuf[DAC_BUF_SIZE] = {0};
+/** The task which calls ::dacCb to keep the ring full */
+static TaskHandle_t dacTask = NULL;
+
+/** Set to false to ask ::dacTask to exit */
+static volatile bool dacTaskRunning = false;
+
+/** The audio lock. ::dacTask holds it while calling ::dacCb, and dacLock() holds it for the application */
+static SemaphoreHandle_t dacMutex = NULL;
+
+/** The memory for ::dacMutex, so it is never allocated or freed */
+static StaticSemaphore_t dacMutexBuf;
+
+/**
+ * Buffers filled by ::dacTask (the single producer) and drained by the DMA interrupt (the single consumer). The
+ * indices run freely and are only ever written by one side each, so no lock is needed
+ */
+static uint8_t ringBufs[DAC_RING_DEPTH][DAC_BUF_SIZE];
+
+/** The number of buffers ever written to ::ringBufs. Only written by ::dacTask */
+static volatile uint32_t ringHead = 0;
+
+/** The number of buffers ever read from ::ringBufs. Only written by the DMA interrupt */
+static volatile uint32_t ringTail = 0;
+
+/** Silence, sent to the DAC when the ring is empty */
+static uint8_t silenceBuf[DAC_BUF_SIZE];
+
+/** The number of DMA buffers which were filled with silence because the ring was empty */
+static volatile uint32_t underruns = 0;
+
+/** The underrun count when dacPoll() last checked it */
+static uint32_t reportedUnderruns = 0;
 
 /** The GPIO which controls amplifier shutdown */
 static gpio_num_t shdnGpio;
 
+//==============================================================================
+// Function Declarations
+//==============================================================================
+
+static bool IRAM_ATTR dac_on_convert_done_callback(dac_continuous_handle_t handle, const dac_event_data_t* event,
+                                                   void* user_data);
+static void dacTaskFn(void* arg);
+static void dacCreateMutex(void);
+
 //==============================================================================
 // Functions
 //==============================================================================
 
 /**
- * @brief Callback for DAC conversion events
+ * @brief Callback for DAC conversion events. This consumes one buffer from the ring, or silence if the ring is empty,
+ * and wakes the audio task to refill it
  *
  * @param handle [in] DAC channel handle, created from dac_continuous_new_channels()
  * @param event [in] DAC event data
@@ -48,19 +96,76 @@ static gpio_num_t shdnGpio;
 static bool IRAM_ATTR dac_on_convert_done_callback(dac_continuous_handle_t handle, const dac_event_data_t* event,
                                                    void* user_data)
 {
-    QueueHandle_t queue = (QueueHandle_t)user_data;
-    BaseType_t need_awoke;
-    /* When the queue is full, drop the oldest item */
-    if (xQueueIsQueueFullFromISR(queue))
+    size_t len = (event->buf_size < DAC_BUF_SIZE) ? event->buf_size : DAC_BUF_SIZE;
+
+    /* Take the oldest buffer from the ring, if there is one */
+    uint32_t tail      = ringTail;
+    const uint8_t* src = silenceBuf;
+    bool haveBuf       = (__atomic_load_n(&ringHead, __ATOMIC_ACQUIRE) != tail);
+    if (haveBuf)
     {
-        dac_event_data_t dummy;
-        xQueueReceiveFromISR(queue, &dummy, &need_awoke);
+        src = ringBufs[tail & (DAC_RING_DEPTH - 1)];
+    }
+    else
+    {
+        underruns++;
+    }
+
+    /* Write the data DMA so that it is sent out the DAC */
+    size_t loaded_bytes = 0;
+    dac_continuous_write_asynchronously(handle, event->buf, event->buf_size, src, len, &loaded_bytes);
+
+    /* Release the slot back to the producer only after it has been copied */
+    if (haveBuf)
+    {
+        __atomic_store_n(&ringTail, tail + 1, __ATOMIC_RELEASE);
+    }
+
+    /* Wake the audio task to refill the ring */
+    BaseType_t need_awoke = pdFALSE;
+    if (NULL != dacTask)
+    {
+        vTaskNotifyGiveFromISR(dacTask, &need_awoke);
     }
-    /* Send the event from callback */
-    xQueueSendFromISR(queue, event, &need_awoke);
     return need_awoke;
 }
 
+/**
+ * @brief The audio task. This requests samples from the application until the ring is full, then sleeps until the
+ * DMA interrupt consumes a buffer
+ *
+ * @param arg unused
+ */
+static void dacTaskFn(void* arg)
+{
+    while (dacTaskRunning)
+    {
+        /* Fill every free slot in the ring */
+        uint32_t head = ringHead;
+        while (dacTaskRunning && (head - __atomic_load_n(&ringTail, __ATOMIC_ACQUIRE)) < DAC_RING_DEPTH)
+        {
+            /* Wait for the application to release the audio lock. Don't wait forever, deinitDac() may be holding it
+             * while waiting for this task to exit */
+            if (pdTRUE != xSemaphoreTakeRecursive(dacMutex, pdMS_TO_TICKS(DAC_LOCK_WAIT_MS)))
+            {
+                continue;
+            }
+            dacCb(ringBufs[head & (DAC_RING_DEPTH - 1)], DAC_BUF_SIZE);
+            xSemaphoreGiveRecursive(dacMutex);
+
+            head++;
+            __atomic_store_n(&ringHead, head, __ATOMIC_RELEASE);
+        }
+
+        /* Sleep until a buffer is consumed or the task is asked to exit */
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+
+    /* Signal deinitDac() that the task is done, then delete it */
+    dacTask = NULL;
+    vTaskDelete(NULL);
+}
+
 /**
  * @brief Initialize the DAC
  *
@@ -91,15 +196,24 @@ void initDac(dac_channel_mask_t channel, gpio_num_t shdn_gpio, fnDacCallback_t c
         /* Allocate continuous channels */
         ESP_ERROR_CHECK(dac_continuous_new_channels(&cont_cfg, &dac_handle));
 
-        /* Create a queue to transport the interrupt event data */
-        dacIsrQueue = xQueueCreate(DMA_DESCRIPTORS, sizeof(dac_event_data_t));
-
         /* Register callbacks for conversion events */
         dac_event_callbacks_t cbs = {
             .on_convert_done = dac_on_convert_done_callback,
             .on_stop         = NULL,
         };
-        ESP_ERROR_CHECK(dac_continuous_register_event_callback(dac_handle, &cbs, dacIsrQueue));
+        ESP_ERROR_CHECK(dac_continuous_register_event_callback(dac_handle, &cbs, NULL));
+
+        /* Start with an empty ring. The DAC's midpoint is silence */
+        memset(silenceBuf, 128, sizeof(silenceBuf));
+        ringHead          = 0;
+        ringTail          = 0;
+        underruns         = 0;
+        reportedUnderruns = 0;
+
+        /* Start the task which keeps the ring full */
+        dacCreateMutex();
+        dacTaskRunning = true;
+        xTaskCreate(dacTaskFn, "dac", DAC_TASK_STACK_SIZE, NULL, DAC_TASK_PRIORITY, &dacTask);
 
         /* Initialize the GPIO of shutdown pin */
         shdnGpio                       = shdn_gpio;
@@ -122,11 +236,18 @@ void deinitDac(void)
         /* Stop the DAC */
         dacStop();
 
+        /* Ask the audio task to exit and wait for it. It can't be deleted from here because it may be in the middle of
+         * the callback, holding who knows what */
+        dacTaskRunning = false;
+        while (NULL != dacTask)
+        {
+            xTaskNotifyGive(dacTask);
+            vTaskDelay(1);
+        }
+
         /* Free resources */
         ESP_ERROR_CHECK(dac_continuous_del_channels(dac_handle));
         dac_handle = NULL;
-        vQueueDelete(dacIsrQueue);
-        dacIsrQueue = NULL;
 
         /* NULL the callback */
         dacCb = NULL;
@@ -160,28 +281,76 @@ void dacStop(void)
 }
 
 /**
- * @brief Poll the queue to see if any buffers need to be filled with audio samples
+ * @brief Create the audio lock, if it hasn't been created yet. It is never deleted, so it may be locked before initDac()
+ * or after deinitDac()
+ */
+static void dacCreateMutex(void)
+{
+    if (NULL == dacMutex)
+    {
+        dacMutex = xSemaphoreCreateRecursiveMutexStatic(&dacMutexBuf);
+    }
+}
+
+/**
+ * @brief Take the audio lock, waiting until the audio task is done generating samples. While the lock is held, the
+ * ::fnDacCallback_t is not called, so state it shares may be changed safely. The lock is recursive, so each call must
+ * be matched by a call to dacUnlock()
+ *
+ * The ring keeps playing while the lock is held. If the lock is held longer than the ring lasts, see
+ * dacGetLatencyUs(), the DAC plays silence until it is released.
+ */
+void dacLock(void)
+{
+    dacCreateMutex();
+    xSemaphoreTakeRecursive(dacMutex, portMAX_DELAY);
+}
+
+/**
+ * @brief Release the audio lock taken by dacLock()
+ */
+void dacUnlock(void)
+{
+    xSemaphoreGiveRecursive(dacMutex);
+}
+
+/**
+ * @brief Get the time between a sample being generated by the ::fnDacCallback_t and it being played, on top of the
+ * DMA buffers. This is the time the ring holds when it is full
+ *
+ * @return The latency added by the ring, in microseconds
+ */
+uint32_t dacGetLatencyUs(void)
+{
+    return (DAC_RING_DEPTH * DAC_BUF_SIZE * 1000000LL) / DAC_SAMPLE_RATE_HZ;
+}
+
+/**
+ * @brief Check the audio ring's health. Samples are generated by the audio task, not here, so this is cheap. If any
+ * DMA buffers were filled with silence since the last call, a warning is logged
  */
 void dacPoll(void)
 {
-    if (dac_handle)
+    uint32_t newUnderruns = underruns;
+    if (newUnderruns != reportedUnderruns)
     {
-        /* If there is an event to receive, receive it */
-        dac_event_data_t evt_data;
-        while (xQueueReceive(dacIsrQueue, &evt_data, 0))
-        {
-            /* Ask the application to fill a buffer */
-            dacCb(tmpDacBuf, evt_data.buf_size);
-
-            /* Write the data DMA so that it is sent out the DAC */
-            size_t loaded_bytes = 0;
-            dac_continuous_write_asynchronously(dac_handle, evt_data.buf, evt_data.buf_size, //
-                                                tmpDacBuf, evt_data.buf_size, &loaded_bytes);
-            /* assume loaded_bytes == DAC_BUF_SIZE */
-        }
+        ESP_LOGW("DAC", "%" PRIu32 " audio underrun(s), %" PRIu32 " total", newUnderruns - reportedUnderruns,
+                 newUnderruns);
+        reportedUnderruns = newUnderruns;
     }
 }
 
+/**
+ * @brief Get the number of DMA buffers which were filled with silence because the audio task did not generate samples
+ * in time
+ *
+ * @return The number of underruns since initDac()
+ */
+uint32_t dacGetUnderruns(void)
+{
+    return underruns;
+}
+
 /**
  * @brief Set the shutdown state of the DAC
  *
@@ -8,9 +8,32 @@
  * continuous, arbitrary signal.
  *
  * This component is initialized by initDac() with a ::fnDacCallback_t callback which will request DAC samples from the
- * application when required. Sample requests come from the DAC peripheral in an interrupt and are queued to be serviced
- * out of the interrupt. This queue is checked in dacPoll(). Spending time to generate samples in an interrupt isn't a
- * good idea.
+ * application when required. Spending time to generate samples in an interrupt isn't a good idea, so samples are
+ * generated ahead of time by a dedicated, high priority audio task into a ring of ::DAC_RING_DEPTH buffers. When the DAC
+ * peripheral finishes with a DMA buffer, its interrupt copies the oldest buffer out of the ring and wakes the audio task
+ * to refill it. The audio task is the only writer and the interrupt is the only reader, so the ring doesn't need a lock.
+ * Because the audio task preempts the main loop, a slow frame doesn't starve the speaker.
+ *
+ * If the audio task can't keep up, the interrupt sends silence instead and counts an underrun. The count can be read
+ * with dacGetUnderruns(). The depth and the task's priority are set with \c CONFIG_DAC_RING_DEPTH and
+ * \c CONFIG_DAC_TASK_PRIORITY in <tt>idf.py menuconfig</tt>.
+ *
+ * \section dac_lock Audio Lock
+ *
+ * The audio task shares state with the main loop, like the MIDI players and the Swadge mode's memory. The audio task
+ * holds the audio lock while it calls the ::fnDacCallback_t, and dacLock() and dacUnlock() hold it for the application.
+ * The lock is only held while shared state changes, never for a whole frame, so the audio task keeps the ring full
+ * while the Swadge mode does slow work like loading assets. The system holds it while Swadge modes are entered and
+ * exited, and every midiPlayer.h function which changes a player takes it while the player changes, so MIDI functions
+ * like midiNoteOn() or globalMidiPlayerPlaySong() may be called from the mode without any locking.
+ *
+ * \section dac_latency Latency
+ *
+ * Each buffer is <tt>::DAC_BUF_SIZE / ::DAC_SAMPLE_RATE_HZ</tt> seconds, about 31ms. When the ring is full, which is
+ * most of the time, a sample is played <tt>::DAC_RING_DEPTH</tt> buffers after it is generated, on top of the DMA
+ * buffers. With the default depth of 2, that is about 62ms of extra latency, returned by dacGetLatencyUs(). The ring
+ * only has to cover the audio task being held off by a higher priority task or by a short hold of the audio lock.
+ * Modes which line up visuals with music, like rhythm games, should delay their visuals by dacGetLatencyUs().
  *
  * \warning
  * Note that the DAC peripheral and the ADC peripheral (hdw-mic.h) use the same DMA controller, so they cannot both be
@@ -24,9 +47,15 @@
  * when the DAC needs to be used. Stopping the DAC when not in use can save some processing cycles, but stopping it
  * abruptly may cause unwanted clicks or pops on the speaker.
  *
- * dacPoll() is called automatically by the system while the DAC is running. By default, samples are requested from
- * sngPlayerFillBuffer(). Swadge modes may override this by providing a non-NULL function pointer for
- * ::swadgeMode_t.fnDacCb.
+ * dacPoll() is called automatically by the system while the DAC is running to log any underruns. By default, samples
+ * are requested from globalMidiPlayerFillBuffer(). Swadge modes may override this by providing a non-NULL function
+ * pointer for ::swadgeMode_t.fnDacCb.
+ *
+ * \warning
+ * The ::fnDacCallback_t runs in the audio task, not the main loop, and may run at the same time as
+ * ::swadgeMode_t.fnMainLoop. A mode with its own ::swadgeMode_t.fnDacCb must call dacLock() and dacUnlock() around any
+ * change to state the callback reads, other than through midiPlayer.h functions. MIDI player callbacks, like
+ * ::midiPlayer_t.songFinishedCallback, also run in the audio task with the lock held.
  *
  * \section dac_example Example
  *
@@ -46,11 +75,10 @@
  *     initDac(dacCallback);
  *     dacStart();
  *
- *     // Loop forever and poll the DAC.
+ *     // dacCallback is called from the audio task as appropriate. Loop forever and check for underruns
  *     bool running = true;
  *     while(running)
  *     {
- *         // This will end up calling dacCallback as appropriate
  *         dacPoll();
  *     }
  *
@@ -81,6 +109,22 @@
 /** The size of each buffer to fill with DAC samples */
 #define DAC_BUF_SIZE 512
 
+#ifdef CONFIG_DAC_RING_DEPTH
+    /** The number of ::DAC_BUF_SIZE buffers generated ahead of the DAC. Must be a power of two */
+    #define DAC_RING_DEPTH CONFIG_DAC_RING_DEPTH
+#else
+    /** The number of ::DAC_BUF_SIZE buffers generated ahead of the DAC. Must be a power of two */
+    #define DAC_RING_DEPTH 2
+#endif
+
+#ifdef CONFIG_DAC_TASK_PRIORITY
+    /** The FreeRTOS priority of the audio task */
+    #define DAC_TASK_PRIORITY CONFIG_DAC_TASK_PRIORITY
+#else
+    /** The FreeRTOS priority of the audio task */
+    #define DAC_TASK_PRIORITY 10
+#endif
+
 //==============================================================================
 // Typedefs
 //==============================================================================
@@ -100,6 +144,10 @@ typedef void (*fnDacCallback_t)(uint8_t* samples, int16_t len);
 void initDac(dac_channel_mask_t channel, gpio_num_t shdn_gpio, fnDacCallback_t cb);
 void deinitDac(void);
 void dacPoll(void);
+uint32_t dacGetUnderruns(void);
+void dacLock(void);
+void dacUnlock(void);
+uint32_t dacGetLatencyUs(void);
 void dacStart(void);
 void dacStop(void);
 void setDacShutdown(bool shutdown);
@@ -15,6 +15,7 @@
 #include <freertos/task.h>
 #include "hdw-imu.h"
 #include "hdw-nvs.h"
+#include "imuFusion.h"
 #include "quaternions.h"
 
 #define DSCL_OUTPUT                             \
@@ -91,12 +92,20 @@ typedef enum __attribute__((packed))
 #define LSM6DSL_ADDRESS 0x6a
 #define QMC6308_ADDRESS 0x2c
 
+/// The number of samples read from the FIFO at a time
+#define IMU_BATCH_SAMPLES 16
+
 //==============================================================================
 // Variables
 //==============================================================================
 
 LSM6DSLData LSM6DSL;
 
+/// The sample rate for each ::imuOdr_t, indexed by the ODR code. 0 is powered down.
+static const float imuOdrHz[] = {
+    0.0f, 12.5f, 26.0f, 52.0f, 104.0f, 208.0f, 416.0f, 833.0f, 1666.0f,
+};
+
 //==============================================================================
 // Static Function Prototypes
 //==============================================================================
@@ -116,6 +125,8 @@ static esp_err_t LSM6DSLSet(int reg, int val);
 static int GeneralI2CGet(int device, int reg, uint8_t* data, int data_len);
 static int ReadLSM6DSL(uint8_t* data, int data_len);
 
+static void accelFuseSample(LSM6DSLData* ld, const int16_t* sample);
+
 //==============================================================================
 // Utility Functions
 //==============================================================================
@@ -216,8 +227,8 @@ static int ReadLSM6DSL(uint8_t* data, int data_len)
         // If we overflow, and we don't do this, bad things happen.
         GetByte(1);
         SendStop();
-        LSM6DSLSet(LSM6DSL_FIFO_CTRL5, (0b0101 << 3) | 0b000); // Disable fifo
-        LSM6DSLSet(LSM6DSL_FIFO_CTRL5, (0b0101 << 3) | 0b110); // 208 Hz ODR
+        LSM6DSLSet(LSM6DSL_FIFO_CTRL5, (LSM6DSL.odr << 3) | 0b000); // Disable fifo
+        LSM6DSLSet(LSM6DSL_FIFO_CTRL5, (LSM6DSL.odr << 3) | 0b110); // Continuous mode at the configured ODR
         LSM6DSL.sampCount = 0;
         return 0;
     }
@@ -355,6 +366,107 @@ esp_err_t deInitAccelerometer(void)
     return ESP_OK;
 }
 
+/**
+ * @brief Fuse one gyro and accelerometer sample into the fixed point orientation
+ *
+ * @param ld The IMU data
+ * @param sample Six values read from the FIFO, three gyro then three accelerometer
+ */
+static void accelFuseSample(LSM6DSLData* ld, const int16_t* sample)
+{
+    // Extract data from IMU
+    const int16_t* euler_deltas = sample; // Euler angles, from gyro.
+    const int16_t* accel_data   = sample + 3;
+
+    // ESP_LOGI( "_", "%2d%3d%4d%4d%4d%5d%5d%5d", samp, readr, euler_deltas[0], euler_deltas[1], euler_deltas[2],
+    // accel_data[0], accel_data[1], accel_data[2] );
+
+    // We can sum rotations to understand the amount of counts in a full circle.
+    // Note: this is actually more of a debug mechanism.
+    ld->gyroaccum[0] += euler_deltas[0];
+    ld->gyroaccum[1] += euler_deltas[1];
+    ld->gyroaccum[2] += euler_deltas[2];
+
+    // STEP 1:  Visually inspect the gyro values.
+    // STEP 2:  Integrate the gyro values, verify they are correct.
+
+    // Used for calibration. This is rare, so it's done in floating point, always in units of radians per sample at
+    // 208 Hz.
+    if (ld->performCal)
+    {
+        float fScale     = GYRO_SCALE_208;
+        float fEulers[3] = {-euler_deltas[0] * fScale, euler_deltas[1] * fScale, -euler_deltas[2] * fScale};
+
+        float diff[3] = {fEulers[0] - ld->fvAverage[0], fEulers[1] - ld->fvAverage[1], fEulers[2] - ld->fvAverage[2]};
+
+        float diffsq[3] = {(diff[0] < 0) ? -diff[0] : diff[0], (diff[1] < 0) ? -diff[1] : diff[1],
+                           (diff[2] < 0) ? -diff[2] : diff[2]};
+
+        diffsq[0] *= 1000.0;
+        diffsq[1] *= 1000.0;
+        diffsq[2] *= 1000.0;
+
+        ld->fvDeviation[0] -= 0.004;
+        ld->fvDeviation[1] -= 0.004;
+        ld->fvDeviation[2] -= 0.004;
+
+        if (ld->fvDeviation[0] < diffsq[0])
+            ld->fvDeviation[0] = diffsq[0];
+        if (ld->fvDeviation[1] < diffsq[1])
+            ld->fvDeviation[1] = diffsq[1];
+        if (ld->fvDeviation[2] < diffsq[2])
+            ld->fvDeviation[2] = diffsq[2];
+
+        if (ld->fvDeviation[0] > 0.8)
+            ld->fvDeviation[0] = 0.8;
+        if (ld->fvDeviation[1] > 0.8)
+            ld->fvDeviation[1] = 0.8;
+        if (ld->fvDeviation[2] > 0.8)
+            ld->fvDeviation[2] = 0.8;
+
+        diff[0] *= mathsqrtf(ld->fvDeviation[0]) * 0.5;
+        diff[1] *= mathsqrtf(ld->fvDeviation[1]) * 0.5;
+        diff[2] *= mathsqrtf(ld->fvDeviation[2]) * 0.5;
+
+        ld->fvAverage[0] += diff[0];
+        ld->fvAverage[1] += diff[1];
+        ld->fvAverage[2] += diff[2];
+
+        // Compute the running RMS error.
+        float fvEuler = accelGetStdDevInCal();
+
+        if (fvEuler < 0.00015f)
+        {
+            ld->fvBias[0] = -ld->fvAverage[0];
+            ld->fvBias[1] = -ld->fvAverage[1];
+            ld->fvBias[2] = -ld->fvAverage[2];
+            imuFusionBiasFromFloat(ld);
+            struct fiunion
+            {
+                union
+                {
+                    int32_t i;
+                    float f;
+                } u;
+            };
+            struct fiunion x, y, z;
+            x.u.f = ld->fvBias[0];
+            y.u.f = ld->fvBias[1];
+            z.u.f = ld->fvBias[2];
+            writeNvs32("gyrocalx", x.u.i);
+            writeNvs32("gyrocaly", y.u.i);
+            writeNvs32("gyrocalz", z.u.i);
+
+            ld->performCal     = 0;
+            ld->fvDeviation[0] = 0;
+            ld->fvDeviation[0] = 1;
+            ld->fvDeviation[0] = 2;
+        }
+    }
+
+    imuFusionSample(ld, euler_deltas, accel_data);
+}
+
 /**
  * @brief Read all pending samples in IMU and perform a sensor fusion pass
  *
@@ -364,7 +476,7 @@ esp_err_t accelIntegrate()
 {
     LSM6DSLData* ld = &LSM6DSL;
 
-    int16_t data[6 * 16];
+    int16_t data[6 * IMU_BATCH_SAMPLES];
 
     // Get temperature sensor (in case we ever want to use it)
     // int r = GeneralI2CGet(LSM6DSL_ADDRESS, 0x20, (uint8_t*)data, 2);
@@ -372,16 +484,6 @@ esp_err_t accelIntegrate()
     //    return r;
     // if (r == 2)
     //    ld->temp = data[0];
-    int readr = ReadLSM6DSL((uint8_t*)data, sizeof(data));
-    if (readr < 0)
-        return readr;
-    int samp;
-    int16_t* cdata = data;
-
-    uint32_t start = getCycleCount();
-
-    // Round down
-    readr = (readr / 6) * 6;
 
     // STEP 0:  Decide your coordinate frame.
 
@@ -389,230 +491,48 @@ esp_err_t accelIntegrate()
     // [1] = +Y axis, pointing straight up out of controller, out where the USB port is.
     // [2] = +Z axis, pointing up from the face of the controller.
 
-    ld->lastreadr = readr;
-
-    for (samp = 0; samp < readr; samp += 6)
+    uint32_t computetime = 0;
+    int totalr           = 0;
+    int readr;
+    do
     {
-        // Extract data from IMU
-        int16_t* euler_deltas = cdata; // Euler angles, from gyro.
-        int16_t* accel_data   = cdata + 3;
-
-        // ESP_LOGI( "_", "%2d%3d%4d%4d%4d%5d%5d%5d", samp, readr, euler_deltas[0], euler_deltas[1], euler_deltas[2],
-        // accel_data[0], accel_data[1], accel_data[2] );
-
-        // Manual cal, used only for Steps 2..8
-        //    euler_deltas[0] -= 12;
-        //    euler_deltas[1] += 22;
-        //    euler_deltas[2] += 4;
-
-        // We can sum rotations to understand the amount of counts in a full circle.
-        // Note: this is actually more of a debug mechanism.
-        ld->gyroaccum[0] += euler_deltas[0];
-        ld->gyroaccum[1] += euler_deltas[1];
-        ld->gyroaccum[2] += euler_deltas[2];
-
-        // STEP 1:  Visually inspect the gyro values.
-        // STEP 2:  Integrate the gyro values, verify they are correct.
-
-        // 2000 dps full-scale
-        // 32768 is full-scale
-        // 208 SPS
-        // convert to radians. ( 2000.0f / 32768.0f / 208.0f * 2.0 * 3.14159f / 180.0f );
-        // Measured = 560,000 counts per scale (Measured by looking at sum)
-        // Testing -> 3.14159 * 2.0 / 566000;
-        float fFudge = 0.5625; // XXX TODO: Investigate.
-        float fScale = (2000.0f / 32768.0f / 208.0f * 2.0 * 3.14159f / 180.0f) * fFudge;
-
-        // STEP 3:  Integrate gyro values into a quaternion.
-        // This step is validated by working with just one axis at a time
-        // then apply a coordinate frame to ld->fqQuat and validate that it is
-        // correct.
-        float fEulerScales[3] = {-fScale, fScale, -fScale};
-
-        float fEulers[3]
-            = {euler_deltas[0] * fEulerScales[0], euler_deltas[1] * fEulerScales[1], euler_deltas[2] * fEulerScales[2]};
-
-        // Used for calibration
-        if (ld->performCal)
-        {
-            float diff[3]
-                = {fEulers[0] - ld->fvAverage[0], fEulers[1] - ld->fvAverage[1], fEulers[2] - ld->fvAverage[2]};
-
-            float diffsq[3] = {(diff[0] < 0) ? -diff[0] : diff[0], (diff[1] < 0) ? -diff[1] : diff[1],
-                               (diff[2] < 0) ? -diff[2] : diff[2]};
-
-            diffsq[0] *= 1000.0;
-            diffsq[1] *= 1000.0;
-            diffsq[2] *= 1000.0;
-
-            ld->fvDeviation[0] -= 0.004;
-            ld->fvDeviation[1] -= 0.004;
-            ld->fvDeviation[2] -= 0.004;
-
-            if (ld->fvDeviation[0] < diffsq[0])
-                ld->fvDeviation[0] = diffsq[0];
-            if (ld->fvDeviation[1] < diffsq[1])
-                ld->fvDeviation[1] = diffsq[1];
-            if (ld->fvDeviation[2] < diffsq[2])
-                ld->fvDeviation[2] = diffsq[2];
-
-            if (ld->fvDeviation[0] > 0.8)
-                ld->fvDeviation[0] = 0.8;
-            if (ld->fvDeviation[1] > 0.8)
-                ld->fvDeviation[1] = 0.8;
-            if (ld->fvDeviation[2] > 0.8)
-                ld->fvDeviation[2] = 0.8;
-
-            diff[0] *= mathsqrtf(ld->fvDeviation[0]) * 0.5;
-            diff[1] *= mathsqrtf(ld->fvDeviation[1]) * 0.5;
-            diff[2] *= mathsqrtf(ld->fvDeviation[2]) * 0.5;
-
-            ld->fvAverage[0] += diff[0];
-            ld->fvAverage[1] += diff[1];
-            ld->fvAverage[2] += diff[2];
-
-            // Compute the running RMS error.
-            float fvEuler = accelGetStdDevInCal();
-
-            if (fvEuler < 0.00015f)
-            {
-                ld->fvBias[0] = -ld->fvAverage[0];
-                ld->fvBias[1] = -ld->fvAverage[1];
-                ld->fvBias[2] = -ld->fvAverage[2];
-                struct fiunion
-                {
-                    union
-                    {
-                        int32_t i;
-                        float f;
-                    } u;
-                };
-                struct fiunion x, y, z;
-                x.u.f = ld->fvBias[0];
-                y.u.f = ld->fvBias[1];
-                z.u.f = ld->fvBias[2];
-                writeNvs32("gyrocalx", x.u.i);
-                writeNvs32("gyrocaly", y.u.i);
-                writeNvs32("gyrocalz", z.u.i);
-
-                ld->performCal     = 0;
-                ld->fvDeviation[0] = 0;
-                ld->fvDeviation[0] = 1;
-                ld->fvDeviation[0] = 2;
-            }
-        }
-
-        fEulers[0] += ld->fvBias[0];
-        fEulers[1] += ld->fvBias[1];
-        fEulers[2] += ld->fvBias[2];
-
-        mathEulerToQuat(ld->fqQuatLast, fEulers);
-        mathQuatApply(ld->fqQuat, ld->fqQuat, ld->fqQuatLast);
-
-        // STEP 4: Validate yor values by doing 4 90 degree turns
-        //  across multiple axes.
-        // i.e. rotate controller down, clockwise from top, up, counter-clockwise.
-        // while investigating quaternion.  It should return to identity.
-
-        // STEP 6: Determine our "error" based on accelerometer.
-        // NOTE: This step could be done on the inner loop if you want, and done over
-        // every accelerometer cycle, or it can be done on the outside, every few cycles.
-        // all that realy matters is that it is done periodically.
+        readr = ReadLSM6DSL((uint8_t*)data, sizeof(data));
+        if (readr < 0)
+            return readr;
 
-        // STEP 6A: Examine vectors.  Generally speaking, we want an "up" vector, not a gravity vector.
-        // this is "up" in the controller's point of view.
-        float accel_up[3] = {-accel_data[0], accel_data[1], -accel_data[2]};
+        uint32_t start = getCycleCount();
 
-        float accel_inverse_mag
-            = rsqrtf(accel_up[0] * accel_up[0] + accel_up[1] * accel_up[1] + accel_up[2] * accel_up[2]);
-        accel_up[0] *= accel_inverse_mag;
-        accel_up[1] *= accel_inverse_mag;
-        accel_up[2] *= accel_inverse_mag;
+        // Round down
+        readr = (readr / 6) * 6;
 
-        ld->fvLastAccelRaw[0] = accel_up[0];
-        ld->fvLastAccelRaw[1] = accel_up[1];
-        ld->fvLastAccelRaw[2] = accel_up[2];
-
-        if (ld->sampCount++ == 0)
+        for (int samp = 0; samp < readr; samp += 6)
         {
-            // set fqQuat to be the rotation to go from our "up" from the
-            // accelerometer to the nominal "up"
-            float ideal_up[3] = {0, 1, 0};
-            mathQuatFromTwoVectors(ld->fqQuat, ideal_up, accel_up);
+            accelFuseSample(ld, &data[samp]);
         }
-        else
-        {
-            // Step 6B: Next, compute what we think "up" should be from our point of view.  We will use +Y Up.
-            float what_we_think_is_up[3] = {0, 1, 0};
-            mathRotateVectorByInverseOfQuaternion(what_we_think_is_up, LSM6DSL.fqQuat, what_we_think_is_up);
-
-            // Step 6C: Next, we determine how far off we are.  This will tell us our error.
-            float corrective_quaternion[4];
-
-            // TRICKY: The ouput of this is actually the axis of rotation, which is ironically
-            // in vector-form the same as a quaternion.  So we can write directly into the quat.
-            mathCrossProduct(corrective_quaternion + 1, accel_up, what_we_think_is_up);
 
-            // Now, we apply this in step 7.
-
-            // First, we can compute what the drift values of our axes are, to anti-drift them.
-            // If you do only this, you will always end up in an unstable oscillation.
-            memcpy(ld->fCorrectLast, corrective_quaternion + 1, 12);
-
-            // XXX TODO: We need to multiply by amount the accelerometer gives us assurance.
-            ld->fvBias[0] += mathsqrtf(corrective_quaternion[1]) * 0.0000002;
-            ld->fvBias[1] += mathsqrtf(corrective_quaternion[2]) * 0.0000002;
-            ld->fvBias[2] += mathsqrtf(corrective_quaternion[3]) * 0.0000002;
-
-            float corrective_force = 0.0005f;
+        if (readr)
+        {
+            ld->gyrolast[0]  = data[readr - 6];
+            ld->gyrolast[1]  = data[readr - 5];
+            ld->gyrolast[2]  = data[readr - 4];
+            ld->accellast[0] = data[readr - 3];
+            ld->accellast[1] = data[readr - 2];
+            ld->accellast[2] = data[readr - 1];
+        }
 
-            // Second, we can apply a very small corrective tug.  This helps prevent oscillation
-            // about the correct answer.  This acts sort of like a P term to a PID loop.
-            // This is actually the **primary**, or fastest responding thing.
-            corrective_quaternion[1] *= corrective_force;
-            corrective_quaternion[2] *= corrective_force;
-            corrective_quaternion[3] *= corrective_force;
+        totalr += readr;
+        computetime += getCycleCount() - start;
 
-            // x^2+y^2+z^2+q^2 -> ALGEBRA! -> sqrt( 1-x^2-y^2-z^2 ) = w
-            corrective_quaternion[0] = mathsqrtf(1 - corrective_quaternion[1] * corrective_quaternion[1]
-                                                 - corrective_quaternion[2] * corrective_quaternion[2]
-                                                 - corrective_quaternion[3] * corrective_quaternion[3]);
+        // At high ODRs there may be more than one batch waiting
+    } while (readr == 6 * IMU_BATCH_SAMPLES);
 
-            mathQuatApply(ld->fqQuat, ld->fqQuat, corrective_quaternion);
-        }
-        cdata += 6;
-    }
+    uint32_t start = getCycleCount();
 
-    // Now we move onto the outer loop.
-    // STEP 5: We now want to normalize the quat periodically.  Don't do this too
-    // soon, otherwise you won't notice math errors.  Realistically, this should
-    // only need to be done every hundreds of thousands of samples.
-    //
-    // Also, don't do this too often, otherwise you will reduce accuracy,
-    // unnecessarily.
-    float* qRot  = ld->fqQuat;
-    float qmagsq = qRot[0] * qRot[0] + qRot[1] * qRot[1] + qRot[2] * qRot[2] + qRot[3] * qRot[3];
-    if (qmagsq > 1.05 || qmagsq < 0.95)
-    {
-        // This normalizes everything.
-        qmagsq  = rsqrtf(qmagsq);
-        qRot[0] = qRot[0] * qmagsq;
-        qRot[1] = qRot[1] * qmagsq;
-        qRot[2] = qRot[2] * qmagsq;
-        qRot[3] = qRot[3] * qmagsq;
-    }
+    ld->lastreadr = totalr;
 
-    if (samp)
-    {
-        ld->gyrolast[0]  = cdata[-6];
-        ld->gyrolast[1]  = cdata[-5];
-        ld->gyrolast[2]  = cdata[-4];
-        ld->accellast[0] = cdata[-3];
-        ld->accellast[1] = cdata[-2];
-        ld->accellast[2] = cdata[-1];
-    }
+    imuFusionEndBatch(ld);
 
-    ld->computetime = getCycleCount() - start;
+    ld->computetime = computetime + getCycleCount() - start;
 
     return ESP_OK;
 }
@@ -747,22 +667,28 @@ float accelGetStdDevInCal()
  */
 void accelSetRegistersAndReset(void)
 {
-    LSM6DSLSet(LSM6DSL_FIFO_CTRL5, (0b0101 << 3) | 0b000); // Reset FIFO
-    LSM6DSLSet(
-        LSM6DSL_FIFO_CTRL5,
-        (0b0101 << 3)
-            | 0b110); // 208 Hz ODR, Continuous mode. If the FIFO is full, the new sample overwrites the older one.
-    LSM6DSLSet(LSM6DSL_FIFO_CTRL3, 0b00001001); // Put both devices (Accel + Gyro) in FIFO.
-    LSM6DSLSet(LSM6DSL_CTRL1_XL, 0b01011001);   // Setup accel (16 g's FS)
-    LSM6DSLSet(LSM6DSL_CTRL2_G, 0b01011100);    // Setup gyro, 2000dps
-    LSM6DSLSet(LSM6DSL_CTRL4_C, 0x00);          // Disable all filtering.
-    LSM6DSLSet(LSM6DSL_CTRL7_G, 0b00000000);    // Setup gyro, not high performance mode = 0x80.  High perf = 0x00
-    LSM6DSLSet(LSM6DSL_FIFO_CTRL2, 0b00000000); // Temp not in fifo  (Why no work?)
+    // Keep the ODR through the reset, or use the default if it was never set
+    imuOdr_t odr = LSM6DSL.odr;
+    if (odr < IMU_ODR_12_5_HZ || odr > IMU_ODR_1660_HZ)
+    {
+        odr = IMU_ODR_208_HZ;
+    }
+
+    LSM6DSLSet(LSM6DSL_FIFO_CTRL5, (odr << 3) | 0b000); // Reset FIFO
+    LSM6DSLSet(LSM6DSL_FIFO_CTRL5, (odr << 3) | 0b110); // Continuous mode. When full, new samples overwrite old ones.
+    LSM6DSLSet(LSM6DSL_FIFO_CTRL3, 0b00001001);         // Put both devices (Accel + Gyro) in FIFO.
+    LSM6DSLSet(LSM6DSL_CTRL1_XL, (odr << 4) | 0b1001);  // Setup accel (16 g's FS)
+    LSM6DSLSet(LSM6DSL_CTRL2_G, (odr << 4) | 0b1100);   // Setup gyro, 2000dps
+    LSM6DSLSet(LSM6DSL_CTRL4_C, 0x00);                  // Disable all filtering.
+    LSM6DSLSet(LSM6DSL_CTRL7_G, 0b00000000);            // Setup gyro, not high perf mode = 0x80.  High perf = 0x00
+    LSM6DSLSet(LSM6DSL_FIFO_CTRL2, 0b00000000);         // Temp not in fifo  (Why no work?)
 
     memset(&LSM6DSL, 0, sizeof(LSM6DSL));
+    LSM6DSL.odr           = odr;
     LSM6DSL.fqQuat[0]     = 1;
     LSM6DSL.fqQuatLast[0] = 1;
-    LSM6DSL.sampCount     = 0;
+    imuFusionReset(&LSM6DSL, imuOdrHz[odr]);
+
     if (!readNvs32("gyrocalx", (int32_t*)&LSM6DSL.fvBias[0]))
     {
         LSM6DSL.performCal = 1;
@@ -778,4 +704,24 @@ void accelSetRegistersAndReset(void)
         LSM6DSL.performCal = 1;
         LSM6DSL.fvBias[2]  = 0;
     }
+    imuFusionBiasFromFloat(&LSM6DSL);
+}
+
+/**
+ * @brief Set how often the IMU samples the accelerometer and gyroscope. This resets the IMU like
+ * accelSetRegistersAndReset(). The rate is kept until it is set again.
+ *
+ * @param odr The output data rate
+ * @return ESP_OK if the rate was set, or ESP_ERR_INVALID_ARG if it is not a valid rate
+ */
+esp_err_t accelSetOutputDataRate(imuOdr_t odr)
+{
+    if (odr < IMU_ODR_12_5_HZ || odr > IMU_ODR_1660_HZ)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    LSM6DSL.odr = odr;
+    accelSetRegistersAndReset();
+    return ESP_OK;
 }
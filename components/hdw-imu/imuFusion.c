@@ -0,0 +1,375 @@
+//==============================================================================
+// Includes
+//==============================================================================
+
+#include <string.h>
+
+#include "imuFusion.h"
+#include "quaternions.h"
+
+//==============================================================================
+// Static Function Prototypes
+//==============================================================================
+
+static inline int32_t imuMulQ30(int32_t a, int32_t b);
+static uint32_t imuIsqrt(uint32_t x);
+static int32_t imuSignedSqrt(int32_t x);
+static void imuSmallEulerToQuat(int32_t* q, const int32_t* halfAngles);
+static void imuQuatApply(int32_t* qout, const int32_t* q1, const int32_t* q2);
+static void imuCrossProduct(int32_t* p, const int32_t* a, const int32_t* b);
+static void imuRotateVectorByInverseOfQuaternion(int32_t* pout, const int32_t* q, const int32_t* p);
+
+//==============================================================================
+// Static Functions
+//==============================================================================
+
+/**
+ * @brief Multiply two Q30 numbers
+ *
+ * @param a A Q30 number
+ * @param b Another Q30 number
+ * @return a * b, in Q30
+ */
+static inline int32_t imuMulQ30(int32_t a, int32_t b)
+{
+    return ((int64_t)a * b) >> IMU_Q;
+}
+
+/**
+ * @brief Compute an integer square root
+ *
+ * @param x The number to take the square root of
+ * @return floor(sqrt(x))
+ */
+static uint32_t imuIsqrt(uint32_t x)
+{
+    uint32_t res = 0;
+    uint32_t bit = 1u << 30;
+    while (bit > x)
+    {
+        bit >>= 2;
+    }
+
+    while (bit)
+    {
+        if (x >= res + bit)
+        {
+            x -= res + bit;
+            res = (res >> 1) + bit;
+        }
+        else
+        {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+    return res;
+}
+
+/**
+ * @brief Compute a square root which keeps the sign of its argument, like mathsqrtf()
+ *
+ * @param x A Q30 number
+ * @return sqrt(|x|) with the sign of x, in Q15
+ */
+static int32_t imuSignedSqrt(int32_t x)
+{
+    if (x < 0)
+    {
+        return -(int32_t)imuIsqrt(-x);
+    }
+    return imuIsqrt(x);
+}
+
+/**
+ * @brief Convert euler angles from one gyro sample to a quaternion, like mathEulerToQuat(), with sin() and cos()
+ * replaced by their Taylor series.
+ *
+ * A full-scale gyro sample at 12.5 Hz turns each half angle by up to about 0.8 radians, so the series can't stop at the
+ * first terms. Up to the h^7 term of sin() and the h^6 term of cos(), they are within 4e-6 of sin() and cos() at 0.8
+ * radians, which is below the other fixed point errors. At 208 Hz, half angles are under 0.05 radians, where the
+ * higher terms are lost in rounding.
+ *
+ * @param q The Q30 wxyz quaternion to write
+ * @param halfAngles Half of each euler angle, in Q30 radians
+ */
+static void imuSmallEulerToQuat(int32_t* q, const int32_t* halfAngles)
+{
+    int32_t c[3];
+    int32_t s[3];
+    for (int i = 0; i < 3; i++)
+    {
+        // cos(h) = 1 - h^2/2 (1 - h^2/12 (1 - h^2/30)), sin(h) = h (1 - h^2/6 (1 - h^2/20 (1 - h^2/42)))
+        int32_t h2 = imuMulQ30(halfAngles[i], halfAngles[i]);
+        c[i]       = IMU_ONE - imuMulQ30(h2 / 2, IMU_ONE - imuMulQ30(h2 / 12, IMU_ONE - h2 / 30));
+        s[i]       = imuMulQ30(halfAngles[i],
+                               IMU_ONE - imuMulQ30(h2 / 6, IMU_ONE - imuMulQ30(h2 / 20, IMU_ONE - h2 / 42)));
+    }
+
+    // c[0] and s[0] are pitch about X, c[1] and s[1] are yaw about Y, c[2] and s[2] are roll about Z
+    int32_t crcp = imuMulQ30(c[0], c[1]);
+    int32_t srsp = imuMulQ30(s[0], s[1]);
+    int32_t srcp = imuMulQ30(s[0], c[1]);
+    int32_t crsp = imuMulQ30(c[0], s[1]);
+    q[0]         = imuMulQ30(crcp, c[2]) + imuMulQ30(srsp, s[2]);
+    q[1]         = imuMulQ30(srcp, c[2]) - imuMulQ30(crsp, s[2]);
+    q[2]         = imuMulQ30(crsp, c[2]) + imuMulQ30(srcp, s[2]);
+    q[3]         = imuMulQ30(crcp, s[2]) - imuMulQ30(srsp, c[2]);
+}
+
+/**
+ * @brief Rotate one Q30 quaternion by another (and do not normalize), like mathQuatApply()
+ *
+ * @param qout The Q30 wxyz quaternion to write. This may be q1 or q2
+ * @param q1 First quaternion to be rotated
+ * @param q2 Quaternion to rotate q1 by
+ */
+static void imuQuatApply(int32_t* qout, const int32_t* q1, const int32_t* q2)
+{
+    int64_t w = (int64_t)q1[0] * q2[0] - (int64_t)q1[1] * q2[1] - (int64_t)q1[2] * q2[2] - (int64_t)q1[3] * q2[3];
+    int64_t x = (int64_t)q1[0] * q2[1] + (int64_t)q1[1] * q2[0] + (int64_t)q1[2] * q2[3] - (int64_t)q1[3] * q2[2];
+    int64_t y = (int64_t)q1[0] * q2[2] - (int64_t)q1[1] * q2[3] + (int64_t)q1[2] * q2[0] + (int64_t)q1[3] * q2[1];
+    int64_t z = (int64_t)q1[0] * q2[3] + (int64_t)q1[1] * q2[2] - (int64_t)q1[2] * q2[1] + (int64_t)q1[3] * q2[0];
+    qout[0]   = w >> IMU_Q;
+    qout[1]   = x >> IMU_Q;
+    qout[2]   = y >> IMU_Q;
+    qout[3]   = z >> IMU_Q;
+}
+
+/**
+ * @brief Perform a Q30 3D cross product, like mathCrossProduct()
+ *
+ * @param p The Q30 output of the cross product (p = a x b). This may be a or b
+ * @param a The Q30 a vector
+ * @param b The Q30 b vector
+ */
+static void imuCrossProduct(int32_t* p, const int32_t* a, const int32_t* b)
+{
+    int32_t tx = ((int64_t)a[1] * b[2] - (int64_t)a[2] * b[1]) >> IMU_Q;
+    int32_t ty = ((int64_t)a[2] * b[0] - (int64_t)a[0] * b[2]) >> IMU_Q;
+    p[2]       = ((int64_t)a[0] * b[1] - (int64_t)a[1] * b[0]) >> IMU_Q;
+    p[1]       = ty;
+    p[0]       = tx;
+}
+
+/**
+ * @brief Rotate a Q30 3D vector by the inverse of a Q30 quaternion, like mathRotateVectorByInverseOfQuaternion()
+ *
+ * @param pout The Q30 output of the antirotation. This may be p
+ * @param q The Q30 wxyz quaternion opposite of the rotation
+ * @param p The Q30 vector to antirotate
+ */
+static void imuRotateVectorByInverseOfQuaternion(int32_t* pout, const int32_t* q, const int32_t* p)
+{
+    // return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+    int32_t iqo[3];
+    imuCrossProduct(iqo, p, q + 1 /*.xyz*/);
+    iqo[0] += imuMulQ30(q[0], p[0]);
+    iqo[1] += imuMulQ30(q[0], p[1]);
+    iqo[2] += imuMulQ30(q[0], p[2]);
+    int32_t ret[3];
+    imuCrossProduct(ret, iqo, q + 1 /*.xyz*/);
+    pout[0] = (int64_t)ret[0] * 2 + p[0];
+    pout[1] = (int64_t)ret[1] * 2 + p[1];
+    pout[2] = (int64_t)ret[2] * 2 + p[2];
+}
+
+//==============================================================================
+// Functions
+//==============================================================================
+
+/**
+ * @brief Reset the fixed point fusion state and scale it to an output data rate
+ *
+ * @param ld The IMU data. The fusion state is cleared, everything else is kept
+ * @param odrHz The IMU's output data rate, in Hz
+ */
+void imuFusionReset(LSM6DSLData* ld, float odrHz)
+{
+    // The tuning constants are per sample at 208 Hz. Scale them by the sample period, so they act the same over time
+    double perSample208 = 208.0 / odrHz;
+
+    ld->gyroScale       = GYRO_RAD_PER_COUNT_SEC / odrHz * (1LL << 44) + 0.5;
+    ld->biasDrift       = GYRO_BIAS_DRIFT_208 / GYRO_SCALE_208 * 65536 * perSample208 + 0.5;
+    ld->correctiveForce = CORRECTIVE_FORCE_208 * IMU_ONE * perSample208 + 0.5;
+
+    memset(ld->iqQuat, 0, sizeof(ld->iqQuat));
+    memset(ld->iqQuatLast, 0, sizeof(ld->iqQuatLast));
+    memset(ld->ivLastAccelUp, 0, sizeof(ld->ivLastAccelUp));
+    memset(ld->ivCorrectLast, 0, sizeof(ld->ivCorrectLast));
+    ld->iqQuat[0]     = IMU_ONE;
+    ld->iqQuatLast[0] = IMU_ONE;
+    ld->sampCount     = 0;
+}
+
+/**
+ * @brief Set the fixed point gyro bias from ::LSM6DSLData.fvBias, after it's loaded or calibrated
+ *
+ * @param ld The IMU data
+ */
+void imuFusionBiasFromFloat(LSM6DSLData* ld)
+{
+    ld->iBias[0] = ld->fvBias[0] * (65536.0f / GYRO_SCALE_208);
+    ld->iBias[1] = ld->fvBias[1] * (65536.0f / GYRO_SCALE_208);
+    ld->iBias[2] = ld->fvBias[2] * (65536.0f / GYRO_SCALE_208);
+}
+
+
+/**
+ * @brief Fuse one gyro and accelerometer sample into the fixed point orientation
+ *
+ * @param ld The IMU data
+ * @param euler_deltas Three raw gyro values read from the FIFO
+ * @param accel_data Three raw accelerometer values read from the FIFO
+ */
+void imuFusionSample(LSM6DSLData* ld, const int16_t* euler_deltas, const int16_t* accel_data)
+{
+    // STEP 3:  Integrate gyro values into a quaternion.
+    // This step is validated by working with just one axis at a time
+    // then apply a coordinate frame to ld->fqQuat and validate that it is
+    // correct.
+    // The bias is in raw counts, so it's the same at any ODR. Counts (Q16) times the scale (Q44) is Q60 radians, and
+    // shifting by 31 gives half of the angle in Q30.
+    int32_t halfAngles[3] = {
+        (((int64_t)-euler_deltas[0] * 65536 + ld->iBias[0]) * ld->gyroScale) >> (16 + 44 - IMU_Q + 1),
+        (((int64_t)euler_deltas[1] * 65536 + ld->iBias[1]) * ld->gyroScale) >> (16 + 44 - IMU_Q + 1),
+        (((int64_t)-euler_deltas[2] * 65536 + ld->iBias[2]) * ld->gyroScale) >> (16 + 44 - IMU_Q + 1),
+    };
+
+    imuSmallEulerToQuat(ld->iqQuatLast, halfAngles);
+    imuQuatApply(ld->iqQuat, ld->iqQuat, ld->iqQuatLast);
+
+    // STEP 4: Validate yor values by doing 4 90 degree turns
+    //  across multiple axes.
+    // i.e. rotate controller down, clockwise from top, up, counter-clockwise.
+    // while investigating quaternion.  It should return to identity.
+
+    // STEP 6: Determine our "error" based on accelerometer.
+    // NOTE: This step could be done on the inner loop if you want, and done over
+    // every accelerometer cycle, or it can be done on the outside, every few cycles.
+    // all that realy matters is that it is done periodically.
+
+    // STEP 6A: Examine vectors.  Generally speaking, we want an "up" vector, not a gravity vector.
+    // this is "up" in the controller's point of view.
+    int32_t accel_up[3] = {-accel_data[0], accel_data[1], -accel_data[2]};
+
+    uint32_t accel_magsq = (uint32_t)(accel_up[0] * accel_up[0]) + (uint32_t)(accel_up[1] * accel_up[1])
+                           + (uint32_t)(accel_up[2] * accel_up[2]);
+    if (0 == accel_magsq)
+    {
+        // No idea which way is up
+        return;
+    }
+
+    // Normalize to Q30. |accel_up| <= accel_mag, so this can't overflow
+    int32_t accel_inverse_mag = IMU_ONE / imuIsqrt(accel_magsq);
+    accel_up[0] *= accel_inverse_mag;
+    accel_up[1] *= accel_inverse_mag;
+    accel_up[2] *= accel_inverse_mag;
+    memcpy(ld->ivLastAccelUp, accel_up, sizeof(ld->ivLastAccelUp));
+
+    if (ld->sampCount++ == 0)
+    {
+        // set fqQuat to be the rotation to go from our "up" from the
+        // accelerometer to the nominal "up". This only happens once, so do it in floating point.
+        float ideal_up[3] = {0, 1, 0};
+        float fAccelUp[3] = {accel_up[0] * (1.0f / IMU_ONE), accel_up[1] * (1.0f / IMU_ONE),
+                             accel_up[2] * (1.0f / IMU_ONE)};
+        float qInit[4];
+        mathQuatFromTwoVectors(qInit, ideal_up, fAccelUp);
+        ld->iqQuat[0] = qInit[0] * IMU_ONE;
+        ld->iqQuat[1] = qInit[1] * IMU_ONE;
+        ld->iqQuat[2] = qInit[2] * IMU_ONE;
+        ld->iqQuat[3] = qInit[3] * IMU_ONE;
+    }
+    else
+    {
+        // Step 6B: Next, compute what we think "up" should be from our point of view.  We will use +Y Up.
+        int32_t what_we_think_is_up[3] = {0, IMU_ONE, 0};
+        imuRotateVectorByInverseOfQuaternion(what_we_think_is_up, ld->iqQuat, what_we_think_is_up);
+
+        // Step 6C: Next, we determine how far off we are.  This will tell us our error.
+        int32_t corrective_quaternion[4];
+
+        // TRICKY: The ouput of this is actually the axis of rotation, which is ironically
+        // in vector-form the same as a quaternion.  So we can write directly into the quat.
+        imuCrossProduct(corrective_quaternion + 1, accel_up, what_we_think_is_up);
+
+        // Now, we apply this in step 7.
+
+        // First, we can compute what the drift values of our axes are, to anti-drift them.
+        // If you do only this, you will always end up in an unstable oscillation.
+        memcpy(ld->ivCorrectLast, corrective_quaternion + 1, sizeof(ld->ivCorrectLast));
+
+        // XXX TODO: We need to multiply by amount the accelerometer gives us assurance.
+        // The square root is Q15, so shift the Q16 product back down by 15
+        ld->iBias[0] += ((int64_t)imuSignedSqrt(corrective_quaternion[1]) * ld->biasDrift) >> 15;
+        ld->iBias[1] += ((int64_t)imuSignedSqrt(corrective_quaternion[2]) * ld->biasDrift) >> 15;
+        ld->iBias[2] += ((int64_t)imuSignedSqrt(corrective_quaternion[3]) * ld->biasDrift) >> 15;
+
+        // Second, we can apply a very small corrective tug.  This helps prevent oscillation
+        // about the correct answer.  This acts sort of like a P term to a PID loop.
+        // This is actually the **primary**, or fastest responding thing.
+        corrective_quaternion[1] = imuMulQ30(corrective_quaternion[1], ld->correctiveForce);
+        corrective_quaternion[2] = imuMulQ30(corrective_quaternion[2], ld->correctiveForce);
+        corrective_quaternion[3] = imuMulQ30(corrective_quaternion[3], ld->correctiveForce);
+
+        // x^2+y^2+z^2+q^2 -> ALGEBRA! -> sqrt( 1-x^2-y^2-z^2 ) = w
+        // The tug is tiny, so sqrt(1 - a) is 1 - a / 2 to well within Q30 precision
+        corrective_quaternion[0] = IMU_ONE
+                                   - (imuMulQ30(corrective_quaternion[1], corrective_quaternion[1])
+                                      + imuMulQ30(corrective_quaternion[2], corrective_quaternion[2])
+                                      + imuMulQ30(corrective_quaternion[3], corrective_quaternion[3]))
+                                         / 2;
+
+        imuQuatApply(ld->iqQuat, ld->iqQuat, corrective_quaternion);
+    }
+}
+
+/**
+ * @brief Normalize the fixed point orientation after a batch of samples, then publish it and the other fusion state as
+ * floats
+ *
+ * @param ld The IMU data
+ */
+void imuFusionEndBatch(LSM6DSLData* ld)
+{
+    // STEP 5: Normalize the quat once per batch. In fixed point, rounding errors add up faster than in floating point,
+    // but since the quat only drifts a tiny bit per batch, a single Newton-Raphson step from 1 is enough. It only needs
+    // a real normalization if something went very wrong.
+    int32_t* qRot  = ld->iqQuat;
+    int64_t qmagsq = ((int64_t)qRot[0] * qRot[0] + (int64_t)qRot[1] * qRot[1] + (int64_t)qRot[2] * qRot[2]
+                      + (int64_t)qRot[3] * qRot[3])
+                     >> IMU_Q;
+    if (qmagsq > (IMU_ONE * 105LL) / 100 || qmagsq < (IMU_ONE * 95LL) / 100)
+    {
+        float fqRot[4] = {qRot[0], qRot[1], qRot[2], qRot[3]};
+        mathQuatNormalize(fqRot, fqRot);
+        qRot[0] = fqRot[0] * IMU_ONE;
+        qRot[1] = fqRot[1] * IMU_ONE;
+        qRot[2] = fqRot[2] * IMU_ONE;
+        qRot[3] = fqRot[3] * IMU_ONE;
+    }
+    else
+    {
+        // 1 / sqrt(m) ~= (3 - m) / 2 when m is close to 1
+        int32_t qScale = (3LL * IMU_ONE - qmagsq) / 2;
+        qRot[0]        = imuMulQ30(qRot[0], qScale);
+        qRot[1]        = imuMulQ30(qRot[1], qScale);
+        qRot[2]        = imuMulQ30(qRot[2], qScale);
+        qRot[3]        = imuMulQ30(qRot[3], qScale);
+    }
+
+    // Publish the floating point state for everyone else
+    for (int i = 0; i < 4; i++)
+    {
+        ld->fqQuat[i]     = qRot[i] * (1.0f / IMU_ONE);
+        ld->fqQuatLast[i] = ld->iqQuatLast[i] * (1.0f / IMU_ONE);
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        ld->fvLastAccelRaw[i] = ld->ivLastAccelUp[i] * (1.0f / IMU_ONE);
+        ld->fCorrectLast[i]   = ld->ivCorrectLast[i] * (1.0f / IMU_ONE);
+        ld->fvBias[i]         = ld->iBias[i] * (GYRO_SCALE_208 / 65536.0f);
+    }
+}
@@ -0,0 +1,63 @@
+/*! \file imuFusion.h
+ *
+ * \section imuFusion_design Design Philosophy
+ *
+ * This is the fixed point sensor fusion behind accelIntegrate(). It doesn't touch the I2C bus or any other hardware, so
+ * it can also be built on a computer. tools/imu_replay uses it to compare the fixed point fusion against the floating
+ * point fusion it replaced.
+ *
+ * Every tuning constant is given per second, or per sample at 208 Hz, and is scaled to the output data rate by
+ * imuFusionReset(). This way the fusion behaves the same over time at every rate.
+ *
+ * \section imuFusion_usage Usage
+ *
+ * Call imuFusionReset() when the IMU is reset, then imuFusionBiasFromFloat() after ::LSM6DSLData.fvBias is loaded.
+ * Call imuFusionSample() for each sample read from the FIFO, then imuFusionEndBatch() after each batch of samples.
+ */
+
+#ifndef _IMU_FUSION_H_
+#define _IMU_FUSION_H_
+
+//==============================================================================
+// Includes
+//==============================================================================
+
+#include <stdint.h>
+
+#include "hdw-imu.h"
+
+//==============================================================================
+// Defines
+//==============================================================================
+
+/// Fixed point quaternions and vectors are Q30, so 1.0 is 1 << 30
+#define IMU_Q   30
+#define IMU_ONE (1 << IMU_Q)
+
+// 2000 dps full-scale
+// 32768 is full-scale
+// convert to radians. ( 2000.0f / 32768.0f * 2.0 * 3.14159f / 180.0f );
+// Measured = 560,000 counts per scale (Measured by looking at sum)
+// Testing -> 3.14159 * 2.0 / 566000;
+// The 0.5625 is a fudge factor. XXX TODO: Investigate.
+#define GYRO_RAD_PER_COUNT_SEC (2000.0 / 32768.0 * 2.0 * 3.14159 / 180.0 * 0.5625)
+
+/// Radians per raw gyro count for one sample at 208 Hz, the unit ::LSM6DSLData.fvBias is in
+#define GYRO_SCALE_208 (GYRO_RAD_PER_COUNT_SEC / 208.0)
+
+/// How far the gyro bias drifts towards the accelerometer per sample at 208 Hz, in radians per sample at 208 Hz
+#define GYRO_BIAS_DRIFT_208 0.0000002
+
+/// How hard the accelerometer tugs the orientation towards "up" per sample at 208 Hz
+#define CORRECTIVE_FORCE_208 0.0005
+
+//==============================================================================
+// Function Prototypes
+//==============================================================================
+
+void imuFusionReset(LSM6DSLData* ld, float odrHz);
+void imuFusionBiasFromFloat(LSM6DSLData* ld);
+void imuFusionSample(LSM6DSLData* ld, const int16_t* euler_deltas, const int16_t* accel_data);
+void imuFusionEndBatch(LSM6DSLData* ld);
+
+#endif
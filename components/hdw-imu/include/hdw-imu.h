@@ -10,6 +10,10 @@
  * we run the IMU at 208 Hz, and we use the hardware FIFO built into the LSM6DSL to queue up events.  Then, every
  * frame, we empty out the FIFO.
  *
+ * The ESP32-S2 has no FPU, so the fusion is done in fixed point. Each batch of samples read from the FIFO is integrated
+ * into a Q30 quaternion, which is renormalized once at the end of the batch and then copied into
+ * ::LSM6DSLData.fqQuat as floats.
+ *
  * \section imu_usage Usage
  *
  * The core system will call initAccelerometer() and deInitAccelerometer() appropriately. And you can at any point
@@ -17,6 +21,9 @@
  *
  * accelSetRegistersAndReset() \b must be called when entering a Swadge mode that uses the IMU.
  *
+ * accelSetOutputDataRate() may be called to change how often the IMU samples, which defaults to 208 Hz. A lower rate
+ * spends less time on sensor fusion, while a higher rate tracks fast motion more closely. This resets the IMU.
+ *
  * accelIntegrate() \b should be called periodically. This can be done either in the mode's main loop or in the
  * background draw callback. If this is called from the background draw callback, make sure to only call it once per
  * frame, since multiple callbacks are called per-frame.
@@ -51,6 +58,21 @@
 
 #include "quaternions.h"
 
+/**
+ * @brief Output data rates for the IMU's accelerometer, gyroscope, and FIFO. The values are the LSM6DSL's ODR codes.
+ */
+typedef enum
+{
+    IMU_ODR_12_5_HZ = 1, ///< 12.5 Hz
+    IMU_ODR_26_HZ   = 2, ///< 26 Hz
+    IMU_ODR_52_HZ   = 3, ///< 52 Hz
+    IMU_ODR_104_HZ  = 4, ///< 104 Hz
+    IMU_ODR_208_HZ  = 5, ///< 208 Hz, the default
+    IMU_ODR_416_HZ  = 6, ///< 416 Hz
+    IMU_ODR_833_HZ  = 7, ///< 833 Hz
+    IMU_ODR_1660_HZ = 8, ///< 1.66 kHz
+} imuOdr_t;
+
 typedef struct
 {
     int32_t temp;
@@ -65,9 +87,20 @@ typedef struct
     // The last raw accelerometer (NOT FUSED)
     float fvLastAccelRaw[3];
 
-    // Bias for all of the euler angles.
+    // Bias for all of the euler angles, in radians per sample at 208 Hz. This is what's saved to NVS.
     float fvBias[3];
 
+    // Fixed point fusion state. fqQuat and fvBias are updated from these after every batch.
+    int32_t iqQuat[4];        // Absolute, Q30
+    int32_t iqQuatLast[4];    // Delta, Q30
+    int32_t ivLastAccelUp[3]; // The last normalized accelerometer "up", Q30
+    int32_t ivCorrectLast[3]; // The last correction towards "up", Q30
+    int32_t iBias[3];         // Bias in raw gyro counts, Q16
+    int32_t gyroScale;        // Radians per raw gyro count at the current ODR, Q44
+    int32_t biasDrift;        // How far the bias drifts towards the accelerometer per sample at the current ODR, Q16
+    int32_t correctiveForce;  // How hard the accelerometer tugs per sample at the current ODR, Q30
+    imuOdr_t odr;             // The current output data rate
+
     // Used for calibration
     float fvDeviation[3];
     float fvAverage[3];
@@ -94,5 +127,6 @@ esp_err_t accelPerformCal(void);
 esp_err_t accelGetSteeringAngleDegrees(int16_t* xcomp, int16_t* ycomp);
 float accelGetStdDevInCal(void);
 void accelSetRegistersAndReset(void);
+esp_err_t accelSetOutputDataRate(imuOdr_t odr);
 
 #endif
@@ -3,10 +3,13 @@
 //==============================================================================
 
 #include <driver/rmt_tx.h>
+#include <esp_attr.h>
 #include <esp_rom_gpio.h>
 #include <soc/gpio_sig_map.h>
 #include <string.h>
 #include <driver/gpio.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 
 #include "led_strip_encoder.h"
 #include "hdw-led.h"
@@ -25,12 +28,52 @@
 static rmt_channel_handle_t led_chan    = NULL;
 static rmt_encoder_handle_t led_encoder = NULL;
 static uint8_t ledBrightness            = 0;
-static led_t localLeds[CONFIG_NUM_LEDS] = {0};
+
+/// Two frames, one being transmitted by the RMT while the other is written
+static led_t ledFrames[2][CONFIG_NUM_LEDS] = {0};
+/// The index of the frame which was last transmitted
+static uint8_t ledFront = 0;
+/// The number of LEDs in the last transmitted frame, or 0 to force the next transmit
+static uint8_t ledFrontCount = 0;
+
+/// The number of frames given to the RMT
+static uint32_t ledTxQueued = 0;
+/// The number of frames the RMT finished transmitting
+static volatile uint32_t ledTxDone = 0;
+
+/// The LED lock, held by setLeds(), getLedState(), and ledLock(). LEDs may be set from the main loop and timer callbacks
+static SemaphoreHandle_t ledMutex = NULL;
+/// The memory for ::ledMutex, so it is never allocated or freed
+static StaticSemaphore_t ledMutexBuf;
+
+//==============================================================================
+// Function Declarations
+//==============================================================================
+
+static bool IRAM_ATTR led_on_trans_done_callback(rmt_channel_handle_t tx_chan, const rmt_tx_done_event_data_t* edata,
+                                                 void* user_ctx);
+static esp_err_t setLedsLocked(led_t* leds, uint8_t numLeds);
+static void ledCreateMutex(void);
 
 //==============================================================================
 // Functions
 //==============================================================================
 
+/**
+ * @brief Callback from the RMT ISR when a frame has been transmitted, so its buffer may be written again
+ *
+ * @param tx_chan The RMT channel
+ * @param edata Unused
+ * @param user_ctx Unused
+ * @return false, no higher priority task was woken
+ */
+static bool IRAM_ATTR led_on_trans_done_callback(rmt_channel_handle_t tx_chan, const rmt_tx_done_event_data_t* edata,
+                                                 void* user_ctx)
+{
+    ledTxDone++;
+    return false;
+}
+
 /**
  * @brief Initialize the RGB LEDs
  *
@@ -41,6 +84,7 @@ static led_t localLeds[CONFIG_NUM_LEDS] = {0};
  */
 esp_err_t initLeds(gpio_num_t gpio, gpio_num_t gpioAlt, uint8_t brightness)
 {
+    ledCreateMutex();
     setLedBrightness(brightness);
 
     rmt_tx_channel_config_t tx_chan_config = {
@@ -57,6 +101,17 @@ esp_err_t initLeds(gpio_num_t gpio, gpio_num_t gpioAlt, uint8_t brightness)
     };
     ESP_ERROR_CHECK(rmt_new_led_strip_encoder(&encoder_config, &led_encoder));
 
+    // Track when frames are done so their buffers can be reused
+    rmt_tx_event_callbacks_t cbs = {
+        .on_trans_done = led_on_trans_done_callback,
+    };
+    ESP_ERROR_CHECK(rmt_tx_register_event_callbacks(led_chan, &cbs, NULL));
+
+    // Make sure the first frame is transmitted
+    ledFrontCount = 0;
+    ledTxQueued   = 0;
+    ledTxDone     = 0;
+
     ESP_ERROR_CHECK(rmt_enable(led_chan));
 
     if (GPIO_NUM_NC != gpioAlt)
@@ -108,7 +163,7 @@ void setLedBrightness(uint8_t brightness)
 }
 
 /**
- * @brief Set the RGB LEDs to the given values
+ * @brief Set the RGB LEDs to the given values. If the LEDs would not change, nothing is transmitted.
  *
  * @param leds A pointer to an array of ::led_t structs to set the LEDs to. The array must have at least numLeds
  * elements
@@ -116,6 +171,21 @@ void setLedBrightness(uint8_t brightness)
  * @return ESP_OK if the LEDs were set, or a nonzero value if they did were not
  */
 esp_err_t setLeds(led_t* leds, uint8_t numLeds)
+{
+    ledLock();
+    esp_err_t err = setLedsLocked(leds, numLeds);
+    ledUnlock();
+    return err;
+}
+
+/**
+ * @brief Set the RGB LEDs to the given values while holding the LED lock
+ *
+ * @param leds A pointer to an array of ::led_t structs to set the LEDs to
+ * @param numLeds The number of LEDs to set
+ * @return ESP_OK if the LEDs were set, or a nonzero value if they did were not
+ */
+static esp_err_t setLedsLocked(led_t* leds, uint8_t numLeds)
 {
     rmt_transmit_config_t tx_config = {
         .loop_count = 0, // no transfer loop
@@ -127,16 +197,40 @@ esp_err_t setLeds(led_t* leds, uint8_t numLeds)
         numLeds = CONFIG_NUM_LEDS;
     }
 
-    // Fill a local copy of LEDs with brightness applied
+    // Build the new frame with brightness applied. LEDs past numLeds keep their current values
+    led_t* front = ledFrames[ledFront];
+    led_t frame[CONFIG_NUM_LEDS];
+    memcpy(frame, front, sizeof(frame));
     for (uint8_t i = 0; i < numLeds; i++)
     {
-        localLeds[i].r = (leds[i].r >> ledBrightness);
-        localLeds[i].g = (leds[i].g >> ledBrightness);
-        localLeds[i].b = (leds[i].b >> ledBrightness);
+        frame[i].r = (leds[i].r >> ledBrightness);
+        frame[i].g = (leds[i].g >> ledBrightness);
+        frame[i].b = (leds[i].b >> ledBrightness);
+    }
+
+    // Don't transmit anything if the LEDs already show this frame
+    if (numLeds == ledFrontCount && 0 == memcmp(frame, front, numLeds * sizeof(led_t)))
+    {
+        return ESP_OK;
+    }
+
+    // The back frame may still be queued from the transmit before last. If so, wait for it to finish
+    if (ledTxQueued - ledTxDone > 1)
+    {
+        rmt_tx_wait_all_done(led_chan, -1);
     }
 
-    // Write RGB values to LEDs
-    return rmt_transmit(led_chan, led_encoder, (uint8_t*)localLeds, numLeds * sizeof(led_t), &tx_config);
+    // Write RGB values to LEDs from the back frame, which then becomes the front
+    uint8_t back = ledFront ^ 1;
+    memcpy(ledFrames[back], frame, sizeof(frame));
+    esp_err_t err = rmt_transmit(led_chan, led_encoder, (uint8_t*)ledFrames[back], numLeds * sizeof(led_t), &tx_config);
+    if (ESP_OK == err)
+    {
+        ledFront      = back;
+        ledFrontCount = numLeds;
+        ledTxQueued++;
+    }
+    return err;
 }
 
 /**
@@ -155,13 +249,45 @@ uint8_t getLedState(led_t* leds, uint8_t numLeds)
             numLeds = CONFIG_NUM_LEDS;
         }
 
-        memcpy(leds, localLeds, sizeof(led_t) * numLeds);
+        ledLock();
+        memcpy(leds, ledFrames[ledFront], sizeof(led_t) * numLeds);
+        ledUnlock();
         return numLeds;
     }
 
     return 0;
 }
 
+/**
+ * @brief Create the LED lock, if it hasn't been created yet. This is first called by initLeds(), before any task could
+ * set the LEDs
+ */
+static void ledCreateMutex(void)
+{
+    if (NULL == ledMutex)
+    {
+        ledMutex = xSemaphoreCreateRecursiveMutexStatic(&ledMutexBuf);
+    }
+}
+
+/**
+ * @brief Take the LED lock, waiting until no other task is setting the LEDs. The lock is recursive, so each call must be
+ * matched by a call to ledUnlock()
+ */
+void ledLock(void)
+{
+    ledCreateMutex();
+    xSemaphoreTakeRecursive(ledMutex, portMAX_DELAY);
+}
+
+/**
+ * @brief Release the LED lock taken by ledLock()
+ */
+void ledUnlock(void)
+{
+    xSemaphoreGiveRecursive(ledMutex);
+}
+
 /**
  * @brief Wait until any pending LED transactions are finished, then return
  */
@@ -17,9 +17,17 @@
  *
  * You don't need to call initLeds() or deinitLeds(). The system does so at the appropriate time.
  *
- * You should call setLeds() any time you want to set the LEDs. There is no buffer, so the LEDs are immediately set to
- * the values given. setLeds() takes a pointer to an array of ::led_t as an argument. These structs each have a red,
- * green, and blue field.
+ * You should call setLeds() any time you want to set the LEDs. The LEDs are immediately set to the values given.
+ * setLeds() takes a pointer to an array of ::led_t as an argument. These structs each have a red, green, and blue field.
+ *
+ * setLeds() double buffers frames so a new frame can be written while the previous one is still being transmitted. If
+ * the LEDs would not change, nothing is transmitted, so it is cheap to call setLeds() every frame with the same values.
+ *
+ * To play an animation which advances on its own timer, see ledAnimation.h.
+ *
+ * setLeds() may be called from any task. It holds the LED lock while it builds and queues a frame. ledLock() and
+ * ledUnlock() take the same lock, for code which must not run at the same time as a frame being set, like stopping an
+ * animation.
  *
  * setLedBrightness() may be called to adjust overall LED brightness.
  * Brightness is adjusted per-color-channel, so dimming may produce different colors.
@@ -72,5 +80,7 @@ esp_err_t setLeds(led_t* leds, uint8_t numLeds);
 void setLedBrightness(uint8_t brightness);
 uint8_t getLedState(led_t* leds, uint8_t numLeds);
 void flushLeds(void);
+void ledLock(void);
+void ledUnlock(void);
 
 #endif
\ No newline at end of file
@@ -2,6 +2,7 @@
 // Includes
 //==============================================================================
 
+#include <esp_attr.h>
 #include <esp_adc/adc_continuous.h>
 #include "hdw-mic.h"
 
@@ -11,10 +12,36 @@
 
 static adc_continuous_handle_t adc_handle = NULL;
 
+/// The number of samples dropped because the ADC's pool was full
+static volatile uint32_t micOverruns = 0;
+
+//==============================================================================
+// Function Declarations
+//==============================================================================
+
+static bool IRAM_ATTR mic_on_pool_ovf_callback(adc_continuous_handle_t handle, const adc_continuous_evt_data_t* edata,
+                                               void* user_data);
+
 //==============================================================================
 // Functions
 //==============================================================================
 
+/**
+ * @brief Callback from the ADC ISR when a conversion frame was dropped because loopMic() wasn't called often enough
+ * to empty the pool
+ *
+ * @param handle The ADC handle
+ * @param edata Unused
+ * @param user_data Unused
+ * @return false, no higher priority task was woken
+ */
+static bool IRAM_ATTR mic_on_pool_ovf_callback(adc_continuous_handle_t handle, const adc_continuous_evt_data_t* edata,
+                                               void* user_data)
+{
+    micOverruns += ADC_READ_LEN / SOC_ADC_DIGI_RESULT_BYTES;
+    return false;
+}
+
 /**
  * @brief Initialize the ADC which continuously samples the microphone
  *
@@ -74,6 +101,12 @@ void initMic(gpio_num_t gpio)
             dig_cfg.pattern_num = 1;
             dig_cfg.adc_pattern = adc_pattern;
             ESP_ERROR_CHECK(adc_continuous_config(adc_handle, &dig_cfg));
+
+            // Count samples which are dropped when the main loop falls behind
+            adc_continuous_evt_cbs_t cbs = {
+                .on_pool_ovf = mic_on_pool_ovf_callback,
+            };
+            ESP_ERROR_CHECK(adc_continuous_register_event_callbacks(adc_handle, &cbs, NULL));
         }
     }
 }
@@ -124,6 +157,17 @@ uint32_t loopMic(uint16_t* outSamples, uint32_t outSamplesMax)
     return 0;
 }
 
+/**
+ * @brief Get the number of samples the ADC dropped because loopMic() was not called often enough. This keeps counting
+ * across initMic() and deinitMic()
+ *
+ * @return The number of dropped samples
+ */
+uint32_t micGetOverruns(void)
+{
+    return micOverruns;
+}
+
 /**
  * @brief Stop sampling the microphone's ADC
  */
@@ -35,6 +35,10 @@
  *
  * If ::swadgeMode_t.fnAudioCallback is left NULL, then the microphone will not be initialized or sampled.
  *
+ * The system filters the samples and stores them in a ring buffer before calling ::swadgeMode_t.fnAudioCallback. Other
+ * consumers can read from that ring too, see micRing.h. If loopMic() is not called often enough, the ADC drops samples,
+ * which are counted by micGetOverruns().
+ *
  * \section mic_example Example
  *
  * \code{.c}
@@ -92,6 +96,7 @@
 void initMic(gpio_num_t gpio);
 void startMic(void);
 uint32_t loopMic(uint16_t* outSamples, uint32_t outSamplesMax);
+uint32_t micGetOverruns(void);
 void stopMic(void);
 void deinitMic(void);
 
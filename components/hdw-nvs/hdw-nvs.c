@@ -2,8 +2,13 @@
 // Includes
 //==============================================================================
 
+#include <string.h>
+#include <inttypes.h>
+
 #include <esp_err.h>
 #include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
 #include <nvs_flash.h>
 #include <nvs.h>
 
@@ -12,6 +17,51 @@
     #include "hdw-bzr.h"
 #endif
 
+//==============================================================================
+// Enums
+//==============================================================================
+
+/**
+ * @brief The kind of write staged in a batch
+ */
+typedef enum
+{
+    NVS_BATCH_WRITE_32,   ///< Write a 32 bit value
+    NVS_BATCH_WRITE_BLOB, ///< Write a blob
+    NVS_BATCH_ERASE,      ///< Erase a key
+} nvsBatchOp_t;
+
+//==============================================================================
+// Structs
+//==============================================================================
+
+/**
+ * @brief A write staged in a batch, with a copy of its blob allocated after it
+ */
+struct nvsBatchEntry
+{
+    nvsBatchEntry_t* next;           ///< The next staged write, or NULL
+    char key[NVS_KEY_NAME_MAX_SIZE]; ///< The key to write
+    nvsBatchOp_t op;                 ///< The kind of write
+    int32_t val;                     ///< The value for ::NVS_BATCH_WRITE_32
+    size_t length;                   ///< The length of the blob for ::NVS_BATCH_WRITE_BLOB
+    uint8_t blob[];                  ///< The blob for ::NVS_BATCH_WRITE_BLOB
+};
+
+//==============================================================================
+// Function Prototypes
+//==============================================================================
+
+static nvsBatchEntry_t* nvsBatchStage(nvsBatch_t* batch, nvsBatchOp_t op, const char* key, size_t length);
+static void nvsRecordTiming(int64_t startUs, uint16_t numWrites);
+
+//==============================================================================
+// Variables
+//==============================================================================
+
+/// The time spent writing to NVS
+static nvsTiming_t nvsTiming = {0};
+
 //==============================================================================
 // Functions
 //==============================================================================
@@ -228,7 +278,8 @@ bool writeNamespaceNvs32(const char* namespace, const char* key, int32_t val)
 #if defined(CONFIG_SOUND_OUTPUT_BUZZER)
     bool bzrPaused = bzrPause();
 #endif
-    bool retVal = false;
+    bool retVal     = false;
+    int64_t startUs = esp_timer_get_time();
 
     nvs_handle_t handle;
     esp_err_t openErr = nvs_open(namespace, NVS_READWRITE, &handle);
@@ -261,6 +312,7 @@ bool writeNamespaceNvs32(const char* namespace, const char* key, int32_t val)
 
             // Close the handle
             nvs_close(handle);
+            nvsRecordTiming(startUs, 1);
             break;
         }
         default:
@@ -399,7 +451,8 @@ bool writeNamespaceNvsBlob(const char* namespace, const char* key, const void* v
 #if defined(CONFIG_SOUND_OUTPUT_BUZZER)
     bool bzrPaused = bzrPause();
 #endif
-    bool retVal = false;
+    bool retVal     = false;
+    int64_t startUs = esp_timer_get_time();
 
     nvs_handle_t handle;
     esp_err_t openErr = nvs_open(namespace, NVS_READWRITE, &handle);
@@ -432,6 +485,7 @@ bool writeNamespaceNvsBlob(const char* namespace, const char* key, const void* v
 
             // Close the handle
             nvs_close(handle);
+            nvsRecordTiming(startUs, 1);
             break;
         }
         default:
@@ -479,7 +533,8 @@ bool eraseNamespaceNvsKey(const char* namespace, const char* key)
 #if defined(CONFIG_SOUND_OUTPUT_BUZZER)
     bool bzrPaused = bzrPause();
 #endif
-    bool retVal = false;
+    bool retVal     = false;
+    int64_t startUs = esp_timer_get_time();
 
     nvs_handle_t handle;
     esp_err_t openErr = nvs_open(namespace, NVS_READWRITE, &handle);
@@ -512,6 +567,7 @@ bool eraseNamespaceNvsKey(const char* namespace, const char* key)
 
             // Close the handle
             nvs_close(handle);
+            nvsRecordTiming(startUs, 1);
             break;
         }
         default:
@@ -655,4 +711,269 @@ bool nvsNamespaceInUse(const char* namespace)
     nvs_release_iterator(it);
 
     return (res == ESP_OK);
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Start a batch of writes to one namespace. The batch must be finished with nvsBatchCommit() or nvsBatchAbort()
+ *
+ * @param batch The batch to start
+ * @param namespace The NVS namespace to write to
+ * @return true if the batch was started, false if the namespace name is too long
+ */
+bool nvsBatchBegin(nvsBatch_t* batch, const char* namespace)
+{
+    memset(batch, 0, sizeof(nvsBatch_t));
+    if (strlen(namespace) >= sizeof(batch->namespace))
+    {
+        ESP_LOGE("NVS", "%s namespace %s is too long", __func__, namespace);
+        batch->failed = true;
+        return false;
+    }
+    strcpy(batch->namespace, namespace);
+    return true;
+}
+
+/**
+ * @brief Stage a 32 bit value to be written when the batch is committed
+ *
+ * @param batch The batch to stage the write in
+ * @param key The key for the value to write
+ * @param val The value to write
+ * @return true if the write was staged, false if it was not
+ */
+bool nvsBatchWrite32(nvsBatch_t* batch, const char* key, int32_t val)
+{
+    nvsBatchEntry_t* entry = nvsBatchStage(batch, NVS_BATCH_WRITE_32, key, 0);
+    if (NULL != entry)
+    {
+        entry->val = val;
+    }
+    return (NULL != entry);
+}
+
+/**
+ * @brief Stage a blob to be written when the batch is committed. The blob is copied, so it doesn't need to stay valid
+ *
+ * @param batch The batch to stage the write in
+ * @param key The key for the value to write
+ * @param value The blob value to write
+ * @param length The length of the blob
+ * @return true if the write was staged, false if it was not
+ */
+bool nvsBatchWriteBlob(nvsBatch_t* batch, const char* key, const void* value, size_t length)
+{
+    nvsBatchEntry_t* entry = nvsBatchStage(batch, NVS_BATCH_WRITE_BLOB, key, length);
+    if (NULL != entry)
+    {
+        memcpy(entry->blob, value, length);
+    }
+    return (NULL != entry);
+}
+
+/**
+ * @brief Stage a key to be erased when the batch is committed. Erasing a key which doesn't exist is not an error
+ *
+ * @param batch The batch to stage the erase in
+ * @param key The NVS key to be deleted
+ * @return true if the erase was staged, false if it was not
+ */
+bool nvsBatchErase(nvsBatch_t* batch, const char* key)
+{
+    return (NULL != nvsBatchStage(batch, NVS_BATCH_ERASE, key, 0));
+}
+
+/**
+ * @brief Commit a batch. This opens a handle once, applies every staged write in order, and commits once. The batch's
+ * memory is freed whether or not this succeeds.
+ *
+ * @param batch The batch to commit
+ * @return true if every staged write was committed, false if any write failed to stage or to commit
+ */
+bool nvsBatchCommit(nvsBatch_t* batch)
+{
+    if (batch->failed)
+    {
+        ESP_LOGE("NVS", "%s batch for %s had a staging error, nothing was written", __func__, batch->namespace);
+        nvsBatchAbort(batch);
+        return false;
+    }
+    else if (0 == batch->numWrites)
+    {
+        return true;
+    }
+
+#if defined(CONFIG_SOUND_OUTPUT_BUZZER)
+    bool bzrPaused = bzrPause();
+#endif
+    int64_t startUs = esp_timer_get_time();
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(batch->namespace, NVS_READWRITE, &handle);
+    if (ESP_OK == err)
+    {
+        for (nvsBatchEntry_t* entry = batch->first; NULL != entry && ESP_OK == err; entry = entry->next)
+        {
+            switch (entry->op)
+            {
+                case NVS_BATCH_WRITE_32:
+                {
+                    err = nvs_set_i32(handle, entry->key, entry->val);
+                    break;
+                }
+                case NVS_BATCH_WRITE_BLOB:
+                {
+                    err = nvs_set_blob(handle, entry->key, entry->blob, entry->length);
+                    break;
+                }
+                case NVS_BATCH_ERASE:
+                {
+                    err = nvs_erase_key(handle, entry->key);
+                    // Erasing a key which doesn't exist leaves NVS how the caller wanted it
+                    if (ESP_ERR_NVS_NOT_FOUND == err)
+                    {
+                        err = ESP_OK;
+                    }
+                    break;
+                }
+            }
+
+            if (ESP_OK != err)
+            {
+                ESP_LOGE("NVS", "%s err %s on %s", __func__, esp_err_to_name(err), entry->key);
+            }
+        }
+
+        // Commit NVS
+        if (ESP_OK == err)
+        {
+            err = nvs_commit(handle);
+        }
+
+        // Close the handle
+        nvs_close(handle);
+        nvsRecordTiming(startUs, batch->numWrites);
+    }
+    else
+    {
+        ESP_LOGE("NVS", "%s openErr %s", __func__, esp_err_to_name(err));
+    }
+
+#if defined(CONFIG_SOUND_OUTPUT_BUZZER)
+    // Resume the buzzer if it was paused
+    if (bzrPaused)
+    {
+        bzrResume();
+    }
+#endif
+
+    nvsBatchAbort(batch);
+    return (ESP_OK == err);
+}
+
+/**
+ * @brief Drop a batch's staged writes without writing anything, and free the batch's memory
+ *
+ * @param batch The batch to drop
+ */
+void nvsBatchAbort(nvsBatch_t* batch)
+{
+    nvsBatchEntry_t* entry = batch->first;
+    while (NULL != entry)
+    {
+        nvsBatchEntry_t* next = entry->next;
+        heap_caps_free(entry);
+        entry = next;
+    }
+    batch->first     = NULL;
+    batch->last      = NULL;
+    batch->numWrites = 0;
+}
+
+/**
+ * @brief Read the time spent writing to NVS
+ *
+ * @param outTiming The timing totals will be written to this memory
+ */
+void readNvsTiming(nvsTiming_t* outTiming)
+{
+    *outTiming = nvsTiming;
+}
+
+/**
+ * @brief Clear the time spent writing to NVS
+ */
+void resetNvsTiming(void)
+{
+    memset(&nvsTiming, 0, sizeof(nvsTiming));
+}
+
+/**
+ * @brief Allocate a staged write and add it to the end of a batch
+ *
+ * @param batch The batch to add the write to
+ * @param op The kind of write
+ * @param key The key to write
+ * @param length The length of the blob to copy into the write, or 0
+ * @return The staged write, or NULL if it couldn't be staged. If NULL, the batch won't be committed
+ */
+static nvsBatchEntry_t* nvsBatchStage(nvsBatch_t* batch, nvsBatchOp_t op, const char* key, size_t length)
+{
+    if (batch->failed)
+    {
+        return NULL;
+    }
+
+    nvsBatchEntry_t* entry = NULL;
+    if (strlen(key) >= sizeof(entry->key))
+    {
+        ESP_LOGE("NVS", "%s key %s is too long", __func__, key);
+    }
+    else if (NULL == (entry = heap_caps_calloc(1, sizeof(nvsBatchEntry_t) + length, MALLOC_CAP_8BIT)))
+    {
+        ESP_LOGE("NVS", "%s couldn't allocate %s", __func__, key);
+    }
+
+    if (NULL == entry)
+    {
+        batch->failed = true;
+        return NULL;
+    }
+
+    entry->op     = op;
+    entry->length = length;
+    strcpy(entry->key, key);
+
+    if (NULL == batch->last)
+    {
+        batch->first = entry;
+    }
+    else
+    {
+        batch->last->next = entry;
+    }
+    batch->last = entry;
+    batch->numWrites++;
+    return entry;
+}
+
+/**
+ * @brief Add a commit to the timing totals
+ *
+ * @param startUs The time the commit started, from esp_timer_get_time()
+ * @param numWrites The number of keys written or erased by the commit
+ */
+static void nvsRecordTiming(int64_t startUs, uint16_t numWrites)
+{
+    int64_t elapsedUs = esp_timer_get_time() - startUs;
+
+    nvsTiming.numCommits++;
+    nvsTiming.numWrites += numWrites;
+    nvsTiming.lastUs = elapsedUs;
+    nvsTiming.totalUs += elapsedUs;
+    if (elapsedUs > nvsTiming.maxUs)
+    {
+        nvsTiming.maxUs = elapsedUs;
+    }
+
+    ESP_LOGD("NVS", "Committed %" PRIu16 " write(s) in %" PRId64 "us", numWrites, elapsedUs);
+}
@@ -25,6 +25,21 @@
  *
  * readNvsStats() and readAllNvsEntryInfos() can be used to read metadata about NVS.
  *
+ * \section nvs_batch Batched Writes
+ *
+ * Each call to writeNvs32(), writeNvsBlob(), or eraseNvsKey() opens a handle, writes, and commits on its own. Saving
+ * many keys this way is slow and stalls the main loop. Instead, several writes to one namespace can be batched.
+ *
+ * nvsBatchBegin() starts a batch. nvsBatchWrite32(), nvsBatchWriteBlob(), and nvsBatchErase() stage writes in RAM, which
+ * don't touch NVS yet. nvsBatchCommit() opens a handle once, applies every staged write, and commits once.
+ * nvsBatchAbort() drops the staged writes without writing anything. Either one must be called to free the batch.
+ *
+ * If any write fails to stage, nvsBatchCommit() writes nothing and returns false. If NVS fails partway through a
+ * commit, the writes applied before the failure may remain.
+ *
+ * The time spent in each write and commit is measured. readNvsTiming() returns the totals, which show how long saving
+ * stalls the caller, and resetNvsTiming() clears them.
+ *
  * \section nvs_example Example
  *
  * \code{.c}
@@ -39,6 +54,17 @@
  *     }
  * }
  * \endcode
+ *
+ * \code{.c}
+ * nvsBatch_t batch;
+ * nvsBatchBegin(&batch, NVS_NAMESPACE_NAME);
+ * nvsBatchWrite32(&batch, "demo_level", level);
+ * nvsBatchWriteBlob(&batch, "demo_board", board, sizeof(board));
+ * if (false == nvsBatchCommit(&batch))
+ * {
+ *     printf("Couldn't save the game\n");
+ * }
+ * \endcode
  */
 
 #ifndef _NVS_MANAGER_H_
@@ -58,6 +84,37 @@
 #define NVS_KEY_NAME_MAX_SIZE  16        /*!< Maximal length of NVS key name (including null terminator) */
 #define NVS_NAMESPACE_NAME     "storage" /*!< The default namespace used for NVS */
 
+//==============================================================================
+// Structs
+//==============================================================================
+
+/// A write staged in an ::nvsBatch_t. This is private to hdw-nvs
+typedef struct nvsBatchEntry nvsBatchEntry_t;
+
+/**
+ * @brief A batch of writes to one namespace which are committed together
+ */
+typedef struct
+{
+    char namespace[NVS_KEY_NAME_MAX_SIZE]; ///< The namespace to write to
+    nvsBatchEntry_t* first;                ///< The first staged write, in the order they were staged
+    nvsBatchEntry_t* last;                 ///< The last staged write
+    uint16_t numWrites;                    ///< The number of staged writes
+    bool failed;                           ///< true if a write failed to stage, so the batch won't be committed
+} nvsBatch_t;
+
+/**
+ * @brief The time spent writing to NVS since boot, or since resetNvsTiming() was called
+ */
+typedef struct
+{
+    uint32_t numCommits; ///< The number of commits, counting each single write and each batch
+    uint32_t numWrites;  ///< The number of keys written or erased
+    int64_t lastUs;      ///< The length of the most recent commit, in microseconds
+    int64_t maxUs;       ///< The length of the longest commit, in microseconds
+    int64_t totalUs;     ///< The total length of all commits, in microseconds
+} nvsTiming_t;
+
 //==============================================================================
 // Function Prototypes
 //==============================================================================
@@ -80,4 +137,13 @@ bool readAllNvsEntryInfos(nvs_stats_t* outStats, nvs_entry_info_t* outEntryInfos
 bool readNamespaceNvsEntryInfos(const char* namespace, nvs_stats_t* outStats, nvs_entry_info_t* outEntryInfos,
                                 size_t* numEntryInfos);
 bool nvsNamespaceInUse(const char* namespace);
+
+bool nvsBatchBegin(nvsBatch_t* batch, const char* namespace);
+bool nvsBatchWrite32(nvsBatch_t* batch, const char* key, int32_t val);
+bool nvsBatchWriteBlob(nvsBatch_t* batch, const char* key, const void* value, size_t length);
+bool nvsBatchErase(nvsBatch_t* batch, const char* key);
+bool nvsBatchCommit(nvsBatch_t* batch);
+void nvsBatchAbort(nvsBatch_t* batch);
+void readNvsTiming(nvsTiming_t* outTiming);
+void resetNvsTiming(void);
 #endif
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <stdint.h>
+
+/// The type of the CPU's cycle counter
+typedef uint32_t esp_cpu_cycle_count_t;
+
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void);
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <stdlib.h>
+#include <stdio.h>
 
 /**
  * @brief Flags to indicate the capabilities of the various memory systems
@@ -99,4 +101,69 @@ void *heap_caps_realloc_dbg(void *ptr, size_t size, uint32_t caps, const char* f
 /** See above, but with function and line debugging */
 void heap_caps_free_dbg(void* ptr, const char* file, const char* func, int32_t line, const char* tag);
 
+/**
+ * @brief Get the total size of all the regions that have the given capabilities
+ *
+ * The emulator only has a budget for SPIRAM. Other capabilities return 0.
+ *
+ * @param caps Bitwise OR of MALLOC_CAP_* flags indicating the type of memory
+ * @return Total size in bytes
+ */
+size_t heap_caps_get_total_size(uint32_t caps);
+
+/**
+ * @brief Get the total free size of all the regions that have the given capabilities
+ *
+ * The emulator only has a budget for SPIRAM. Other capabilities return 0.
+ *
+ * @param caps Bitwise OR of MALLOC_CAP_* flags indicating the type of memory
+ * @return Amount of free bytes in the regions
+ */
+size_t heap_caps_get_free_size(uint32_t caps);
+
+/**
+ * @brief Get the largest free block of memory able to be allocated with the given capabilities.
+ *
+ * The emulator only has a budget for SPIRAM. Other capabilities return 0.
+ *
+ * @param caps Bitwise OR of MALLOC_CAP_* flags indicating the type of memory
+ * @return Size of the largest free block in bytes
+ */
+size_t heap_caps_get_largest_free_block(uint32_t caps);
+
+/// The most tags which memory usage is kept for
+#define HEAP_MAX_TAGS 2048
+
+/**
+ * @brief The memory allocated with one tag. Index 0 of each array is internal memory, index 1 is SPIRAM
+ */
+typedef struct
+{
+    const char* tag;    ///< The tag
+    int32_t idx;        ///< A unique number for this tag, less than ::HEAP_MAX_TAGS
+    uint32_t numAllocs; ///< The number of allocations made with this tag
+    uint32_t numFrees;  ///< The number of allocations with this tag which were freed
+    size_t used[2];     ///< The memory currently allocated with this tag
+    size_t peak[2];     ///< The most memory which was ever allocated with this tag at once
+} heapTagUsage_t;
+
+/**
+ * @brief The high-water marks of the memory allocated since resetHeapPeaks(). Index 0 of each array is internal memory,
+ * index 1 is SPIRAM
+ *
+ * The peak is split at the point where the least memory was allocated. When a Swadge mode switches, that's usually
+ * between the old mode's fnExitMode() and the new mode's fnEnterMode(), so each mode's peak can be told apart.
+ */
+typedef struct
+{
+    size_t beforeLow[2]; ///< The most memory allocated at once before the low point
+    size_t low[2];       ///< The least memory allocated at once
+    size_t afterLow[2];  ///< The most memory allocated at once after the low point
+} heapPeaks_t;
+
 void dumpAllocTable(void);
+void writeHeapProfile(FILE* out);
+void getHeapUsed(size_t* internalUsed, size_t* spiramUsed);
+void getHeapPeaks(heapPeaks_t* out);
+void resetHeapPeaks(void);
+bool iterateHeapTags(int32_t* idx, heapTagUsage_t* out);
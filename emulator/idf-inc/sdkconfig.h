@@ -0,0 +1,4 @@
+#pragma once
+
+// The ESP-IDF generates sdkconfig.h from the Kconfig options. The emulator defines the CONFIG_ options it needs in the
+// makefile instead, so this is empty. It lets firmware headers include "sdkconfig.h" when they test a CONFIG_ option.
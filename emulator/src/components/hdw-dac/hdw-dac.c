@@ -4,6 +4,7 @@
 
 #include <stddef.h>
 #include <string.h>
+#include <pthread.h>
 #include "hdw-dac.h"
 #include "hdw-dac_emu.h"
 
@@ -18,6 +19,17 @@
 fnDacCallback_t dacCb = NULL;
 static bool shdn      = false;
 
+/// The audio lock, held by the sound thread while calling ::dacCb and by dacLock()
+static pthread_mutex_t dacMutex;
+/// Initializes ::dacMutex once, whichever thread uses it first
+static pthread_once_t dacMutexOnce = PTHREAD_ONCE_INIT;
+
+//==============================================================================
+// Function Prototypes
+//==============================================================================
+
+static void dacCreateMutex(void);
+
 //==============================================================================
 // Functions
 //==============================================================================
@@ -70,6 +82,56 @@ void dacPoll(void)
     // In the emulator, that's handled in dacHandleSoundOutput() instead
 }
 
+/**
+ * @brief Get the number of DMA buffers which were filled with silence because the audio task did not generate samples
+ * in time
+ *
+ * @return Always 0. The emulator's sound thread requests samples directly, so there is no ring to underrun
+ */
+uint32_t dacGetUnderruns(void)
+{
+    return 0;
+}
+
+/**
+ * @brief Create the recursive audio lock
+ */
+static void dacCreateMutex(void)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&dacMutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+/**
+ * @brief Take the audio lock, waiting until the sound thread is done generating samples
+ */
+void dacLock(void)
+{
+    pthread_once(&dacMutexOnce, dacCreateMutex);
+    pthread_mutex_lock(&dacMutex);
+}
+
+/**
+ * @brief Release the audio lock taken by dacLock()
+ */
+void dacUnlock(void)
+{
+    pthread_mutex_unlock(&dacMutex);
+}
+
+/**
+ * @brief Get the time between a sample being generated by the ::fnDacCallback_t and it being played
+ *
+ * @return Always 0. The emulator's sound thread requests samples directly, so there is no ring to add latency
+ */
+uint32_t dacGetLatencyUs(void)
+{
+    return 0;
+}
+
 /**
  * @brief Fill a buffer with sample output
  *
@@ -87,7 +149,9 @@ void dacHandleSoundOutput(short* out, int framesp, short numChannels)
         {
             // Get samples from the Swadge mode
             uint8_t tempSamps[framesp];
+            dacLock();
             dacCb(tempSamps, framesp);
+            dacUnlock();
 
             // Write the samples to the emulator output, in signed short format
             for (int i = 0; i < framesp; i++)
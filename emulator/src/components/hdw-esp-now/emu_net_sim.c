@@ -0,0 +1,262 @@
+//==============================================================================
+// Includes
+//==============================================================================
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <esp_timer.h>
+#include <esp_log.h>
+
+#include "emu_net_sim.h"
+#include "emu_args.h"
+#include "macros.h"
+
+//==============================================================================
+// Defines
+//==============================================================================
+
+/// The number of packets which may wait in the delivery queue. More are dropped as an overflow
+#define NET_SIM_QUEUE_LEN 64
+
+//==============================================================================
+// Function Prototypes
+//==============================================================================
+
+static uint32_t netSimHash(const uint8_t* mac, uint32_t seq, uint32_t salt);
+static void netSimTrace(const char* event, const uint8_t* mac, const uint8_t* data, uint8_t len);
+
+//==============================================================================
+// Variables
+//==============================================================================
+
+/// Packets waiting to be delivered, sorted by delivery time
+static emuNetPacket_t netQueue[NET_SIM_QUEUE_LEN];
+/// The number of packets in netQueue
+static int netQueueLen = 0;
+
+/// The emulated time at which the simulated channel finishes receiving the packets queued so far
+static int64_t netBusyUntilUs = 0;
+
+/// The packet trace file, or NULL
+static FILE* netTraceFile = NULL;
+
+//==============================================================================
+// Functions
+//==============================================================================
+
+/**
+ * @brief Open the packet trace file, if one was given. This is called once when the emulator starts, so the trace
+ * covers every Swadge mode which is run
+ */
+void emuNetSimOpenTrace(void)
+{
+    if (NULL != emulatorArgs.netTrace && NULL == netTraceFile)
+    {
+        netTraceFile = fopen(emulatorArgs.netTrace, "w");
+        if (NULL == netTraceFile)
+        {
+            ESP_LOGE("NET", "Couldn't open packet trace file %s", emulatorArgs.netTrace);
+        }
+        else
+        {
+            fprintf(netTraceFile, "timeUs,event,mac,len,data\n");
+        }
+    }
+}
+
+/**
+ * @brief Close the packet trace file. This is called once when the emulator exits
+ */
+void emuNetSimCloseTrace(void)
+{
+    if (NULL != netTraceFile)
+    {
+        fclose(netTraceFile);
+        netTraceFile = NULL;
+    }
+}
+
+/**
+ * @brief Reset the simulator. This is called from initEspNow()
+ */
+void emuNetSimInit(void)
+{
+    netQueueLen    = 0;
+    netBusyUntilUs = 0;
+}
+
+/**
+ * @brief Drop any packets still waiting and flush the packet trace file. This is called from deinitEspNow(), which
+ * happens on every Swadge mode switch, so the trace file is kept open
+ */
+void emuNetSimDeinit(void)
+{
+    netQueueLen = 0;
+
+    if (NULL != netTraceFile)
+    {
+        fflush(netTraceFile);
+    }
+}
+
+/**
+ * @brief Check if received packets should go through the simulator
+ *
+ * @return true if the \c --net-sim option was given
+ */
+bool emuNetSimIsEnabled(void)
+{
+    return emulatorArgs.netSim;
+}
+
+/**
+ * @brief Note a packet this emulator sent in the packet trace
+ *
+ * @param mac This emulator's MAC
+ * @param data The packet which was sent
+ * @param len The length of the packet
+ */
+void emuNetSimSent(const uint8_t* mac, const uint8_t* data, uint8_t len)
+{
+    netSimTrace("tx", mac, data, len);
+}
+
+/**
+ * @brief Apply the simulated loss, latency, jitter, and bandwidth to a received packet, then queue it for delivery
+ *
+ * @param srcMac The MAC of the Swadge which sent the packet
+ * @param seq The sender's sequence number for the packet, counted from when the sender's emulator started
+ * @param data The packet which was received
+ * @param len The length of the packet
+ */
+void emuNetSimReceived(const uint8_t* srcMac, uint32_t seq, const uint8_t* data, uint8_t len)
+{
+    len = MIN(len, NET_SIM_MAX_LEN);
+
+    // Drop the packet with the given probability
+    if (netSimHash(srcMac, seq, 1) % 10000 < (uint32_t)(emulatorArgs.netLossPct * 100))
+    {
+        netSimTrace("drop", srcMac, data, len);
+        return;
+    }
+
+    if (netQueueLen >= NET_SIM_QUEUE_LEN)
+    {
+        netSimTrace("overflow", srcMac, data, len);
+        return;
+    }
+
+    // The channel receives one packet at a time, so wait for earlier packets when the bandwidth is limited
+    int64_t nowUs   = esp_timer_get_time();
+    int64_t startUs = MAX(nowUs, netBusyUntilUs);
+    if (emulatorArgs.netKbps)
+    {
+        netBusyUntilUs = startUs + ((int64_t)len * 8 * 1000) / emulatorArgs.netKbps;
+    }
+    else
+    {
+        netBusyUntilUs = startUs;
+    }
+
+    int64_t jitterUs = 0;
+    if (emulatorArgs.netJitterMs)
+    {
+        jitterUs = netSimHash(srcMac, seq, 2) % (emulatorArgs.netJitterMs * 1000 + 1);
+    }
+    int64_t deliverUs = netBusyUntilUs + emulatorArgs.netLatencyMs * 1000 + jitterUs;
+
+    // Insert the packet sorted by delivery time, after any packets due at the same time
+    int idx = netQueueLen;
+    while (idx > 0 && netQueue[idx - 1].deliverUs > deliverUs)
+    {
+        netQueue[idx] = netQueue[idx - 1];
+        idx--;
+    }
+    emuNetPacket_t* packet = &netQueue[idx];
+    packet->deliverUs      = deliverUs;
+    packet->len            = len;
+    packet->rssi           = emulatorArgs.netRssi;
+    memcpy(packet->srcMac, srcMac, sizeof(packet->srcMac));
+    memcpy(packet->data, data, len);
+    netQueueLen++;
+}
+
+/**
+ * @brief Take the next packet whose delivery time has passed out of the queue
+ *
+ * @param[out] packet Written with the packet to deliver
+ * @return true if a packet was due, false if no packets are due yet
+ */
+bool emuNetSimPopDue(emuNetPacket_t* packet)
+{
+    if (0 == netQueueLen || netQueue[0].deliverUs > esp_timer_get_time())
+    {
+        return false;
+    }
+
+    *packet = netQueue[0];
+    netQueueLen--;
+    memmove(&netQueue[0], &netQueue[1], netQueueLen * sizeof(emuNetPacket_t));
+
+    netSimTrace("rx", packet->srcMac, packet->data, packet->len);
+    return true;
+}
+
+/**
+ * @brief Hash a packet's sender and sequence number into a random number. The same inputs always give the same number
+ *
+ * @param mac The sender's MAC
+ * @param seq The sender's sequence number for the packet
+ * @param salt A different value for each random decision about the same packet
+ * @return A random number
+ */
+static uint32_t netSimHash(const uint8_t* mac, uint32_t seq, uint32_t salt)
+{
+    // FNV-1a over the seed, MAC, sequence number, and salt
+    uint32_t seed   = (UINT32_MAX == emulatorArgs.seed) ? 0 : emulatorArgs.seed;
+    uint32_t vals[] = {seed, seq, salt};
+    uint32_t hash   = 2166136261u;
+    for (int i = 0; i < 6; i++)
+    {
+        hash = (hash ^ mac[i]) * 16777619u;
+    }
+    for (int i = 0; i < ARRAY_SIZE(vals); i++)
+    {
+        for (int b = 0; b < 32; b += 8)
+        {
+            hash = (hash ^ ((vals[i] >> b) & 0xFF)) * 16777619u;
+        }
+    }
+
+    // Finish with a mix so that nearby sequence numbers give unrelated numbers
+    hash ^= hash >> 16;
+    hash *= 0x7FEB352Du;
+    hash ^= hash >> 15;
+    return hash;
+}
+
+/**
+ * @brief Write a line to the packet trace file, if it's open
+ *
+ * @param event What happened to the packet
+ * @param mac The MAC of the Swadge which sent the packet
+ * @param data The packet
+ * @param len The length of the packet
+ */
+static void netSimTrace(const char* event, const uint8_t* mac, const uint8_t* data, uint8_t len)
+{
+    if (NULL == netTraceFile)
+    {
+        return;
+    }
+
+    fprintf(netTraceFile, "%" PRId64 ",%s,%02X%02X%02X%02X%02X%02X,%" PRIu8 ",", esp_timer_get_time(), event, mac[0],
+            mac[1], mac[2], mac[3], mac[4], mac[5], len);
+    for (int i = 0; i < len; i++)
+    {
+        fprintf(netTraceFile, "%02X", data[i]);
+    }
+    fputc('\n', netTraceFile);
+}
@@ -0,0 +1,64 @@
+/**
+ * @file emu_net_sim.h
+ * @brief A deterministic network simulator for the emulator's ESP-NOW backend
+ *
+ * Emulated Swadges on one machine talk to each other by broadcasting UDP over the loopback interface. Loopback never
+ * drops, delays, or reorders packets, so it can't show how p2pConnection and multiplayer modes behave on a real radio.
+ *
+ * When enabled with the \c --net-sim option, every packet received by this emulator is held in a delivery queue
+ * instead of being passed straight to the Swadge mode. Each packet may be dropped, is delayed by a fixed latency plus
+ * random jitter, waits for earlier packets when the simulated bandwidth is used up, and is received with a fixed RSSI.
+ * Packets are delivered from checkEspNowRxQueue() once their delivery time, in emulated time, has passed.
+ *
+ * The random loss and jitter for each packet come from a hash of the seed, the sender's MAC, and the sequence number the
+ * sender put in the packet. The sender counts its packets from when its emulator started, across Swadge mode switches,
+ * so the impairments are repeatable for a given seed no matter how the emulator processes are scheduled or when the
+ * receiver switched modes. With \c --fake-time, the delivery times are repeatable too.
+ *
+ * When enabled with the \c --net-trace option, every packet sent, received, or dropped is written to a CSV file. The
+ * file is opened once when the emulator starts and closed when it exits, so it covers every Swadge mode which is run.
+ */
+#pragma once
+
+//==============================================================================
+// Includes
+//==============================================================================
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//==============================================================================
+// Defines
+//==============================================================================
+
+/// The largest ESP-NOW payload the simulator holds
+#define NET_SIM_MAX_LEN 250
+
+//==============================================================================
+// Structs
+//==============================================================================
+
+/**
+ * @brief A packet held by the simulator until its delivery time
+ */
+typedef struct
+{
+    int64_t deliverUs;             ///< The emulated time at which this packet is delivered
+    uint8_t srcMac[6];             ///< The MAC of the Swadge which sent this packet
+    uint8_t len;                   ///< The length of the packet
+    int8_t rssi;                   ///< The RSSI this packet is received with
+    uint8_t data[NET_SIM_MAX_LEN]; ///< The packet's data
+} emuNetPacket_t;
+
+//==============================================================================
+// Function Prototypes
+//==============================================================================
+
+void emuNetSimOpenTrace(void);
+void emuNetSimCloseTrace(void);
+void emuNetSimInit(void);
+void emuNetSimDeinit(void);
+bool emuNetSimIsEnabled(void);
+void emuNetSimSent(const uint8_t* mac, const uint8_t* data, uint8_t len);
+void emuNetSimReceived(const uint8_t* srcMac, uint32_t seq, const uint8_t* data, uint8_t len);
+bool emuNetSimPopDue(emuNetPacket_t* packet);
@@ -30,11 +30,13 @@
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
+#include <inttypes.h>
 
 #include "hdw-esp-now.h"
 #include "esp_wifi.h"
 #include "esp_log.h"
 #include "emu_main.h"
+#include "emu_net_sim.h"
 
 //==============================================================================
 // Defines
@@ -43,6 +45,9 @@
 #define ESP_NOW_PORT  32888
 #define MAXRECVSTRING 1024 // Longest string to receive
 
+/// The length of the "ESP_NOW-<MAC>-<sequence number>-" header before each packet's data
+#define ESP_NOW_HDR_LEN 30
+
 //==============================================================================
 // Variables
 //==============================================================================
@@ -52,6 +57,10 @@ hostEspNowSendCb_t hostEspNowSendCb = NULL;
 
 int socketFd;
 
+/// The number of packets this emulator has sent since it started. This isn't reset when the Swadge mode changes, so the
+/// network simulator on the receiving end can key its random impairments on it
+static uint32_t txSeq = 0;
+
 //==============================================================================
 // Functions
 //==============================================================================
@@ -76,6 +85,8 @@ esp_err_t initEspNow(hostEspNowRecvCb_t recvCb, hostEspNowSendCb_t sendCb, gpio_
     hostEspNowRecvCb = recvCb;
     hostEspNowSendCb = sendCb;
 
+    emuNetSimInit();
+
 #if defined(USING_WINDOWS)
     // Initialize Winsock
     WSADATA wsaData;
@@ -183,15 +194,25 @@ void checkEspNowRxQueue(void)
     {
         // If the packet matches the ESP_NOW format
         uint8_t recvMac[6] = {0};
-        if (6
-            == sscanf(recvString, "ESP_NOW-%02hhX%02hhX%02hhX%02hhX%02hhX%02hhX-", &recvMac[0], &recvMac[1],
-                      &recvMac[2], &recvMac[3], &recvMac[4], &recvMac[5]))
+        uint32_t recvSeq   = 0;
+        if ((recvStringLen >= ESP_NOW_HDR_LEN)
+            && (7
+                == sscanf(recvString, "ESP_NOW-%02hhX%02hhX%02hhX%02hhX%02hhX%02hhX-%08" SCNx32 "-", &recvMac[0],
+                          &recvMac[1], &recvMac[2], &recvMac[3], &recvMac[4], &recvMac[5], &recvSeq)))
         {
             // Make sure the MAC differs from our own
             uint8_t ourMac[6] = {0};
             esp_wifi_get_mac(WIFI_IF_STA, ourMac);
             if (0 != memcmp(recvMac, ourMac, sizeof(ourMac)))
             {
+                if (emuNetSimIsEnabled())
+                {
+                    // Let the network simulator decide if and when to deliver it
+                    emuNetSimReceived(recvMac, recvSeq, (uint8_t*)&recvString[ESP_NOW_HDR_LEN],
+                                      recvStringLen - ESP_NOW_HDR_LEN);
+                    continue;
+                }
+
                 // Set up the receive info
                 esp_now_recv_info_t espNowInfo = {0};
                 espNowInfo.src_addr            = recvMac;
@@ -202,10 +223,29 @@ void checkEspNowRxQueue(void)
                 espNowInfo.rx_ctrl              = &packetRxCtrl;
 
                 // If it does, send it to the application through the callback
-                hostEspNowRecvCb(&espNowInfo, (uint8_t*)&recvString[21], recvStringLen - 21, packetRxCtrl.rssi);
+                hostEspNowRecvCb(&espNowInfo, (uint8_t*)&recvString[ESP_NOW_HDR_LEN], recvStringLen - ESP_NOW_HDR_LEN,
+                                 packetRxCtrl.rssi);
             }
         }
     }
+
+    // Deliver packets from the network simulator once they're due
+    emuNetPacket_t packet;
+    while (emuNetSimPopDue(&packet))
+    {
+        uint8_t ourMac[6] = {0};
+        esp_wifi_get_mac(WIFI_IF_STA, ourMac);
+
+        esp_now_recv_info_t espNowInfo = {0};
+        espNowInfo.src_addr            = packet.srcMac;
+        espNowInfo.des_addr            = ourMac;
+
+        wifi_pkt_rx_ctrl_t packetRxCtrl = {0};
+        packetRxCtrl.rssi               = packet.rssi;
+        espNowInfo.rx_ctrl              = &packetRxCtrl;
+
+        hostEspNowRecvCb(&espNowInfo, packet.data, packet.len, packetRxCtrl.rssi);
+    }
 }
 
 /**
@@ -225,11 +265,12 @@ void espNowSend(const char* data, uint8_t dataLen)
     broadcastAddr.sin_addr.s_addr = htonl(0x7FFFFFFF);   // Local broadcast IP address, 127.255.255.255
     broadcastAddr.sin_port        = htons(ESP_NOW_PORT); // Broadcast port
 
-    // Tack on ESP-NOW header and randomized MAC address
-    char espNowPacket[dataLen + 24];
+    // Tack on ESP-NOW header, randomized MAC address, and sequence number
+    char espNowPacket[dataLen + ESP_NOW_HDR_LEN + 1];
     uint8_t mac[6] = {0};
     esp_wifi_get_mac(WIFI_IF_STA, mac);
-    sprintf(espNowPacket, "ESP_NOW-%02X%02X%02X%02X%02X%02X-", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    sprintf(espNowPacket, "ESP_NOW-%02X%02X%02X%02X%02X%02X-%08" PRIX32 "-", mac[0], mac[1], mac[2], mac[3], mac[4],
+            mac[5], txSeq++);
     int hdrLen = strlen(espNowPacket);
     memcpy(&espNowPacket[hdrLen], data, dataLen);
 
@@ -253,6 +294,7 @@ void espNowSend(const char* data, uint8_t dataLen)
     }
     else
     {
+        emuNetSimSent(mac, (const uint8_t*)data, dataLen);
         hostEspNowSendCb(bcastMac, ESP_NOW_SEND_SUCCESS);
     }
 }
@@ -262,6 +304,7 @@ void espNowSend(const char* data, uint8_t dataLen)
  */
 void deinitEspNow(void)
 {
+    emuNetSimDeinit();
     close(socketFd);
 #if defined(USING_WINDOWS)
     WSACleanup();
@@ -197,6 +197,17 @@ void accelSetRegistersAndReset()
 {
 }
 
+// stub
+esp_err_t accelSetOutputDataRate(imuOdr_t odr)
+{
+    if (odr < IMU_ODR_12_5_HZ || odr > IMU_ODR_1660_HZ)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    LSM6DSL.odr = odr;
+    return ESP_OK;
+}
+
 // stub
 esp_err_t accelPerformCal()
 {
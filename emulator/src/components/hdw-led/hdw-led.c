@@ -106,6 +106,20 @@ led_t* getLedMemory(uint8_t* numLeds)
     return rdLeds;
 }
 
+/**
+ * @brief Take the LED lock. The emulator's timers run in the main loop, so there is nothing to lock out
+ */
+void ledLock(void)
+{
+}
+
+/**
+ * @brief Release the LED lock taken by ledLock()
+ */
+void ledUnlock(void)
+{
+}
+
 /**
  * @brief Wait until any pending LED transactions are finished, then return
  * Immediately returns on the emulator
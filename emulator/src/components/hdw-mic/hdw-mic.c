@@ -21,6 +21,7 @@ static uint16_t ssamples[SSBUF] = {0};
 static int sshead               = 0;
 static int sstail               = 0;
 static bool adcSampling         = false;
+static uint32_t micOverruns     = 0;
 
 //==============================================================================
 // Functions
@@ -66,6 +67,17 @@ uint32_t loopMic(uint16_t* outSamples, uint32_t outSamplesMax)
     return samplesRead;
 }
 
+/**
+ * @brief Get the number of samples the ADC dropped because loopMic() was not called often enough. This keeps counting
+ * across initMic() and deinitMic()
+ *
+ * @return The number of dropped samples
+ */
+uint32_t micGetOverruns(void)
+{
+    return micOverruns;
+}
+
 /**
  * @brief Stop sampling the microphone's ADC
  */
@@ -134,6 +146,10 @@ void micHandleSoundInput(short* in, int framesr, short numChannels)
                 ssamples[sshead] = v;
                 sshead           = (sshead + 1) % SSBUF;
             }
+            else
+            {
+                micOverruns++;
+            }
         }
     }
 }
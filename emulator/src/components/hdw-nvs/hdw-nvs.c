@@ -12,6 +12,7 @@
 #include <math.h>
 #include <sys/stat.h>
 #include <errno.h>
+#include <inttypes.h>
 
 #include "hdw-nvs.h"
 #include "hdw-nvs_emu.h"
@@ -20,6 +21,8 @@
 #include "emu_utils.h"
 #include "hashMap.h"
 #include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_log.h"
 
 //==============================================================================
 // Defines
@@ -32,6 +35,23 @@
 #define NVS_ENTRY_BYTES      32
 #define NVS_OVERHEAD_ENTRIES 12
 
+// Writes are coalesced and written to the file this long after the first unsaved write
+#define NVS_FLUSH_DELAY_US 1000000
+
+//==============================================================================
+// Enums
+//==============================================================================
+
+/**
+ * @brief The kind of write staged in a batch
+ */
+typedef enum
+{
+    NVS_BATCH_WRITE_32,   ///< Write a 32 bit value
+    NVS_BATCH_WRITE_BLOB, ///< Write a blob
+    NVS_BATCH_ERASE,      ///< Erase a key
+} nvsBatchOp_t;
+
 //==============================================================================
 // Structs
 //==============================================================================
@@ -48,6 +68,25 @@ typedef struct
     };
 } emuNvsInjectedData_t;
 
+typedef struct
+{
+    cJSON* obj;     ///< The namespace's object in nvsJson
+    hashMap_t keys; ///< The namespace's items in nvsJson, indexed by key
+} emuNvsNamespace_t;
+
+/**
+ * @brief A write staged in a batch, with a copy of its blob allocated after it
+ */
+struct nvsBatchEntry
+{
+    nvsBatchEntry_t* next;           ///< The next staged write, or NULL
+    char key[NVS_KEY_NAME_MAX_SIZE]; ///< The key to write
+    nvsBatchOp_t op;                 ///< The kind of write
+    int32_t val;                     ///< The value for ::NVS_BATCH_WRITE_32
+    size_t length;                   ///< The length of the blob for ::NVS_BATCH_WRITE_BLOB
+    uint8_t blob[];                  ///< The blob for ::NVS_BATCH_WRITE_BLOB
+};
+
 //==============================================================================
 // Function Prototypes
 //==============================================================================
@@ -57,6 +96,16 @@ static FILE* openNvsFile(const char* mode);
 static size_t emuGetInjectedBlobLength(const char* namespace, const char* key);
 static void* emuGetInjectedBlob(const char* namespace, const char* key);
 static bool emuGetInjected32(const char* namespace, const char* key, int32_t* out);
+static bool nvsLoad(void);
+static void nvsUnload(void);
+static emuNvsNamespace_t* nvsGetNamespace(const char* namespace, bool create);
+static cJSON* nvsGetItem(const char* namespace, const char* key);
+static bool nvsSetItem(const char* namespace, const char* key, cJSON* item);
+static void nvsMarkDirty(void);
+static void nvsFlush(void);
+static void nvsFlushTimerCb(void* arg);
+static nvsBatchEntry_t* nvsBatchStage(nvsBatch_t* batch, nvsBatchOp_t op, const char* key, size_t length);
+static void nvsRecordTiming(int64_t startUs, uint16_t numWrites);
 
 //==============================================================================
 // Constants
@@ -81,6 +130,17 @@ static const char** nvsFileName = defaultNvsFiles;
 static bool nvsInjectedDataInit = false;
 static hashMap_t nvsInjectedData;
 
+/// The parsed contents of the NVS file. All reads and writes use this, and it's written back to the file later
+static cJSON* nvsJson = NULL;
+/// The namespaces in nvsJson, indexed by name
+static hashMap_t nvsNamespaces;
+/// true if nvsJson has writes which aren't in the file yet
+static bool nvsDirty = false;
+/// A timer which writes nvsJson to the file after a burst of writes
+static esp_timer_handle_t nvsFlushTimer = NULL;
+/// The time spent writing to NVS
+static nvsTiming_t nvsTiming = {0};
+
 //==============================================================================
 // Functions
 //==============================================================================
@@ -143,7 +203,7 @@ bool initNvs(bool firstTry)
                         fclose(nvsFile);
                         nvsFileName = curFile;
                         printf("Using NVS file %s\n", *nvsFileName);
-                        return true;
+                        return nvsLoad();
                     }
                     else
                     {
@@ -158,7 +218,7 @@ bool initNvs(bool firstTry)
             // File exists
             nvsFileName = curFile;
             printf("Using NVS file %s\n", *nvsFileName);
-            return true;
+            return nvsLoad();
         }
 
         printf("Could not load NVS file %s\n", *curFile);
@@ -174,6 +234,17 @@ bool initNvs(bool firstTry)
  */
 bool deinitNvs(void)
 {
+    // Write anything which hasn't been saved yet
+    nvsFlush();
+    nvsUnload();
+
+    if (NULL != nvsFlushTimer)
+    {
+        esp_timer_stop(nvsFlushTimer);
+        esp_timer_delete(nvsFlushTimer);
+        nvsFlushTimer = NULL;
+    }
+
     if (nvsInjectedDataInit)
     {
         hashIterator_t iter = {0};
@@ -185,7 +256,7 @@ bool deinitNvs(void)
         hashDeinit(&nvsInjectedData);
         nvsInjectedDataInit = false;
     }
-    return true; // Nothing to do
+    return true;
 }
 
 /**
@@ -195,6 +266,9 @@ bool deinitNvs(void)
  */
 bool eraseNvs(void)
 {
+    // Drop the in-memory contents, including unsaved writes
+    nvsUnload();
+
     // Check if the json file exists
     if (access(NVS_JSON_FILE, F_OK) != 0)
     {
@@ -255,66 +329,11 @@ bool readNamespaceNvs32(const char* namespace, const char* key, int32_t* outVal)
         return true;
     }
 
-    // Open the file
-    FILE* nvsFile = openNvsFile("rb");
-    if (NULL != nvsFile)
+    cJSON* item = nvsGetItem(namespace, key);
+    if (cJSON_IsNumber(item))
     {
-        // Get the file size
-        fseek(nvsFile, 0L, SEEK_END);
-        size_t fsize = ftell(nvsFile);
-        fseek(nvsFile, 0L, SEEK_SET);
-
-        if (fsize == 0)
-        {
-            fclose(nvsFile);
-            return false;
-        }
-
-        // Read the file
-        char fbuf[fsize + 1];
-        fbuf[fsize] = 0;
-        if (fsize == fread(fbuf, 1, fsize, nvsFile))
-        {
-            // Close the file
-            fclose(nvsFile);
-
-            // Parse the JSON
-            cJSON* json = cJSON_Parse(fbuf);
-            cJSON* jsonIter;
-
-            if (!json)
-            {
-                return false;
-            }
-
-            cJSON* jsonNs = cJSON_GetObjectItemCaseSensitive(json, namespace);
-
-            if (cJSON_IsObject(jsonNs))
-            {
-                // Find the requested key
-                char* current_key = NULL;
-                cJSON_ArrayForEach(jsonIter, jsonNs)
-                {
-                    current_key = jsonIter->string;
-                    if (current_key != NULL)
-                    {
-                        // If the key matches
-                        if (0 == strcmp(current_key, key))
-                        {
-                            // Return the value
-                            *outVal = (int32_t)cJSON_GetNumberValue(jsonIter);
-                            cJSON_Delete(json);
-                            return true;
-                        }
-                    }
-                }
-            }
-            cJSON_Delete(json);
-        }
-        else
-        {
-            fclose(nvsFile);
-        }
+        *outVal = (int32_t)cJSON_GetNumberValue(item);
+        return true;
     }
     return false;
 }
@@ -329,86 +348,10 @@ bool readNamespaceNvs32(const char* namespace, const char* key, int32_t* outVal)
  */
 bool writeNamespaceNvs32(const char* namespace, const char* key, int32_t val)
 {
-    // Open the file
-    FILE* nvsFile = openNvsFile("rb");
-    if (NULL != nvsFile)
-    {
-        // Get the file size
-        fseek(nvsFile, 0L, SEEK_END);
-        size_t fsize = ftell(nvsFile);
-        fseek(nvsFile, 0L, SEEK_SET);
-
-        // Read the file
-        char fbuf[fsize + 1];
-        fbuf[fsize] = 0;
-        if (fsize == fread(fbuf, 1, fsize, nvsFile))
-        {
-            // Close the file
-            fclose(nvsFile);
-
-            // Parse the JSON
-            cJSON* json = cJSON_Parse(fbuf);
-
-            cJSON* jsonNs = cJSON_GetObjectItemCaseSensitive(json, namespace);
-
-            if (NULL == jsonNs)
-            {
-                jsonNs = cJSON_CreateObject();
-                cJSON_AddItemToObject(json, namespace, jsonNs);
-            }
-
-            // Check if the key alredy exists
-            cJSON* jsonIter;
-            bool keyExists = false;
-            cJSON_ArrayForEach(jsonIter, jsonNs)
-            {
-                if (0 == strcmp(jsonIter->string, key))
-                {
-                    keyExists = true;
-                }
-            }
-
-            // Add or replace the item
-            cJSON* jsonVal = cJSON_CreateNumber(val);
-            if (keyExists)
-            {
-                cJSON_ReplaceItemInObject(jsonNs, key, jsonVal);
-            }
-            else
-            {
-                cJSON_AddItemToObject(jsonNs, key, jsonVal);
-            }
-
-            // Write the new JSON back to the file
-            FILE* nvsFileW = openNvsFile("wb");
-            if (NULL != nvsFileW)
-            {
-                char* jsonStr = cJSON_Print(json);
-                fprintf(nvsFileW, "%s", jsonStr);
-                fclose(nvsFileW);
-
-                free(jsonStr);
-                cJSON_Delete(json);
-
-                return true;
-            }
-            else
-            {
-                // Couldn't open file to write
-            }
-            cJSON_Delete(json);
-        }
-        else
-        {
-            // Couldn't read file
-            fclose(nvsFile);
-        }
-    }
-    else
-    {
-        // couldn't open file to read
-    }
-    return false;
+    int64_t startUs = esp_timer_get_time();
+    bool retVal     = nvsSetItem(namespace, key, cJSON_CreateNumber(val));
+    nvsRecordTiming(startUs, 1);
+    return retVal;
 }
 
 /**
@@ -439,66 +382,22 @@ bool readNamespaceNvsBlob(const char* namespace, const char* key, void* out_valu
         return true;
     }
 
-    // Open the file
-    FILE* nvsFile = openNvsFile("rb");
-    if (NULL != nvsFile)
+    cJSON* item = nvsGetItem(namespace, key);
+    if (cJSON_IsString(item))
     {
-        // Get the file size
-        fseek(nvsFile, 0L, SEEK_END);
-        size_t fsize = ftell(nvsFile);
-        fseek(nvsFile, 0L, SEEK_SET);
+        char* strBlob = cJSON_GetStringValue(item);
 
-        // Read the file
-        char fbuf[fsize + 1];
-        fbuf[fsize] = 0;
-        if (fsize == fread(fbuf, 1, fsize, nvsFile))
+        if (out_value != NULL)
         {
-            // Close the file
-            fclose(nvsFile);
-
-            // Parse the JSON
-            cJSON* json = cJSON_Parse(fbuf);
-            cJSON* jsonIter;
-
-            cJSON* jsonNs = cJSON_GetObjectItemCaseSensitive(json, namespace);
-
-            if (NULL != jsonNs && cJSON_IsObject(jsonNs))
-            {
-                // Find the requested key
-                char* current_key = NULL;
-                cJSON_ArrayForEach(jsonIter, jsonNs)
-                {
-                    current_key = jsonIter->string;
-                    if (current_key != NULL)
-                    {
-                        // If the key matches
-                        if (0 == strcmp(current_key, key))
-                        {
-                            // Return the value
-                            char* strBlob = cJSON_GetStringValue(jsonIter);
-
-                            if (out_value != NULL)
-                            {
-                                // The call to read, using returned length
-                                strToBlob(strBlob, out_value, *length);
-                            }
-                            else
-                            {
-                                // The call to get length of blob
-                                *length = strlen(strBlob) / 2;
-                            }
-                            cJSON_Delete(json);
-                            return true;
-                        }
-                    }
-                }
-            }
-            cJSON_Delete(json);
+            // The call to read, using returned length
+            strToBlob(strBlob, out_value, *length);
         }
         else
         {
-            fclose(nvsFile);
+            // The call to get length of blob
+            *length = strlen(strBlob) / 2;
         }
+        return true;
     }
     return false;
 }
@@ -514,88 +413,14 @@ bool readNamespaceNvsBlob(const char* namespace, const char* key, void* out_valu
  */
 bool writeNamespaceNvsBlob(const char* namespace, const char* key, const void* value, size_t length)
 {
-    // Open the file
-    FILE* nvsFile = openNvsFile("rb");
-    if (NULL != nvsFile)
-    {
-        // Get the file size
-        fseek(nvsFile, 0L, SEEK_END);
-        size_t fsize = ftell(nvsFile);
-        fseek(nvsFile, 0L, SEEK_SET);
-
-        // Read the file
-        char fbuf[fsize + 1];
-        fbuf[fsize] = 0;
-        if (fsize == fread(fbuf, 1, fsize, nvsFile))
-        {
-            // Close the file
-            fclose(nvsFile);
-
-            // Parse the JSON
-            cJSON* json = cJSON_Parse(fbuf);
-
-            cJSON* jsonNs = cJSON_GetObjectItemCaseSensitive(json, namespace);
-
-            if (NULL == jsonNs)
-            {
-                jsonNs = cJSON_CreateObject();
-                cJSON_AddItemToObject(json, namespace, jsonNs);
-            }
-
-            // Check if the key alredy exists
-            cJSON* jsonIter;
-            bool keyExists = false;
-            cJSON_ArrayForEach(jsonIter, jsonNs)
-            {
-                if (0 == strcmp(jsonIter->string, key))
-                {
-                    keyExists = true;
-                }
-            }
-
-            // Add or replace the item
-            char* blobStr  = blobToStr(value, length);
-            cJSON* jsonVal = cJSON_CreateString(blobStr);
-            free(blobStr);
-            if (keyExists)
-            {
-                cJSON_ReplaceItemInObject(jsonNs, key, jsonVal);
-            }
-            else
-            {
-                cJSON_AddItemToObject(jsonNs, key, jsonVal);
-            }
-
-            // Write the new JSON back to the file
-            FILE* nvsFileW = openNvsFile("wb");
-            if (NULL != nvsFileW)
-            {
-                char* jsonStr = cJSON_Print(json);
-                fprintf(nvsFileW, "%s", jsonStr);
-                fclose(nvsFileW);
-
-                free(jsonStr);
-                cJSON_Delete(json);
-
-                return true;
-            }
-            else
-            {
-                // Couldn't open file to write
-            }
-            cJSON_Delete(json);
-        }
-        else
-        {
-            // Couldn't read file
-            fclose(nvsFile);
-        }
-    }
-    else
-    {
-        // couldn't open file to read
-    }
-    return false;
+    int64_t startUs = esp_timer_get_time();
+    char* blobStr   = blobToStr(value, length);
+    cJSON* jsonVal  = cJSON_CreateString(blobStr);
+    free(blobStr);
+
+    bool retVal = nvsSetItem(namespace, key, jsonVal);
+    nvsRecordTiming(startUs, 1);
+    return retVal;
 }
 
 /**
@@ -647,79 +472,19 @@ bool eraseNvsKey(const char* key)
  */
 bool eraseNamespaceNvsKey(const char* namespace, const char* key)
 {
-    // Open the file
-    FILE* nvsFile = openNvsFile("rb");
-    if (NULL != nvsFile)
-    {
-        // Get the file size
-        fseek(nvsFile, 0L, SEEK_END);
-        size_t fsize = ftell(nvsFile);
-        fseek(nvsFile, 0L, SEEK_SET);
-
-        // Read the file
-        char fbuf[fsize + 1];
-        fbuf[fsize] = 0;
-        if (fsize == fread(fbuf, 1, fsize, nvsFile))
-        {
-            // Close the file
-            fclose(nvsFile);
-
-            // Parse the JSON
-            cJSON* json = cJSON_Parse(fbuf);
-
-            // Check if the key exists
-            cJSON* jsonIter;
-            bool keyExists = false;
+    int64_t startUs       = esp_timer_get_time();
+    bool retVal           = false;
+    emuNvsNamespace_t* ns = nvsGetNamespace(namespace, false);
 
-            cJSON* jsonNs = cJSON_GetObjectItemCaseSensitive(json, namespace);
-
-            if (NULL != jsonNs)
-            {
-                cJSON_ArrayForEach(jsonIter, jsonNs)
-                {
-                    if (0 == strcmp(jsonIter->string, key))
-                    {
-                        keyExists = true;
-                    }
-                }
-            }
-
-            // Remove the key if it exists
-            if (keyExists)
-            {
-                cJSON_DeleteItemFromObject(jsonNs, key);
-            }
-
-            // Write the new JSON back to the file
-            FILE* nvsFileW = openNvsFile("wb");
-            if (NULL != nvsFileW)
-            {
-                char* jsonStr = cJSON_Print(json);
-                fprintf(nvsFileW, "%s", jsonStr);
-                fclose(nvsFileW);
-
-                free(jsonStr);
-                cJSON_Delete(json);
-
-                return keyExists;
-            }
-            else
-            {
-                // Couldn't open file to write
-            }
-            cJSON_Delete(json);
-        }
-        else
-        {
-            // Couldn't read file
-            fclose(nvsFile);
-        }
-    }
-    else
+    // Remove the key if it exists
+    if (NULL != ns && NULL != hashRemove(&ns->keys, key))
     {
-        // couldn't open file to read
+        cJSON_DeleteItemFromObjectCaseSensitive(ns->obj, key);
+        nvsMarkDirty();
+        retVal = true;
     }
-    return false;
+    nvsRecordTiming(startUs, 1);
+    return retVal;
 }
 
 /**
@@ -731,93 +496,71 @@ bool eraseNamespaceNvsKey(const char* namespace, const char* key)
  */
 bool readNvsStats(nvs_stats_t* outStats)
 {
-    // Open the file
-    FILE* nvsFile = openNvsFile("rb");
-    if (NULL != nvsFile)
+    if (NULL == nvsJson)
     {
-        // Get the file size
-        fseek(nvsFile, 0L, SEEK_END);
-        size_t fsize = ftell(nvsFile);
-        fseek(nvsFile, 0L, SEEK_SET);
-
-        // Read the file
-        char fbuf[fsize + 1];
-        fbuf[fsize] = 0;
-        if (fsize == fread(fbuf, 1, fsize, nvsFile))
-        {
-            // Close the file
-            fclose(nvsFile);
+        return false;
+    }
 
-            // Parse the JSON
-            cJSON* json = cJSON_Parse(fbuf);
-            cJSON* jsonIter;
-            cJSON* namespace;
+    cJSON* jsonIter;
+    cJSON* namespace;
 
-            cJSON_ArrayForEach(namespace, json)
+    cJSON_ArrayForEach(namespace, nvsJson)
+    {
+        // 1 entry is always used by each namespace, and there should only ever be 1 namespace
+        outStats->used_entries++;
+        // TODO: I just checked a Swadge and it said it was using 5 namespaces. Why?
+        outStats->namespace_count++;
+        /**
+         * When running readNvsStats() on an actual Swadge, the total NVS
+         * size is displayed as 12 entries less than the partition size.
+         *
+         * It's unknown if this is a percentage of total size,
+         * or a fixed number of overhead/control entries.
+         * I'm assuming it's a fixed number here.
+         */
+        outStats->total_entries = NVS_PARTITION_SIZE / NVS_ENTRY_BYTES - NVS_OVERHEAD_ENTRIES;
+
+        cJSON_ArrayForEach(jsonIter, namespace)
+        {
+            if (jsonIter->string != NULL)
             {
-                // 1 entry is always used by each namespace, and there should only ever be 1 namespace
-                outStats->used_entries++;
-                // TODO: I just checked a Swadge and it said it was using 5 namespaces. Why?
-                outStats->namespace_count++;
-                /**
-                 * When running readNvsStats() on an actual Swadge, the total NVS
-                 * size is displayed as 12 entries less than the partition size.
-                 *
-                 * It's unknown if this is a percentage of total size,
-                 * or a fixed number of overhead/control entries.
-                 * I'm assuming it's a fixed number here.
-                 */
-                outStats->total_entries = NVS_PARTITION_SIZE / NVS_ENTRY_BYTES - NVS_OVERHEAD_ENTRIES;
-
-                cJSON_ArrayForEach(jsonIter, namespace)
+                switch (jsonIter->type)
                 {
-                    if (jsonIter->string != NULL)
+                    case cJSON_Number:
                     {
-                        switch (jsonIter->type)
-                        {
-                            case cJSON_Number:
-                            {
-                                outStats->used_entries += 1;
-                                break;
-                            }
-                            case cJSON_String:
-                            {
-                                char* strBlob = cJSON_GetStringValue(jsonIter);
-
-                                /**
-                                 * Get length of blob
-                                 *
-                                 * When the ESP32 is storing blobs, it uses 1 entry to index chunks,
-                                 * 1 entry per chunk, then 1 entry for every 32 bytes of data, rounding up.
-                                 *
-                                 * I don't know how to find out how many chunks the ESP32 would split
-                                 * certain length blobs into, so for now I'm assuming 1 chunk per blob.
-                                 *
-                                 * Blobs in the JSON are encoded as hexadecimal, so every 2 characters are
-                                 * 1 byte of data. Then, every 32 bytes of data is an entry.
-                                 */
-                                outStats->used_entries += 2 + ceil(strlen(strBlob) / 2.0f / NVS_ENTRY_BYTES);
-                                break;
-                            }
-                            default:
-                            {
-                                break;
-                            }
-                        }
+                        outStats->used_entries += 1;
+                        break;
+                    }
+                    case cJSON_String:
+                    {
+                        char* strBlob = cJSON_GetStringValue(jsonIter);
+
+                        /**
+                         * Get length of blob
+                         *
+                         * When the ESP32 is storing blobs, it uses 1 entry to index chunks,
+                         * 1 entry per chunk, then 1 entry for every 32 bytes of data, rounding up.
+                         *
+                         * I don't know how to find out how many chunks the ESP32 would split
+                         * certain length blobs into, so for now I'm assuming 1 chunk per blob.
+                         *
+                         * Blobs in the JSON are encoded as hexadecimal, so every 2 characters are
+                         * 1 byte of data. Then, every 32 bytes of data is an entry.
+                         */
+                        outStats->used_entries += 2 + ceil(strlen(strBlob) / 2.0f / NVS_ENTRY_BYTES);
+                        break;
+                    }
+                    default:
+                    {
+                        break;
                     }
                 }
             }
-
-            outStats->free_entries = outStats->total_entries - outStats->used_entries;
-            cJSON_Delete(json);
-            return true;
-        }
-        else
-        {
-            fclose(nvsFile);
         }
     }
-    return false;
+
+    outStats->free_entries = outStats->total_entries - outStats->used_entries;
+    return true;
 }
 
 /**
@@ -836,113 +579,86 @@ bool readNvsStats(nvs_stats_t* outStats)
 bool readNamespaceNvsEntryInfos(const char* namespace, nvs_stats_t* outStats, nvs_entry_info_t* outEntryInfos,
                                 size_t* numEntryInfos)
 {
-    // Open the file
-    FILE* nvsFile = openNvsFile("rb");
-    if (NULL != nvsFile)
+    cJSON* jsonIter;
+
+    // If the user doesn't want to receive the stats, only use them internally
+    bool freeOutStats = false;
+    if (outStats == NULL)
     {
-        // Get the file size
-        fseek(nvsFile, 0L, SEEK_END);
-        size_t fsize = ftell(nvsFile);
-        fseek(nvsFile, 0L, SEEK_SET);
+        outStats     = heap_caps_calloc(1, sizeof(nvs_stats_t), MALLOC_CAP_8BIT);
+        freeOutStats = true;
+    }
 
-        // Read the file
-        char fbuf[fsize + 1];
-        fbuf[fsize] = 0;
-        if (fsize == fread(fbuf, 1, fsize, nvsFile))
+    if (!readNvsStats(outStats))
+    {
+        if (freeOutStats)
         {
-            // Close the file
-            fclose(nvsFile);
-
-            // Parse the JSON
-            cJSON* json = cJSON_Parse(fbuf);
-            cJSON* jsonIter;
-
-            // If the user doesn't want to receive the stats, only use them internally
-            bool freeOutStats = false;
-            if (outStats == NULL)
-            {
-                outStats     = heap_caps_calloc(1, sizeof(nvs_stats_t), MALLOC_CAP_8BIT);
-                freeOutStats = true;
-            }
-
-            if (!readNvsStats(outStats))
-            {
-                if (freeOutStats)
-                {
-                    free(outStats);
-                }
-                return false;
-            }
+            free(outStats);
+        }
+        return false;
+    }
 
-            cJSON* jsonNs = cJSON_GetObjectItemCaseSensitive(json, namespace);
+    emuNvsNamespace_t* ns = nvsGetNamespace(namespace, false);
 
-            if (NULL != jsonNs && cJSON_IsObject(jsonNs))
+    if (NULL != ns)
+    {
+        int i = 0;
+        char* current_key;
+        cJSON_ArrayForEach(jsonIter, ns->obj)
+        {
+            current_key = jsonIter->string;
+            if (current_key != NULL)
             {
-                int i = 0;
-                char* current_key;
-                cJSON_ArrayForEach(jsonIter, jsonNs)
+                if (outEntryInfos != NULL)
                 {
-                    current_key = jsonIter->string;
-                    if (current_key != NULL)
+                    switch (jsonIter->type)
                     {
-                        if (outEntryInfos != NULL)
+                        case cJSON_Number:
                         {
-                            switch (jsonIter->type)
-                            {
-                                case cJSON_Number:
-                                {
 #ifdef USING_U32
-                                    // cJSON cannot store any integer larger than 2^53 or smaller than -(2^53), since
-                                    // those are the limits of a double
-                                    int64_t val = (int64_t)cJSON_GetNumberValue(jsonIter);
-                                    if (val > INT32_MAX)
-                                    {
-                                        outEntryInfos[i].type = NVS_TYPE_U32;
-                                    }
-                                    else
+                            // cJSON cannot store any integer larger than 2^53 or smaller than -(2^53), since
+                            // those are the limits of a double
+                            int64_t val = (int64_t)cJSON_GetNumberValue(jsonIter);
+                            if (val > INT32_MAX)
+                            {
+                                outEntryInfos[i].type = NVS_TYPE_U32;
+                            }
+                            else
 #endif
-                                    {
-                                        outEntryInfos[i].type = NVS_TYPE_I32;
-                                    }
-                                    break;
-                                }
-                                case cJSON_String:
-                                {
-                                    outEntryInfos[i].type = NVS_TYPE_BLOB;
-                                    break;
-                                }
-                                default:
-                                {
-                                    break;
-                                }
+                            {
+                                outEntryInfos[i].type = NVS_TYPE_I32;
                             }
-                            snprintf(outEntryInfos[i].namespace_name, NVS_KEY_NAME_MAX_SIZE, "%s", namespace);
-                            snprintf(outEntryInfos[i].key, NVS_KEY_NAME_MAX_SIZE, "%s", current_key);
+                            break;
+                        }
+                        case cJSON_String:
+                        {
+                            outEntryInfos[i].type = NVS_TYPE_BLOB;
+                            break;
+                        }
+                        default:
+                        {
+                            break;
                         }
-                        i++;
                     }
+                    snprintf(outEntryInfos[i].namespace_name, NVS_KEY_NAME_MAX_SIZE, "%s", namespace);
+                    snprintf(outEntryInfos[i].key, NVS_KEY_NAME_MAX_SIZE, "%s", current_key);
                 }
-
-                if (outEntryInfos == NULL)
-                {
-                    *numEntryInfos = i;
-                }
+                i++;
             }
-
-            if (freeOutStats)
-            {
-                free(outStats);
-            }
-
-            cJSON_Delete(json);
-            return true;
         }
-        else
+
+        if (outEntryInfos == NULL)
         {
-            fclose(nvsFile);
+            *numEntryInfos = i;
         }
     }
-    return false;
+
+    if (freeOutStats)
+    {
+        free(outStats);
+    }
+
+    return true;
 }
 
 /**
@@ -971,43 +687,176 @@ bool readAllNvsEntryInfos(nvs_stats_t* outStats, nvs_entry_info_t* outEntryInfos
  */
 bool nvsNamespaceInUse(const char* namespace)
 {
-    // Open the file
-    FILE* nvsFile = openNvsFile("rb");
+    emuNvsNamespace_t* ns = nvsGetNamespace(namespace, false);
+    return (NULL != ns) && (cJSON_GetArraySize(ns->obj) != 0);
+}
 
-    if (NULL != nvsFile)
+/**
+ * @brief Start a batch of writes to one namespace. The batch must be finished with nvsBatchCommit() or nvsBatchAbort()
+ *
+ * @param batch The batch to start
+ * @param namespace The NVS namespace to write to
+ * @return true if the batch was started, false if the namespace name is too long
+ */
+bool nvsBatchBegin(nvsBatch_t* batch, const char* namespace)
+{
+    memset(batch, 0, sizeof(nvsBatch_t));
+    if (strlen(namespace) >= sizeof(batch->namespace))
     {
-        // Get the file size
-        fseek(nvsFile, 0L, SEEK_END);
-        size_t fsize = ftell(nvsFile);
-        fseek(nvsFile, 0L, SEEK_SET);
+        ESP_LOGE("NVS", "%s namespace %s is too long", __func__, namespace);
+        batch->failed = true;
+        return false;
+    }
+    strcpy(batch->namespace, namespace);
+    return true;
+}
 
-        // Read the file
-        char fbuf[fsize + 1];
-        fbuf[fsize] = 0;
-        if (fsize == fread(fbuf, 1, fsize, nvsFile))
-        {
-            // Close the file
-            fclose(nvsFile);
+/**
+ * @brief Stage a 32 bit value to be written when the batch is committed
+ *
+ * @param batch The batch to stage the write in
+ * @param key The key for the value to write
+ * @param val The value to write
+ * @return true if the write was staged, false if it was not
+ */
+bool nvsBatchWrite32(nvsBatch_t* batch, const char* key, int32_t val)
+{
+    nvsBatchEntry_t* entry = nvsBatchStage(batch, NVS_BATCH_WRITE_32, key, 0);
+    if (NULL != entry)
+    {
+        entry->val = val;
+    }
+    return (NULL != entry);
+}
 
-            // Parse the JSON
-            cJSON* json   = cJSON_Parse(fbuf);
-            cJSON* jsonNs = cJSON_GetObjectItemCaseSensitive(json, namespace);
-            bool result   = false;
+/**
+ * @brief Stage a blob to be written when the batch is committed. The blob is copied, so it doesn't need to stay valid
+ *
+ * @param batch The batch to stage the write in
+ * @param key The key for the value to write
+ * @param value The blob value to write
+ * @param length The length of the blob
+ * @return true if the write was staged, false if it was not
+ */
+bool nvsBatchWriteBlob(nvsBatch_t* batch, const char* key, const void* value, size_t length)
+{
+    nvsBatchEntry_t* entry = nvsBatchStage(batch, NVS_BATCH_WRITE_BLOB, key, length);
+    if (NULL != entry)
+    {
+        memcpy(entry->blob, value, length);
+    }
+    return (NULL != entry);
+}
 
-            if (NULL != jsonNs && cJSON_IsObject(jsonNs))
-            {
-                result = (cJSON_GetArraySize(jsonNs) != 0);
-            }
+/**
+ * @brief Stage a key to be erased when the batch is committed. Erasing a key which doesn't exist is not an error
+ *
+ * @param batch The batch to stage the erase in
+ * @param key The NVS key to be deleted
+ * @return true if the erase was staged, false if it was not
+ */
+bool nvsBatchErase(nvsBatch_t* batch, const char* key)
+{
+    return (NULL != nvsBatchStage(batch, NVS_BATCH_ERASE, key, 0));
+}
 
-            cJSON_Delete(json);
-            return result;
-        }
-        else
+/**
+ * @brief Commit a batch. Every staged write is applied in order, then the NVS file is written right away, like the
+ * Swadge's single commit. The batch's memory is freed whether or not this succeeds.
+ *
+ * @param batch The batch to commit
+ * @return true if every staged write was committed, false if any write failed to stage or to commit
+ */
+bool nvsBatchCommit(nvsBatch_t* batch)
+{
+    if (batch->failed)
+    {
+        ESP_LOGE("NVS", "%s batch for %s had a staging error, nothing was written", __func__, batch->namespace);
+        nvsBatchAbort(batch);
+        return false;
+    }
+    else if (0 == batch->numWrites)
+    {
+        return true;
+    }
+
+    int64_t startUs = esp_timer_get_time();
+    bool retVal     = (NULL != nvsJson);
+
+    for (nvsBatchEntry_t* entry = batch->first; NULL != entry && retVal; entry = entry->next)
+    {
+        switch (entry->op)
         {
-            fclose(nvsFile);
+            case NVS_BATCH_WRITE_32:
+            {
+                retVal = nvsSetItem(batch->namespace, entry->key, cJSON_CreateNumber(entry->val));
+                break;
+            }
+            case NVS_BATCH_WRITE_BLOB:
+            {
+                char* blobStr = blobToStr(entry->blob, entry->length);
+                retVal        = nvsSetItem(batch->namespace, entry->key, cJSON_CreateString(blobStr));
+                free(blobStr);
+                break;
+            }
+            case NVS_BATCH_ERASE:
+            {
+                // Erasing a key which doesn't exist leaves NVS how the caller wanted it
+                emuNvsNamespace_t* ns = nvsGetNamespace(batch->namespace, false);
+                if (NULL != ns && NULL != hashRemove(&ns->keys, entry->key))
+                {
+                    cJSON_DeleteItemFromObjectCaseSensitive(ns->obj, entry->key);
+                    nvsMarkDirty();
+                }
+                break;
+            }
         }
     }
-    return false;
+
+    // Write the whole batch to the file at once
+    nvsFlush();
+    retVal = retVal && !nvsDirty;
+
+    nvsRecordTiming(startUs, batch->numWrites);
+    nvsBatchAbort(batch);
+    return retVal;
+}
+
+/**
+ * @brief Drop a batch's staged writes without writing anything, and free the batch's memory
+ *
+ * @param batch The batch to drop
+ */
+void nvsBatchAbort(nvsBatch_t* batch)
+{
+    nvsBatchEntry_t* entry = batch->first;
+    while (NULL != entry)
+    {
+        nvsBatchEntry_t* next = entry->next;
+        heap_caps_free(entry);
+        entry = next;
+    }
+    batch->first     = NULL;
+    batch->last      = NULL;
+    batch->numWrites = 0;
+}
+
+/**
+ * @brief Read the time spent writing to NVS
+ *
+ * @param outTiming The timing totals will be written to this memory
+ */
+void readNvsTiming(nvsTiming_t* outTiming)
+{
+    *outTiming = nvsTiming;
+}
+
+/**
+ * @brief Clear the time spent writing to NVS
+ */
+void resetNvsTiming(void)
+{
+    memset(&nvsTiming, 0, sizeof(nvsTiming));
 }
 
 /**
@@ -1084,6 +933,266 @@ static FILE* openNvsFile(const char* mode)
     return fopen(buffer, mode);
 }
 
+/**
+ * @brief Read and parse the NVS file into nvsJson, and index its namespaces and keys
+ *
+ * @return true if the file was read, false if it wasn't
+ */
+static bool nvsLoad(void)
+{
+    nvsUnload();
+
+    FILE* nvsFile = openNvsFile("rb");
+    if (NULL == nvsFile)
+    {
+        return false;
+    }
+
+    // Get the file size
+    fseek(nvsFile, 0L, SEEK_END);
+    size_t fsize = ftell(nvsFile);
+    fseek(nvsFile, 0L, SEEK_SET);
+
+    // Read the file
+    char* fbuf    = heap_caps_malloc(fsize + 1, MALLOC_CAP_8BIT);
+    bool readFile = (NULL != fbuf) && (fsize == fread(fbuf, 1, fsize, nvsFile));
+    fclose(nvsFile);
+
+    if (!readFile)
+    {
+        free(fbuf);
+        return false;
+    }
+
+    // Parse the JSON. If the file is corrupt, start empty, but don't overwrite it until something is written
+    fbuf[fsize] = 0;
+    nvsJson     = cJSON_Parse(fbuf);
+    free(fbuf);
+    if (!cJSON_IsObject(nvsJson))
+    {
+        printf("Could not parse NVS file %s\n", NVS_JSON_FILE);
+        cJSON_Delete(nvsJson);
+        nvsJson = cJSON_CreateObject();
+    }
+
+    // Index every namespace and key
+    hashInit(&nvsNamespaces, 8);
+    cJSON* jsonNs;
+    cJSON_ArrayForEach(jsonNs, nvsJson)
+    {
+        if (NULL != jsonNs->string && cJSON_IsObject(jsonNs))
+        {
+            emuNvsNamespace_t* ns = heap_caps_malloc(sizeof(emuNvsNamespace_t), MALLOC_CAP_8BIT);
+            ns->obj               = jsonNs;
+            hashInit(&ns->keys, 32);
+
+            cJSON* jsonIter;
+            cJSON_ArrayForEach(jsonIter, jsonNs)
+            {
+                if (NULL != jsonIter->string)
+                {
+                    hashPut(&ns->keys, jsonIter->string, jsonIter);
+                }
+            }
+            hashPut(&nvsNamespaces, jsonNs->string, ns);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Free nvsJson and its index without writing it to the file
+ */
+static void nvsUnload(void)
+{
+    if (NULL == nvsJson)
+    {
+        return;
+    }
+
+    hashIterator_t iter = {0};
+    while (hashIterate(&nvsNamespaces, &iter))
+    {
+        emuNvsNamespace_t* ns = iter.value;
+        hashDeinit(&ns->keys);
+        free(ns);
+        hashIterRemove(&nvsNamespaces, &iter);
+    }
+    hashDeinit(&nvsNamespaces);
+
+    cJSON_Delete(nvsJson);
+    nvsJson  = NULL;
+    nvsDirty = false;
+}
+
+/**
+ * @brief Get a namespace from the index
+ *
+ * @param namespace The name of the namespace
+ * @param create true to create the namespace if it doesn't exist
+ * @return The namespace, or NULL if it doesn't exist and wasn't created
+ */
+static emuNvsNamespace_t* nvsGetNamespace(const char* namespace, bool create)
+{
+    if (NULL == nvsJson)
+    {
+        return NULL;
+    }
+
+    emuNvsNamespace_t* ns = hashGet(&nvsNamespaces, namespace);
+    if (NULL == ns && create)
+    {
+        ns      = heap_caps_malloc(sizeof(emuNvsNamespace_t), MALLOC_CAP_8BIT);
+        ns->obj = cJSON_AddObjectToObject(nvsJson, namespace);
+        hashInit(&ns->keys, 32);
+        hashPut(&nvsNamespaces, ns->obj->string, ns);
+    }
+    return ns;
+}
+
+/**
+ * @brief Get an item from the index
+ *
+ * @param namespace The namespace of the item
+ * @param key The key of the item
+ * @return The item, or NULL if it doesn't exist
+ */
+static cJSON* nvsGetItem(const char* namespace, const char* key)
+{
+    emuNvsNamespace_t* ns = nvsGetNamespace(namespace, false);
+    return (NULL == ns) ? NULL : hashGet(&ns->keys, key);
+}
+
+/**
+ * @brief Add or replace an item and schedule it to be written to the file
+ *
+ * @param namespace The namespace of the item
+ * @param key The key of the item
+ * @param item The new item, which is owned by nvsJson afterwards
+ * @return true if the item was set, false if NVS isn't loaded
+ */
+static bool nvsSetItem(const char* namespace, const char* key, cJSON* item)
+{
+    emuNvsNamespace_t* ns = nvsGetNamespace(namespace, true);
+    if (NULL == ns || NULL == item)
+    {
+        cJSON_Delete(item);
+        return false;
+    }
+
+    // The index points at the old item's key, so remove it before the old item is freed
+    if (NULL != hashRemove(&ns->keys, key))
+    {
+        cJSON_ReplaceItemInObjectCaseSensitive(ns->obj, key, item);
+    }
+    else
+    {
+        cJSON_AddItemToObject(ns->obj, key, item);
+    }
+    hashPut(&ns->keys, item->string, item);
+
+    nvsMarkDirty();
+    return true;
+}
+
+/**
+ * @brief Note that nvsJson has unsaved writes, and start the timer to write them if it isn't already running
+ */
+static void nvsMarkDirty(void)
+{
+    if (nvsDirty)
+    {
+        // The timer is already running, this write will be coalesced with the others
+        return;
+    }
+    nvsDirty = true;
+
+    if (NULL == nvsFlushTimer)
+    {
+        esp_timer_create_args_t nvsFlushTimerArgs = {
+            .callback              = nvsFlushTimerCb,
+            .arg                   = NULL,
+            .dispatch_method       = ESP_TIMER_TASK,
+            .name                  = "nvsFlush",
+            .skip_unhandled_events = true,
+        };
+        esp_timer_create(&nvsFlushTimerArgs, &nvsFlushTimer);
+    }
+    esp_timer_start_once(nvsFlushTimer, NVS_FLUSH_DELAY_US);
+}
+
+/**
+ * @brief Write nvsJson to the NVS file if it has unsaved writes. The JSON is written to a temporary file first, which
+ * then replaces the NVS file, so the NVS file is never left half written.
+ */
+static void nvsFlush(void)
+{
+    if (!nvsDirty || NULL == nvsJson)
+    {
+        return;
+    }
+
+    if (NULL != nvsFlushTimer)
+    {
+        esp_timer_stop(nvsFlushTimer);
+    }
+
+    char path[1024];
+    char tmpPath[1024 + 4];
+    expandPath(path, sizeof(path), NVS_JSON_FILE);
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+
+    char* jsonStr = cJSON_Print(nvsJson);
+    FILE* tmpFile = fopen(tmpPath, "wb");
+    if (NULL == jsonStr || NULL == tmpFile)
+    {
+        printf("Could not write NVS file %s\n", tmpPath);
+        free(jsonStr);
+        if (NULL != tmpFile)
+        {
+            fclose(tmpFile);
+        }
+        return;
+    }
+
+    size_t len   = strlen(jsonStr);
+    bool written = (len == fwrite(jsonStr, 1, len, tmpFile));
+    written      = (0 == fclose(tmpFile)) && written;
+    free(jsonStr);
+
+    if (written)
+    {
+        // rename() doesn't replace an existing file on Windows
+        if (0 != rename(tmpPath, path))
+        {
+            remove(path);
+            written = (0 == rename(tmpPath, path));
+        }
+    }
+
+    if (written)
+    {
+        nvsDirty = false;
+    }
+    else
+    {
+        // Try again later
+        printf("Could not write NVS file %s\n", path);
+        remove(tmpPath);
+        esp_timer_start_once(nvsFlushTimer, NVS_FLUSH_DELAY_US);
+    }
+}
+
+/**
+ * @brief Timer callback which writes coalesced writes to the NVS file
+ *
+ * @param arg Unused
+ */
+static void nvsFlushTimerCb(void* arg)
+{
+    nvsFlush();
+}
+
 void emuInjectNvsBlob(const char* namespace, const char* key, size_t length, const void* blob)
 {
     if (!nvsInjectedDataInit)
@@ -1223,3 +1332,74 @@ static bool emuGetInjected32(const char* namespace, const char* key, int32_t* ou
 
     return false;
 }
+
+/**
+ * @brief Allocate a staged write and add it to the end of a batch
+ *
+ * @param batch The batch to add the write to
+ * @param op The kind of write
+ * @param key The key to write
+ * @param length The length of the blob to copy into the write, or 0
+ * @return The staged write, or NULL if it couldn't be staged. If NULL, the batch won't be committed
+ */
+static nvsBatchEntry_t* nvsBatchStage(nvsBatch_t* batch, nvsBatchOp_t op, const char* key, size_t length)
+{
+    if (batch->failed)
+    {
+        return NULL;
+    }
+
+    nvsBatchEntry_t* entry = NULL;
+    if (strlen(key) >= sizeof(entry->key))
+    {
+        ESP_LOGE("NVS", "%s key %s is too long", __func__, key);
+    }
+    else if (NULL == (entry = heap_caps_calloc(1, sizeof(nvsBatchEntry_t) + length, MALLOC_CAP_8BIT)))
+    {
+        ESP_LOGE("NVS", "%s couldn't allocate %s", __func__, key);
+    }
+
+    if (NULL == entry)
+    {
+        batch->failed = true;
+        return NULL;
+    }
+
+    entry->op     = op;
+    entry->length = length;
+    strcpy(entry->key, key);
+
+    if (NULL == batch->last)
+    {
+        batch->first = entry;
+    }
+    else
+    {
+        batch->last->next = entry;
+    }
+    batch->last = entry;
+    batch->numWrites++;
+    return entry;
+}
+
+/**
+ * @brief Add a commit to the timing totals
+ *
+ * @param startUs The time the commit started, from esp_timer_get_time()
+ * @param numWrites The number of keys written or erased by the commit
+ */
+static void nvsRecordTiming(int64_t startUs, uint16_t numWrites)
+{
+    int64_t elapsedUs = esp_timer_get_time() - startUs;
+
+    nvsTiming.numCommits++;
+    nvsTiming.numWrites += numWrites;
+    nvsTiming.lastUs = elapsedUs;
+    nvsTiming.totalUs += elapsedUs;
+    if (elapsedUs > nvsTiming.maxUs)
+    {
+        nvsTiming.maxUs = elapsedUs;
+    }
+
+    ESP_LOGD("NVS", "Committed %" PRIu16 " write(s) in %" PRId64 "us", numWrites, elapsedUs);
+}
@@ -43,6 +43,7 @@
 #include "trigonometry.h"
 
 #include "hdw-esp-now.h"
+#include "emu_net_sim.h"
 #include "esp_random_emu.h"
 #include "mainMenu.h"
 
@@ -130,6 +131,7 @@ void signalHandler_crash(int signum, siginfo_t* si, void* vcontext);
 
 static void drawBitmapPixel(uint32_t* bitmapDisplay, int w, int h, int x, int y, uint32_t col);
 static void EmuSoundCb(struct CNFADriver* sd, short* out, short* in, int framesp, int framesr);
+static void emuWriteHeapProfile(void);
 void handleArgs(int argc, char** argv);
 
 //==============================================================================
@@ -197,6 +199,9 @@ int main(int argc, char** argv)
         emulatorSetEspRandomSeed(emulatorArgs.seed);
     }
 
+    // The packet trace covers every mode, so it stays open while ESP-NOW is initialized and deinitialized
+    emuNetSimOpenTrace();
+
     // First initialize rawdraw
     // Screen-specific configurations
     // Save window dimensions from the last loop
@@ -302,11 +307,18 @@ void taskYIELD(void)
         if (!isRunning)
         {
             deinitSystem();
+            emuNetSimCloseTrace();
             // This is registered with atexit()
             // CNFGTearDown();
 
             deinitExtensions();
 
+            // Everything was freed, so any memory still used in the profile was leaked
+            if (emulatorArgs.heapProfile)
+            {
+                emuWriteHeapProfile();
+            }
+
 #ifdef ENABLE_GCOV
             __gcov_dump();
 #endif
@@ -657,6 +669,30 @@ int HandleDestroy()
     #pragma GCC diagnostic pop
 #endif
 
+/**
+ * @brief Write the heap profile to the file given with \c --heap-profile, or to stdout if no file was given
+ */
+static void emuWriteHeapProfile(void)
+{
+    FILE* out = stdout;
+    if (NULL != emulatorArgs.heapProfileFile)
+    {
+        out = fopen(emulatorArgs.heapProfileFile, "w");
+        if (NULL == out)
+        {
+            fprintf(stderr, "Couldn't open heap profile file %s\n", emulatorArgs.heapProfileFile);
+            return;
+        }
+    }
+
+    writeHeapProfile(out);
+
+    if (stdout != out)
+    {
+        fclose(out);
+    }
+}
+
 /**
  * @brief Callback for sound events, both input and output
  * Handle output here, pass input to handleSoundInput()
@@ -76,6 +76,7 @@ static const struct option* findOption(char shortOpt, const char* longOpt);
 static void getOptionsStr(char* buffer, int buflen);
 static void printColWordWrap(const char* text, int* col, int startCol, int wrapCol);
 static bool parseBoolArg(const char* val, bool defaultValue);
+static bool parseNetSimArg(const char* val);
 
 //==============================================================================
 // Variables
@@ -123,6 +124,18 @@ emuArgs_t emulatorArgs = {
     .vsync = true,
 
     .joystick = NULL,
+
+    .netSim       = false,
+    .netLatencyMs = 0,
+    .netJitterMs  = 0,
+    .netLossPct   = 0.0,
+    .netRssi      = 0x7F,
+    .netKbps      = 0,
+    .netTrace     = NULL,
+
+    .heapProfile     = false,
+    .heapProfileFile = NULL,
+    .heapTrace       = NULL,
 };
 
 static const char mainDoc[] = "Emulates a swadge";
@@ -139,6 +152,8 @@ static const char argFuzzTouch[]   = "fuzz-touch";
 static const char argFuzzTime[]    = "fuzz-time";
 static const char argFuzzMotion[]  = "fuzz-motion";
 static const char argHeadless[]    = "headless";
+static const char argHeapProfile[] = "heap-profile";
+static const char argHeapTrace[]   = "heap-trace";
 static const char argHideLeds[]    = "hide-leds";
 static const char argJoystick[]    = "joystick";
 static const char argJsPreset[]    = "preset";
@@ -148,6 +163,8 @@ static const char argMidiFile[]    = "midi-file";
 static const char argMode[]        = "mode";
 static const char argModeSwitch[]  = "mode-switch";
 static const char argModeList[]    = "modes-list";
+static const char argNetSim[]      = "net-sim";
+static const char argNetTrace[]    = "net-trace";
 static const char argPlayback[]    = "playback";
 static const char argRecord[]      = "record";
 static const char argScreensaver[] = "screensaver";
@@ -173,6 +190,8 @@ static const struct option options[] =
     { argFuzzTouch,   optional_argument, (int*)&emulatorArgs.fuzzTouch,    true },
     { argFuzzMotion,  optional_argument, (int*)&emulatorArgs.fuzzMotion,   true },
     { argHeadless,    no_argument,       (int*)&emulatorArgs.headless,     true },
+    { argHeapProfile, optional_argument, NULL,                             0    },
+    { argHeapTrace,   required_argument, NULL,                             0    },
     { argHideLeds,    no_argument,       (int*)&emulatorArgs.hideLeds,     true },
     { argJoystick,    required_argument, (int*)&emulatorArgs.joystick,     'j'  },
     { argJsPreset,    required_argument, (int*)&emulatorArgs.jsPreset,     0    },
@@ -187,6 +206,8 @@ static const struct option options[] =
     { argShowFps,     optional_argument, (int*)&emulatorArgs.showFps,      'c'  },
     { argModeSwitch,  optional_argument, NULL,                             10   },
     { argModeList,    no_argument,       NULL,                             0    },
+    { argNetSim,      required_argument, NULL,                             0    },
+    { argNetTrace,    required_argument, NULL,                             0    },
     { argTouch,       no_argument,       (int*)&emulatorArgs.emulateTouch, 't'  },
     { argVsync,       optional_argument, (int*)&emulatorArgs.vsync,        true },
     { argHelp,        no_argument,       NULL,                             'h'  },
@@ -208,6 +229,8 @@ static const optDoc_t argDocs[] =
     { 0,  argFuzzTime,    "y|n",   "Set whether frame durations are fuzzed" },
     { 0,  argFuzzMotion,  "y|n",   "Set whether motion inputs are fuzzed" },
     { 0,  argHeadless,    NULL,    "Runs the emulator without a window." },
+    { 0,  argHeapProfile, "FILE",  "Write memory allocated per tag to a CSV file, or stdout, when exiting" },
+    { 0,  argHeapTrace,   "FILE",  "Write memory used each frame to a CSV file, or a Chrome trace if FILE is .json" },
     {'j', argJoystick,   "JOYDEV", "Sets the joystick device to use." },
     { 0,  argJsPreset,   "PRESET", "Sets the joystick config preset to use. PRESET can be swadge or switch"},
     { 0,  argHideLeds,    NULL,    "Don't draw simulated LEDs next to the display" },
@@ -217,6 +240,8 @@ static const optDoc_t argDocs[] =
     {'m', argMode,        "MODE",  "Start the emulator in the swadge mode MODE instead of the main menu"},
     { 0,  argModeSwitch,  "TIME",  "Enable or set the timer to switch modes automatically" },
     { 0,  argModeList,    NULL,    "Print out a list of all possible values for MODE" },
+    { 0,  argNetSim,      "SPEC",  "Simulate a network. SPEC is like latency=20,jitter=10,loss=5,rssi=-50,kbps=1000" },
+    { 0,  argNetTrace,    "FILE",  "Write every ESP-NOW packet sent, received, or dropped to a CSV file" },
     {'p', argPlayback,    "FILE",  "Play back recorded emulator inputs from a file" },
     {'r', argRecord,      "FILE",  "Record emulator inputs to a file" },
     {'s', argSeed,        "SEED",  "Seed the random number generator with a specific value" },
@@ -369,6 +394,28 @@ static bool handleArgument(const char* optName, const char* arg, int optVal)
             emulatorArgs.modeSwitchTime = optVal;
         }
     }
+    else if (argNetSim == optName)
+    {
+        if (!parseNetSimArg(arg))
+        {
+            printf("ERR: Invalid network simulator spec '%s'\n", arg);
+            return false;
+        }
+        emulatorArgs.netSim = true;
+    }
+    else if (argNetTrace == optName)
+    {
+        emulatorArgs.netTrace = arg;
+    }
+    else if (argHeapProfile == optName)
+    {
+        emulatorArgs.heapProfile     = true;
+        emulatorArgs.heapProfileFile = arg;
+    }
+    else if (argHeapTrace == optName)
+    {
+        emulatorArgs.heapTrace = arg;
+    }
     else if (argRecord == optName)
     {
         if (emulatorArgs.playback)
@@ -1070,3 +1117,72 @@ static bool parseBoolArg(const char* val, bool defaultValue)
 
     return false;
 }
+
+/**
+ * @brief Parse the network simulator spec, a comma separated list of key=value pairs, into ::emulatorArgs
+ *
+ * @param val The spec, like "latency=20,jitter=10,loss=5"
+ * @return true if every pair in the spec was valid
+ * @return false if the spec was missing or had an unknown key or bad value
+ */
+static bool parseNetSimArg(const char* val)
+{
+    if (NULL == val)
+    {
+        return false;
+    }
+
+    while (*val)
+    {
+        char key[16];
+        float num;
+        int used = 0;
+        if (2 != sscanf(val, "%15[^=,]=%f%n", key, &num, &used))
+        {
+            return false;
+        }
+
+        // Only the RSSI may be negative
+        if (num < 0.0f && strcmp(key, "rssi"))
+        {
+            return false;
+        }
+
+        if (!strcmp(key, "latency"))
+        {
+            emulatorArgs.netLatencyMs = num;
+        }
+        else if (!strcmp(key, "jitter"))
+        {
+            emulatorArgs.netJitterMs = num;
+        }
+        else if (!strcmp(key, "loss"))
+        {
+            emulatorArgs.netLossPct = MIN(num, 100.0f);
+        }
+        else if (!strcmp(key, "rssi"))
+        {
+            emulatorArgs.netRssi = CLAMP(num, -128, 127);
+        }
+        else if (!strcmp(key, "kbps"))
+        {
+            emulatorArgs.netKbps = num;
+        }
+        else
+        {
+            return false;
+        }
+
+        // Move on to the next pair
+        val += used;
+        if (',' == *val)
+        {
+            val++;
+        }
+        else if (*val)
+        {
+            return false;
+        }
+    }
+    return true;
+}
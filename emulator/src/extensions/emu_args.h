@@ -85,6 +85,40 @@ typedef struct
 
     // Joystick config preset name
     const char* jsPreset;
+
+    // Network Simulator
+
+    /// @brief Whether to pass received ESP-NOW packets through the network simulator
+    bool netSim;
+
+    /// @brief The delay added to every simulated packet, in milliseconds
+    uint32_t netLatencyMs;
+
+    /// @brief The largest random delay added on top of netLatencyMs, in milliseconds
+    uint32_t netJitterMs;
+
+    /// @brief The percentage of simulated packets to drop
+    float netLossPct;
+
+    /// @brief The RSSI simulated packets are received with
+    int8_t netRssi;
+
+    /// @brief The simulated bandwidth in kilobits per second, or 0 for unlimited
+    uint32_t netKbps;
+
+    /// @brief Name of the file to write a packet trace to, or NULL for none
+    const char* netTrace;
+
+    // Heap Profiler
+
+    /// @brief Whether to write a heap profile when the emulator exits
+    bool heapProfile;
+
+    /// @brief Name of the file to write the heap profile to, or NULL for stdout
+    const char* heapProfileFile;
+
+    /// @brief Name of the file to write a heap usage trace to, or NULL for none
+    const char* heapTrace;
 } emuArgs_t;
 
 //==============================================================================
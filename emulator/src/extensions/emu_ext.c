@@ -23,6 +23,7 @@
 #include "ext_replay.h"
 #include "ext_tools.h"
 #include "ext_screensaver.h"
+#include "ext_heap.h"
 
 //==============================================================================
 // Registered Extensions
@@ -35,6 +36,7 @@
 static const emuExtension_t* registeredExtensions[] = {
     &touchEmuCallback,  &ledEmuExtension,     &fuzzerEmuExtension, &toolsEmuExtension, &keymapEmuCallback,
     &modesEmuExtension, &gamepadEmuExtension, &replayEmuExtension, &midiEmuExtension,  &screensaverEmuExtension,
+    &heapEmuExtension,
 };
 
 //==============================================================================
@@ -0,0 +1,323 @@
+/**
+ * @file ext_heap.c
+ * @brief Records the memory used by the Swadge each frame, and the peak memory used by each Swadge mode
+ *
+ * Enabled with the \c --heap-trace option. After every frame, the memory allocated in internal RAM and SPIRAM, the
+ * free SPIRAM, and the largest free SPIRAM block are written to the trace, along with the memory allocated with each
+ * tag which changed since the last frame. If the trace file ends in \c .json it is written in the Chrome trace event
+ * format, which can be opened with \c chrome://tracing or Perfetto. Otherwise it is written as CSV.
+ *
+ * Each Swadge mode's peak memory is tracked separately for its first frame, which includes fnEnterMode(), and for the
+ * rest of the time it runs. The peaks are the high-water marks kept by the allocator, so memory which is allocated and
+ * freed within a frame is counted. In the frame where the mode switches, the peak before the least memory was allocated
+ * goes to the old mode, and the peak after it goes to the new one. The peaks are printed, compared to the SPIRAM
+ * budget, when the emulator exits.
+ */
+
+//==============================================================================
+// Includes
+//==============================================================================
+
+#include "ext_heap.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+
+#include "swadge2024.h"
+#include "emu_args.h"
+#include "macros.h"
+
+//==============================================================================
+// Defines
+//==============================================================================
+
+/// The number of Swadge modes peaks are tracked for
+#define HEAP_MAX_MODES 64
+
+//==============================================================================
+// Structs
+//==============================================================================
+
+/**
+ * @brief The peak memory used by a Swadge mode. Index 0 of each array is internal memory, index 1 is SPIRAM
+ */
+typedef struct
+{
+    const swadgeMode_t* mode; ///< The Swadge mode
+    size_t enterPeak[2];      ///< The most memory used in the mode's first frame, which includes fnEnterMode()
+    size_t runPeak[2];        ///< The most memory used in any later frame
+} heapModePeaks_t;
+
+//==============================================================================
+// Function Prototypes
+//==============================================================================
+
+static bool heapInit(emuArgs_t* args);
+static void heapDeinit(void);
+static void heapPostFrame(uint64_t frame);
+static heapModePeaks_t* heapGetModePeaks(const swadgeMode_t* mode);
+static void heapTraceEvent(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+static void heapTraceTags(int64_t timeUs, uint64_t frame, const char* modeName);
+
+//==============================================================================
+// Variables
+//==============================================================================
+
+const emuExtension_t heapEmuExtension = {
+    .name            = "heap",
+    .fnInitCb        = heapInit,
+    .fnDeinitCb      = heapDeinit,
+    .fnPreFrameCb    = NULL,
+    .fnPostFrameCb   = heapPostFrame,
+    .fnKeyCb         = NULL,
+    .fnMouseMoveCb   = NULL,
+    .fnMouseButtonCb = NULL,
+    .fnRenderCb      = NULL,
+};
+
+/// The trace file
+static FILE* traceFile = NULL;
+/// true if the trace is written as a Chrome trace, false if it's CSV
+static bool chromeTrace = false;
+/// true until the first Chrome trace event is written
+static bool firstEvent = true;
+
+/// The memory allocated with each tag when it was last written to the trace
+static size_t lastTagUsed[HEAP_MAX_TAGS][2];
+
+/// The peak memory used by each Swadge mode
+static heapModePeaks_t modePeaks[HEAP_MAX_MODES];
+/// The number of Swadge modes in modePeaks
+static int numModePeaks = 0;
+/// The Swadge mode in the last frame
+static const swadgeMode_t* lastMode = NULL;
+
+//==============================================================================
+// Functions
+//==============================================================================
+
+/**
+ * @brief Open the trace file if the \c --heap-trace option was given
+ *
+ * @param args The emulator's arguments
+ * @return true if the extension is enabled, false if it isn't
+ */
+static bool heapInit(emuArgs_t* args)
+{
+    if (NULL == args->heapTrace)
+    {
+        return false;
+    }
+
+    traceFile = fopen(args->heapTrace, "w");
+    if (NULL == traceFile)
+    {
+        fprintf(stderr, "Couldn't open heap trace file %s\n", args->heapTrace);
+        return false;
+    }
+
+    const char* ext = strrchr(args->heapTrace, '.');
+    chromeTrace     = (NULL != ext && 0 == strcmp(ext, ".json"));
+    firstEvent      = true;
+    if (chromeTrace)
+    {
+        fprintf(traceFile, "[\n");
+    }
+    else
+    {
+        fprintf(traceFile, "timeUs,frame,mode,tag,intUsed,spiUsed,spiFree,spiLargestFree\n");
+    }
+
+    memset(lastTagUsed, 0, sizeof(lastTagUsed));
+    numModePeaks = 0;
+    lastMode     = NULL;
+    resetHeapPeaks();
+    return true;
+}
+
+/**
+ * @brief Close the trace file and print each Swadge mode's peak memory
+ */
+static void heapDeinit(void)
+{
+    if (NULL != traceFile)
+    {
+        if (chromeTrace)
+        {
+            fprintf(traceFile, "\n]\n");
+        }
+        fclose(traceFile);
+        traceFile = NULL;
+    }
+
+    size_t budget = heap_caps_get_total_size(MALLOC_CAP_SPIRAM);
+    printf("Peak memory by mode, SPIRAM budget is %zu bytes\n", budget);
+    printf("%s,%s,%s,%s,%s,%s\n", "Mode", "Enter INT", "Enter SPI", "Run INT", "Run SPI", "SPI Budget %");
+    for (int i = 0; i < numModePeaks; i++)
+    {
+        heapModePeaks_t* mp = &modePeaks[i];
+        size_t spiPeak      = MAX(mp->enterPeak[1], mp->runPeak[1]);
+        printf("%s,%zu,%zu,%zu,%zu,%.1f\n", mp->mode->modeName, mp->enterPeak[0], mp->enterPeak[1], mp->runPeak[0],
+               mp->runPeak[1], budget ? (100.0 * spiPeak) / budget : 0.0);
+    }
+}
+
+/**
+ * @brief Sample the memory used after each frame, update the Swadge mode's peaks, and write the trace
+ *
+ * @param frame The frame number
+ */
+static void heapPostFrame(uint64_t frame)
+{
+    int64_t timeUs               = esp_timer_get_time();
+    const swadgeMode_t* mode     = getSwadgeMode();
+    const swadgeMode_t* prevMode = lastMode;
+    bool modeChanged             = (mode != lastMode);
+    lastMode                     = mode;
+
+    size_t used[2];
+    getHeapUsed(&used[0], &used[1]);
+    size_t spiFree    = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    size_t spiLargest = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM);
+
+    // Use the high-water marks since the last frame, so short peaks like ones inside fnEnterMode() aren't missed
+    heapPeaks_t peaks;
+    getHeapPeaks(&peaks);
+    resetHeapPeaks();
+
+    heapModePeaks_t* mp = heapGetModePeaks(mode);
+    if (modeChanged)
+    {
+        // The old mode exited during this frame, so the peak before the low point was still the old mode's
+        heapModePeaks_t* prevMp = heapGetModePeaks(prevMode);
+        if (NULL != prevMp)
+        {
+            prevMp->runPeak[0] = MAX(prevMp->runPeak[0], peaks.beforeLow[0]);
+            prevMp->runPeak[1] = MAX(prevMp->runPeak[1], peaks.beforeLow[1]);
+        }
+
+        // The first frame of a mode includes the memory allocated by fnEnterMode()
+        if (NULL != mp)
+        {
+            mp->enterPeak[0] = MAX(mp->enterPeak[0], peaks.afterLow[0]);
+            mp->enterPeak[1] = MAX(mp->enterPeak[1], peaks.afterLow[1]);
+        }
+    }
+    else if (NULL != mp)
+    {
+        mp->runPeak[0] = MAX(mp->runPeak[0], MAX(peaks.beforeLow[0], peaks.afterLow[0]));
+        mp->runPeak[1] = MAX(mp->runPeak[1], MAX(peaks.beforeLow[1], peaks.afterLow[1]));
+    }
+
+    const char* modeName = (NULL != mode) ? mode->modeName : "";
+    if (chromeTrace)
+    {
+        if (modeChanged)
+        {
+            heapTraceEvent("{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%" PRId64 ",\"pid\":1,\"tid\":1}", modeName,
+                           timeUs);
+        }
+        heapTraceEvent("{\"name\":\"heap\",\"ph\":\"C\",\"ts\":%" PRId64 ",\"pid\":1,\"args\":{\"internal\":%zu,"
+                       "\"spiram\":%zu,\"spiramFree\":%zu,\"spiramLargestFree\":%zu}}",
+                       timeUs, used[0], used[1], spiFree, spiLargest);
+    }
+    else
+    {
+        fprintf(traceFile, "%" PRId64 ",%" PRIu64 ",%s,*,%zu,%zu,%zu,%zu\n", timeUs, frame, modeName, used[0], used[1],
+                spiFree, spiLargest);
+    }
+
+    heapTraceTags(timeUs, frame, modeName);
+}
+
+/**
+ * @brief Find or add the peaks for a Swadge mode
+ *
+ * @param mode The Swadge mode
+ * @return The Swadge mode's peaks, or NULL if too many modes were run
+ */
+static heapModePeaks_t* heapGetModePeaks(const swadgeMode_t* mode)
+{
+    if (NULL == mode)
+    {
+        return NULL;
+    }
+
+    for (int i = 0; i < numModePeaks; i++)
+    {
+        if (modePeaks[i].mode == mode)
+        {
+            return &modePeaks[i];
+        }
+    }
+
+    if (numModePeaks < HEAP_MAX_MODES)
+    {
+        heapModePeaks_t* mp = &modePeaks[numModePeaks++];
+        memset(mp, 0, sizeof(heapModePeaks_t));
+        mp->mode = mode;
+        return mp;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Write an event to the Chrome trace, separated from the previous event
+ *
+ * @param fmt The printf() format of the event
+ * @param ... The format arguments
+ */
+static void heapTraceEvent(const char* fmt, ...)
+{
+    if (!firstEvent)
+    {
+        fprintf(traceFile, ",\n");
+    }
+    firstEvent = false;
+
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(traceFile, fmt, args);
+    va_end(args);
+}
+
+/**
+ * @brief Write the memory allocated with each tag which changed since the last frame to the trace
+ *
+ * @param timeUs The time of this frame
+ * @param frame The frame number
+ * @param modeName The name of the Swadge mode which is running
+ */
+static void heapTraceTags(int64_t timeUs, uint64_t frame, const char* modeName)
+{
+    int32_t idx = 0;
+    heapTagUsage_t usage;
+    while (iterateHeapTags(&idx, &usage))
+    {
+        size_t* last = lastTagUsed[usage.idx];
+        if (last[0] == usage.used[0] && last[1] == usage.used[1])
+        {
+            continue;
+        }
+        last[0] = usage.used[0];
+        last[1] = usage.used[1];
+
+        if (chromeTrace)
+        {
+            // Tags are function names and identifiers, so they don't need to be escaped
+            heapTraceEvent("{\"name\":\"tag %s\",\"ph\":\"C\",\"ts\":%" PRId64
+                           ",\"pid\":1,\"args\":{\"internal\":%zu,\"spiram\":%zu}}",
+                           usage.tag, timeUs, usage.used[0], usage.used[1]);
+        }
+        else
+        {
+            fprintf(traceFile, "%" PRId64 ",%" PRIu64 ",%s,%s,%zu,%zu,,\n", timeUs, frame, modeName, usage.tag,
+                    usage.used[0], usage.used[1]);
+        }
+    }
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+#include "emu_ext.h"
+
+extern const emuExtension_t heapEmuExtension;
@@ -12,6 +12,7 @@
 #include "ext_screensaver.h"
 #include "hdw-nvs_emu.h"
 #include "emu_cnfs.h"
+#include "frameProfiler.h"
 
 // Console command handlers
 static int screenshotCommandCb(const char** args, int argCount, char* out);
@@ -25,6 +26,7 @@ static int ledsCommandCb(const char** args, int argCount, char* out);
 static int injectCommandCb(const char** args, int argCount, char* out);
 static int joystickCommandCb(const char** args, int argCount, char* out);
 static int attractCommandCb(const char** args, int argCount, char* out);
+static int profileCommandCb(const char** args, int argCount, char* out);
 static int helpCommandCb(const char** args, int argCount, char* out);
 
 // command, usage, description
@@ -62,6 +64,9 @@ static const char* commandDocs[][3] = {
     {"inject nvs", "inject nvs [namespace] <key> <int|str|file> <value>",
      "injects data into an NVS key. Value can be either an integer, a string, or a file path"},
     {"inject asset", "inject asset <name> <filename>", "injects a file's entire contents as an asset"},
+    {"profile", "profile [on|off]", "toggles timing the phases of the main loop"},
+    {"profile overlay", "profile overlay [on|off]", "toggles drawing the main loop timing over the display"},
+    {"profile report", "profile report", "prints the min, average, max, and 99th percentile cycles for each phase"},
     {"help", "help [command]", "prints help text for all commands, or for commands matching [command]"},
 };
 
@@ -72,6 +77,7 @@ static const consoleCommand_t consoleCommands[] = {
     {.name = "touchpad", .cb = touchCommandCb},        {.name = "leds", .cb = ledsCommandCb},
     {.name = "inject", .cb = injectCommandCb},         {.name = "help", .cb = helpCommandCb},
     {.name = "joystick", .cb = joystickCommandCb},     {.name = "attract", .cb = attractCommandCb},
+    {.name = "profile", .cb = profileCommandCb},
 };
 
 const consoleCommand_t* getConsoleCommands(void)
@@ -906,6 +912,66 @@ static int attractCommandCb(const char** args, int argCount, char* out)
     return 0;
 }
 
+static int profileCommandCb(const char** args, int argCount, char* out)
+{
+    uint8_t flags = getFrameProfilerFlags();
+
+    if (argCount > 0 && !strncmp("report", args[0], strlen(args[0])))
+    {
+        if (!(flags & FRAME_PROFILER_RECORD))
+        {
+            return sprintf(out, "The profiler is off, turn it on with 'profile on'\n");
+        }
+        printFrameProfile();
+        return 0;
+    }
+
+    // Either toggle the overlay or recording
+    uint8_t flag     = FRAME_PROFILER_RECORD;
+    const char* name = "Profiler";
+    if (argCount > 0 && !strncmp("overlay", args[0], strlen(args[0])))
+    {
+        flag = FRAME_PROFILER_OVERLAY;
+        name = "Profiler overlay";
+        args++;
+        argCount--;
+    }
+
+    bool enable = !(flags & flag);
+    if (argCount > 0)
+    {
+        if (!strncmp("on", args[0], strlen(args[0])))
+        {
+            enable = true;
+        }
+        else if (!strncmp("off", args[0], strlen(args[0])))
+        {
+            enable = false;
+        }
+        else
+        {
+            return 0;
+        }
+    }
+
+    if (enable)
+    {
+        flags |= flag;
+    }
+    else if (FRAME_PROFILER_RECORD == flag)
+    {
+        // Nothing else works without recording
+        flags = 0;
+    }
+    else
+    {
+        flags &= ~flag;
+    }
+    setFrameProfilerFlags(flags);
+
+    return sprintf(out, "%s %s\n", name, enable ? "enabled" : "disabled");
+}
+
 static int helpCommandCb(const char** args, int argCount, char* out)
 {
     char* cur = out;
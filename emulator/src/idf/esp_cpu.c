@@ -0,0 +1,17 @@
+#include <time.h>
+
+#include "esp_cpu.h"
+
+/**
+ * @brief Get the CPU's cycle count. The emulator counts cycles of a CPU running at CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ
+ * from the host's monotonic clock, so the count wraps around like it does on the Swadge
+ *
+ * @return The number of cycles
+ */
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t ns = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    return (esp_cpu_cycle_count_t)((ns * CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ) / 1000);
+}
@@ -15,11 +15,28 @@
 #define MEMORY_DEBUG
 // #define MEMORY_DEBUG_PRINT
 
+// This file is also built by the assets preprocessor, which doesn't have main/utils/macros.h
+#ifndef MIN
+    #define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef MAX
+    #define MAX(a, b) (((a) > (b)) ? (a) : (b))
+#endif
+
 #define SPIRAM_SIZE          2093904
 #define SPIRAM_LARGEST_BLOCK 2064384
 
+// The ESP32-S2's internal SRAM. Less than this is free on a Swadge, but it is only used to report what modes allocate
+#define INTERNAL_SIZE 327680
+
 #define A_TABLE_SIZE 16384
 
+// The pointer index is twice the size of the table, and must be a power of two, so probes stay short
+#define A_INDEX_SIZE (2 * A_TABLE_SIZE)
+
+// The number of different tags which totals are kept for. Must be a power of two
+#define TAG_TABLE_SIZE HEAP_MAX_TAGS
+
 //==============================================================================
 // Enums
 //==============================================================================
@@ -52,8 +69,21 @@ typedef struct
     const char* func;
     uint32_t line;
     char tag[32];
+    int32_t tagIdx; ///< The index of this allocation's tag in tagTable, or -1 if it isn't counted
 } allocation_t;
 
+/**
+ * @brief Running totals for all allocations with the same tag
+ */
+typedef struct
+{
+    char tag[32];               ///< The tag, or an empty string if this entry is unused
+    uint32_t numAllocs;         ///< The number of allocations made with this tag
+    uint32_t numFrees;          ///< The number of allocations with this tag which were freed
+    size_t used[MAX_MEM_TYPES]; ///< The memory currently allocated with this tag
+    size_t peak[MAX_MEM_TYPES]; ///< The most memory which was ever allocated with this tag at once
+} tagStats_t;
+
 //==============================================================================
 // Variables
 //==============================================================================
@@ -61,6 +91,23 @@ typedef struct
 allocation_t aTable[A_TABLE_SIZE] = {0};
 size_t usedMemory[MAX_MEM_TYPES]  = {0};
 
+/// The high-water marks since resetHeapPeaks(), updated on every allocation and free
+static heapPeaks_t heapPeaks = {0};
+
+/// Open addressing index from a pointer to its entry in aTable. Each value is the entry's index plus one, or 0 if empty
+static int32_t aIndex[A_INDEX_SIZE] = {0};
+/// A stack of the unused entries in aTable
+static int32_t freeSlots[A_TABLE_SIZE];
+/// The number of unused entries in freeSlots
+static int32_t numFreeSlots = 0;
+/// true once freeSlots was filled
+static bool aTableInit = false;
+/// true if aTable ever ran out of space, so some pointers aren't tracked
+static bool aTableOverflowed = false;
+
+/// Open addressing table of running totals for each tag
+static tagStats_t tagTable[TAG_TABLE_SIZE] = {0};
+
 //==============================================================================
 // Function declarations
 //==============================================================================
@@ -68,6 +115,15 @@ size_t usedMemory[MAX_MEM_TYPES]  = {0};
 static void printMemoryOperation(memOp_t op, allocation_t* al);
 static void saveAllocation(memOp_t op, void* ptr, allocation_t* oldEntry, uint32_t size, uint32_t caps,
                            const char* file, const char* func, uint32_t line, const char* tag);
+static uint32_t hashPtr(const void* ptr);
+static allocation_t* findAllocation(const void* ptr);
+static void indexAllocation(allocation_t* al);
+static void unindexAllocation(const void* ptr);
+static allocation_t* takeFreeSlot(void);
+static int32_t findTagStats(const char* tag);
+static void countTag(allocation_t* al, bool add);
+static void updateHeapPeaks(void);
+static int compareTagPeaks(const void* a, const void* b);
 
 //==============================================================================
 // Functions
@@ -156,35 +212,160 @@ void dumpAllocTable(void)
 }
 
 /**
- * @brief TODO
+ * @brief Write the running totals for each tag, sorted by the most memory each tag ever had allocated at once
  *
- * @param op
- * @param ptr
- * @param oldPtr
- * @param size
- * @param caps
- * @param file
- * @param func
- * @param line
- * @param tag
+ * @param out The file to write the CSV profile to
  */
-static void saveAllocation(memOp_t op, void* ptr, allocation_t* oldEntry, uint32_t size, uint32_t caps,
-                           const char* file, const char* func, uint32_t line, const char* tag)
+void writeHeapProfile(FILE* out)
 {
-    allocation_t* al = NULL;
-    // Find the old entry in the table. if oldPtr is NULL, then an empty entry will be found
-    if (NULL == oldEntry)
+    static int32_t sorted[TAG_TABLE_SIZE];
+    int32_t numTags = 0;
+    for (int32_t idx = 0; idx < TAG_TABLE_SIZE; idx++)
     {
-        int32_t idx = 0;
-        while (idx < A_TABLE_SIZE && NULL != aTable[idx].ptr)
+        if (tagTable[idx].tag[0])
         {
-            idx++;
+            sorted[numTags++] = idx;
         }
-        al = &aTable[idx];
     }
-    else
+    qsort(sorted, numTags, sizeof(int32_t), compareTagPeaks);
+
+    fprintf(out, "%s,%s,%s,%s,%s,%s,%s\n", "Tag", "Allocs", "Frees", "INT Used", "INT Peak", "SPI Used", "SPI Peak");
+    for (int32_t i = 0; i < numTags; i++)
+    {
+        tagStats_t* ts = &tagTable[sorted[i]];
+        fprintf(out, "%s,%" PRIu32 ",%" PRIu32 ",%zu,%zu,%zu,%zu\n", ts->tag, ts->numAllocs, ts->numFrees,
+                ts->used[MEM_INTERNAL], ts->peak[MEM_INTERNAL], ts->used[MEM_SPIRAM], ts->peak[MEM_SPIRAM]);
+    }
+}
+
+/**
+ * @brief Get the memory currently allocated
+ *
+ * @param[out] internalUsed Written with the internal memory allocated, in bytes
+ * @param[out] spiramUsed Written with the SPIRAM allocated, in bytes
+ */
+void getHeapUsed(size_t* internalUsed, size_t* spiramUsed)
+{
+    *internalUsed = usedMemory[MEM_INTERNAL];
+    *spiramUsed   = usedMemory[MEM_SPIRAM];
+}
+
+/**
+ * @brief Get the high-water marks of the memory allocated since resetHeapPeaks(). Unlike getHeapUsed(), this catches
+ * memory which was allocated and freed in between calls
+ *
+ * @param[out] out Written with the high-water marks
+ */
+void getHeapPeaks(heapPeaks_t* out)
+{
+    *out = heapPeaks;
+}
+
+/**
+ * @brief Reset the high-water marks to the memory allocated now
+ */
+void resetHeapPeaks(void)
+{
+    for (int type = 0; type < MAX_MEM_TYPES; type++)
+    {
+        heapPeaks.beforeLow[type] = usedMemory[type];
+        heapPeaks.low[type]       = usedMemory[type];
+        heapPeaks.afterLow[type]  = usedMemory[type];
+    }
+}
+
+/**
+ * @brief Iterate through the memory allocated with each tag
+ *
+ * @param[in,out] idx The iterator position. Set this to 0 before the first call, then don't change it
+ * @param[out] out Written with the next tag's memory usage
+ * @return true if out was written, false if there are no more tags
+ */
+bool iterateHeapTags(int32_t* idx, heapTagUsage_t* out)
+{
+    while (*idx < TAG_TABLE_SIZE)
+    {
+        tagStats_t* ts = &tagTable[*idx];
+        if (ts->tag[0])
+        {
+            out->tag       = ts->tag;
+            out->idx       = (*idx)++;
+            out->numAllocs = ts->numAllocs;
+            out->numFrees  = ts->numFrees;
+            memcpy(out->used, ts->used, sizeof(out->used));
+            memcpy(out->peak, ts->peak, sizeof(out->peak));
+            return true;
+        }
+        (*idx)++;
+    }
+    return false;
+}
+
+/**
+ * @brief Get the total size of all the regions that have the given capabilities
+ *
+ * @param caps Bitwise OR of MALLOC_CAP_* flags indicating the type of memory
+ * @return The emulated SPIRAM size, or the emulated internal memory size for other memory
+ */
+size_t heap_caps_get_total_size(uint32_t caps)
+{
+    return (MALLOC_CAP_SPIRAM & caps) ? SPIRAM_SIZE : INTERNAL_SIZE;
+}
+
+/**
+ * @brief Get the total free size of all the regions that have the given capabilities
+ *
+ * @param caps Bitwise OR of MALLOC_CAP_* flags indicating the type of memory
+ * @return The emulated SPIRAM which isn't allocated, or the emulated internal memory which isn't allocated for other
+ * memory
+ */
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    if (MALLOC_CAP_SPIRAM & caps)
+    {
+        return SPIRAM_SIZE - MIN(usedMemory[MEM_SPIRAM], (size_t)SPIRAM_SIZE);
+    }
+    return INTERNAL_SIZE - MIN(usedMemory[MEM_INTERNAL], (size_t)INTERNAL_SIZE);
+}
+
+/**
+ * @brief Get the largest free block of memory able to be allocated with the given capabilities. The emulator uses the
+ * host's allocator, so this can't measure fragmentation. It is the free memory, limited by the largest block the
+ * Swadge's SPIRAM has after booting.
+ *
+ * @param caps Bitwise OR of MALLOC_CAP_* flags indicating the type of memory
+ * @return The largest emulated block which may be allocated
+ */
+size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+    if (MALLOC_CAP_SPIRAM & caps)
     {
-        al = oldEntry;
+        return MIN(heap_caps_get_free_size(caps), (size_t)SPIRAM_LARGEST_BLOCK);
+    }
+    return heap_caps_get_free_size(caps);
+}
+
+/**
+ * @brief Add an allocation to the table, change it after a realloc, or remove it after a free, and update the totals
+ *
+ * @param op The memory operation
+ * @param ptr The pointer which was allocated, reallocated, or freed
+ * @param oldEntry The table entry for the pointer, or NULL if it isn't in the table yet
+ * @param size The size of the allocation
+ * @param caps The capabilities of the allocation
+ * @param file The file the operation was called from
+ * @param func The function the operation was called from
+ * @param line The line the operation was called from
+ * @param tag The allocation's tag, or NULL to use the function and line
+ */
+static void saveAllocation(memOp_t op, void* ptr, allocation_t* oldEntry, uint32_t size, uint32_t caps,
+                           const char* file, const char* func, uint32_t line, const char* tag)
+{
+    allocation_t* al = oldEntry;
+    // If there's no old entry, take an empty one
+    if (NULL == al && OP_FREE != op)
+    {
+        al = takeFreeSlot();
     }
 
     // If the index is valid
@@ -212,12 +393,20 @@ static void saveAllocation(memOp_t op, void* ptr, allocation_t* oldEntry, uint32
             {
                 *usedMem -= al->size;
             }
+            countTag(al, false);
+            if (0 <= al->tagIdx)
+            {
+                tagTable[al->tagIdx].numFrees++;
+            }
 
             // Print the operation
             printMemoryOperation(op, al);
 
-            // Erase the table entry
+            // Erase the table entry and return it to the free list
+            unindexAllocation(al->ptr);
             memset(al, 0, sizeof(allocation_t));
+            freeSlots[numFreeSlots++] = al - aTable;
+            updateHeapPeaks();
         }
         else
         {
@@ -231,11 +420,15 @@ static void saveAllocation(memOp_t op, void* ptr, allocation_t* oldEntry, uint32
             // Pick a variable to track overall size
             size_t* usedMem = (MALLOC_CAP_SPIRAM & caps) ? &usedMemory[1] : &usedMemory[0];
 
-            // Save the old size for reallocs
-            uint32_t oldSize = 0;
-            if (OP_REALLOC == op)
+            // Take the old pointer and size out of the index and totals for reallocs. The caps may change
+            int32_t oldTagIdx = al->tagIdx;
+            bool isNew        = (NULL == al->ptr);
+            if (!isNew)
             {
-                oldSize = al->size;
+                size_t* oldUsedMem = (MALLOC_CAP_SPIRAM & al->caps) ? &usedMemory[1] : &usedMemory[0];
+                *oldUsedMem -= MIN(al->size, *oldUsedMem);
+                countTag(al, false);
+                unindexAllocation(al->ptr);
             }
 
             // Save entry
@@ -253,10 +446,23 @@ static void saveAllocation(memOp_t op, void* ptr, allocation_t* oldEntry, uint32
             {
                 snprintf(al->tag, sizeof(al->tag) - 1, "%s:%d", al->func, al->line);
             }
+            al->tagIdx = findTagStats(al->tag);
+            indexAllocation(al);
+
+            // A realloc which changes the tag moves the allocation from one tag to the other
+            if (0 <= al->tagIdx && (isNew || oldTagIdx != al->tagIdx))
+            {
+                tagTable[al->tagIdx].numAllocs++;
+            }
+            if (!isNew && 0 <= oldTagIdx && oldTagIdx != al->tagIdx)
+            {
+                tagTable[oldTagIdx].numFrees++;
+            }
+            countTag(al, true);
 
             // Adjust space
-            *usedMem -= oldSize;
             *usedMem += al->size;
+            updateHeapPeaks();
 
             // Print it
             printMemoryOperation(op, al);
@@ -271,16 +477,244 @@ static void saveAllocation(memOp_t op, void* ptr, allocation_t* oldEntry, uint32
     }
     else if (OP_FREE == op)
     {
-        // Trying to free an entry not in the table
-        fprintf(stderr, "!! Probable double-free at %s:%d (%p)\n", file, line, ptr);
+        // Trying to free an entry not in the table. If the table ran out of space, this is expected
+        if (!aTableOverflowed)
+        {
+            fprintf(stderr, "!! Probable double-free at %s:%d (%p)\n", file, line, ptr);
+        }
     }
     else
     {
         // Trying to add to the table, but there's no space
-        fprintf(stderr, "!! Allocation table out of space\n");
+        if (!aTableOverflowed)
+        {
+            fprintf(stderr, "!! Allocation table out of space\n");
+            aTableOverflowed = true;
+        }
     }
 }
 
+/**
+ * @brief Hash a pointer into an index for aIndex
+ *
+ * @param ptr The pointer to hash
+ * @return The pointer's home index in aIndex
+ */
+static uint32_t hashPtr(const void* ptr)
+{
+    // Allocations are aligned, so the low bits carry no information
+    uint64_t val = (uintptr_t)ptr >> 3;
+    return (uint32_t)((val * 0x9E3779B97F4A7C15ull) >> 32) & (A_INDEX_SIZE - 1);
+}
+
+/**
+ * @brief Find the table entry for a pointer
+ *
+ * @param ptr The pointer to find
+ * @return The table entry, or NULL if the pointer isn't in the table
+ */
+static allocation_t* findAllocation(const void* ptr)
+{
+    for (uint32_t i = hashPtr(ptr); 0 != aIndex[i]; i = (i + 1) & (A_INDEX_SIZE - 1))
+    {
+        if (aTable[aIndex[i] - 1].ptr == ptr)
+        {
+            return &aTable[aIndex[i] - 1];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Add a table entry to the pointer index
+ *
+ * @param al The table entry, with its pointer set
+ */
+static void indexAllocation(allocation_t* al)
+{
+    uint32_t i = hashPtr(al->ptr);
+    while (0 != aIndex[i])
+    {
+        i = (i + 1) & (A_INDEX_SIZE - 1);
+    }
+    aIndex[i] = (al - aTable) + 1;
+}
+
+/**
+ * @brief Remove a pointer from the pointer index. Later entries in the same run are shifted back so that lookups which
+ * pass over the removed entry still find them
+ *
+ * @param ptr The pointer to remove
+ */
+static void unindexAllocation(const void* ptr)
+{
+    uint32_t hole = hashPtr(ptr);
+    while (0 != aIndex[hole] && aTable[aIndex[hole] - 1].ptr != ptr)
+    {
+        hole = (hole + 1) & (A_INDEX_SIZE - 1);
+    }
+    if (0 == aIndex[hole])
+    {
+        return;
+    }
+
+    uint32_t i = hole;
+    while (true)
+    {
+        i = (i + 1) & (A_INDEX_SIZE - 1);
+        if (0 == aIndex[i])
+        {
+            break;
+        }
+
+        // Move the entry into the hole unless the hole is before the entry's home index
+        uint32_t home = hashPtr(aTable[aIndex[i] - 1].ptr);
+        if (((i - home) & (A_INDEX_SIZE - 1)) >= ((i - hole) & (A_INDEX_SIZE - 1)))
+        {
+            aIndex[hole] = aIndex[i];
+            hole         = i;
+        }
+    }
+    aIndex[hole] = 0;
+}
+
+/**
+ * @brief Take an empty entry from the table
+ *
+ * @return The empty entry, or NULL if the table is full
+ */
+static allocation_t* takeFreeSlot(void)
+{
+    if (!aTableInit)
+    {
+        // Fill the stack so the lowest entries are used first
+        for (int32_t idx = 0; idx < A_TABLE_SIZE; idx++)
+        {
+            freeSlots[idx] = A_TABLE_SIZE - 1 - idx;
+        }
+        numFreeSlots = A_TABLE_SIZE;
+        aTableInit   = true;
+    }
+
+    if (0 == numFreeSlots)
+    {
+        return NULL;
+    }
+
+    allocation_t* al = &aTable[freeSlots[--numFreeSlots]];
+    memset(al, 0, sizeof(allocation_t));
+    al->tagIdx = -1;
+    return al;
+}
+
+/**
+ * @brief Find or add the running totals for a tag
+ *
+ * @param tag The tag to find
+ * @return The index of the tag's totals in tagTable, or -1 if the table is full
+ */
+static int32_t findTagStats(const char* tag)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (const char* c = tag; *c; c++)
+    {
+        hash = (hash ^ (uint8_t)*c) * 16777619u;
+    }
+
+    uint32_t idx = hash & (TAG_TABLE_SIZE - 1);
+    for (int32_t probes = 0; probes < TAG_TABLE_SIZE; probes++)
+    {
+        tagStats_t* ts = &tagTable[idx];
+        if (!ts->tag[0])
+        {
+            // Add the tag
+            snprintf(ts->tag, sizeof(ts->tag), "%s", tag);
+            return idx;
+        }
+        else if (0 == strcmp(ts->tag, tag))
+        {
+            return idx;
+        }
+        idx = (idx + 1) & (TAG_TABLE_SIZE - 1);
+    }
+
+    static bool warned = false;
+    if (!warned)
+    {
+        fprintf(stderr, "!! Tag table out of space, some allocations won't be profiled\n");
+        warned = true;
+    }
+    return -1;
+}
+
+/**
+ * @brief Add or subtract an allocation's size from its tag's running totals
+ *
+ * @param al The allocation
+ * @param add true to add the size, false to subtract it
+ */
+static void countTag(allocation_t* al, bool add)
+{
+    if (0 > al->tagIdx)
+    {
+        return;
+    }
+
+    tagStats_t* ts = &tagTable[al->tagIdx];
+    memType_t type = (MALLOC_CAP_SPIRAM & al->caps) ? MEM_SPIRAM : MEM_INTERNAL;
+    if (add)
+    {
+        ts->used[type] += al->size;
+        if (ts->used[type] > ts->peak[type])
+        {
+            ts->peak[type] = ts->used[type];
+        }
+    }
+    else
+    {
+        ts->used[type] -= MIN(al->size, ts->used[type]);
+    }
+}
+
+/**
+ * @brief Update the high-water marks after the memory allocated changed
+ */
+static void updateHeapPeaks(void)
+{
+    for (int type = 0; type < MAX_MEM_TYPES; type++)
+    {
+        size_t used = usedMemory[type];
+        if (used < heapPeaks.low[type])
+        {
+            // A new low point. Everything before it was the peak before the low
+            heapPeaks.beforeLow[type] = MAX(heapPeaks.beforeLow[type], heapPeaks.afterLow[type]);
+            heapPeaks.low[type]       = used;
+            heapPeaks.afterLow[type]  = used;
+        }
+        else if (used > heapPeaks.afterLow[type])
+        {
+            heapPeaks.afterLow[type] = used;
+        }
+    }
+}
+
+/**
+ * @brief qsort() comparator which sorts tag indices by the tag's total peak memory, largest first
+ *
+ * @param a A pointer to an index in tagTable
+ * @param b A pointer to another index in tagTable
+ * @return A negative number if a should be first, a positive number if b should be first, or 0 if they're equal
+ */
+static int compareTagPeaks(const void* a, const void* b)
+{
+    const tagStats_t* tsA = &tagTable[*(const int32_t*)a];
+    const tagStats_t* tsB = &tagTable[*(const int32_t*)b];
+    size_t peakA          = tsA->peak[MEM_INTERNAL] + tsA->peak[MEM_SPIRAM];
+    size_t peakB          = tsB->peak[MEM_INTERNAL] + tsB->peak[MEM_SPIRAM];
+    return (peakA < peakB) - (peakA > peakB);
+}
+
 /**
  * @brief Allocate a chunk of memory which has the given capabilities
  *
@@ -299,7 +733,10 @@ void* heap_caps_malloc_dbg(size_t size, uint32_t caps, const char* file, const c
 {
 #ifdef MEMORY_DEBUG
     void* ptr = malloc(size);
-    saveAllocation(OP_MALLOC, ptr, NULL, size, caps, file, func, line, tag);
+    if (NULL != ptr)
+    {
+        saveAllocation(OP_MALLOC, ptr, NULL, size, caps, file, func, line, tag);
+    }
     return ptr;
 #else
     return malloc(size);
@@ -326,7 +763,10 @@ void* heap_caps_calloc_dbg(size_t n, size_t size, uint32_t caps, const char* fil
 {
 #ifdef MEMORY_DEBUG
     void* ptr = calloc(n, size);
-    saveAllocation(OP_CALLOC, ptr, NULL, n * size, caps, file, func, line, tag);
+    if (NULL != ptr)
+    {
+        saveAllocation(OP_CALLOC, ptr, NULL, n * size, caps, file, func, line, tag);
+    }
     return ptr;
 #else
     return calloc(n, size);
@@ -350,15 +790,19 @@ void* heap_caps_realloc_dbg(void* ptr, size_t size, uint32_t caps, const char* f
 {
 #ifdef MEMORY_DEBUG
 
-    // Find the old entry in the table. if oldPtr is NULL, then an empty entry will be found
-    int32_t idx = 0;
-    while (idx < A_TABLE_SIZE && ptr != aTable[idx].ptr)
-    {
-        idx++;
-    }
+    // Find the old entry in the table. If ptr is NULL or untracked, a new entry will be used
+    allocation_t* al = (NULL == ptr) ? NULL : findAllocation(ptr);
 
     void* newPtr = realloc(ptr, size);
-    saveAllocation(OP_REALLOC, newPtr, &aTable[idx], size, caps, file, func, line, tag);
+    if (NULL != newPtr)
+    {
+        saveAllocation(OP_REALLOC, newPtr, al, size, caps, file, func, line, tag);
+    }
+    else if (NULL != al && 0 == size)
+    {
+        // realloc() to zero bytes may free the memory
+        saveAllocation(OP_FREE, ptr, al, 0, 0, file, func, line, tag);
+    }
     return newPtr;
 #else
     return realloc(ptr, size);
@@ -376,15 +820,10 @@ void* heap_caps_realloc_dbg(void* ptr, size_t size, uint32_t caps, const char* f
 void heap_caps_free_dbg(void* ptr, const char* file, const char* func, int32_t line, const char* tag)
 {
 #ifdef MEMORY_DEBUG
-
-    // Find the old entry in the table. if oldPtr is NULL, then an empty entry will be found
-    int32_t idx = 0;
-    while (idx < A_TABLE_SIZE && ptr != aTable[idx].ptr)
+    if (NULL != ptr)
     {
-        idx++;
+        saveAllocation(OP_FREE, ptr, findAllocation(ptr), 0, 0, file, func, line, tag);
     }
-
-    saveAllocation(OP_FREE, ptr, &aTable[idx], 0, 0, file, func, line, tag);
 #endif
     free(ptr);
 }
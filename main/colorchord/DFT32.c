@@ -6,6 +6,7 @@
 
 #include "DFT32.h"
 #include <string.h>
+#include <esp_heap_caps.h>
 
 #ifndef CC_EMBEDDED
     #include <stdlib.h>
@@ -136,14 +137,14 @@ void UpdateOutputBins32(dft32_data* dd)
 {
     int i;
     int32_t* ipt = &dd->sDatSpace32BOut[0];
-    for (i = 0; i < FIX_BINS; i++)
+    for (i = 0; i < dd->bins; i++)
     {
         int32_t isps = *(ipt++); // keep 32 bits
         int32_t ispc = *(ipt++);
         // take absolute values
         isps       = isps < 0 ? -isps : isps;
         ispc       = ispc < 0 ? -ispc : ispc;
-        int octave = i / FIX_B_PER_O;
+        int octave = i / dd->binsPerOctave;
 
         // If we are running DFT32 on regular ColorChord, then we will need to
         // also update gOutBins[]... But if we're on embedded systems, we only
@@ -176,10 +177,75 @@ void UpdateOutputBins32(dft32_data* dd)
 }
 
 /**
- * @brief TODO
+ * @brief Latch the running sin/cos state of every bin into the output and decay it. This happens once every
+ * dft32_data.binCycle calls to HandleInt()
  *
- * @param dd
- * @param sample
+ * @param dd The DFT state
+ */
+static void SnapshotBins32(dft32_data* dd)
+{
+    int32_t* bins    = &dd->sDatSpace32B[0];
+    int32_t* binsOut = &dd->sDatSpace32BOut[0];
+
+    for (int i = 0; i < dd->bins; i++)
+    {
+        // First for the SIN then the COS.
+        int32_t val  = *(bins);
+        *(binsOut++) = val;
+        *(bins++) -= val >> DFT_IIR;
+
+        val          = *(bins);
+        *(binsOut++) = val;
+        *(bins++) -= val >> DFT_IIR;
+    }
+}
+
+/**
+ * @brief Run decimated samples through every bin of one octave. Each bin's phase and sin/cos sums stay in registers
+ * for all the samples
+ *
+ * @param dd The DFT state
+ * @param oct The octave to update
+ * @param filtered The decimated samples for this octave, in order
+ * @param count The number of decimated samples
+ */
+static void RunOctave32(dft32_data* dd, uint8_t oct, const int16_t* filtered, uint8_t count)
+{
+    uint16_t* dsA = &dd->sDatSpace32A[oct * dd->binsPerOctave * 2];
+    int32_t* dsB  = &dd->sDatSpace32B[oct * dd->binsPerOctave * 2];
+
+    for (int i = 0; i < dd->binsPerOctave; i++)
+    {
+        uint16_t adv   = dsA[0];
+        uint16_t place = dsA[1];
+        int32_t isps   = dsB[0];
+        int32_t ispc   = dsB[1];
+
+        for (uint8_t s = 0; s < count; s++)
+        {
+            uint8_t localipl = place >> 8;
+            place += adv;
+
+            isps += (Ssinonlytable[localipl] * filtered[s]);
+            // Get the cosine (1/4 wavelength out-of-phase with sin)
+            localipl += 64;
+            ispc += (Ssinonlytable[localipl] * filtered[s]);
+        }
+
+        dsA[1] = place;
+        dsB[0] = isps;
+        dsB[1] = ispc;
+        dsA += 2;
+        dsB += 2;
+    }
+}
+
+/**
+ * @brief Handle one sample. Every octave's accumulator gets the sample, then either one octave's bins are updated
+ * with its decimated sample or the output is latched, depending on the place in the octave schedule
+ *
+ * @param dd The DFT state
+ * @param sample The sample to handle
  */
 static void HandleInt(dft32_data* dd, int16_t sample)
 {
@@ -187,9 +253,9 @@ static void HandleInt(dft32_data* dd, int16_t sample)
 
     uint8_t oct = dd->Sdo_this_octave[dd->sWhichOctavePlace];
     dd->sWhichOctavePlace++;
-    dd->sWhichOctavePlace &= BIN_CYCLE - 1;
+    dd->sWhichOctavePlace &= dd->binCycle - 1;
 
-    for (i = 0; i < OCTAVES; i++)
+    for (i = 0; i < dd->octaves; i++)
     {
         dd->sAccum_octave_bins[i] += sample;
     }
@@ -197,63 +263,69 @@ static void HandleInt(dft32_data* dd, int16_t sample)
     if (oct > 128)
     {
         // Special: This is when we can update everything.
-        // This gets run once out of every (1<<OCTAVES) times.
+        // This gets run once out of every (1<<octaves) times.
         //  which is half as many samples
         // It handles updating part of the DFT.
         // It should happen at the very first call to HandleInit
-        int32_t* bins    = &dd->sDatSpace32B[0];
-        int32_t* binsOut = &dd->sDatSpace32BOut[0];
-
-        for (i = 0; i < FIX_BINS; i++)
-        {
-            // First for the SIN then the COS.
-            int32_t val  = *(bins);
-            *(binsOut++) = val;
-            *(bins++) -= val >> DFT_IIR;
-
-            val          = *(bins);
-            *(binsOut++) = val;
-            *(bins++) -= val >> DFT_IIR;
-        }
+        SnapshotBins32(dd);
         return;
     }
 
-    if ((oct * FIX_B_PER_O * 2) < (FIX_BINS * 2) && (oct <= OCTAVES))
+    if (oct < dd->octaves)
     {
         // process a filtered sample for one of the octaves
-        uint16_t* dsA               = &dd->sDatSpace32A[oct * FIX_B_PER_O * 2];
-        int32_t* dsB                = &dd->sDatSpace32B[oct * FIX_B_PER_O * 2];
-        int16_t filteredsample      = dd->sAccum_octave_bins[oct] >> (OCTAVES - oct);
+        int16_t filteredsample      = dd->sAccum_octave_bins[oct] >> (dd->octaves - oct);
         dd->sAccum_octave_bins[oct] = 0;
-
-        for (i = 0; i < FIX_B_PER_O; i++)
-        {
-            uint16_t adv     = *(dsA++);
-            uint8_t localipl = *(dsA) >> 8;
-            *(dsA++) += adv;
-
-            *(dsB++) += (Ssinonlytable[localipl] * filteredsample);
-            // Get the cosine (1/4 wavelength out-of-phase with sin)
-            localipl += 64;
-            *(dsB++) += (Ssinonlytable[localipl] * filteredsample);
-        }
+        RunOctave32(dd, oct, &filteredsample, 1);
     }
 }
 
 /**
- * @brief TODO
+ * @brief Allocate and initialize the state for a DFT with the given resolution. The lowest octave starts at the
+ * frequencies passed to UpdateBins32(), and each octave above it is twice that. Call FreeDFTProgressive32() when
+ * done.
  *
- * @param dd
- * @return int
+ * @param dd The DFT state to set up
+ * @param octaves The number of octaves to analyze, 1 to ::DFT32_MAX_OCTAVES
+ * @param binsPerOctave The number of bins in each octave
+ * @return int 0 on success, nonzero if the resolution is invalid or the state could not be allocated
  */
-int SetupDFTProgressive32(dft32_data* dd)
+int SetupDFTProgressive32(dft32_data* dd, uint8_t octaves, uint8_t binsPerOctave)
 {
     int i;
     int j;
 
+    if (0 == octaves || octaves > DFT32_MAX_OCTAVES || 0 == binsPerOctave)
+    {
+        return -1;
+    }
+
+    dd->octaves           = octaves;
+    dd->binsPerOctave     = binsPerOctave;
+    dd->bins              = octaves * binsPerOctave;
+    dd->binCycle          = 1 << octaves;
+    dd->sWhichOctavePlace = 0;
+
+    // Allocate all the arrays in one block, widest types first so they all stay aligned
+    uint16_t bins = dd->bins;
+    size_t size   = (sizeof(int32_t) * (bins * 4 + octaves)) + (sizeof(uint16_t) * bins * 3)
+                  + (sizeof(int16_t) * octaves * (dd->binCycle / 2)) + (sizeof(uint8_t) * dd->binCycle);
+
+    dd->sDatSpace32B = heap_caps_calloc(1, size, MALLOC_CAP_8BIT);
+    if (NULL == dd->sDatSpace32B)
+    {
+        return -1;
+    }
+    dd->sDatSpace32BOut    = dd->sDatSpace32B + bins * 2;
+    dd->sAccum_octave_bins = dd->sDatSpace32BOut + bins * 2;
+    dd->sDatSpace32A       = (uint16_t*)(dd->sAccum_octave_bins + octaves);
+    dd->embeddedBins32     = dd->sDatSpace32A + bins * 2;
+    dd->sOctaveSamples     = (int16_t*)(dd->embeddedBins32 + bins);
+    dd->Sdo_this_octave    = (uint8_t*)(dd->sOctaveSamples + octaves * (dd->binCycle / 2));
+
     dd->sDoneFirstRun      = 1;
     dd->Sdo_this_octave[0] = 0xff;
-    for (i = 0; i < BIN_CYCLE - 1; i++)
+    for (i = 0; i < dd->binCycle - 1; i++)
     {
         // dd->Sdo_this_octave =
         // 255 4 3 4 2 4 3 4 1 4 3 4 2 4 3 4 0 4 3 4 2 4 3 4 1 4 3 4 2 4 3 4 is case for 5 octaves.
@@ -261,26 +333,39 @@ int SetupDFTProgressive32(dft32_data* dd)
         // update of that octave
         // search for "first" zero
 
-        for (j = 0; j <= OCTAVES; j++)
+        for (j = 0; j <= octaves; j++)
         {
             if (((1 << j) & i) == 0)
             {
                 break;
             }
         }
-        if (j > OCTAVES)
+        if (j > octaves)
         {
 #ifndef CC_EMBEDDED
             fprintf(stderr, "Error: algorithm fault.\n");
             exit(-1);
 #endif
+            FreeDFTProgressive32(dd);
             return -1;
         }
-        dd->Sdo_this_octave[i + 1] = OCTAVES - j - 1;
+        dd->Sdo_this_octave[i + 1] = octaves - j - 1;
     }
     return 0;
 }
 
+/**
+ * @brief Free the state allocated by SetupDFTProgressive32()
+ *
+ * @param dd The DFT state to free
+ */
+void FreeDFTProgressive32(dft32_data* dd)
+{
+    // Everything was allocated in one block starting at sDatSpace32B
+    heap_caps_free(dd->sDatSpace32B);
+    memset(dd, 0, sizeof(dft32_data));
+}
+
 /**
  * @brief TODO
  *
@@ -291,9 +376,9 @@ void UpdateBins32(dft32_data* dd, const uint16_t* frequencies)
 {
     int i;
     int imod = 0;
-    for (i = 0; i < FIX_BINS; i++, imod++)
+    for (i = 0; i < dd->bins; i++, imod++)
     {
-        if (imod >= FIX_B_PER_O)
+        if (imod >= dd->binsPerOctave)
         {
             imod = 0;
         }
@@ -314,6 +399,77 @@ void PushSample32(dft32_data* dd, int16_t dat)
     HandleInt(dd, dat);
 }
 
+/**
+ * @brief Push a whole buffer of samples. The bin outputs are exactly the same as calling PushSample32() for each
+ * sample, but much less work is done per sample.
+ *
+ * Instead of adding each sample to every octave's accumulator, a running sum is kept and each octave's decimated
+ * sample is the difference since that octave was last updated. Decimated samples are collected per octave until
+ * the next output latch, then each octave's bins are updated in one tight loop over its samples.
+ *
+ * @param dd The DFT state
+ * @param samples The samples to push, see PushSample32() for the range
+ * @param count The number of samples
+ */
+void PushBlock32(dft32_data* dd, const int16_t* samples, uint32_t count)
+{
+    uint8_t octaves = dd->octaves;
+
+    // Between output latches, octave N is updated at most 2^N times, so each octave has room for binCycle / 2
+    uint8_t octStride                   = dd->binCycle / 2;
+    int16_t* octSamples                 = dd->sOctaveSamples;
+    uint8_t octCount[DFT32_MAX_OCTAVES] = {0};
+
+    // Each octave's accumulator is its carried-in value plus the running sum since it was last updated
+    int32_t carry[DFT32_MAX_OCTAVES];
+    int32_t since[DFT32_MAX_OCTAVES] = {0};
+    int32_t total                    = 0;
+    memcpy(carry, dd->sAccum_octave_bins, sizeof(int32_t) * octaves);
+
+    // Every sample is handled twice, just like PushSample32()
+    uint32_t calls = count * 2;
+    for (uint32_t c = 0; c < calls; c++)
+    {
+        uint8_t oct = dd->Sdo_this_octave[dd->sWhichOctavePlace];
+        dd->sWhichOctavePlace++;
+        dd->sWhichOctavePlace &= dd->binCycle - 1;
+
+        total += samples[c >> 1];
+
+        if (oct > 128)
+        {
+            // All the decimated samples so far must be in the bins before they are latched
+            for (uint8_t o = 0; o < octaves; o++)
+            {
+                if (octCount[o])
+                {
+                    RunOctave32(dd, o, &octSamples[o * octStride], octCount[o]);
+                    octCount[o] = 0;
+                }
+            }
+            SnapshotBins32(dd);
+        }
+        else if (oct < octaves)
+        {
+            int32_t accum = carry[oct] + (total - since[oct]);
+            carry[oct]    = 0;
+            since[oct]    = total;
+
+            octSamples[oct * octStride + octCount[oct]++] = accum >> (octaves - oct);
+        }
+    }
+
+    // Update the bins with whatever is left, and save the accumulators for next time
+    for (uint8_t o = 0; o < octaves; o++)
+    {
+        if (octCount[o])
+        {
+            RunOctave32(dd, o, &octSamples[o * octStride], octCount[o]);
+        }
+        dd->sAccum_octave_bins[o] = carry[o] + (total - since[o]);
+    }
+}
+
 #ifndef CC_EMBEDDED
 
 /**
@@ -325,9 +481,9 @@ void PushSample32(dft32_data* dd, int16_t dat)
 void UpdateBinsForDFT32(dft32_data* dd, const float* frequencies)
 {
     int i;
-    for (i = 0; i < FIX_BINS; i++)
+    for (i = 0; i < dd->bins; i++)
     {
-        float freq              = frequencies[(i % FIX_B_PER_O) + (FIX_B_PER_O * (OCTAVES - 1))];
+        float freq = frequencies[(i % dd->binsPerOctave) + (dd->binsPerOctave * (dd->octaves - 1))];
         dd->sDatSpace32A[i * 2] = (65536.0 / freq); // / oneoveroctave;
     }
 }
@@ -22,6 +22,8 @@
     #define APPROX_NORM 1
 #endif
 
+// The default resolution, used by InitColorChord(). Each DFT may be set up
+// with its own number of octaves and bins per octave at runtime instead.
 #ifndef OCTAVES
     #define OCTAVES 5
 #endif
@@ -34,6 +36,11 @@
 #define FIX_BINS  (FIX_B_PER_O * OCTAVES)
 #define BIN_CYCLE (1 << OCTAVES)
 
+// The lowest octave always starts at BASE_FREQ. Each octave added above five
+// doubles the top frequency, so more than this would put the top octave past
+// the Nyquist frequency at D_FREQ.
+#define DFT32_MAX_OCTAVES 6
+
 // You may increase this past 5 but if you do, the amplitude of your incoming
 // signal must decrease.  Increasing this value makes responses slower.  Lower
 // values are more responsive.
@@ -53,11 +60,18 @@ void DoDFTProgressive32(dft32_data* dd, float* outBins, float* frequencies, int
 
 typedef struct
 {
+    // The resolution this DFT was set up with. Don't change these after
+    // calling SetupDFTProgressive32().
+    uint8_t octaves;
+    uint8_t binsPerOctave;
+    uint16_t bins;    // octaves * binsPerOctave
+    uint8_t binCycle; // 1 << octaves
+
     // Whenever you need to read the bins, you can do it from here.
     // These outputs are limited to 0..~2047, this makes it possible
     // for you to process with uint16_t's more easily.
     // This is updated every time the DFT hits the octave count, or 1/32 updates.
-    uint16_t embeddedBins32[FIX_BINS];
+    uint16_t* embeddedBins32; //[bins]
 
     // NOTES to self:
     //
@@ -68,30 +82,35 @@ typedef struct
     uint8_t sDoneFirstRun;
 
     // (advances,places) full revolution is 256. 8bits integer part 8bit fractional
-    uint16_t sDatSpace32A[FIX_BINS * 2];
+    uint16_t* sDatSpace32A; //[bins * 2]
     // (isses,icses)
-    int32_t sDatSpace32B[FIX_BINS * 2];
+    int32_t* sDatSpace32B; //[bins * 2]
 
     // This is updated every time the DFT hits the octave count, or 1 out of
-    // (1<<OCTAVES) times which is (1<<(OCTAVES-1)) samples
+    // (1<<octaves) times which is (1<<(octaves-1)) samples
     // (isses,icses)
-    int32_t sDatSpace32BOut[FIX_BINS * 2];
+    int32_t* sDatSpace32BOut; //[bins * 2]
 
     // Sdo_this_octave is a scheduling state for the running SIN/COS states for
     // each bin.  We have to execute the highest octave every time, however, we can
     // get away with updating the next octave down every-other-time, then the next
     // one down yet, every-other-time from that one.  That way, no matter how many
-    // octaves we have, we only need to update FIX_B_PER_O*2 DFT bins.
-    uint8_t Sdo_this_octave[BIN_CYCLE];
+    // octaves we have, we only need to update binsPerOctave*2 DFT bins.
+    uint8_t* Sdo_this_octave; //[binCycle]
 
-    int32_t sAccum_octave_bins[OCTAVES];
+    int32_t* sAccum_octave_bins; //[octaves]
     uint8_t sWhichOctavePlace;
 
-    uint16_t embeddedBins[FIX_BINS];
+    // Decimated samples collected by PushBlock32() between output latches
+    int16_t* sOctaveSamples; //[octaves * binCycle / 2]
 } dft32_data;
 
 // It's actually split into a few functions, which you can call on your own:
-int SetupDFTProgressive32(dft32_data* dd); // Call at start. Returns nonzero if error.
+// Call at start. Allocates all the state for this resolution. Returns nonzero if error.
+int SetupDFTProgressive32(dft32_data* dd, uint8_t octaves, uint8_t binsPerOctave);
+// Call when done to free the state allocated by SetupDFTProgressive32().
+void FreeDFTProgressive32(dft32_data* dd);
+// frequencies holds one octave, dd->binsPerOctave entries.
 void UpdateBins32(dft32_data* dd, const uint16_t* frequencies);
 
 // Call this to push on new frames of sound.
@@ -99,6 +118,10 @@ void UpdateBins32(dft32_data* dd, const uint16_t* frequencies);
 // Any more and you will exceed the accumulators and it will cause an overflow.
 void PushSample32(dft32_data* dd, int16_t dat);
 
+// Call this to push a whole buffer of samples at once, with the same range as
+// PushSample32(). The results are identical, but it's much faster per sample.
+void PushBlock32(dft32_data* dd, const int16_t* samples, uint32_t count);
+
 #ifndef CC_EMBEDDED
 // ColorChord regular uses this to pass in floats.
 void UpdateBinsForDFT32(dft32_data* dd, const float* frequencies); // Update the frequencies
@@ -5,81 +5,32 @@
 //==============================================================================
 
 #include <string.h>
+#include <math.h>
+#include <esp_heap_caps.h>
 #include "embeddedNf.h"
 #include "DFT32.h"
 
-//==============================================================================
-// Constant data
-//==============================================================================
-
-#ifndef PRECOMPUTE_FREQUENCY_TABLE
-static const float bf_table[24] = {1.000000, 1.029302, 1.059463, 1.090508, 1.122462, 1.155353, 1.189207, 1.224054,
-                                   1.259921, 1.296840, 1.334840, 1.373954, 1.414214, 1.455653, 1.498307, 1.542211,
-                                   1.587401, 1.633915, 1.681793, 1.731073, 1.781797, 1.834008, 1.887749, 1.943064};
-
-/* The above table was generated using the following code:
-
-#include <stdio.h>
-#include <math.h>
-
-int main()
-{
-    int i;
-    #define FIX_B_PER_O 24
-    printf( "const float bf_table[%d] = {", FIX_B_PER_O );
-    for( i = 0; i < FIX_B_PER_O; i++ )
-    {
-        if( ( i % 6 ) == 0 )
-            printf( "\n\t" );
-        printf( "%f, ", pow( 2, (float)i / (float)FIX_B_PER_O ) );
-    }
-    printf( "};\n" );
-    return 0;
-}
-*/
-
-#endif
-
 //==============================================================================
 // Functions
 //==============================================================================
 
 /**
- * @brief TODO
+ * @brief Build the frequency table for the DFT's resolution and load it. This uses floating point, so avoid doing
+ * it frequently.
  *
- * @param dd
+ * @param dd The DFT to update, already set up with SetupDFTProgressive32()
  */
 void UpdateFrequencies(dft32_data* dd)
 {
-#ifndef PRECOMPUTE_FREQUENCY_TABLE
-
-    #define BUILD_BUG_ON(condition) ((void)sizeof(char[1 - 2 * !!(condition)]))
-
-    uint16_t fbins[FIX_B_PER_O];
-    int i;
-
-    BUILD_BUG_ON(sizeof(bf_table) != FIX_B_PER_O * 4);
+    uint16_t fbins[MAX_B_PER_O];
 
-    // Warning: This does floating point.  Avoid doing this frequently.  If you
-    // absolutely cannot have floating point on your system, you may precompute
-    // this and store it as a table.  It does preclude you from changing
-    // BASE_FREQ in runtime.
-
-    for (i = 0; i < FIX_B_PER_O; i++)
+    // The table is the phase advance per update for each bin of the lowest octave. A full revolution is 65536 and
+    // the lowest octave is updated once every (binCycle / 2) samples.
+    for (int i = 0; i < dd->binsPerOctave; i++)
     {
-        float frq = (bf_table[i] * BASE_FREQ);
-        fbins[i]  = (65536.0) / (D_FREQ)*frq * 16 + 0.5;
+        float frq = powf(2, (float)i / dd->binsPerOctave) * BASE_FREQ;
+        fbins[i]  = (65536.0) / (D_FREQ)*frq * (dd->binCycle / 2) + 0.5;
     }
-#else
-
-    #define PCOMP(f) (uint16_t)((65536.0) / (D_FREQ) * (f * BASE_FREQ) * 16 + 0.5)
-
-    static const uint16_t fbins[FIX_B_PER_O]
-        = {PCOMP(1.000000), PCOMP(1.029302), PCOMP(1.059463), PCOMP(1.090508), PCOMP(1.122462), PCOMP(1.155353),
-           PCOMP(1.189207), PCOMP(1.224054), PCOMP(1.259921), PCOMP(1.296840), PCOMP(1.334840), PCOMP(1.373954),
-           PCOMP(1.414214), PCOMP(1.455653), PCOMP(1.498307), PCOMP(1.542211), PCOMP(1.587401), PCOMP(1.633915),
-           PCOMP(1.681793), PCOMP(1.731073), PCOMP(1.781797), PCOMP(1.834008), PCOMP(1.887749), PCOMP(1.943064)};
-#endif
 
 #ifdef USE_32DFT
     UpdateBins32(dd, fbins);
@@ -88,30 +39,87 @@ void UpdateFrequencies(dft32_data* dd)
 #endif
 }
 
-void InitColorChord(embeddedNf_data* ed, dft32_data* dd)
+/**
+ * @brief Set up a note finder and its DFT with the default resolution, ::OCTAVES and ::FIX_B_PER_O
+ *
+ * @param ed The note finder to set up
+ * @param dd The DFT to set up
+ * @return true if it was set up, false if memory could not be allocated
+ */
+bool InitColorChord(embeddedNf_data* ed, dft32_data* dd)
+{
+    return InitColorChordRes(ed, dd, OCTAVES, FIX_B_PER_O);
+}
+
+/**
+ * @brief Set up a note finder and its DFT with the given resolution. The lowest bin is always ::BASE_FREQ, so
+ * octaves are added or removed from the top. Call DeinitColorChord() when done.
+ *
+ * @param ed The note finder to set up
+ * @param dd The DFT to set up
+ * @param octaves The number of octaves, 1 to ::DFT32_MAX_OCTAVES
+ * @param binsPerOctave The number of bins per octave, 1 to ::MAX_B_PER_O
+ * @return true if it was set up, false if the resolution is invalid or memory could not be allocated
+ */
+bool InitColorChordRes(embeddedNf_data* ed, dft32_data* dd, uint8_t octaves, uint8_t binsPerOctave)
 {
     int i;
-    // Set up and initialize arrays.
-    for (i = 0; i < MAX_NOTES; i++)
+
+    if (binsPerOctave > MAX_B_PER_O)
     {
-        ed->note_peak_frequencies[i] = 255;
-        ed->note_peak_amps[i]        = 0;
-        ed->note_peak_amps2[i]       = 0;
+        return false;
     }
 
-    memset(ed->folded_bins, 0, sizeof(ed->folded_bins));
-    memset(ed->fuzzed_bins, 0, sizeof(ed->fuzzed_bins));
-
     // Step 1: Initialize the Integer DFT.
 #ifdef USE_32DFT
-    SetupDFTProgressive32(dd);
+    if (SetupDFTProgressive32(dd, octaves, binsPerOctave))
+    {
+        return false;
+    }
 #else
     SetupDFTProgressiveIntegerSkippy();
 #endif
 
+    ed->octaves       = octaves;
+    ed->binsPerOctave = binsPerOctave;
+    ed->bins          = octaves * binsPerOctave;
+    ed->noteRange     = (1 << SEMI_BITS_PER_BIN) * binsPerOctave;
+
+    // Both bin arrays are in one block
+    ed->folded_bins = heap_caps_calloc(binsPerOctave + ed->bins, sizeof(uint16_t), MALLOC_CAP_8BIT);
+    if (NULL == ed->folded_bins)
+    {
+        FreeDFTProgressive32(dd);
+        return false;
+    }
+    ed->fuzzed_bins = &ed->folded_bins[binsPerOctave];
+
+    // Set up and initialize arrays.
+    for (i = 0; i < MAX_NOTES; i++)
+    {
+        ed->note_peak_frequencies[i] = 255;
+        ed->note_peak_amps[i]        = 0;
+        ed->note_peak_amps2[i]       = 0;
+    }
+
     // Step 2: Set up the frequency list.  You could do this multiple times
     // if you want to change the loadout of the frequencies.
     UpdateFrequencies(dd);
+    return true;
+}
+
+/**
+ * @brief Free a note finder and its DFT
+ *
+ * @param ed The note finder to free
+ * @param dd The DFT to free
+ */
+void DeinitColorChord(embeddedNf_data* ed, dft32_data* dd)
+{
+    heap_caps_free(ed->folded_bins);
+    ed->folded_bins = NULL;
+    ed->fuzzed_bins = NULL;
+    FreeDFTProgressive32(dd);
 }
 
 /**
@@ -123,6 +131,7 @@ void InitColorChord(embeddedNf_data* ed, dft32_data* dd)
 void HandleFrameInfo(embeddedNf_data* ed, dft32_data* dd)
 {
     int i, j, k;
+    uint8_t bpo = ed->binsPerOctave;
     uint8_t hitnotes[MAX_NOTES];
     memset(hitnotes, 0, sizeof(hitnotes));
 
@@ -135,36 +144,36 @@ void HandleFrameInfo(embeddedNf_data* ed, dft32_data* dd)
 #endif
 
     // Copy out the bins from the DFT to our fuzzed bins.
-    for (i = 0; i < FIX_BINS; i++)
+    for (i = 0; i < ed->bins; i++)
     {
         ed->fuzzed_bins[i]
             = (ed->fuzzed_bins[i] + (strens[i] >> FUZZ_IIR_BITS) - (ed->fuzzed_bins[i] >> FUZZ_IIR_BITS));
     }
 
     // Taper first octave
-    for (i = 0; i < FIX_B_PER_O; i++)
+    for (i = 0; i < bpo; i++)
     {
-        uint32_t taperamt  = (65536 / FIX_B_PER_O) * i;
+        uint32_t taperamt  = (65536 / bpo) * i;
         ed->fuzzed_bins[i] = (taperamt * ed->fuzzed_bins[i]) >> 16;
     }
 
     // Taper last octave
-    for (i = 0; i < FIX_B_PER_O; i++)
+    for (i = 0; i < bpo; i++)
     {
-        int newi              = FIX_BINS - i - 1;
-        uint32_t taperamt     = (65536 / FIX_B_PER_O) * i;
+        int newi              = ed->bins - i - 1;
+        uint32_t taperamt     = (65536 / bpo) * i;
         ed->fuzzed_bins[newi] = (taperamt * ed->fuzzed_bins[newi]) >> 16;
     }
 
     // Fold the bins from fuzzedbins into one octave.
-    for (i = 0; i < FIX_B_PER_O; i++)
+    for (i = 0; i < bpo; i++)
     {
         ed->folded_bins[i] = 0;
     }
     k = 0;
-    for (j = 0; j < OCTAVES; j++)
+    for (j = 0; j < ed->octaves; j++)
     {
-        for (i = 0; i < FIX_B_PER_O; i++)
+        for (i = 0; i < bpo; i++)
         {
             ed->folded_bins[i] += ed->fuzzed_bins[k++];
         }
@@ -177,10 +186,10 @@ void HandleFrameInfo(embeddedNf_data* ed, dft32_data* dd)
     for (j = 0; j < FILTER_BLUR_PASSES; j++)
     {
         // Extra scoping because this is a large on-stack buffer.
-        uint16_t folded_out[FIX_B_PER_O];
-        uint8_t adjLeft  = FIX_B_PER_O - 1;
+        uint16_t folded_out[MAX_B_PER_O];
+        uint8_t adjLeft  = bpo - 1;
         uint8_t adjRight = 1;
-        for (i = 0; i < FIX_B_PER_O; i++)
+        for (i = 0; i < bpo; i++)
         {
             uint16_t lbin = ed->folded_bins[adjLeft] >> 2;
             uint16_t rbin = ed->folded_bins[adjRight] >> 2;
@@ -190,18 +199,18 @@ void HandleFrameInfo(embeddedNf_data* ed, dft32_data* dd)
             // We do this funny dance to avoid a modulus operation.  On some
             // processors, a modulus operation is slow.  This is cheap.
             adjLeft++;
-            if (adjLeft == FIX_B_PER_O)
+            if (adjLeft == bpo)
             {
                 adjLeft = 0;
             }
             adjRight++;
-            if (adjRight == FIX_B_PER_O)
+            if (adjRight == bpo)
             {
                 adjRight = 0;
             }
         }
 
-        for (i = 0; i < FIX_B_PER_O; i++)
+        for (i = 0; i < bpo; i++)
         {
             ed->folded_bins[i] = folded_out[i];
         }
@@ -211,9 +220,9 @@ void HandleFrameInfo(embeddedNf_data* ed, dft32_data* dd)
     // normal tool.  As a warning, it expects that the values in foolded_bins
     // do NOT exceed 32767.
     {
-        uint8_t adjLeft  = FIX_B_PER_O - 1;
+        uint8_t adjLeft  = bpo - 1;
         uint8_t adjRight = 1;
-        for (i = 0; i < FIX_B_PER_O; i++)
+        for (i = 0; i < bpo; i++)
         {
             int16_t prev     = ed->folded_bins[adjLeft];
             int16_t next     = ed->folded_bins[adjRight];
@@ -221,12 +230,12 @@ void HandleFrameInfo(embeddedNf_data* ed, dft32_data* dd)
             uint8_t thisfreq = i << SEMI_BITS_PER_BIN;
             int16_t offset;
             adjLeft++;
-            if (adjLeft == FIX_B_PER_O)
+            if (adjLeft == bpo)
             {
                 adjLeft = 0;
             }
             adjRight++;
-            if (adjRight == FIX_B_PER_O)
+            if (adjRight == bpo)
             {
                 adjRight = 0;
             }
@@ -266,7 +275,7 @@ void HandleFrameInfo(embeddedNf_data* ed, dft32_data* dd)
             // In the event we went 'below zero' need to wrap to the top.
             if (thisfreq > 255 - (1 << SEMI_BITS_PER_BIN))
             {
-                thisfreq = (1 << SEMI_BITS_PER_BIN) * FIX_B_PER_O - (256 - thisfreq);
+                thisfreq = ed->noteRange - (256 - thisfreq);
             }
 
             // Okay, we have a peak, and a frequency. Now, we need to search
@@ -299,9 +308,9 @@ void HandleFrameInfo(embeddedNf_data* ed, dft32_data* dd)
 
                 // Make sure that if we've wrapped around the right side of the
                 // array, we can detect it and loop it back.
-                if (distance > ((1 << (SEMI_BITS_PER_BIN - 1)) * FIX_B_PER_O))
+                if (distance > (ed->noteRange >> 1))
                 {
-                    distance = ((1 << (SEMI_BITS_PER_BIN)) * FIX_B_PER_O) - distance;
+                    distance = ed->noteRange - distance;
                 }
 
                 // If we find a note closer to where we are than any of the
@@ -380,9 +389,9 @@ void HandleFrameInfo(embeddedNf_data* ed, dft32_data* dd)
 
             // If it wraps around above the halfway point, then we're closer to it
             // on the other side.
-            if (distance > ((1 << (SEMI_BITS_PER_BIN - 1)) * FIX_B_PER_O))
+            if (distance > (ed->noteRange >> 1))
             {
-                distance = ((1 << (SEMI_BITS_PER_BIN)) * FIX_B_PER_O) - distance;
+                distance = ed->noteRange - distance;
             }
 
             if (distance > MAX_COMBINE_DISTANCE)
@@ -467,7 +476,7 @@ void HandleFrameInfo(embeddedNf_data* ed, dft32_data* dd)
 #endif
 
 #if 0
-    for( i = 0; i < FIX_B_PER_O; i++ )
+    for( i = 0; i < bpo; i++ )
     {
         printf( "%4d ", ed->folded_bins[i] );
     }
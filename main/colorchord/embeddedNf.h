@@ -3,6 +3,7 @@
 #ifndef _EMBEDDED_NF_H
 #define _EMBEDDED_NF_H
 
+#include <stdbool.h>
 #include "ccconfig.h"
 
 // Use a 32-bit DFT.  It won't work for AVRs, but for any 32-bit systems where
@@ -13,9 +14,8 @@
     #define D_FREQ 8000
 #endif
 
-// You may make this a float. If PRECOMPUTE_FREQUENCY_TABLE is defined, then
-// it will create the table at compile time, and the float will never be used
-// runtime.
+// The frequency of the lowest bin. The frequency table is built from this when
+// setting up, which is the only time floating point is used.
 #define BASE_FREQ 55.0
 
 // The higher the number the slackier your FFT will be come.
@@ -37,13 +37,18 @@
 
 // Determines bit shifts for where notes lie.  We represent notes with an
 // uint8_t.  We have to define all of the possible locations on the note line
-// in this. note_frequency = 0..((1<<SEMI_BITS_PER_BIN)*FIX_B_PER_O-1)
+// in this. note_frequency = 0..((1<<SEMI_BITS_PER_BIN)*binsPerOctave-1)
 #ifndef SEMI_BITS_PER_BIN
     #define SEMI_BITS_PER_BIN 3
 #endif
 
+// The note range at the default resolution. ECCtoHEX() expects notes in this range.
 #define NOTE_RANGE ((1 << SEMI_BITS_PER_BIN) * FIX_B_PER_O)
 
+// The most bins per octave a note finder may have. 255 means a note is not set,
+// and notes which wrap below zero must land above the note range.
+#define MAX_B_PER_O ((256 - (1 << SEMI_BITS_PER_BIN)) >> SEMI_BITS_PER_BIN)
+
 // If there is detected note this far away from an established note, we will
 // then consider this new note the same one as last time, and move the
 // established note.  This is also used when combining notes.  It is this
@@ -80,17 +85,17 @@
     #define MINIMUM_AMP_FOR_NOTE_TO_DISAPPEAR 64
 #endif
 
-// This prevents compilation of any floating-point code, but it does come with
-// an added restriction: Both D_FREQ and BASE_FREQ must be #defined to be
-// constants.
-#define PRECOMPUTE_FREQUENCY_TABLE
-
 #include "DFT32.h"
 
 typedef struct
 {
-    uint16_t folded_bins[FIX_B_PER_O]; //<! The folded fourier output.
-    uint16_t fuzzed_bins[FIX_BINS];    //<! The Full DFT after IIR, Blur and Taper
+    uint8_t octaves;       //<! The number of octaves, the same as the DFT's
+    uint8_t binsPerOctave; //<! The number of bins per octave, the same as the DFT's
+    uint16_t bins;         //<! octaves * binsPerOctave
+    uint8_t noteRange;     //<! Notes are 0..(noteRange-1), (1<<SEMI_BITS_PER_BIN)*binsPerOctave
+
+    uint16_t* folded_bins; //<! The folded fourier output. [binsPerOctave]
+    uint16_t* fuzzed_bins; //<! The Full DFT after IIR, Blur and Taper. [bins]
     //  frequency of note; Note if it is == 255,
     // then it means it is not set. It is
     // generally a value from
@@ -106,7 +111,14 @@ typedef struct
 void UpdateFrequencies(dft32_data* dd);                    // Not user-useful on most systems.
 void HandleFrameInfo(embeddedNf_data* ed, dft32_data* dd); // Not user-useful on most systems
 
-// Call this when starting.
-void InitColorChord(embeddedNf_data* ed, dft32_data* dd);
+// Call this when starting. This uses the default resolution, OCTAVES and FIX_B_PER_O.
+bool InitColorChord(embeddedNf_data* ed, dft32_data* dd);
+
+// Call this when starting to pick the resolution. More bins cost more CPU time.
+// Each pair of ed and dd is an independent instance.
+bool InitColorChordRes(embeddedNf_data* ed, dft32_data* dd, uint8_t octaves, uint8_t binsPerOctave);
+
+// Call this when done to free everything allocated by InitColorChord() or InitColorChordRes().
+void DeinitColorChord(embeddedNf_data* ed, dft32_data* dd);
 
 #endif
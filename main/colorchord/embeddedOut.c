@@ -7,10 +7,32 @@
 #include "embeddedOut.h"
 #include "color_utils.h"
 
+//==============================================================================
+// Function Prototypes
+//==============================================================================
+
+static uint32_t NoteToHex(embeddedNf_data* end, uint8_t root, uint8_t note, uint8_t val);
+
 //==============================================================================
 // Functions
 //==============================================================================
 
+/**
+ * @brief Get the color of a note from a note finder of any resolution. ECCtoHEX() works on the default note range,
+ * so the note is scaled to that.
+ *
+ * @param end The note finder the note is from
+ * @param root The root note offset, in the note finder's note range
+ * @param note The note, in the note finder's note range
+ * @param val The brightness of the color
+ * @return uint32_t The color
+ */
+static uint32_t NoteToHex(embeddedNf_data* end, uint8_t root, uint8_t note, uint8_t val)
+{
+    uint16_t scaled = (((note + root) % end->noteRange) * NOTE_RANGE) / end->noteRange;
+    return ECCtoHEX(scaled, 255, val);
+}
+
 /**
  * @brief TODO
  *
@@ -174,9 +196,9 @@ void UpdateLinearLEDs(embeddedOut_data* eod, embeddedNf_data* end)
             {
                 d *= -1;
             }
-            if (d > (NOTE_RANGE >> 1))
+            if (d > (end->noteRange >> 1))
             {
-                d = NOTE_RANGE - d + 1;
+                d = end->noteRange - d + 1;
             }
             dqty += (d * d);
 
@@ -214,7 +236,7 @@ void UpdateLinearLEDs(embeddedOut_data* eod, embeddedNf_data* end)
         {
             amp = 255;
         }
-        uint32_t color = ECCtoHEX((eod->ledFreqOut[j] + eod->RootNoteOffset) % NOTE_RANGE, 255, amp);
+        uint32_t color = NoteToHex(end, eod->RootNoteOffset, eod->ledFreqOut[j], amp);
 
         // Flipping red and green here.
         eod->ledOut[l * 3 + 1] = (color >> 0) & 0xff;
@@ -287,7 +309,7 @@ void UpdateAllSameLEDs(embeddedOut_data* eod, embeddedNf_data* end)
     {
         amp = 255;
     }
-    uint32_t color = ECCtoHEX((freq + eod->RootNoteOffset) % NOTE_RANGE, 255, amp);
+    uint32_t color = NoteToHex(end, eod->RootNoteOffset, freq, amp);
 
     for (i = 0; i < CONFIG_NUM_LEDS; i++)
     {
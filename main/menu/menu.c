@@ -15,11 +15,21 @@
 
 const char* mnuBackStr = "Back";
 
+//==============================================================================
+// Variables
+//==============================================================================
+
+/// The generation given to the last menu which was created. See ::menu_t.generation
+static uint32_t lastMenuGeneration = 0;
+
 //==============================================================================
 // Function Prototypes
 //==============================================================================
 
 static void deinitSubMenu(menu_t* menu);
+static bool menuItemHasLabel(const menuItem_t* item, const char* label, uint8_t* optIdx);
+static void menuIndexItem(menu_t* menu, node_t* itemNode);
+static void menuUnindexItem(menu_t* menu, node_t* itemNode);
 
 //==============================================================================
 // Functions
@@ -55,6 +65,8 @@ menu_t* initMenu(const char* title, menuCb cbFunc)
     menu->items       = heap_caps_calloc(1, sizeof(list_t), MALLOC_CAP_SPIRAM);
     menu->parentMenu  = NULL;
     menu->showBattery = false;
+    menu->generation  = ++lastMenuGeneration;
+    openMapInitBin(&menu->labelIndex, 8, hashInt, intsEq);
     return menu;
 }
 
@@ -107,8 +119,9 @@ static void deinitSubMenu(menu_t* menu)
 
     // Clear all items in the list
     clear(menu->items);
-    // Free the list
+    // Free the list and the index into it
     heap_caps_free(menu->items);
+    openMapDeinit(&menu->labelIndex);
     // Free the menu
     heap_caps_free(menu);
 }
@@ -137,6 +150,8 @@ menu_t* startSubMenu(menu_t* menu, const char* label)
     subMenu->currentItem = NULL;
     subMenu->items       = heap_caps_calloc(1, sizeof(list_t), MALLOC_CAP_SPIRAM);
     subMenu->parentMenu  = menu;
+    subMenu->generation  = ++lastMenuGeneration;
+    openMapInitBin(&subMenu->labelIndex, 8, hashInt, intsEq);
 
     // Allocate a new menu item
     menuItem_t* newItem = heap_caps_calloc(1, sizeof(menuItem_t), MALLOC_CAP_SPIRAM);
@@ -146,6 +161,7 @@ menu_t* startSubMenu(menu_t* menu, const char* label)
     newItem->currentOpt = 0;
     newItem->subMenu    = subMenu;
     push(menu->items, newItem);
+    menuIndexItem(menu, menu->items->last);
 
     // If this is the first item, set it as the current
     if (1 == menu->items->length)
@@ -199,6 +215,7 @@ menuItem_t* addSingleItemToMenu(menu_t* menu, const char* label)
     newItem->currentOpt = 0;
     newItem->subMenu    = NULL;
     push(menu->items, newItem);
+    menuIndexItem(menu, menu->items->last);
 
     // If this is the first item, set it as the current
     if (1 == menu->items->length)
@@ -234,6 +251,7 @@ void removeSingleItemFromMenu(menu_t* menu, const char* label)
                     menu->currentItem = listNode->prev;
                 }
             }
+            menuUnindexItem(menu, listNode);
             removeEntry(menu->items, listNode);
             heap_caps_free(item);
             return;
@@ -268,6 +286,7 @@ void addMultiItemToMenu(menu_t* menu, const char* const* labels, uint8_t numLabe
     newItem->currentOpt = currentLabel;
     newItem->subMenu    = NULL;
     push(menu->items, newItem);
+    menuIndexItem(menu, menu->items->last);
 
     // If this is the first item, set it as the current
     if (1 == menu->items->length)
@@ -291,6 +310,7 @@ void removeMultiItemFromMenu(menu_t* menu, const char* const* labels)
         menuItem_t* item = listNode->val;
         if (item->options == labels)
         {
+            menuUnindexItem(menu, listNode);
             removeEntry(menu->items, listNode);
             if (menu->currentItem == listNode)
             {
@@ -334,6 +354,7 @@ void addSettingsItemToMenu(menu_t* menu, const char* label, const settingParam_t
     newItem->maxSetting     = bounds->max;
     newItem->currentSetting = val;
     push(menu->items, newItem);
+    menuIndexItem(menu, menu->items->last);
 
     // If this is the first item, set it as the current
     if (1 == menu->items->length)
@@ -357,6 +378,7 @@ void removeSettingsItemFromMenu(menu_t* menu, const char* label)
         menuItem_t* item = listNode->val;
         if (item->label == label)
         {
+            menuUnindexItem(menu, listNode);
             removeEntry(menu->items, listNode);
             if (menu->currentItem == listNode)
             {
@@ -432,6 +454,7 @@ void addSettingsOptionsItemToMenu(menu_t* menu, const char* settingLabel, const
     }
 
     push(menu->items, newItem);
+    menuIndexItem(menu, menu->items->last);
 
     // If this is the first item, set it as the current
     if (1 == menu->items->length)
@@ -455,6 +478,7 @@ void removeSettingsOptionsItemFromMenu(menu_t* menu, const char* const* optionLa
         menuItem_t* item = listNode->val;
         if (item->options == optionLabels)
         {
+            menuUnindexItem(menu, listNode);
             removeEntry(menu->items, listNode);
             if (menu->currentItem == listNode)
             {
@@ -474,6 +498,96 @@ void removeSettingsOptionsItemFromMenu(menu_t* menu, const char* const* optionLa
     }
 }
 
+/**
+ * @brief Check if an item has a label, the same way menuNavigateToItem() matches items. Items with a label only match
+ * that label, and items without one match any of their options
+ *
+ * @param item The item to check
+ * @param label The label to look for
+ * @param[out] optIdx Written with the index of the matching option, if the item has options instead of a label
+ * @return true if the item has the label, false if it doesn't
+ */
+static bool menuItemHasLabel(const menuItem_t* item, const char* label, uint8_t* optIdx)
+{
+    if (item->label)
+    {
+        return item->label == label;
+    }
+    else if (item->options)
+    {
+        for (uint8_t i = 0; i < item->numOptions; i++)
+        {
+            if (item->options[i] == label)
+            {
+                *optIdx = i;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Add an item's labels to the menu's label index, unless an earlier item already has them
+ *
+ * @param menu The menu the item was added to
+ * @param itemNode The item's node in the menu's list of items
+ */
+static void menuIndexItem(menu_t* menu, node_t* itemNode)
+{
+    const menuItem_t* item = itemNode->val;
+    if (item->label)
+    {
+        if (NULL == openMapGetBin(&menu->labelIndex, item->label))
+        {
+            openMapPutBin(&menu->labelIndex, item->label, itemNode);
+        }
+    }
+    else if (item->options)
+    {
+        for (uint8_t i = 0; i < item->numOptions; i++)
+        {
+            if (NULL != item->options[i] && NULL == openMapGetBin(&menu->labelIndex, item->options[i]))
+            {
+                openMapPutBin(&menu->labelIndex, item->options[i], itemNode);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Remove an item's labels from the menu's label index before the item is removed. If a later item has the same
+ * label, the index points to that item instead
+ *
+ * @param menu The menu the item is being removed from
+ * @param itemNode The item's node in the menu's list of items
+ */
+static void menuUnindexItem(menu_t* menu, node_t* itemNode)
+{
+    const menuItem_t* item = itemNode->val;
+    uint8_t numLabels      = item->label ? 1 : (item->options ? item->numOptions : 0);
+    for (uint8_t i = 0; i < numLabels; i++)
+    {
+        const char* label = item->label ? item->label : item->options[i];
+        if (NULL == label || itemNode != openMapGetBin(&menu->labelIndex, label))
+        {
+            continue;
+        }
+        openMapRemoveBin(&menu->labelIndex, label);
+
+        // Duplicate labels are rare, so just look through the rest of the list for one
+        uint8_t optIdx;
+        for (node_t* other = itemNode->next; NULL != other; other = other->next)
+        {
+            if (menuItemHasLabel(other->val, label, &optIdx))
+            {
+                openMapPutBin(&menu->labelIndex, label, other);
+                break;
+            }
+        }
+    }
+}
+
 /**
  * @brief Helper function to call the callback when a menu is navigated or an item is selected
  *
@@ -502,41 +616,35 @@ static void menuCallCallbackForItem(menu_t* menu, menuItem_t* item, bool selecte
  */
 menu_t* menuNavigateToItem(menu_t* menu, const char* label)
 {
-    node_t* listNode = menu->items->first;
-    while (NULL != listNode)
-    {
-        menuItem_t* item = listNode->val;
+    uint8_t optIdx   = 0;
+    node_t* listNode = (NULL != label) ? openMapGetBin(&menu->labelIndex, label) : NULL;
 
-        if (item->label)
+    // Items pushed to the list directly, or changed after being added, aren't in the index, so look for them too
+    if (NULL == listNode || !menuItemHasLabel(listNode->val, label, &optIdx))
+    {
+        listNode = menu->items->first;
+        while (NULL != listNode && !menuItemHasLabel(listNode->val, label, &optIdx))
         {
-            if (item->label == label)
-            {
-                menu->currentItem = listNode;
-                menuCallCallbackForItem(menu, item, false);
-                return menu;
-            }
+            listNode = listNode->next;
         }
-        else if (item->options)
-        {
-            for (uint8_t i = 0; i < item->numOptions; i++)
-            {
-                if (item->options[i] == label)
-                {
-                    menu->currentItem = listNode;
-                    item->currentOpt  = i;
+    }
 
-                    if (item->settingVals)
-                    {
-                        item->currentSetting = item->settingVals[i];
-                    }
+    if (NULL != listNode)
+    {
+        menuItem_t* item  = listNode->val;
+        menu->currentItem = listNode;
 
-                    menuCallCallbackForItem(menu, item, false);
-                    return menu;
-                }
+        if (!item->label)
+        {
+            item->currentOpt = optIdx;
+
+            if (item->settingVals)
+            {
+                item->currentSetting = item->settingVals[optIdx];
             }
         }
 
-        listNode = listNode->next;
+        menuCallCallbackForItem(menu, item, false);
     }
 
     return menu;
@@ -136,6 +136,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "linked_list.h"
+#include "openMap.h"
 #include "hdw-btn.h"
 #include "font.h"
 #include "settingsManager.h"
@@ -174,11 +175,13 @@ typedef struct _menu_t
     const char* title;        ///< The title for this menu
     menuCb cbFunc;            ///< The callback function to call when menu items are selected
     list_t* items;            ///< A list_t of menu items to display
+    openMap_t labelIndex;     ///< Maps each label and option label to the node_t in items of the first item with it
     node_t* currentItem;      ///< The currently selected menu item
     menu_t* parentMenu;       ///< The parent menu, may be NULL if this is not a submenu
     bool showBattery;         ///< true if the battery measurement should be shown. false by default
     int32_t batteryReadTimer; ///< A timer to read the battery every 10s
     int batteryLevel;         ///< The current battery measurement
+    uint32_t generation;      ///< Unique to this menu, to tell it apart from an old menu at the same address
 } menu_t;
 
 /// @brief A string used to return to super-menus that says "Back"
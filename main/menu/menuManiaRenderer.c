@@ -2,6 +2,7 @@
 // Includes
 //==============================================================================
 
+#include <string.h>
 #include <esp_random.h>
 #include <esp_heap_caps.h>
 #include "hdw-battmon.h"
@@ -20,14 +21,17 @@
 // Defines
 //==============================================================================
 
-#define ITEMS_PER_PAGE 5
-
 #define PARALLELOGRAM_X_OFFSET 13
 #define PARALLELOGRAM_HEIGHT   25
 #define PARALLELOGRAM_WIDTH    229
 #define ROW_MARGIN             8
 #define DROP_SHADOW_OFFSET     (ROW_MARGIN / 2)
 
+/// The Y coordinate of the first row on a page
+#define FIRST_ROW_Y (MANIA_TITLE_HEIGHT + Y_SECTION_MARGIN)
+/// The Y coordinate of a row on a page
+#define ROW_Y(idx) (FIRST_ROW_Y + (idx) * (PARALLELOGRAM_HEIGHT + ROW_MARGIN))
+
 #define ARROW_MARGIN 4
 #define ARROW_WIDTH  2
 
@@ -60,6 +64,11 @@ static const int16_t selectedBounceOffsets[] = {
 
 static void drawMenuText(menuManiaRenderer_t* renderer, const char* text, int16_t x, int16_t y, bool isSelected,
                          bool leftArrow, bool rightArrow, bool doubleArrows);
+static void drawManiaTitle(menu_t* menu, menuManiaRenderer_t* renderer);
+static void drawManiaItem(menuManiaRenderer_t* renderer, const menuItem_t* item, int16_t y, bool isSelected);
+static void drawManiaStatic(menu_t* menu, menuManiaRenderer_t* renderer, node_t* pageStart);
+static void updateManiaStaticLayer(menu_t* menu, menuManiaRenderer_t* renderer, node_t* pageStart);
+static void blitManiaStaticLayer(menuManiaRenderer_t* renderer);
 
 //==============================================================================
 // Functions
@@ -188,6 +197,9 @@ void deinitMenuManiaRenderer(menuManiaRenderer_t* renderer)
     freeWsg(&renderer->batt[2]);
     freeWsg(&renderer->batt[3]);
 
+    // Free the offscreen layer, if it was turned on
+    setManiaStaticCache(renderer, false);
+
     // Free fonts if allocated
     if (renderer->titleFontAllocated)
     {
@@ -361,6 +373,188 @@ static void drawManiaRing(int16_t radius, int16_t angle, paletteColor_t ringColo
     drawCircleFilled((TFT_WIDTH / 2) + circlePos.x, (TFT_HEIGHT / 2) + circlePos.y, ORBIT_RING_RADIUS_2, ringColor);
 }
 
+/**
+ * @brief Draw the title and the hexagon behind it
+ *
+ * @param menu The menu to draw the title of
+ * @param renderer The renderer to draw with
+ */
+static void drawManiaTitle(menu_t* menu, menuManiaRenderer_t* renderer)
+{
+    // Where to start drawing
+    int16_t y = Y_SECTION_MARGIN;
+
+    int16_t tWidth = textWidth(renderer->titleFont, menu->title);
+
+    // Draw blue hexagon behind the title
+    int16_t titleBgX0 = (TFT_WIDTH - tWidth) / 2 - 6;
+    int16_t titleBgX1 = (TFT_WIDTH + tWidth) / 2 + 6;
+    int16_t titleBgY0 = y;
+    int16_t titleBgY1 = y + TITLE_BG_HEIGHT;
+    fillDisplayArea(titleBgX0, titleBgY0, titleBgX1, titleBgY1, renderer->titleBgColor);
+    drawTriangleOutlined(titleBgX0, titleBgY0, titleBgX0, titleBgY1, titleBgX0 - (TITLE_BG_HEIGHT / 2),
+                         (titleBgY0 + titleBgY1) / 2, renderer->titleBgColor, renderer->titleBgColor);
+    drawTriangleOutlined(titleBgX1, titleBgY0, titleBgX1, titleBgY1, titleBgX1 + (TITLE_BG_HEIGHT / 2),
+                         (titleBgY0 + titleBgY1) / 2, renderer->titleBgColor, renderer->titleBgColor);
+
+    // Draw a title
+    y += (TITLE_BG_HEIGHT - renderer->titleFont->height) / 2;
+    // Draw the menu text
+    drawText(renderer->titleFont, renderer->titleTextColor, menu->title, (TFT_WIDTH - tWidth) / 2, y);
+    // Outline the menu text
+    drawText(renderer->titleFontOutline, renderer->textOutlineColor, menu->title, (TFT_WIDTH - tWidth) / 2, y);
+}
+
+/**
+ * @brief Draw a single menu item as a row, with its current label and arrows
+ *
+ * @param renderer The renderer to draw with
+ * @param item The item to draw
+ * @param y The Y coordinate to draw the row at
+ * @param isSelected true if the item is selected, false if it is not
+ */
+static void drawManiaItem(menuManiaRenderer_t* renderer, const menuItem_t* item, int16_t y, bool isSelected)
+{
+    char buffer[64]   = {0};
+    const char* label = getMenuItemLabelText(buffer, sizeof(buffer), item);
+
+    bool leftArrow    = menuItemHasPrev(item) || menuItemIsBack(item);
+    bool rightArrow   = menuItemHasNext(item) || menuItemHasSubMenu(item);
+    bool doubleArrows = menuItemIsBack(item) || menuItemHasSubMenu(item);
+
+    drawMenuText(renderer, label, PARALLELOGRAM_X_OFFSET, y, isSelected, leftArrow, rightArrow, doubleArrows);
+}
+
+/**
+ * @brief Draw the parts of the menu which don't animate, the title and the unselected rows on the current page
+ *
+ * @param menu The menu to draw
+ * @param renderer The renderer to draw with
+ * @param pageStart The node of the first item on the current page
+ */
+static void drawManiaStatic(menu_t* menu, menuManiaRenderer_t* renderer, node_t* pageStart)
+{
+    drawManiaTitle(menu, renderer);
+
+    node_t* curNode = pageStart;
+    for (uint8_t itemIdx = 0; itemIdx < MANIA_ITEMS_PER_PAGE && NULL != curNode; itemIdx++)
+    {
+        if (menu->currentItem->val != curNode->val)
+        {
+            drawManiaItem(renderer, (const menuItem_t*)curNode->val, ROW_Y(itemIdx), false);
+        }
+        curNode = curNode->next;
+    }
+}
+
+/**
+ * @brief Redraw the offscreen layer with the title and unselected rows if anything drawn in it has changed. This draws
+ * over the whole display, so it must be called before the frame is drawn
+ *
+ * @param menu The menu to draw
+ * @param renderer The renderer to draw with
+ * @param pageStart The node of the first item on the current page
+ */
+static void updateManiaStaticLayer(menu_t* menu, menuManiaRenderer_t* renderer, node_t* pageStart)
+{
+    if (NULL == renderer->staticLayer)
+    {
+        return;
+    }
+
+    // Build the key for what would be drawn now. It's zeroed first so it can be compared with memcmp()
+    maniaLayerKey_t key;
+    memset(&key, 0, sizeof(maniaLayerKey_t));
+    key.menu       = menu;
+    key.generation = menu->generation;
+    if (NULL != menu->title)
+    {
+        strncpy(key.title, menu->title, sizeof(key.title) - 1);
+    }
+    key.selectedItem = menu->currentItem->val;
+
+    node_t* curNode = pageStart;
+    for (uint8_t itemIdx = 0; itemIdx < MANIA_ITEMS_PER_PAGE && NULL != curNode; itemIdx++)
+    {
+        const menuItem_t* item = curNode->val;
+        if (key.selectedItem != item)
+        {
+            key.items[itemIdx]  = item;
+            key.values[itemIdx] = (item->options) ? item->currentOpt : item->currentSetting;
+
+            // Copy the text which would be drawn, in case it was written to the same buffer
+            char* keyLabel    = key.labels[itemIdx];
+            const char* label = getMenuItemLabelText(keyLabel, MANIA_KEY_TEXT_LEN, item);
+            if (label != keyLabel)
+            {
+                strncpy(keyLabel, label, MANIA_KEY_TEXT_LEN - 1);
+            }
+        }
+        curNode = curNode->next;
+    }
+
+    if (renderer->staticValid && 0 == memcmp(&key, &renderer->staticKey, sizeof(maniaLayerKey_t)))
+    {
+        // Nothing changed
+        return;
+    }
+
+    // Draw the layer on a transparent display, then save it
+    paletteColor_t* pxs = getPxTftFramebuffer();
+    fillDisplayArea(0, 0, TFT_WIDTH, TFT_HEIGHT, cTransparent);
+    drawManiaStatic(menu, renderer, pageStart);
+    memcpy(renderer->staticLayer, pxs, TFT_WIDTH * TFT_HEIGHT * sizeof(paletteColor_t));
+
+    // Save the runs of pixels which were drawn, so only those are copied each frame
+    dynArrayClear(&renderer->staticSpans);
+    for (int16_t y = 0; y < TFT_HEIGHT; y++)
+    {
+        const paletteColor_t* row = &renderer->staticLayer[y * TFT_WIDTH];
+        int16_t x                 = 0;
+        while (x < TFT_WIDTH)
+        {
+            // Skip transparent pixels
+            while (x < TFT_WIDTH && cTransparent == row[x])
+            {
+                x++;
+            }
+
+            // Find the end of the opaque pixels
+            int16_t x0 = x;
+            while (x < TFT_WIDTH && cTransparent != row[x])
+            {
+                x++;
+            }
+
+            if (x0 < x && NULL == DYN_ARRAY_PUSH(&renderer->staticSpans, maniaSpan_t, .y = y, .x0 = x0, .x1 = x))
+            {
+                // Out of memory, so stop caching and draw everything directly
+                setManiaStaticCache(renderer, false);
+                return;
+            }
+        }
+    }
+
+    memcpy(&renderer->staticKey, &key, sizeof(maniaLayerKey_t));
+    renderer->staticValid = true;
+}
+
+/**
+ * @brief Copy the offscreen layer with the title and unselected rows to the display, over what's already drawn
+ *
+ * @param renderer The renderer with the layer to copy
+ */
+static void blitManiaStaticLayer(menuManiaRenderer_t* renderer)
+{
+    paletteColor_t* pxs = getPxTftFramebuffer();
+    for (uint32_t i = 0; i < renderer->staticSpans.length; i++)
+    {
+        const maniaSpan_t* span = &DYN_ARRAY_AT(&renderer->staticSpans, maniaSpan_t, i);
+        int32_t offset          = span->y * TFT_WIDTH + span->x0;
+        memcpy(&pxs[offset], &renderer->staticLayer[offset], (span->x1 - span->x0) * sizeof(paletteColor_t));
+    }
+}
+
 /**
  * @brief Draw a themed menu to the display and control the LEDs
  *
@@ -484,21 +678,6 @@ void drawMenuMania(menu_t* menu, menuManiaRenderer_t* renderer, int64_t elapsedU
 
     renderer->selectedMarqueeTimer += elapsedUs;
 
-    // Clear the background
-    fillDisplayArea(0, 0, TFT_WIDTH, TFT_HEIGHT, renderer->bgColor);
-
-    if (renderer->drawRings)
-    {
-        // Draw the rings
-        for (int16_t i = 0; i < ARRAY_SIZE(renderer->rings); i++)
-        {
-            maniaRing_t* ring  = &renderer->rings[i];
-            int16_t ringRadius = (MIN_RING_RADIUS + MAX_RING_RADIUS) / 2
-                                 + (((MAX_RING_RADIUS - MIN_RING_RADIUS) * getSin1024(ring->diameterAngle)) / 1024);
-            drawManiaRing(ringRadius, ring->orbitAngle, ring->color, renderer->bgColor);
-        }
-    }
-
     // Find the start of the 'page'
     node_t* pageStart = menu->items->first;
     uint8_t pageIdx   = 0;
@@ -515,7 +694,7 @@ void drawMenuMania(menu_t* menu, menuManiaRenderer_t* renderer, int64_t elapsedU
         {
             curNode = curNode->next;
             pageIdx++;
-            if (ITEMS_PER_PAGE <= pageIdx && NULL != curNode)
+            if (MANIA_ITEMS_PER_PAGE <= pageIdx && NULL != curNode)
             {
                 pageIdx   = 0;
                 pageStart = curNode;
@@ -523,55 +702,56 @@ void drawMenuMania(menu_t* menu, menuManiaRenderer_t* renderer, int64_t elapsedU
         }
     }
 
-    // Where to start drawing
-    int16_t y = Y_SECTION_MARGIN;
-
-    int16_t tWidth = textWidth(renderer->titleFont, menu->title);
+    // Redraw the title and unselected rows offscreen, if anything in them changed
+    updateManiaStaticLayer(menu, renderer, pageStart);
 
-    // Draw blue hexagon behind the title
-    int16_t titleBgX0 = (TFT_WIDTH - tWidth) / 2 - 6;
-    int16_t titleBgX1 = (TFT_WIDTH + tWidth) / 2 + 6;
-    int16_t titleBgY0 = y;
-    int16_t titleBgY1 = y + TITLE_BG_HEIGHT;
-    fillDisplayArea(titleBgX0, titleBgY0, titleBgX1, titleBgY1, renderer->titleBgColor);
-    drawTriangleOutlined(titleBgX0, titleBgY0, titleBgX0, titleBgY1, titleBgX0 - (TITLE_BG_HEIGHT / 2),
-                         (titleBgY0 + titleBgY1) / 2, renderer->titleBgColor, renderer->titleBgColor);
-    drawTriangleOutlined(titleBgX1, titleBgY0, titleBgX1, titleBgY1, titleBgX1 + (TITLE_BG_HEIGHT / 2),
-                         (titleBgY0 + titleBgY1) / 2, renderer->titleBgColor, renderer->titleBgColor);
+    // Clear the background
+    fillDisplayArea(0, 0, TFT_WIDTH, TFT_HEIGHT, renderer->bgColor);
 
-    // Draw a title
-    y += (TITLE_BG_HEIGHT - renderer->titleFont->height) / 2;
-    // Draw the menu text
-    drawText(renderer->titleFont, renderer->titleTextColor, menu->title, (TFT_WIDTH - tWidth) / 2, y);
-    // Outline the menu text
-    drawText(renderer->titleFontOutline, renderer->textOutlineColor, menu->title, (TFT_WIDTH - tWidth) / 2, y);
+    if (renderer->drawRings)
+    {
+        // Draw the rings
+        for (int16_t i = 0; i < ARRAY_SIZE(renderer->rings); i++)
+        {
+            maniaRing_t* ring  = &renderer->rings[i];
+            int16_t ringRadius = (MIN_RING_RADIUS + MAX_RING_RADIUS) / 2
+                                 + (((MAX_RING_RADIUS - MIN_RING_RADIUS) * getSin1024(ring->diameterAngle)) / 1024);
+            drawManiaRing(ringRadius, ring->orbitAngle, ring->color, renderer->bgColor);
+        }
+    }
 
-    // Move to drawing the rows
-    y = titleBgY1 + Y_SECTION_MARGIN;
+    // Draw the title and unselected rows over the rings
+    if (NULL != renderer->staticLayer)
+    {
+        blitManiaStaticLayer(renderer);
+    }
+    else
+    {
+        drawManiaStatic(menu, renderer, pageStart);
+    }
 
-    if (menu->items->length > ITEMS_PER_PAGE && renderer->pageArrowTimer > 500000)
+    bool drawPageArrows = menu->items->length > MANIA_ITEMS_PER_PAGE && renderer->pageArrowTimer > 500000;
+    if (drawPageArrows)
     {
         // Draw UP page indicator
-        y -= (UP_ARROW_HEIGHT);
+        int16_t y = FIRST_ROW_Y - UP_ARROW_HEIGHT;
         for (int t = 0; t < UP_ARROW_HEIGHT - UP_ARROW_MARGIN; t++)
         {
             drawLineFast(PARALLELOGRAM_X_OFFSET + PARALLELOGRAM_HEIGHT - t + (UP_ARROW_HEIGHT * 2 - 1) / 2, y + t,
                          PARALLELOGRAM_X_OFFSET + PARALLELOGRAM_HEIGHT + t + (UP_ARROW_HEIGHT * 2 - 1) / 2, y + t,
                          renderer->rowColor);
         }
-        y += (UP_ARROW_HEIGHT);
     }
 
-    // Draw a page-worth of items
-    for (uint8_t itemIdx = 0; itemIdx < ITEMS_PER_PAGE; itemIdx++)
+    // Draw the selected item, which animates
+    curNode = pageStart;
+    for (uint8_t itemIdx = 0; itemIdx < MANIA_ITEMS_PER_PAGE && NULL != curNode; itemIdx++)
     {
-        if (NULL != pageStart)
+        menuItem_t* item = (menuItem_t*)curNode->val;
+        if (menu->currentItem->val == item)
         {
-            menuItem_t* item = (menuItem_t*)pageStart->val;
-            bool isSelected  = (menu->currentItem->val == item);
-
             // If there's a new selected item
-            if (isSelected && renderer->selectedItem != item)
+            if (renderer->selectedItem != item)
             {
                 // Save it
                 renderer->selectedItem = item;
@@ -579,41 +759,29 @@ void drawMenuMania(menu_t* menu, menuManiaRenderer_t* renderer, int64_t elapsedU
                 renderer->selectedBounceIdx    = 1;
                 renderer->selectedMarqueeTimer = 0;
             }
-            else if (isSelected)
+            // If the selected option has changed
+            else if (menuItemHasOptions(item) || menuItemIsSetting(item))
             {
-                // If the selected option has changed
-                if (menuItemHasOptions(item) || menuItemIsSetting(item))
+                int32_t value = (item->options) ? item->currentOpt : item->currentSetting;
+                if (value != renderer->selectedValue)
                 {
-                    int32_t value = (item->options) ? item->currentOpt : item->currentSetting;
-                    if (value != renderer->selectedValue)
-                    {
-                        renderer->selectedMarqueeTimer = 0;
-                        renderer->selectedValue        = value;
-                    }
+                    renderer->selectedMarqueeTimer = 0;
+                    renderer->selectedValue        = value;
                 }
             }
 
-            char buffer[64]   = {0};
-            const char* label = getMenuItemLabelText(buffer, sizeof(buffer), item);
-
-            bool leftArrow    = menuItemHasPrev(item) || menuItemIsBack(item);
-            bool rightArrow   = menuItemHasNext(item) || menuItemHasSubMenu(item);
-            bool doubleArrows = menuItemIsBack(item) || menuItemHasSubMenu(item);
-
-            drawMenuText(renderer, label, PARALLELOGRAM_X_OFFSET, y, isSelected, leftArrow, rightArrow, doubleArrows);
-
-            // Move to the next item
-            pageStart = pageStart->next;
+            drawManiaItem(renderer, item, ROW_Y(itemIdx), true);
+            break;
         }
 
-        // Move to the next row
-        y += PARALLELOGRAM_HEIGHT + ROW_MARGIN;
+        // Move to the next item
+        curNode = curNode->next;
     }
 
-    if (menu->items->length > ITEMS_PER_PAGE && renderer->pageArrowTimer > 500000)
+    if (drawPageArrows)
     {
-        y += UP_ARROW_MARGIN;
         // Draw DOWN page indicator
+        int16_t y = ROW_Y(MANIA_ITEMS_PER_PAGE) + UP_ARROW_MARGIN;
         for (int16_t t = UP_ARROW_HEIGHT - UP_ARROW_MARGIN; t >= 0; t--)
         {
             drawLineFast(PARALLELOGRAM_X_OFFSET + PARALLELOGRAM_WIDTH - t - (UP_ARROW_HEIGHT * 2) / 2, y - t,
@@ -676,6 +844,34 @@ void setManiaDrawRings(menuManiaRenderer_t* renderer, bool ringsOn)
     renderer->drawRings = ringsOn;
 }
 
+/**
+ * @brief Set if the title and unselected rows should be drawn once to an offscreen layer and copied each frame. This
+ * makes drawing the menu much faster, but the layer is as big as the display, about 67KB of SPIRAM, so it's off by
+ * default
+ *
+ * @param renderer The renderer to set
+ * @param cacheOn true to allocate the layer and draw from it, false to free it and draw everything directly
+ */
+void setManiaStaticCache(menuManiaRenderer_t* renderer, bool cacheOn)
+{
+    if (cacheOn && NULL == renderer->staticLayer)
+    {
+        // If the layer can't be allocated, the title and rows are still drawn directly
+        renderer->staticLayer = heap_caps_malloc(TFT_WIDTH * TFT_HEIGHT * sizeof(paletteColor_t), MALLOC_CAP_SPIRAM);
+        if (NULL != renderer->staticLayer)
+        {
+            dynArrayInit(&renderer->staticSpans, sizeof(maniaSpan_t), 256, MALLOC_CAP_SPIRAM);
+        }
+    }
+    else if (!cacheOn && NULL != renderer->staticLayer)
+    {
+        heap_caps_free(renderer->staticLayer);
+        renderer->staticLayer = NULL;
+        dynArrayDeinit(&renderer->staticSpans);
+    }
+    renderer->staticValid = false;
+}
+
 /**
  * @brief Recolor a menu renderer
  *
@@ -711,4 +907,7 @@ void recolorMenuManiaRenderer(menuManiaRenderer_t* renderer, paletteColor_t titl
     renderer->shadowColorsLen   = shadowColorsLen;
     renderer->selectedShadowIdx = 0;
     renderer->baseLedColor      = baseLedColor;
+
+    // The title and rows must be redrawn in the new colors
+    renderer->staticValid = false;
 }
@@ -19,6 +19,13 @@
  * The menu is drawn with drawMenuMania(). This will both draw over the entire display and light LEDs. The menu may be
  * drawn on top of later.
  *
+ * The title and the unselected rows only change when the menu does, but drawing text, especially the outlined title, is
+ * slow. setManiaStaticCache() draws them once to an offscreen layer, which is copied over the animated rings each
+ * frame. Then only the rings, the selected row, the page arrows, and the battery are drawn from scratch. The layer is
+ * redrawn whenever the menu, the page, the selected item, a visible label, or the colors change. The layer is as big as
+ * the display, about 67KB of SPIRAM, so it's off by default. Turn it on for menus which are shown for a long time,
+ * like the main menu.
+ *
  * \section menuManiaRenderer_example Example
  *
  * See menu.h for examples on how to use menuManiaRenderer
@@ -31,10 +38,14 @@
 #include "fs_font.h"
 #include "fs_wsg.h"
 #include "hdw-led.h"
+#include "dynArray.h"
 
 #define Y_SECTION_MARGIN 14
 #define TITLE_BG_HEIGHT  40
 
+/// The number of menu items drawn on each page
+#define MANIA_ITEMS_PER_PAGE 5
+
 /// The height of the title section, from the top of the TFT to the bottom of the title block
 #define MANIA_TITLE_HEIGHT (TITLE_BG_HEIGHT + Y_SECTION_MARGIN)
 
@@ -52,6 +63,34 @@ typedef struct
     paletteColor_t color;     ///< The color of this ring
 } maniaRing_t;
 
+/**
+ * @brief A horizontal run of opaque pixels in the static layer
+ */
+typedef struct
+{
+    int16_t y;  ///< The row of the run
+    int16_t x0; ///< The first column of the run
+    int16_t x1; ///< The column after the last column of the run
+} maniaSpan_t;
+
+/// The longest title or label text compared to tell if the static layer changed, including the null terminator
+#define MANIA_KEY_TEXT_LEN 64
+
+/**
+ * @brief Everything the static layer was drawn from. If any of it changes, the layer is redrawn. Text is copied rather
+ * than pointed to, because menus are often rebuilt at the same address, and labels are often written to the same buffer
+ */
+typedef struct
+{
+    const menu_t* menu;                                    ///< The menu which was drawn
+    uint32_t generation;                                   ///< The ::menu_t.generation of the menu which was drawn
+    char title[MANIA_KEY_TEXT_LEN];                        ///< The title text which was drawn
+    const menuItem_t* selectedItem;                        ///< The selected item, which isn't part of the layer
+    const menuItem_t* items[MANIA_ITEMS_PER_PAGE];         ///< The unselected items on the page, or NULL
+    char labels[MANIA_ITEMS_PER_PAGE][MANIA_KEY_TEXT_LEN]; ///< The label text drawn for each unselected item
+    int32_t values[MANIA_ITEMS_PER_PAGE];                  ///< The option index or setting value of each item
+} maniaLayerKey_t;
+
 /**
  * @brief A struct containing all the state data to render a mania-style menu and LEDs
  */
@@ -97,6 +136,11 @@ typedef struct
     const paletteColor_t* shadowColors; ///< The colors cycled through as the selected shadow
     int32_t shadowColorsLen;            ///< The number of selected shadow colors to cycle through
     led_t baseLedColor;                 ///< The base color of the LED rotation
+
+    paletteColor_t* staticLayer; ///< The title and unselected rows drawn offscreen, or NULL if they're drawn directly
+    dynArray_t staticSpans;      ///< The runs of opaque pixels in staticLayer, as maniaSpan_t
+    maniaLayerKey_t staticKey;   ///< What staticLayer was drawn from
+    bool staticValid;            ///< false if staticLayer must be redrawn before it's used
 } menuManiaRenderer_t;
 
 menuManiaRenderer_t* initMenuManiaRenderer(font_t* titleFont, font_t* titleFontOutline, font_t* menuFont);
@@ -104,6 +148,7 @@ void deinitMenuManiaRenderer(menuManiaRenderer_t* renderer);
 void drawMenuMania(menu_t* menu, menuManiaRenderer_t* renderer, int64_t elapsedUs);
 void setManiaLedsOn(menuManiaRenderer_t* renderer, bool ledsOn);
 void setManiaDrawRings(menuManiaRenderer_t* renderer, bool ringsOn);
+void setManiaStaticCache(menuManiaRenderer_t* renderer, bool cacheOn);
 void recolorMenuManiaRenderer(menuManiaRenderer_t* renderer, paletteColor_t titleBgColor, paletteColor_t titleTextColor,
                               paletteColor_t textOutlineColor, paletteColor_t bgColor, paletteColor_t outerRingColor,
                               paletteColor_t innerRingColor, paletteColor_t rowColor, paletteColor_t rowTextColor,
@@ -732,6 +732,60 @@ int8_t donutDrumkitFunc(percussionNote_t drum, uint32_t idx, bool* done, uint32_
 #endif
 }
 
+const int8_t* defaultDrumkitSamples(percussionNote_t drum, uint32_t* count, void* data)
+{
+#ifdef USE_BAKED_DRUMS
+    if (ACOUSTIC_BASS_DRUM_OR_LOW_BASS_DRUM <= drum && drum <= OPEN_TRIANGLE)
+    {
+        int32_t dIdx = drum - ACOUSTIC_BASS_DRUM_OR_LOW_BASS_DRUM;
+        *count       = bakedDrumsLens[dIdx];
+        return bakedDrums[dIdx];
+    }
+#endif
+
+    *count = 0;
+    return NULL;
+}
+
+const int8_t* donutDrumkitSamples(percussionNote_t drum, uint32_t* count, void* data)
+{
+#ifdef USE_BAKED_DRUMS
+    int32_t dIdx = -1;
+    if (ACOUSTIC_BASS_DRUM_OR_LOW_BASS_DRUM <= drum && drum <= LOW_MID_TOM)
+    {
+        dIdx = 0;
+    }
+    else if (HIGH_MID_TOM <= drum && drum <= HIGH_BONGO)
+    {
+        dIdx = 1;
+    }
+    else if (LOW_BONGO == drum)
+    {
+        // Colossus Roar
+        dIdx = 2;
+    }
+    else if (SHORT_WHISTLE == drum)
+    {
+        // MAG
+        dIdx = 3;
+    }
+    else if (LONG_WHISTLE == drum)
+    {
+        // FEST
+        dIdx = 4;
+    }
+
+    if (dIdx >= 0)
+    {
+        *count = bakedDonutDrumsLens[dIdx];
+        return bakedDonutDrums[dIdx];
+    }
+#endif
+
+    *count = 0;
+    return NULL;
+}
+
 #ifdef BAKE_DRUMS
 
     #include <stdio.h>
@@ -27,6 +27,26 @@ int8_t defaultDrumkitFunc(percussionNote_t drum, uint32_t idx, bool* done, uint3
  */
 int8_t donutDrumkitFunc(percussionNote_t drum, uint32_t idx, bool* done, uint32_t scratch[4], void* data);
 
+/**
+ * @brief Returns the pre-rendered samples for a drum of the standard drumkit, if they were baked into the firmware
+ *
+ * @param drum The MIDI note corresponding to the drum to play
+ * @param[out] count A pointer to be set to the number of samples returned
+ * @param data Not used by this drumkit
+ * @return const int8_t* The signed 8-bit samples for the drum, or NULL if none are available
+ */
+const int8_t* defaultDrumkitSamples(percussionNote_t drum, uint32_t* count, void* data);
+
+/**
+ * @brief Returns the pre-rendered samples for a drum of the King Donut drumkit, if they were baked into the firmware
+ *
+ * @param drum The drum index, between ::ACOUSTIC_BASS_DRUM_OR_LOW_BASS_DRUM and ::HIGH_BONGO, inclusive
+ * @param[out] count A pointer to be set to the number of samples returned
+ * @param data Not used by this drumkit
+ * @return const int8_t* The signed 8-bit samples for the drum, or NULL if none are available
+ */
+const int8_t* donutDrumkitSamples(percussionNote_t drum, uint32_t* count, void* data);
+
 #ifdef BAKE_DRUMS
 void bakeDrums(void);
 #endif
\ No newline at end of file
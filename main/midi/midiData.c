@@ -177,7 +177,7 @@ const midiTimbre_t noiseHitTimbre = {
 
 const midiTimbre_t colossusTimbre = {
     .type = SAMPLE,
-    .flags = TF_NONE,
+    .flags = TF_INTERPOLATE,
     .sample = {
         // Config will be replaced by .data and .count at load time
         .config = {
@@ -194,7 +194,7 @@ const midiTimbre_t colossusTimbre = {
 
 const midiTimbre_t magTimbre = {
     .type = SAMPLE,
-    .flags = TF_NONE,
+    .flags = TF_INTERPOLATE,
     .sample = {
         // Config will be replaced by .data and .count at load time
         .config = {
@@ -211,7 +211,7 @@ const midiTimbre_t magTimbre = {
 
 const midiTimbre_t festTimbre = {
     .type = SAMPLE,
-    .flags = TF_NONE,
+    .flags = TF_INTERPOLATE,
     .sample = {
         // Config will be replaced by .data and .count at load time
         .config = {
@@ -228,7 +228,7 @@ const midiTimbre_t festTimbre = {
 
 const midiTimbre_t wilhelmTimbre = {
     .type = SAMPLE,
-    .flags = TF_NONE,
+    .flags = TF_INTERPOLATE,
     .sample = {
         // Config will be replaced by .data and .count at load time
         .config = {
@@ -245,7 +245,7 @@ const midiTimbre_t wilhelmTimbre = {
 
 const midiTimbre_t noriTimbre = {
     .type = SAMPLE,
-    .flags = TF_NONE,
+    .flags = TF_INTERPOLATE,
     .sample = {
         // Config will be replaced by .data and .count at load time
         .config = {
@@ -275,6 +275,7 @@ const midiTimbre_t defaultDrumkitTimbre = {
         .playFunc = defaultDrumkitFunc,
         // TODO: Define the data and put it here!
         .data = NULL,
+        .getSamples = defaultDrumkitSamples,
     },
     .envelope = { 0 },
     .name = "Swadge Drums 0",
@@ -287,6 +288,7 @@ const midiTimbre_t donutDrumkitTimbre = {
         .playFunc = donutDrumkitFunc,
         // This should be set though
         .data = NULL,
+        .getSamples = donutDrumkitSamples,
     },
     .envelope = { 0 },
     .name = "Donut Swadge Drums",
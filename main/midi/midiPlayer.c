@@ -84,6 +84,34 @@ static const uint8_t oscDither[] = {
 
 static midiPlayer_t* globalPlayers = NULL;
 
+/**
+ * @brief A single drum sound rendered into the percussion cache
+ */
+typedef struct
+{
+    /// @brief The function which generated this drum
+    percussionFunc_t playFunc;
+
+    /// @brief The user data passed to the function which generated this drum
+    void* data;
+
+    /// @brief The drum which was rendered
+    percussionNote_t drum;
+
+    /// @brief The rendered samples, or NULL if this drum could not be rendered and must be played live
+    int8_t* samples;
+
+    /// @brief The number of rendered samples
+    uint32_t count;
+} percCacheEntry_t;
+
+/// @brief Drum sounds rendered ahead of time by midiPercussionCacheWarm(), shared by all MIDI players
+static percCacheEntry_t percCache[PERCUSSION_CACHE_SIZE];
+
+/// @brief The number of entries used in percCache. Entries are filled before this is incremented, so the audio path may
+/// read them while more are added
+static uint8_t percCacheCount = 0;
+
 static uint32_t allocVoice(const voiceStates_t* states, uint8_t voiceCount);
 static bool releaseNote(voiceStates_t* states, uint8_t voiceIdx, midiVoice_t* voice);
 static void midiStepVoice(midiChannel_t* channel, voiceStates_t* states, uint8_t voiceIdx, midiVoice_t* voice);
@@ -91,11 +119,19 @@ static void setVoiceTimbre(midiVoice_t* voice, midiTimbre_t* timbre);
 static void initTimbre(midiTimbre_t* dest, const midiTimbre_t* config);
 static const midiTimbre_t* getTimbreForProgram(bool percussion, uint8_t bank, uint8_t program);
 static int32_t midiSumPercussion(midiPlayer_t* player);
+static uq16_16 sampleStepForFreq(const midiTimbre_t* timbre, uq16_16 freq);
+static void noteOn(midiPlayer_t* player, uint8_t chanId, uint8_t note, uint8_t velocity);
+static void afterTouch(midiPlayer_t* player, uint8_t channel, uint8_t note, uint8_t velocity);
+static void noteOff(midiPlayer_t* player, uint8_t channel, uint8_t note, uint8_t velocity);
 static void handleMidiEvent(midiPlayer_t* player, const midiStatusEvent_t* event);
 static void handleSysexEvent(midiPlayer_t* player, const midiSysexEvent_t* sysex);
 static void handleMetaEvent(midiPlayer_t* player, const midiMetaEvent_t* event);
 static void handleEvent(midiPlayer_t* player, const midiEvent_t* event);
 static void midiSongEnd(midiPlayer_t* player);
+static void midiRunSchedule(midiPlayer_t* player);
+static const int8_t* getPercussionSamples(const midiTimbre_t* timbre, percussionNote_t drum, uint32_t* count);
+static const percCacheEntry_t* findPercussionSamples(percussionFunc_t playFunc, void* data, percussionNote_t drum);
+static void renderPercussionSamples(percussionFunc_t playFunc, void* data, percussionNote_t drum);
 
 // Check for the first unused note, then try to steal one in order of less to more bad, and return INT32_MAX if none are
 // available
@@ -572,10 +608,20 @@ static int32_t midiSumPercussion(midiPlayer_t* player)
         playingVoices &= ~(1 << voiceIdx);
 
         bool done = false;
-        sum += voices[voiceIdx].timbre->percussion.playFunc(voices[voiceIdx].note, voices[voiceIdx].sampleTick++, &done,
-                                                            voices[voiceIdx].percScratch,
-                                                            voices[voiceIdx].timbre->percussion.data)
-               * voices[voiceIdx].velocity / 127;
+        int32_t sample;
+        if (voices[voiceIdx].percSamples)
+        {
+            // Pre-rendered drum, just read it from the table
+            sample = voices[voiceIdx].percSamples[voices[voiceIdx].sampleTick++];
+            done   = (voices[voiceIdx].sampleTick >= voices[voiceIdx].percSampleCount);
+        }
+        else
+        {
+            sample = voices[voiceIdx].timbre->percussion.playFunc(voices[voiceIdx].note, voices[voiceIdx].sampleTick++,
+                                                                  &done, voices[voiceIdx].percScratch,
+                                                                  voices[voiceIdx].timbre->percussion.data);
+        }
+        sum += sample * voices[voiceIdx].velocity / 127;
 
         if (done)
         {
@@ -623,7 +669,8 @@ static int32_t midiSumPercussion(midiPlayer_t* player)
 
             states->on &= ~(1 << voiceIdx);
             player->channels[voices[voiceIdx].channel].allocedVoices &= ~(1 << voiceIdx);
-            voices[voiceIdx].sampleTick = 0;
+            voices[voiceIdx].sampleTick  = 0;
+            voices[voiceIdx].percSamples = NULL;
             memset(voices[voiceIdx].percScratch, 0, 4 * sizeof(uint32_t));
         }
     }
@@ -631,6 +678,38 @@ static int32_t midiSumPercussion(midiPlayer_t* player)
     return sum;
 }
 
+/**
+ * @brief Calculate how far a sample timbre's playback position advances per DAC sample
+ *
+ * @param timbre The sample timbre
+ * @param freq The frequency of the note to play, with pitch bend applied
+ * @return The number of source samples per DAC sample, as a UQ16.16
+ */
+static uq16_16 sampleStepForFreq(const midiTimbre_t* timbre, uq16_16 freq)
+{
+    // A step of 0 would never finish the sample, so a sample without a rate is played at the DAC's rate
+    uint32_t rate = timbre->sample.rate ? timbre->sample.rate : DAC_SAMPLE_RATE_HZ;
+
+    if (0 == timbre->sample.baseNote)
+    {
+        // The sample's pitch isn't known, so play it at its own rate no matter which note it's for
+        return (uq16_16)(((uint64_t)rate << 16) / DAC_SAMPLE_RATE_HZ);
+    }
+
+    // Both the sample rate ratio and the pitch ratio are applied at once to keep the precision
+    return (uq16_16)((((uint64_t)rate << 16) * freq) / ((uint64_t)DAC_SAMPLE_RATE_HZ * timbre->sample.baseNote));
+}
+
+/**
+ * @brief Sum the output of all voices playing sample timbres
+ *
+ * Each voice steps through its sample data by a fixed-point fractional step, so samples may be stored at any rate
+ * and played at any pitch. Timbres with ::TF_INTERPOLATE linearly interpolate between source samples, otherwise the
+ * nearest earlier sample is held.
+ *
+ * @param player The MIDI player
+ * @return The summed samples
+ */
 static int32_t midiSumSamples(midiPlayer_t* player)
 {
     voiceStates_t* states = &player->poolVoiceStates;
@@ -646,79 +725,194 @@ static int32_t midiSumSamples(midiPlayer_t* player)
         uint8_t voiceIdx = __builtin_ctz(playingVoices);
         playingVoices &= ~(1 << voiceIdx);
 
-        if (voices[voiceIdx].timbre->type != SAMPLE)
+        midiVoice_t* voice         = &voices[voiceIdx];
+        const midiTimbre_t* timbre = voice->timbre;
+        if (timbre->type != SAMPLE)
         {
             // Only sample timbres past here!
             continue;
         }
 
-        // Same rate for now -- this is the number of times we need to output each source sample
-        // in order to maintain the desired speed/pitch ratio
-        uq24_8 sampleRateRatio = (1 << 8) * DAC_SAMPLE_RATE_HZ / voices[voiceIdx].timbre->sample.rate;
-        sampleRateRatio *= voices[voiceIdx].timbre->sample.baseNote;
-        sampleRateRatio /= bendPitchWheel(voices[voiceIdx].note, player->channels[voices[voiceIdx].channel].pitchBend);
-        // Assume C4 is the base note? A4? doesn't really matter
-        // Divide the desired note freq
-
-        bool done      = false;
-        int32_t sample = (int)voices[voiceIdx].timbre->sample.data[voices[voiceIdx].sampleTick] - 128;
-
-        // TODO: Possibly change to 0x08000 for rounding at the half?
-        if (voices[voiceIdx].sampleError > 0x100)
+        uint32_t count     = timbre->sample.count;
+        uint32_t loopStart = timbre->sample.loopStart;
+        uint32_t loopEnd   = timbre->sample.loopEnd;
+        if (0 == loopEnd || loopEnd > count)
         {
-            voices[voiceIdx].sampleError -= 0x100;
+            loopEnd = count;
         }
-        else
+        // sampleLoops is the number of plays remaining through the loop section, 0 means forever
+        bool looping = (1 != voice->sampleLoops) && (loopStart < loopEnd);
+
+        bool done = (voice->sampleTick >= count);
+        if (!done)
         {
-            do
+            int32_t sample = (int32_t)timbre->sample.data[voice->sampleTick] - 128;
+
+            if (timbre->flags & TF_INTERPOLATE)
             {
-                // TODO this probably will not work if we go backwards
-                voices[voiceIdx].sampleTick++;
-                // We now need to omit (playRate / sampleDataRate) samples before continuing
-                voices[voiceIdx].sampleError += sampleRateRatio;
-                // And account for the sample we just played
+                // Find the next source sample, following the loop
+                uint32_t nextTick = voice->sampleTick + 1;
+                if (looping && nextTick == loopEnd)
+                {
+                    nextTick = loopStart;
+                }
 
-                if (voices[voiceIdx].sampleTick == voices[voiceIdx].timbre->sample.count)
+                if (nextTick < count)
                 {
-                    if (voices[voiceIdx].sampleLoops > 0)
-                    {
-                        voices[voiceIdx].sampleLoops--;
+                    int32_t next = (int32_t)timbre->sample.data[nextTick] - 128;
+                    sample += ((next - sample) * (int32_t)(voice->sampleFrac >> 1)) >> 15;
+                }
+            }
 
-                        if (!voices[voiceIdx].sampleLoops)
-                        {
-                            done = true;
-                            break;
-                        }
-                        else
-                        {
-                            voices[voiceIdx].sampleTick = 0;
-                        }
-                    }
-                    else
-                    {
-                        voices[voiceIdx].sampleTick = 0;
-                    }
+            sum += sample * voice->velocity / 127;
+
+            // Advance the playback position by the fractional step
+            uint32_t pos      = voice->sampleFrac + voice->sampleStep;
+            voice->sampleFrac = pos & 0xFFFF;
+            voice->sampleTick += pos >> 16;
+
+            // Loop back as many times as the step passed the end of the loop
+            while (looping && voice->sampleTick >= loopEnd)
+            {
+                voice->sampleTick -= (loopEnd - loopStart);
+                if (voice->sampleLoops > 0)
+                {
+                    voice->sampleLoops--;
+                    looping = (1 != voice->sampleLoops);
                 }
-            } while (voices[voiceIdx].sampleError < 0x100);
+            }
 
-            voices[voiceIdx].sampleError -= 0x100;
+            done = (voice->sampleTick >= count);
         }
 
-        sum += sample * voices[voiceIdx].velocity / 127;
-
         if (done)
         {
             states->on &= ~(1 << voiceIdx);
-            player->channels[voices[voiceIdx].channel].allocedVoices &= ~(1 << voiceIdx);
-            voices[voiceIdx].sampleTick  = 0;
-            voices[voiceIdx].sampleLoops = 0;
-            voices[voiceIdx].sampleError = 0;
+            player->channels[voice->channel].allocedVoices &= ~(1 << voiceIdx);
+            voice->sampleTick  = 0;
+            voice->sampleLoops = 0;
+            voice->sampleFrac  = 0;
         }
     }
 
     return sum;
 }
 
+/**
+ * @brief Return pre-rendered samples for a drum. This is called from the audio path, so it never renders anything.
+ * Drums which are neither baked nor in the percussion cache are played live
+ *
+ * @param timbre The percussion timbre to play
+ * @param drum The drum to play
+ * @param[out] count A pointer to be set to the number of samples returned
+ * @return const int8_t* The samples for the drum, or NULL if it must be generated live
+ */
+static const int8_t* getPercussionSamples(const midiTimbre_t* timbre, percussionNote_t drum, uint32_t* count)
+{
+    *count = 0;
+
+    if (timbre->flags & TF_LIVE_PERCUSSION)
+    {
+        return NULL;
+    }
+
+    if (timbre->percussion.getSamples)
+    {
+        // If the drum was baked ahead of time, use that
+        const int8_t* baked = timbre->percussion.getSamples(drum, count, timbre->percussion.data);
+        if (baked && *count > 0)
+        {
+            return baked;
+        }
+        *count = 0;
+    }
+
+    const percCacheEntry_t* entry = findPercussionSamples(timbre->percussion.playFunc, timbre->percussion.data, drum);
+    if (NULL == entry)
+    {
+        return NULL;
+    }
+
+    *count = entry->count;
+    return entry->samples;
+}
+
+/**
+ * @brief Find a drum's entry in the percussion cache
+ *
+ * @param playFunc The function which generates the drum
+ * @param data The user data passed to playFunc
+ * @param drum The drum to find
+ * @return The drum's entry, or NULL if it hasn't been rendered. The entry's samples are NULL if it couldn't be rendered
+ */
+static const percCacheEntry_t* findPercussionSamples(percussionFunc_t playFunc, void* data, percussionNote_t drum)
+{
+    uint8_t cacheCount = __atomic_load_n(&percCacheCount, __ATOMIC_ACQUIRE);
+    for (uint8_t i = 0; i < cacheCount; i++)
+    {
+        if (percCache[i].playFunc == playFunc && percCache[i].data == data && percCache[i].drum == drum)
+        {
+            return &percCache[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Render a drum into the next percussion cache entry, then publish it. Only the main task renders drums, so
+ * the entry is only read by the audio path once it's complete
+ *
+ * @param playFunc The function which generates the drum
+ * @param data The user data to pass to playFunc
+ * @param drum The drum to render
+ */
+static void renderPercussionSamples(percussionFunc_t playFunc, void* data, percussionNote_t drum)
+{
+    if (percCacheCount >= PERCUSSION_CACHE_SIZE)
+    {
+        // No more room, this drum will be generated live
+        return;
+    }
+
+    // Measure the drum first, so we don't need a scratch buffer the size of the longest drum
+    uint32_t scratch[4] = {0};
+    uint32_t len        = 0;
+    bool done           = false;
+    while (!done && len < PERCUSSION_CACHE_MAX_SAMPLES)
+    {
+        playFunc(drum, len++, &done, scratch, data);
+    }
+
+    percCacheEntry_t* entry = &percCache[percCacheCount];
+    entry->playFunc         = playFunc;
+    entry->data             = data;
+    entry->drum             = drum;
+    entry->samples          = NULL;
+    entry->count            = 0;
+
+    // If the drum never finished, it's left with a NULL entry so it is played live without measuring it again
+    if (done)
+    {
+        int8_t* samples = heap_caps_malloc_tag(len, MALLOC_CAP_SPIRAM, "percCache");
+        if (samples)
+        {
+            // The final sample, returned along with done, is played too
+            memset(scratch, 0, sizeof(scratch));
+            done = false;
+            for (uint32_t idx = 0; idx < len; idx++)
+            {
+                samples[idx] = playFunc(drum, idx, &done, scratch, data);
+            }
+            entry->samples = samples;
+            entry->count   = len;
+        }
+    }
+
+    // Publish the entry only once it's filled
+    __atomic_store_n(&percCacheCount, percCacheCount + 1, __ATOMIC_RELEASE);
+}
+
 /**
  * @brief Process a normal MIDI status event and update the player state accordingly
  *
@@ -1169,6 +1363,75 @@ static void handleEvent(midiPlayer_t* player, const midiEvent_t* event)
     }
 }
 
+/**
+ * @brief Sort newly scheduled events into the player's schedule and handle every event which is due
+ *
+ * This is the only place the schedule is read, so it is safe to call from the audio task while midiScheduleEvent()
+ * is called from the main loop.
+ *
+ * @param player The MIDI player to run the schedule of
+ */
+static void midiRunSchedule(midiPlayer_t* player)
+{
+    // Discard everything that was scheduled before midiClearSchedule() was last called
+    uint32_t clearHead = __atomic_load_n(&player->scheduleClearHead, __ATOMIC_ACQUIRE);
+    if (clearHead != player->scheduleClearSeen)
+    {
+        player->scheduleClearSeen = clearHead;
+
+        uint8_t kept = 0;
+        for (uint8_t i = 0; i < player->scheduleCount; i++)
+        {
+            if ((int32_t)(player->schedule[i].seq - clearHead) >= 0)
+            {
+                player->schedule[kept++] = player->schedule[i];
+            }
+        }
+        player->scheduleCount = kept;
+
+        if ((int32_t)(clearHead - player->scheduleInboxTail) > 0)
+        {
+            __atomic_store_n(&player->scheduleInboxTail, clearHead, __ATOMIC_RELEASE);
+        }
+    }
+
+    // Insertion sort new events into the schedule. Events for the same time stay in the order they were scheduled
+    uint32_t head = __atomic_load_n(&player->scheduleInboxHead, __ATOMIC_ACQUIRE);
+    uint32_t tail = player->scheduleInboxTail;
+    while (tail != head)
+    {
+        const midiScheduledEvent_t* newEvent = &player->scheduleInbox[tail % MIDI_SCHEDULE_SIZE];
+
+        uint8_t idx = player->scheduleCount;
+        while (idx > 0 && player->schedule[idx - 1].time > newEvent->time)
+        {
+            player->schedule[idx] = player->schedule[idx - 1];
+            idx--;
+        }
+        player->schedule[idx] = *newEvent;
+
+        // Count the event before releasing its slot so midiScheduleFree() never sees too much room
+        player->scheduleCount++;
+        tail++;
+        __atomic_store_n(&player->scheduleInboxTail, tail, __ATOMIC_RELEASE);
+    }
+
+    // Handle every event which is due
+    uint8_t due = 0;
+    while (due < player->scheduleCount && player->schedule[due].time <= player->sampleCount)
+    {
+        handleMidiEvent(player, &player->schedule[due].event);
+        due++;
+    }
+
+    if (due)
+    {
+        memmove(&player->schedule[0], &player->schedule[due],
+                (player->scheduleCount - due) * sizeof(player->schedule[0]));
+        player->scheduleCount -= due;
+    }
+}
+
 static void midiSongEnd(midiPlayer_t* player)
 {
     for (uint8_t ch = 0; ch < MIDI_CHANNEL_COUNT; ch++)
@@ -1195,6 +1458,8 @@ static void midiSongEnd(midiPlayer_t* player)
 
 void midiPlayerInit(midiPlayer_t* player)
 {
+    dacLock();
+
     // Zero out EVERYTHING
     memset(player, 0, sizeof(midiPlayer_t));
 
@@ -1219,10 +1484,14 @@ void midiPlayerInit(midiPlayer_t* player)
 
     // Set up the values which must be non-zero
     midiPlayerReset(player);
+
+    dacUnlock();
 }
 
 void midiPlayerReset(midiPlayer_t* player)
 {
+    dacLock();
+
     midiAllSoundOff(player);
     midiGmOff(player);
 
@@ -1241,10 +1510,16 @@ void midiPlayerReset(midiPlayer_t* player)
 
     deinitMidiParser(&player->reader);
     player->paused = true;
+
+    midiClearSchedule(player);
+
+    dacUnlock();
 }
 
 void midiPlayerResetNewSong(midiPlayer_t* player)
 {
+    dacLock();
+
     midiAllSoundOff(player);
 
     // Set all the relevant bits to 1, meaning not in use
@@ -1252,6 +1527,11 @@ void midiPlayerResetNewSong(midiPlayer_t* player)
 
     player->sampleCount    = 0;
     player->eventAvailable = false;
+
+    // Scheduled times are relative to sampleCount, which was just reset
+    midiClearSchedule(player);
+
+    dacUnlock();
 }
 
 int32_t midiPlayerStep(midiPlayer_t* player)
@@ -1261,6 +1541,13 @@ int32_t midiPlayerStep(midiPlayer_t* player)
         return 0;
     }
 
+    // Handle any events scheduled for this sample
+    if (player->scheduleCount || player->scheduleInboxHead != player->scheduleInboxTail
+        || player->scheduleClearHead != player->scheduleClearSeen)
+    {
+        midiRunSchedule(player);
+    }
+
     bool checkEvents = true;
     if (player->mode == MIDI_FILE)
     {
@@ -1399,6 +1686,8 @@ void midiPlayerFillBufferMulti(midiPlayer_t* players, uint8_t playerCount, uint8
 
 void midiAllSoundOff(midiPlayer_t* player)
 {
+    dacLock();
+
     // TODO: It is unclear whether this applies to every channel or just one
     // Seems like people "agree" it's special and applies to every channel
     // But also people say the spec is deficient in this area.
@@ -1450,10 +1739,14 @@ void midiAllSoundOff(midiPlayer_t* player)
         chan->held          = false;
         chan->sustenuto     = false;
     }
+
+    dacUnlock();
 }
 
 void midiResetChannelControllers(midiPlayer_t* player, uint8_t channel)
 {
+    dacLock();
+
     midiChannel_t* chan = &player->channels[channel];
     midiSustain(player, channel, MIDI_FALSE);
     chan->volume              = UINT14_MAX;
@@ -1465,10 +1758,14 @@ void midiResetChannelControllers(midiPlayer_t* player, uint8_t channel)
     chan->held              = 0;
     chan->sustenuto         = 0;
     initTimbre(&chan->timbre, getTimbreForProgram(chan->percussion, chan->bank, chan->program));
+
+    dacUnlock();
 }
 
 void midiGmOn(midiPlayer_t* player)
 {
+    dacLock();
+
     for (uint8_t chanIdx = 0; chanIdx < MIDI_CHANNEL_COUNT; chanIdx++)
     {
         midiChannel_t* chan = &player->channels[chanIdx];
@@ -1481,10 +1778,14 @@ void midiGmOn(midiPlayer_t* player)
 
         initTimbre(&chan->timbre, getTimbreForProgram(chan->percussion, 0, chan->program));
     }
+
+    dacUnlock();
 }
 
 void midiGmOff(midiPlayer_t* player)
 {
+    dacLock();
+
     for (uint8_t chanIdx = 0; chanIdx < MIDI_CHANNEL_COUNT; chanIdx++)
     {
         midiChannel_t* chan = &player->channels[chanIdx];
@@ -1533,10 +1834,14 @@ void midiGmOff(midiPlayer_t* player)
 
         initTimbre(&chan->timbre, getTimbreForProgram(chan->percussion, chan->bank, chan->program));
     }
+
+    dacUnlock();
 }
 
 void midiAllNotesOff(midiPlayer_t* player, uint8_t channel)
 {
+    dacLock();
+
     midiChannel_t* chan   = &player->channels[channel];
     voiceStates_t* states = chan->percussion ? &player->percVoiceStates : &player->poolVoiceStates;
 
@@ -1551,14 +1856,24 @@ void midiAllNotesOff(midiPlayer_t* player, uint8_t channel)
 
         playingVoices &= ~(1 << voiceIdx);
     }
+
+    dacUnlock();
 }
 
-void midiNoteOn(midiPlayer_t* player, uint8_t chanId, uint8_t note, uint8_t velocity)
+/**
+ * @brief Start playing a note. This is midiNoteOn() without taking the audio lock
+ *
+ * @param player The MIDI player
+ * @param chanId The channel to play the note on
+ * @param note The MIDI note number
+ * @param velocity The note velocity. 0 stops the note
+ */
+static void noteOn(midiPlayer_t* player, uint8_t chanId, uint8_t note, uint8_t velocity)
 {
     if (velocity == 0)
     {
         // MIDI note on with a value of 0 is considered a note off
-        midiNoteOff(player, chanId, note, 0x7F);
+        noteOff(player, chanId, note, 0x7F);
         return;
     }
 
@@ -1720,13 +2035,15 @@ void midiNoteOn(midiPlayer_t* player, uint8_t chanId, uint8_t note, uint8_t velo
     if ((chan->timbre.flags & TF_PERCUSSION))
     {
         // Reset the percussion voice state
-        voice->sampleTick = 0;
+        voice->sampleTick  = 0;
+        voice->percSamples = getPercussionSamples(&chan->timbre, note, &voice->percSampleCount);
     }
     else if (chan->timbre.type == SAMPLE)
     {
         voice->sampleTick  = 0;
-        voice->sampleError = 0;
+        voice->sampleFrac  = 0;
         voice->sampleLoops = chan->timbre.sample.loop;
+        voice->sampleStep  = sampleStepForFreq(&chan->timbre, bendPitchWheel(note, chan->pitchBend));
     }
     else
     {
@@ -1747,7 +2064,15 @@ void midiNoteOn(midiPlayer_t* player, uint8_t chanId, uint8_t note, uint8_t velo
     }
 }
 
-void midiAfterTouch(midiPlayer_t* player, uint8_t channel, uint8_t note, uint8_t velocity)
+/**
+ * @brief Change the pressure of a playing note. This is midiAfterTouch() without taking the audio lock
+ *
+ * @param player The MIDI player
+ * @param channel The channel the note is playing on
+ * @param note The MIDI note number
+ * @param velocity The new pressure
+ */
+static void afterTouch(midiPlayer_t* player, uint8_t channel, uint8_t note, uint8_t velocity)
 {
     midiChannel_t* chan = &player->channels[channel];
 
@@ -1797,7 +2122,15 @@ void midiAfterTouch(midiPlayer_t* player, uint8_t channel, uint8_t note, uint8_t
     }
 }
 
-void midiNoteOff(midiPlayer_t* player, uint8_t channel, uint8_t note, uint8_t velocity)
+/**
+ * @brief Stop playing a note. This is midiNoteOff() without taking the audio lock
+ *
+ * @param player The MIDI player
+ * @param channel The channel the note is playing on
+ * @param note The MIDI note number
+ * @param velocity The release velocity
+ */
+static void noteOff(midiPlayer_t* player, uint8_t channel, uint8_t note, uint8_t velocity)
 {
     midiChannel_t* chan   = &player->channels[channel];
     voiceStates_t* states = chan->percussion ? &player->percVoiceStates : &player->poolVoiceStates;
@@ -1864,8 +2197,31 @@ void midiNoteOff(midiPlayer_t* player, uint8_t channel, uint8_t note, uint8_t ve
     }
 }
 
+void midiNoteOn(midiPlayer_t* player, uint8_t chanId, uint8_t note, uint8_t velocity)
+{
+    dacLock();
+    noteOn(player, chanId, note, velocity);
+    dacUnlock();
+}
+
+void midiAfterTouch(midiPlayer_t* player, uint8_t channel, uint8_t note, uint8_t velocity)
+{
+    dacLock();
+    afterTouch(player, channel, note, velocity);
+    dacUnlock();
+}
+
+void midiNoteOff(midiPlayer_t* player, uint8_t channel, uint8_t note, uint8_t velocity)
+{
+    dacLock();
+    noteOff(player, channel, note, velocity);
+    dacUnlock();
+}
+
 void midiSetProgram(midiPlayer_t* player, uint8_t channel, uint8_t program)
 {
+    dacLock();
+
     // Dynamic voice allocation somehow makes this way simpler
     player->channels[channel].program = program;
 
@@ -1879,10 +2235,14 @@ void midiSetProgram(midiPlayer_t* player, uint8_t channel, uint8_t program)
         // It's fine for now because envelopes, etc. aren't fully implemented so the only difference is the wave index
         player->channels[channel].timbre.waveIndex = program;
     }
+
+    dacUnlock();
 }
 
 void midiSustain(midiPlayer_t* player, uint8_t channel, uint8_t val)
 {
+    dacLock();
+
     midiChannel_t* chan = &player->channels[channel];
     bool newIsHold      = MIDI_TO_BOOL(val);
 
@@ -1926,10 +2286,14 @@ void midiSustain(midiPlayer_t* player, uint8_t channel, uint8_t val)
         }
         chan->held = newIsHold;
     }
+
+    dacUnlock();
 }
 
 void midiSustenuto(midiPlayer_t* player, uint8_t channel, uint8_t val)
 {
+    dacLock();
+
     midiChannel_t* chan = &player->channels[channel];
     bool newIsSust      = MIDI_TO_BOOL(val);
 
@@ -1969,10 +2333,14 @@ void midiSustenuto(midiPlayer_t* player, uint8_t channel, uint8_t val)
         }
         chan->sustenuto = newIsSust;
     }
+
+    dacUnlock();
 }
 
 void midiControlChange(midiPlayer_t* player, uint8_t channel, midiControl_t control, uint8_t val)
 {
+    dacLock();
+
     switch (control)
     {
         case MCC_BANK_MSB:
@@ -2148,9 +2516,11 @@ void midiControlChange(midiPlayer_t* player, uint8_t channel, midiControl_t cont
                 ESP_LOGI("MIDI", "Ignoring unknown/unsupported controller: %" PRIu8, ctlNum);
                 state[ctlNum / 32] |= (1 << (ctlNum % 32));
             }
-            return;
+            break;
         }
     }
+
+    dacUnlock();
 }
 
 uint8_t midiGetControlValue(midiPlayer_t* player, uint8_t channel, midiControl_t control)
@@ -2211,6 +2581,8 @@ uint16_t midiGetControlValue14bit(midiPlayer_t* player, uint8_t channel, midiCon
 
 void midiSetParameter(midiPlayer_t* player, uint8_t channel, bool registeredParam, uint16_t param, uint16_t value)
 {
+    dacLock();
+
     if (registeredParam)
     {
         switch (param)
@@ -2268,6 +2640,8 @@ void midiSetParameter(midiPlayer_t* player, uint8_t channel, bool registeredPara
             }
         }
     }
+
+    dacUnlock();
 }
 
 uint16_t midiGetParameterValue(midiPlayer_t* player, uint8_t channel, bool registered, uint16_t param)
@@ -2299,21 +2673,29 @@ uint16_t midiGetParameterValue(midiPlayer_t* player, uint8_t channel, bool regis
 
 void midiPitchWheel(midiPlayer_t* player, uint8_t channel, uint16_t value)
 {
+    dacLock();
+
     // Save the pitch bend value
     player->channels[channel].pitchBend = value;
     voiceStates_t* states = player->channels[channel].percussion ? &player->percVoiceStates : &player->poolVoiceStates;
     midiVoice_t* voices   = player->channels[channel].percussion ? player->percVoices : player->poolVoices;
 
-    if (player->channels[channel].timbre.type != SAMPLE)
+    // Find all the voices currently sounding for this channel and update their frequencies
+    uint32_t playingVoices = (VS_ANY(states) | states->held) & player->channels[channel].allocedVoices;
+
+    while (playingVoices != 0)
     {
-        // Find all the voices currently sounding for this channel and update their frequencies
-        uint32_t playingVoices = (VS_ANY(states) | states->held) & player->channels[channel].allocedVoices;
+        uint8_t voiceIdx  = __builtin_ctz(playingVoices);
+        uint32_t voiceBit = (1 << voiceIdx);
 
-        while (playingVoices != 0)
+        if (player->channels[channel].timbre.type == SAMPLE)
+        {
+            // Sample voices just change their playback speed
+            voices[voiceIdx].sampleStep
+                = sampleStepForFreq(voices[voiceIdx].timbre, bendPitchWheel(voices[voiceIdx].note, value));
+        }
+        else
         {
-            uint8_t voiceIdx  = __builtin_ctz(playingVoices);
-            uint32_t voiceBit = (1 << voiceIdx);
-
             for (uint8_t oscIdx = 0; oscIdx < OSC_PER_VOICE; oscIdx++)
             {
                 // Apply the pitch bend to all this channel's oscillators
@@ -2323,23 +2705,30 @@ void midiPitchWheel(midiPlayer_t* player, uint8_t channel, uint16_t value)
                 swSynthSetFreqPrecise(&voices[voiceIdx].oscillators[oscIdx],
                                       bendPitchWheel(voices[voiceIdx].note, value));
             }
-
-            // Next!
-            playingVoices &= ~voiceBit;
         }
+
+        // Next!
+        playingVoices &= ~voiceBit;
     }
+
+    dacUnlock();
 }
 
 void midiSetTempo(midiPlayer_t* player, uint32_t tempo)
 {
+    dacLock();
+
     uint32_t oldTempo = player->tempo;
 
     player->tempo       = tempo;
     player->sampleCount = player->sampleCount * tempo / oldTempo;
+
+    dacUnlock();
 }
 
 void midiSetFile(midiPlayer_t* player, const midiFile_t* song)
 {
+    dacLock();
     player->mode = MIDI_FILE;
     if (player->reader.states == NULL)
     {
@@ -2355,11 +2744,81 @@ void midiSetFile(midiPlayer_t* player, const midiFile_t* song)
     {
         midiParserSetFile(&player->reader, song);
     }
+    dacUnlock();
+
+    // Render any drums which aren't baked now, rather than in the audio path. The cache is safe to add to while the
+    // audio task plays, so this is done without the audio lock
+    for (uint8_t ch = 0; ch < MIDI_CHANNEL_COUNT; ch++)
+    {
+        if (player->channels[ch].timbre.flags & TF_PERCUSSION)
+        {
+            midiPercussionCacheWarm(&player->channels[ch].timbre);
+        }
+    }
+}
+
+uint64_t midiPlayerGetSampleTime(midiPlayer_t* player)
+{
+    return player->sampleCount;
+}
+
+bool midiScheduleEvent(midiPlayer_t* player, uint64_t time, const midiStatusEvent_t* event)
+{
+    if (0 == midiScheduleFree(player))
+    {
+        return false;
+    }
+
+    uint32_t head              = player->scheduleInboxHead;
+    midiScheduledEvent_t* slot = &player->scheduleInbox[head % MIDI_SCHEDULE_SIZE];
+    slot->time                 = time;
+    slot->seq                  = head;
+    slot->event                = *event;
+
+    // Publish the event only after it's fully written
+    __atomic_store_n(&player->scheduleInboxHead, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+bool midiScheduleNoteOn(midiPlayer_t* player, uint64_t time, uint8_t channel, uint8_t note, uint8_t velocity)
+{
+    midiStatusEvent_t event = {
+        .status = 0x90 | (channel & 0x0F),
+        .data   = {note & 0x7F, velocity & 0x7F},
+    };
+    return midiScheduleEvent(player, time, &event);
+}
+
+bool midiScheduleNoteOff(midiPlayer_t* player, uint64_t time, uint8_t channel, uint8_t note, uint8_t velocity)
+{
+    midiStatusEvent_t event = {
+        .status = 0x80 | (channel & 0x0F),
+        .data   = {note & 0x7F, velocity & 0x7F},
+    };
+    return midiScheduleEvent(player, time, &event);
+}
+
+uint8_t midiScheduleFree(midiPlayer_t* player)
+{
+    // Read the tail before the count. The synthesizer counts an event before releasing its inbox slot, so this can
+    // only ever overestimate the number of events in use
+    uint32_t tail = __atomic_load_n(&player->scheduleInboxTail, __ATOMIC_ACQUIRE);
+    uint32_t used = (player->scheduleInboxHead - tail) + player->scheduleCount;
+    return (used < MIDI_SCHEDULE_SIZE) ? (MIDI_SCHEDULE_SIZE - used) : 0;
+}
+
+void midiClearSchedule(midiPlayer_t* player)
+{
+    __atomic_store_n(&player->scheduleClearHead, player->scheduleInboxHead, __ATOMIC_RELEASE);
 }
 
 void midiPause(midiPlayer_t* player, bool pause)
 {
+    // Once this returns, the audio task is done with the player. A paused player isn't stepped, so the caller may
+    // change it freely until it is unpaused
+    dacLock();
     player->paused = pause;
+    dacUnlock();
 }
 
 void midiSeek(midiPlayer_t* player, uint32_t ticks)
@@ -2369,6 +2828,12 @@ void midiSeek(midiPlayer_t* player, uint32_t ticks)
 
     if (player->mode == MIDI_FILE && player->reader.file)
     {
+        // Set the seeking flag so that the DAC won't get any output. The audio task skips a seeking player, so the
+        // rest of the seek runs without holding the audio lock
+        dacLock();
+        player->seeking = true;
+        dacUnlock();
+
         const midiFile_t* loadedFile = player->reader.file;
         midiTextCallback_t textCb    = player->textMessageCallback;
         songFinishedCbFn endCb       = player->songFinishedCallback;
@@ -2383,9 +2848,6 @@ void midiSeek(midiPlayer_t* player, uint32_t ticks)
             midiSetFile(player, loadedFile);
         }
 
-        // Set the seeking flag so that the DAC won't get any output
-        player->seeking = true;
-
         // Unpause the player otherwise nothing will happen
         midiPause(player, false);
         player->loop = false;
@@ -2452,6 +2914,43 @@ void midiSeek(midiPlayer_t* player, uint32_t ticks)
     midiPause(player, paused || stopped);
 }
 
+void midiPercussionCacheWarm(const midiTimbre_t* timbre)
+{
+    if (!(timbre->flags & TF_PERCUSSION))
+    {
+        return;
+    }
+
+    uint32_t count;
+    for (percussionNote_t drum = ACOUSTIC_BASS_DRUM_OR_LOW_BASS_DRUM; drum <= OPEN_TRIANGLE; drum++)
+    {
+        // Only render drums which aren't baked or cached already
+        if (!(timbre->flags & TF_LIVE_PERCUSSION) && NULL == getPercussionSamples(timbre, drum, &count)
+            && NULL == findPercussionSamples(timbre->percussion.playFunc, timbre->percussion.data, drum))
+        {
+            renderPercussionSamples(timbre->percussion.playFunc, timbre->percussion.data, drum);
+        }
+    }
+}
+
+void midiPercussionCacheClear(void)
+{
+    dacLock();
+
+    for (uint8_t i = 0; i < percCacheCount; i++)
+    {
+        if (percCache[i].samples)
+        {
+            heap_caps_free(percCache[i].samples);
+        }
+    }
+
+    memset(percCache, 0, sizeof(percCache));
+    percCacheCount = 0;
+
+    dacUnlock();
+}
+
 //==============================================================================
 // System-wide MIDI player functions
 //==============================================================================
@@ -2460,11 +2959,19 @@ void initGlobalMidiPlayer(void)
 {
     if (!globalPlayers)
     {
-        globalPlayers = heap_caps_calloc(NUM_GLOBAL_PLAYERS, sizeof(midiPlayer_t), MALLOC_CAP_8BIT);
-        for (int i = 0; i < NUM_GLOBAL_PLAYERS; i++)
+        // Initialize the players before the audio task can see them
+        midiPlayer_t* players = heap_caps_calloc(NUM_GLOBAL_PLAYERS, sizeof(midiPlayer_t), MALLOC_CAP_8BIT);
+        if (players)
         {
-            midiPlayerInit(&globalPlayers[i]);
+            for (int i = 0; i < NUM_GLOBAL_PLAYERS; i++)
+            {
+                midiPlayerInit(&players[i]);
+            }
         }
+
+        dacLock();
+        globalPlayers = players;
+        dacUnlock();
     }
 }
 
@@ -2479,8 +2986,13 @@ void deinitGlobalMidiPlayer(void)
             midiPlayerReset(&globalPlayers[i]);
         }
 
+        dacLock();
         heap_caps_free(globalPlayers);
         globalPlayers = NULL;
+        dacUnlock();
+
+        // Drumkit data may be freed after this, so don't hold onto anything rendered from it
+        midiPercussionCacheClear();
     }
 }
 
@@ -2502,6 +3014,7 @@ void globalMidiPlayerPlaySong(midiFile_t* song, uint8_t songIdx)
 
     if (globalPlayers)
     {
+        // The audio task leaves a paused player alone, so the song can be changed without holding the audio lock
         midiPause(&globalPlayers[songIdx], true);
         midiPlayerResetNewSong(&globalPlayers[songIdx]);
         globalPlayers[songIdx].sampleCount = 0;
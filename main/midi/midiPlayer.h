@@ -13,6 +13,14 @@
  * 24 melodic notes and 8 percussion notes, shared across all channels. All 128 General MIDI
  * instruments are supported, as well as the full General MIDI percussion range.
  *
+ * Samples are generated by the DAC's audio task, see hdw-dac.h, while Swadge modes call these functions from the main
+ * loop. Every function which changes a player takes the audio lock with dacLock() while it does, so they may be called
+ * at any time. The scheduling functions, like midiScheduleEvent(), hand events to the audio task without the lock. The
+ * audio task doesn't touch a paused player, so its fields may be set directly. Simple fields of a playing player, like
+ * \c volume or \c loop, may be set at any time, but hold dacLock() to change anything more. The player's
+ * \c songFinishedCallback and \c textMessageCallback are called from the audio task with the lock held, so they must
+ * be quick.
+ *
  * \code{.c}
  * // Load a MIDI file
  * midiFile_t ode_to_joy;
@@ -83,6 +91,12 @@
 #define MIDI_BGM 1
 // The maximum volume setting for globalMidiPlayerSetVolume()
 #define MAX_VOLUME 13
+// The number of drum sounds which can be rendered and cached at once, shared by all players
+#define PERCUSSION_CACHE_SIZE 32
+// The longest drum sound that will be rendered into the cache, in samples. Longer drums are generated live.
+#define PERCUSSION_CACHE_MAX_SAMPLES (DAC_SAMPLE_RATE_HZ * 4)
+// The maximum number of events which may be waiting to be played after midiScheduleEvent()
+#define MIDI_SCHEDULE_SIZE 64
 
 #define MIDI_TRUE         0x7F
 #define MIDI_FALSE        0x00
@@ -106,6 +120,9 @@
 /// @brief Calculate the number of DAC samples in the given number of milliseconds
 #define MS_TO_SAMPLES(ms) ((ms) * DAC_SAMPLE_RATE_HZ / 1000)
 
+/// @brief Calculate the number of DAC samples in the given number of microseconds
+#define US_TO_SAMPLES(us) ((int64_t)(us) * DAC_SAMPLE_RATE_HZ / 1000000)
+
 /// @brief Convert MIDI ticks to microseconds
 #define MIDI_TICKS_TO_US(ticks, tempo, div) (int64_t)((int64_t)((int64_t)(ticks) * (int64_t)(tempo)) / ((int64_t)(div)))
 
@@ -152,6 +169,11 @@ typedef enum
     TF_PERCUSSION = 1,
     /// @brief This timbre represents a monophonic instrument
     TF_MONO = 2,
+    /// @brief This percussion timbre is not deterministic, so its samples must always be generated live
+    TF_LIVE_PERCUSSION = 4,
+    /// @brief This sample timbre linearly interpolates between source samples. This costs a little more time, but
+    /// sounds much cleaner when a sample is stored at a low rate or pitched far from its base note
+    TF_INTERPOLATE = 8,
 } timbreFlags_t;
 
 /**
@@ -414,6 +436,19 @@ typedef struct
  */
 typedef int8_t (*percussionFunc_t)(percussionNote_t drum, uint32_t idx, bool* done, uint32_t scratch[4], void* data);
 
+/**
+ * @brief A function that returns pre-rendered samples for a percussion timbre
+ *
+ * The returned samples must be exactly what the timbre's ::percussionFunc_t would generate for the same drum,
+ * and must remain valid for as long as the timbre may be played.
+ *
+ * @param drum The percussion instrument to return samples for
+ * @param[out] count A pointer to be set to the number of samples returned
+ * @param data A pointer to user-defined data which may be used in sample generation
+ * @return A pointer to the signed 8-bit samples for the drum, or NULL if the drum has no pre-rendered samples
+ */
+typedef const int8_t* (*percussionSamplesFunc_t)(percussionNote_t drum, uint32_t* count, void* data);
+
 /**
  * @brief A function to handle text meta-messages from playing MIDI files
  *
@@ -476,14 +511,21 @@ typedef struct
                 } config;
             };
 
-            /// @brief The sample rate.
+            /// @brief The sample rate of the data. This may be lower than ::DAC_SAMPLE_RATE_HZ to save space
             uint32_t rate;
 
-            /// @brief The base frequency, at which the sample plays at normal speed
-            uq8_24 baseNote;
+            /// @brief The frequency at which the sample plays at normal speed, or 0 to play every note at normal speed
+            uq16_16 baseNote;
 
             /// @brief 0 to loop forever, or the number of loops to play
             uint32_t loop;
+
+            /// @brief The index of the first sample of the looped section
+            uint32_t loopStart;
+
+            /// @brief The index after the last sample of the looped section, or 0 to loop the whole sample.
+            /// After the last loop, playback continues from here to the end of the sample
+            uint32_t loopEnd;
         } sample;
 
         struct
@@ -492,6 +534,9 @@ typedef struct
             percussionFunc_t playFunc;
             /// @brief User data to pass to the drumkit
             void* data;
+            /// @brief An optional callback to get pre-rendered drum samples. Drums it does not return are rendered
+            /// into the percussion cache by midiPercussionCacheWarm(), unless ::TF_LIVE_PERCUSSION is set
+            percussionSamplesFunc_t getSamples;
         } percussion;
 
         /// @brief The shape of this wave, when type is RAW_WAVE
@@ -551,18 +596,43 @@ typedef struct
 
         struct
         {
-            /// @brief The number of fractional samples remaining
-            uint32_t sampleError;
+            /// @brief The fractional part of the playback position in the sample, as a UQ16.16 fraction.
+            /// The integer part is \c sampleTick
+            uint32_t sampleFrac;
 
             /// @brief The number of loops remaining
             uint32_t sampleLoops;
+
+            /// @brief The number of source samples to advance per output sample, including pitch bend
+            uq16_16 sampleStep;
         };
     };
 
+    /// @brief Pre-rendered samples for the percussion note being played, or NULL if it is generated live
+    const int8_t* percSamples;
+
+    /// @brief The number of samples in \c percSamples
+    uint32_t percSampleCount;
+
     /// @brief A pointer to the timbre of this voice, which defines its musical characteristics
     const midiTimbre_t* timbre;
 } midiVoice_t;
 
+/**
+ * @brief A MIDI channel event which will be handled by the synthesizer at a specific sample
+ */
+typedef struct
+{
+    /// @brief The value of ::midiPlayer_t.sampleCount when this event will be handled
+    uint64_t time;
+
+    /// @brief The order this event was scheduled in, used to discard it in midiClearSchedule()
+    uint32_t seq;
+
+    /// @brief The event to handle
+    midiStatusEvent_t event;
+} midiScheduledEvent_t;
+
 /**
  * @brief Holds several bitfields that track the state of each voice for fast access.
  * This may be used for dynamic voice allocation, and to minimize the impact of note stealing
@@ -715,6 +785,29 @@ typedef struct
 
     /// @brief If true, the playing file will automatically repeat when complete
     bool loop;
+
+    /// @brief Events passed to midiScheduleEvent() which haven't been sorted into \c schedule yet.
+    /// This is a ring which is only written by the caller of midiScheduleEvent() and only read by the synthesizer,
+    /// so events may be scheduled while samples are being generated in another task
+    midiScheduledEvent_t scheduleInbox[MIDI_SCHEDULE_SIZE];
+
+    /// @brief The number of events ever written to \c scheduleInbox
+    volatile uint32_t scheduleInboxHead;
+
+    /// @brief The number of events ever read from \c scheduleInbox
+    volatile uint32_t scheduleInboxTail;
+
+    /// @brief Set to \c scheduleInboxHead by midiClearSchedule(). Every event scheduled before it is discarded
+    volatile uint32_t scheduleClearHead;
+
+    /// @brief The value of \c scheduleClearHead when the synthesizer last discarded scheduled events
+    uint32_t scheduleClearSeen;
+
+    /// @brief Scheduled events waiting to be handled, sorted by time. Only accessed by the synthesizer
+    midiScheduledEvent_t schedule[MIDI_SCHEDULE_SIZE];
+
+    /// @brief The number of events in \c schedule
+    volatile uint8_t scheduleCount;
 } midiPlayer_t;
 
 /**
@@ -981,6 +1074,92 @@ void midiPause(midiPlayer_t* player, bool pause);
  */
 void midiSeek(midiPlayer_t* player, uint32_t ticks);
 
+/**
+ * @brief Get the current time of a MIDI player's synthesizer, for use with midiScheduleEvent()
+ *
+ * This is ::midiPlayer_t.sampleCount. It only advances while the player is not paused, and it is reset when a new
+ * song is played. Samples are generated ahead of the DAC, so this is slightly ahead of what is currently audible.
+ *
+ * @param player The MIDI player
+ * @return The number of samples generated by the player
+ */
+uint64_t midiPlayerGetSampleTime(midiPlayer_t* player);
+
+/**
+ * @brief Schedule a MIDI channel event to be handled by the synthesizer at an exact sample in the future
+ *
+ * This gives rhythm which is independent of the frame rate. Schedule events a short window ahead of time, comfortably
+ * longer than a frame plus one DAC buffer, for example 100ms. Events scheduled in the past are handled as soon as
+ * possible. Events scheduled for the same sample are handled in the order they were scheduled.
+ *
+ * This may be called from the main loop while samples are generated in the DAC's audio task.
+ *
+ * @param player The MIDI player to schedule the event on
+ * @param time The sample time to handle the event at, relative to midiPlayerGetSampleTime()
+ * @param event The event to handle. Only channel events, like note on and note off, may be scheduled
+ * @return true if the event was scheduled, false if there are already ::MIDI_SCHEDULE_SIZE events waiting
+ */
+bool midiScheduleEvent(midiPlayer_t* player, uint64_t time, const midiStatusEvent_t* event);
+
+/**
+ * @brief Schedule a note on event to be handled at an exact sample in the future
+ *
+ * @param player The MIDI player to schedule the note on
+ * @param time The sample time to start the note at, relative to midiPlayerGetSampleTime()
+ * @param channel The MIDI channel to start the note on
+ * @param note The MIDI note number to start
+ * @param velocity The MIDI velocity of the note
+ * @return true if the event was scheduled, false if there is no room
+ */
+bool midiScheduleNoteOn(midiPlayer_t* player, uint64_t time, uint8_t channel, uint8_t note, uint8_t velocity);
+
+/**
+ * @brief Schedule a note off event to be handled at an exact sample in the future
+ *
+ * @param player The MIDI player to schedule the note off on
+ * @param time The sample time to stop the note at, relative to midiPlayerGetSampleTime()
+ * @param channel The MIDI channel to stop the note on
+ * @param note The MIDI note number to stop
+ * @param velocity The MIDI release velocity of the note
+ * @return true if the event was scheduled, false if there is no room
+ */
+bool midiScheduleNoteOff(midiPlayer_t* player, uint64_t time, uint8_t channel, uint8_t note, uint8_t velocity);
+
+/**
+ * @brief Get the number of events which may still be passed to midiScheduleEvent()
+ *
+ * @param player The MIDI player
+ * @return The number of free schedule slots. This may be lower than the real number, but is never higher
+ */
+uint8_t midiScheduleFree(midiPlayer_t* player);
+
+/**
+ * @brief Discard every scheduled event which hasn't been handled yet. Notes which already started are not stopped.
+ *
+ * @param player The MIDI player to clear the schedule of
+ */
+void midiClearSchedule(midiPlayer_t* player);
+
+/**
+ * @brief Render every drum of a percussion timbre into the percussion cache ahead of time
+ *
+ * Drums are never rendered in the audio path. Drums which aren't baked or rendered here are generated live, sample by
+ * sample, which costs much more time. midiSetFile() calls this for the timbres of the percussion channels, so this only
+ * needs to be called when a mode sets a custom drumkit timbre. Drums returned by the timbre's
+ * ::percussionSamplesFunc_t, and timbres with ::TF_LIVE_PERCUSSION set, are not rendered.
+ *
+ * This must be called from the main task, not from the audio task.
+ *
+ * @param timbre The percussion timbre to render
+ */
+void midiPercussionCacheWarm(const midiTimbre_t* timbre);
+
+/**
+ * @brief Free all drum samples in the percussion cache. This must be called before any drumkit data
+ * passed in ::midiTimbre_t.percussion is freed, and must not be called while percussion is playing.
+ */
+void midiPercussionCacheClear(void);
+
 //==============================================================================
 // Global MIDI Player Functions
 //==============================================================================
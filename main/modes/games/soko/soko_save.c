@@ -5,9 +5,9 @@ static void sokoLoadCurrentLevelEntities(soko_abs_t* soko);
 static void sokoSetLevelSolvedState(soko_abs_t* soko, uint16_t levelIndex, bool solved);
 static void sokoLoadBinTiles(soko_abs_t* soko, int byteCount);
 static int sokoFindIndex(soko_abs_t* self, int targetIndex);
-void sokoSaveEulerTiles(soko_abs_t* soko);
+void sokoSaveEulerTiles(soko_abs_t* soko, nvsBatch_t* batch);
 void sokoLoadEulerTiles(soko_abs_t* soko);
-void sokoSaveCurrentLevelEntities(soko_abs_t* soko);
+void sokoSaveCurrentLevelEntities(soko_abs_t* soko, nvsBatch_t* batch);
 
 const char key_sk_data[]  = "sk_data";
 const char key_sklv1[]    = "sklv1";
@@ -59,14 +59,23 @@ void sokoSaveGameplay(soko_abs_t* soko)
     int current = soko->currentLevelIndex;
     // current level entity positions
     uint32_t data = current;
+    // Everything is saved at once, with a single commit
+    nvsBatch_t batch;
+    nvsBatchBegin(&batch, NVS_NAMESPACE_NAME);
+
     // what other data gets encoded? we can also save the sk_tiles count.
-    writeNvs32(key_sk_data, data);
+    nvsBatchWrite32(&batch, key_sk_data, data);
 
-    sokoSaveCurrentLevelEntities(soko);
+    sokoSaveCurrentLevelEntities(soko, &batch);
 
     if (soko->currentLevel.gameMode == SOKO_EULER)
     {
-        sokoSaveEulerTiles(soko);
+        sokoSaveEulerTiles(soko, &batch);
+    }
+
+    if (!nvsBatchCommit(&batch))
+    {
+        ESP_LOGE(SOKO_TAG, "Couldn't save gameplay");
     }
 }
 
@@ -166,7 +175,7 @@ void sokoSolveCurrentLevel(soko_abs_t* soko)
 // current level progress (all entitity positions/data, entities array. non-entities comes from file.)
 // euler encoding? (do like picross level?)
 
-void sokoSaveCurrentLevelEntities(soko_abs_t* soko)
+void sokoSaveCurrentLevelEntities(soko_abs_t* soko, nvsBatch_t* batch)
 {
     // todo: the overworld will have >max entities... and they never need to be serialized...
     // so maybe just make a separate array for portals that is entities of size maxLevelCount...
@@ -197,7 +206,7 @@ void sokoSaveCurrentLevelEntities(soko_abs_t* soko)
         entities[i * 4 + 3] = soko->currentLevel.entities[i].facing;
     }
     size_t size = sizeof(char) * (soko->currentLevel.entityCount) * 4;
-    writeNvsBlob(key_sk_ents, entities, size);
+    nvsBatchWriteBlob(batch, key_sk_ents, entities, size);
     heap_caps_free(entities);
 }
 // todo: there is no clean place to return to the main menu right now, so gotta write that function/flow so this can get
@@ -224,7 +233,7 @@ void sokoLoadCurrentLevelEntities(soko_abs_t* soko)
     heap_caps_free(entities);
 }
 
-void sokoSaveEulerTiles(soko_abs_t* soko)
+void sokoSaveEulerTiles(soko_abs_t* soko, nvsBatch_t* batch)
 {
     ESP_LOGD(SOKO_TAG, "encoding euler tiles.");
 
@@ -258,8 +267,8 @@ void sokoSaveEulerTiles(soko_abs_t* soko)
         }
     }
     i++;
-    writeNvsBlob(key_sk_e_t_c, &i, sizeof(uint16_t));
-    writeNvsBlob(key_sk_e_ts, blops, sizeof(char) * i);
+    nvsBatchWriteBlob(batch, key_sk_e_t_c, &i, sizeof(uint16_t));
+    nvsBatchWriteBlob(batch, key_sk_e_ts, blops, sizeof(char) * i);
 
     heap_caps_free(blops);
 }
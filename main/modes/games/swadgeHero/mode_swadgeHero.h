@@ -93,7 +93,7 @@ typedef struct
     int32_t leadOutUs;
     char hsKey[16];
     const char* songName;
-    uint32_t songTimeUs;
+    int32_t songTimeUs; ///< Negative until the start of the song is heard, see dacGetLatencyUs()
     bool paused;
 
     // Chart data
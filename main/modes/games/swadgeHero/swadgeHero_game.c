@@ -401,14 +401,14 @@ bool shRunTimers(shVars_t* sh, uint32_t elapsedUs)
         // The song hasn't started yet, so the time is negative
         songUs = -sh->leadInUs;
 
-        // Start the song
-        if (sh->leadInUs <= 0)
+        // Start the song early enough that it is heard when the lead in is over. Samples are generated ahead of the
+        // speaker by the DAC's ring
+        if (sh->leadInUs <= (int32_t)dacGetLatencyUs())
         {
             // Lead in is over, start the song
             globalMidiPlayerPlaySongCb(&sh->midiSong, MIDI_BGM, shSongOver);
-            sh->songTimeUs = 0;
+            sh->songTimeUs = songUs;
             sh->leadInUs   = 0;
-            songUs         = 0;
         }
     }
     else
@@ -51,6 +51,7 @@ typedef struct
     dft32_data dd;
     embeddedNf_data end;
     embeddedOut_data eod;
+    bool ccReady; // false if InitColorChord() failed
     uint8_t samplesProcessed;
     uint16_t maxValue;
     ccOpt_t optSel;
@@ -105,7 +106,7 @@ void colorchordEnterMode(void)
     loadFont("ibm_vga8.font", &colorchord->ibm_vga8, false);
 
     // Init CC
-    InitColorChord(&colorchord->end, &colorchord->dd);
+    colorchord->ccReady  = InitColorChord(&colorchord->end, &colorchord->dd);
     colorchord->maxValue = 1;
 }
 
@@ -118,6 +119,7 @@ void colorchordExitMode(void)
     {
         heap_caps_free(colorchord->sampleHist);
     }
+    DeinitColorChord(&colorchord->end, &colorchord->dd);
     freeFont(&colorchord->ibm_vga8);
     heap_caps_free(colorchord);
 }
@@ -138,42 +140,45 @@ void colorchordMainLoop(int64_t elapsedUs __attribute__((unused)))
     // Clear everything
     clearPxTft();
 
-    // Draw the spectrum as a bar graph. Figure out bar and margin size
-    int16_t binWidth  = (TFT_WIDTH / FIX_BINS);
-    int16_t binMargin = (TFT_WIDTH - (binWidth * FIX_BINS)) / 2;
+    if (colorchord->ccReady)
+    {
+        // Draw the spectrum as a bar graph. Figure out bar and margin size
+        int16_t binWidth  = (TFT_WIDTH / colorchord->end.bins);
+        int16_t binMargin = (TFT_WIDTH - (binWidth * colorchord->end.bins)) / 2;
 
-    // This is the center line to draw the graph around
-    uint8_t centerLine
-        = (TEXT_Y + colorchord->ibm_vga8.height + 2) + (TFT_HEIGHT - (TEXT_Y + colorchord->ibm_vga8.height + 2)) / 2;
+        // This is the center line to draw the graph around
+        uint8_t centerLine = (TEXT_Y + colorchord->ibm_vga8.height + 2)
+                             + (TFT_HEIGHT - (TEXT_Y + colorchord->ibm_vga8.height + 2)) / 2;
 
-    // Find the max value
-    for (uint16_t i = 0; i < FIX_BINS; i++)
-    {
-        if (colorchord->end.fuzzed_bins[i] > colorchord->maxValue)
+        // Find the max value
+        for (uint16_t i = 0; i < colorchord->end.bins; i++)
         {
-            colorchord->maxValue = colorchord->end.fuzzed_bins[i];
+            if (colorchord->end.fuzzed_bins[i] > colorchord->maxValue)
+            {
+                colorchord->maxValue = colorchord->end.fuzzed_bins[i];
+            }
         }
-    }
 
-    // Plot the bars
-    for (uint16_t i = 0; i < FIX_BINS; i++)
-    {
-        uint8_t height
-            = ((TFT_HEIGHT - colorchord->ibm_vga8.height - 2) * colorchord->end.fuzzed_bins[i]) / colorchord->maxValue;
-
-        paletteColor_t color = RGBtoPalette(
-            ECCtoHEX(((i << SEMI_BITS_PER_BIN) + colorchord->eod.RootNoteOffset) % NOTE_RANGE, 255, 255));
-        int16_t x0 = binMargin + (i * binWidth);
-        int16_t x1 = binMargin + ((i + 1) * binWidth);
-        if (height < 2)
+        // Plot the bars
+        for (uint16_t i = 0; i < colorchord->end.bins; i++)
         {
-            // Too small to plot, draw a line
-            drawLine(x0, centerLine, x1, centerLine, color, 0);
-        }
-        else
-        {
-            // Big enough, fill an area
-            fillDisplayArea(x0, centerLine - (height / 2), x1, centerLine + (height / 2), color);
+            uint8_t height = ((TFT_HEIGHT - colorchord->ibm_vga8.height - 2) * colorchord->end.fuzzed_bins[i])
+                             / colorchord->maxValue;
+
+            paletteColor_t color = RGBtoPalette(
+                ECCtoHEX(((i << SEMI_BITS_PER_BIN) + colorchord->eod.RootNoteOffset) % NOTE_RANGE, 255, 255));
+            int16_t x0 = binMargin + (i * binWidth);
+            int16_t x1 = binMargin + ((i + 1) * binWidth);
+            if (height < 2)
+            {
+                // Too small to plot, draw a line
+                drawLine(x0, centerLine, x1, centerLine, color, 0);
+            }
+            else
+            {
+                // Big enough, fill an area
+                fillDisplayArea(x0, centerLine - (height / 2), x1, centerLine + (height / 2), color);
+            }
         }
     }
 
@@ -379,44 +384,51 @@ void colorchordAudioCb(uint16_t* samples, uint32_t sampleCnt)
     uint16_t sampleHistHead  = colorchord->sampleHistHead;
     uint16_t sampleHistCount = colorchord->sampleHistCount;
 
-    // For each sample
+    // Save every sample to the history
     for (uint32_t idx = 0; idx < sampleCnt; idx++)
     {
-        uint16_t sample = samples[idx];
-
-        // Push to colorchord
-        PushSample32(&colorchord->dd, sample);
-
-        sampleHist[sampleHistHead] = sample;
+        sampleHist[sampleHistHead] = samples[idx];
         sampleHistHead++;
         if (sampleHistHead == sampleHistCount)
         {
             sampleHistHead = 0;
         }
+    }
 
-        // If 128 samples have been pushed
-        colorchord->samplesProcessed++;
-        if (colorchord->samplesProcessed >= 128)
+    if (colorchord->ccReady)
+    {
+        // Push samples to colorchord in blocks which end every 128 samples
+        uint32_t idx = 0;
+        while (idx < sampleCnt)
         {
-            // Update LEDs
-            colorchord->samplesProcessed = 0;
-            HandleFrameInfo(&colorchord->end, &colorchord->dd);
-            switch (getColorchordModeSetting())
+            uint32_t blockLen = MIN(sampleCnt - idx, 128 - colorchord->samplesProcessed);
+            PushBlock32(&colorchord->dd, (const int16_t*)&samples[idx], blockLen);
+            idx += blockLen;
+
+            // If 128 samples have been pushed
+            colorchord->samplesProcessed += blockLen;
+            if (colorchord->samplesProcessed >= 128)
             {
-                default:
-                case NUM_CC_MODES:
-                case ALL_SAME_LEDS:
-                {
-                    UpdateAllSameLEDs(&colorchord->eod, &colorchord->end);
-                    break;
-                }
-                case LINEAR_LEDS:
+                // Update LEDs
+                colorchord->samplesProcessed = 0;
+                HandleFrameInfo(&colorchord->end, &colorchord->dd);
+                switch (getColorchordModeSetting())
                 {
-                    UpdateLinearLEDs(&colorchord->eod, &colorchord->end);
-                    break;
+                    default:
+                    case NUM_CC_MODES:
+                    case ALL_SAME_LEDS:
+                    {
+                        UpdateAllSameLEDs(&colorchord->eod, &colorchord->end);
+                        break;
+                    }
+                    case LINEAR_LEDS:
+                    {
+                        UpdateLinearLEDs(&colorchord->eod, &colorchord->end);
+                        break;
+                    }
                 }
+                setLeds((led_t*)colorchord->eod.ledOut, CONFIG_NUM_LEDS);
             }
-            setLeds((led_t*)colorchord->eod.ledOut, CONFIG_NUM_LEDS);
         }
     }
 
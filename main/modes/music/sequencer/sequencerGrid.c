@@ -13,6 +13,9 @@
 
 #define MIDI_VELOCITY 0x7F
 
+/// How far ahead of the song timer notes are scheduled. This must cover a frame plus a DAC buffer
+#define SEQ_LOOKAHEAD_US 100000
+
 //==============================================================================
 // Variables
 //==============================================================================
@@ -25,6 +28,9 @@ static const char* keys[] = {"C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A
 
 static vec_t getCursorScreenPos(sequencerVars_t* sv);
 static void stopSequencer(sequencerVars_t* sv);
+static void startSequencer(sequencerVars_t* sv);
+static bool scheduleSequencerNote(sequencerVars_t* sv, midiPlayer_t* player, uint64_t passStartSample,
+                                  const sequencerNote_t* note);
 static void moveCursor(sequencerVars_t* sv, buttonBit_t direction);
 void addOrRemoveNote(sequencerVars_t* sv, bool playPreview);
 
@@ -98,8 +104,7 @@ void sequencerGridButton(sequencerVars_t* sv, buttonEvt_t* evt)
                 {
                     // If it's at the beginning, stop again to be safe, then play
                     stopSequencer(sv);
-                    sv->isPlaying = true;
-                    sv->songTimer = 0;
+                    startSequencer(sv);
                 }
                 break;
             }
@@ -434,9 +439,15 @@ void runSequencerTimers(sequencerVars_t* sv, int32_t elapsedUs)
             }
         }
 
-        // Check for note on/off
+        // Run the song timer
         sv->songTimer += elapsedUs;
-        node_t* noteNode = sv->notes.first;
+        int32_t songEndUs = (sv->songParams.songEnd * 60 * (int64_t)1000000) / (4 * sv->songParams.tempo);
+
+        // Schedule notes which start within the lookahead window, so they play at their exact sample regardless of
+        // the frame rate
+        midiPlayer_t* player  = globalMidiPlayerGet(MIDI_BGM);
+        int32_t scheduleUntil = sv->songTimer + SEQ_LOOKAHEAD_US;
+        node_t* noteNode      = sv->notes.first;
         while (noteNode)
         {
             sequencerNote_t* note = noteNode->val;
@@ -445,50 +456,90 @@ void runSequencerTimers(sequencerVars_t* sv, int32_t elapsedUs)
             int32_t usOn  = note->sixteenthOn * sv->usPerBeat / 4;
             int32_t usOff = note->sixteenthOff * sv->usPerBeat / 4;
 
-            if (usOn > sv->songTimer)
+            if (usOn > scheduleUntil || usOn >= songEndUs)
             {
-                // Note start is past the song timer, stop looping
+                // Note start is past the lookahead window or the song, stop looping
                 break;
             }
-            // If the song time is between on and off
-            else if (usOn <= sv->songTimer && sv->songTimer <= usOff)
+            // If the note isn't scheduled yet
+            else if (!note->isOn)
             {
-                // If the note isn't on yet
-                if (!note->isOn)
+                if (usOff <= sv->songTimer)
                 {
-                    // Turn the note on
+                    // Too late to play this note, skip it
                     note->isOn = true;
-                    midiNoteOn(globalMidiPlayerGet(MIDI_BGM), note->channel, note->midiNum, MIDI_VELOCITY);
                 }
-            }
-            // If the note is on, and shouldn't be
-            else if (note->isOn)
-            {
-                // Turn it off
-                note->isOn = false;
-                midiNoteOff(globalMidiPlayerGet(MIDI_BGM), note->channel, note->midiNum, MIDI_VELOCITY);
+                else if (scheduleSequencerNote(sv, player, sv->songStartSample, note))
+                {
+                    note->isOn = true;
+                }
+                // Otherwise the schedule is full, try again next frame
             }
 
             // Iterate
             noteNode = noteNode->next;
         }
 
+        // If the lookahead window reaches past the end of a looping song, schedule the start of the next pass too, so
+        // it plays right after this one ends
+        if (sv->songParams.loop && scheduleUntil > songEndUs)
+        {
+            uint64_t nextPassStartSample = sv->songStartSample + US_TO_SAMPLES(songEndUs);
+            noteNode                     = sv->notes.first;
+            while (noteNode)
+            {
+                sequencerNote_t* note = noteNode->val;
+                int32_t usOn          = note->sixteenthOn * sv->usPerBeat / 4;
+
+                if (usOn > scheduleUntil - songEndUs || usOn >= songEndUs)
+                {
+                    // Note start is past the lookahead window or the song, stop looping
+                    break;
+                }
+                // Notes are sorted by start time, so everything before nextPassScheduledUs is already scheduled
+                else if (usOn >= sv->nextPassScheduledUs)
+                {
+                    if (!scheduleSequencerNote(sv, player, nextPassStartSample, note))
+                    {
+                        // The schedule is full, try again next frame
+                        break;
+                    }
+                    sv->nextPassScheduledUs = usOn + 1;
+                }
+
+                // Iterate
+                noteNode = noteNode->next;
+            }
+        }
+
         // Check for song end
-        uint32_t songEndUs = (sv->songParams.songEnd * 60 * (int64_t)1000000) / (4 * sv->songParams.tempo);
         if (sv->songTimer >= songEndUs)
         {
-            // Always stop
-            stopSequencer(sv);
-
             // Loop if that's set
             if (sv->songParams.loop)
             {
+                // Keep playing without a gap. The next pass starts exactly where this one ended, and the notes still
+                // sounding are left to their scheduled note offs
+                sv->songTimer -= songEndUs;
+                sv->songStartSample += US_TO_SAMPLES(songEndUs);
+
+                // Notes which were scheduled ahead for this pass are already on
+                noteNode = sv->notes.first;
+                while (noteNode)
+                {
+                    sequencerNote_t* note = noteNode->val;
+                    note->isOn            = (note->sixteenthOn * sv->usPerBeat / 4) < sv->nextPassScheduledUs;
+                    noteNode              = noteNode->next;
+                }
+                sv->nextPassScheduledUs = 0;
+
                 // reset to beginning
                 sv->gridOffsetTarget.x = 0;
                 sv->cursorPos.x        = 0;
-                // Play
-                sv->isPlaying = true;
-                sv->songTimer = 0;
+            }
+            else
+            {
+                stopSequencer(sv);
             }
         }
     }
@@ -632,6 +683,51 @@ void drawSequencerGrid(sequencerVars_t* sv, int32_t elapsedUs)
     }
 }
 
+/**
+ * @brief Start playing the sequencer from the beginning
+ *
+ * @param sv The entire sequencer state
+ */
+static void startSequencer(sequencerVars_t* sv)
+{
+    sv->isPlaying           = true;
+    sv->songTimer           = 0;
+    sv->songStartSample     = midiPlayerGetSampleTime(globalMidiPlayerGet(MIDI_BGM));
+    sv->nextPassScheduledUs = 0;
+    sv->scheduleOverflowed  = false;
+}
+
+/**
+ * @brief Schedule the start and end of a note on the MIDI player
+ *
+ * @param sv The entire sequencer state
+ * @param player The MIDI player to schedule the note on
+ * @param passStartSample The MIDI player's sample time when this pass through the song started
+ * @param note The note to schedule
+ * @return true if the note was scheduled, false if the MIDI player's schedule is full
+ */
+static bool scheduleSequencerNote(sequencerVars_t* sv, midiPlayer_t* player, uint64_t passStartSample,
+                                  const sequencerNote_t* note)
+{
+    if (2 > midiScheduleFree(player))
+    {
+        // Notes will be late, or skipped if they end before there is room. Only report it once each time the song plays
+        if (!sv->scheduleOverflowed)
+        {
+            sv->scheduleOverflowed = true;
+            ESP_LOGW("SEQ", "MIDI schedule is full, notes are late or skipped");
+        }
+        return false;
+    }
+
+    // Schedule both the start and the end of the note
+    int32_t usOn  = note->sixteenthOn * sv->usPerBeat / 4;
+    int32_t usOff = note->sixteenthOff * sv->usPerBeat / 4;
+    midiScheduleNoteOn(player, passStartSample + US_TO_SAMPLES(usOn), note->channel, note->midiNum, MIDI_VELOCITY);
+    midiScheduleNoteOff(player, passStartSample + US_TO_SAMPLES(usOff), note->channel, note->midiNum, MIDI_VELOCITY);
+    return true;
+}
+
 /**
  * @brief Stop the sequencer from playing
  *
@@ -641,7 +737,8 @@ static void stopSequencer(sequencerVars_t* sv)
 {
     sv->isPlaying = false;
 
-    // Stop MIDI
+    // Stop MIDI, including anything scheduled ahead
+    midiClearSchedule(globalMidiPlayerGet(MIDI_BGM));
     midiAllSoundOff(globalMidiPlayerGet(MIDI_BGM));
 
     // Stop here
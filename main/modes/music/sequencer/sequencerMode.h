@@ -98,6 +98,9 @@ typedef struct
 
     // Playing
     int32_t songTimer;
+    uint64_t songStartSample;    ///< The MIDI player's sample time when the song timer was zero
+    int32_t nextPassScheduledUs; ///< Notes in the next pass of a looping song which start before this are scheduled
+    bool scheduleOverflowed;     ///< true if notes didn't fit in the MIDI player's schedule since the song started
     list_t notes;
     int32_t exampleMidiNote;
     int32_t exampleMidiChannel;
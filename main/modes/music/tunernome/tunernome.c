@@ -144,6 +144,7 @@ typedef struct
     dft32_data dd;
     embeddedNf_data end;
     embeddedOut_data eod;
+    bool ccReady; // false if InitColorChord() failed
     int audioSamplesProcessed;
     uint32_t intensities_filt[CONFIG_NUM_LEDS];
     int32_t diffs_filt[CONFIG_NUM_LEDS];
@@ -385,7 +386,7 @@ void tunernomeEnterMode(void)
 
     switchToSubmode(TN_TUNER);
 
-    InitColorChord(&tunernome->end, &tunernome->dd);
+    tunernome->ccReady = InitColorChord(&tunernome->end, &tunernome->dd);
 
     tunernome->blinkTimerUs     = 0;
     tunernome->clickTimerUs     = 0;
@@ -474,6 +475,8 @@ void tunernomeExitMode(void)
     freeWsg(&(tunernome->metronomeTopWsg));
     freeWsg(&(tunernome->metronomeBottomWsg));
 
+    DeinitColorChord(&tunernome->end, &tunernome->dd);
+
     heap_caps_free(tunernome);
 }
 
@@ -510,11 +513,11 @@ static inline int16_t getSemiMagnitude(int16_t idx)
 {
     if (idx < 0)
     {
-        idx += FIX_B_PER_O;
+        idx += tunernome->end.binsPerOctave;
     }
-    if (idx > FIX_B_PER_O - 1)
+    if (idx > tunernome->end.binsPerOctave - 1)
     {
-        idx -= FIX_B_PER_O;
+        idx -= tunernome->end.binsPerOctave;
     }
     return tunernome->end.folded_bins[idx];
 }
@@ -1372,12 +1375,10 @@ void modifyBpm(int16_t bpmMod)
  */
 void tunernomeSampleHandler(uint16_t* samples, uint32_t sampleCnt)
 {
-    if (tunernome->mode == TN_TUNER)
+    // The tuner can't work without colorchord
+    if (tunernome->mode == TN_TUNER && tunernome->ccReady)
     {
-        for (uint32_t i = 0; i < sampleCnt; i++)
-        {
-            PushSample32(&tunernome->dd, samples[i]);
-        }
+        PushBlock32(&tunernome->dd, (const int16_t*)samples, sampleCnt);
         tunernome->audioSamplesProcessed += sampleCnt;
 
         // If at least 128 samples have been processed
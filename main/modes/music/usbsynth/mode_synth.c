@@ -282,6 +282,7 @@ typedef struct
     bool stopped;
     bool shuffle;
     bool autoplay;
+    bool playNextSong; ///< Set by songEndCb() in the audio task, to load the next song in the main loop
     lfsrState_t shuffleState;
     int32_t shufflePos;
     int32_t headroom;
@@ -1943,10 +1944,20 @@ static void synthMainLoop(int64_t elapsedUs)
         drawSynthMode(elapsedUs);
     }
 
-    // Delete any expired texts -- but only every so often, to prevent it from being weird and jumpy
+    // The song ended and autoplay is on, so load the next one here rather than in the audio task
+    if (sd->playNextSong)
+    {
+        sd->playNextSong = false;
+        nextSong();
+        midiPause(&sd->midiPlayer, false);
+    }
+
+    // Delete any expired texts -- but only every so often, to prevent it from being weird and jumpy. Texts are added
+    // by midiTextCallback() in the audio task, so hold the audio lock while changing the list
     uint64_t now = esp_timer_get_time();
     if (now >= sd->nextExpiry)
     {
+        dacLock();
         node_t* curNode = sd->midiTexts.first;
         while (curNode != NULL)
         {
@@ -1966,6 +1977,7 @@ static void synthMainLoop(int64_t elapsedUs)
                 curNode = curNode->next;
             }
         }
+        dacUnlock();
 
         sd->nextExpiry = now + 2000000;
     }
@@ -3276,6 +3288,8 @@ static void drawMidiText(bool filter, uint32_t types)
     paletteColor_t midiTextColor = c550;
     bool colorSet                = false;
 
+    // Texts are added by midiTextCallback() in the audio task, so hold the audio lock while reading the list
+    dacLock();
     node_t* curNode = sd->midiTexts.first;
     while (curNode != NULL && msgLen + 1 < sizeof(textMessages))
     {
@@ -3333,6 +3347,7 @@ static void drawMidiText(bool filter, uint32_t types)
 
         curNode = curNode->next;
     }
+    dacUnlock();
     textMessages[msgLen] = '\0';
 
     int16_t x = 18;
@@ -4412,6 +4427,7 @@ static void synthMenuCb(const char* label, bool selected, uint32_t value)
 
 static void songEndCb(void)
 {
+    // This runs in the audio task, which must not stall loading a file, so the main loop loads the next song
     if (sd->loop)
     {
         midiSetFile(&sd->midiPlayer, &sd->midiFile);
@@ -4421,8 +4437,7 @@ static void songEndCb(void)
     {
         if (sd->autoplay)
         {
-            nextSong();
-            midiPause(&sd->midiPlayer, false);
+            sd->playNextSong = true;
         }
         else
         {
@@ -41,7 +41,7 @@ static void introDrawSwadgeButtons(int64_t elapsedUs, int16_t x, int16_t y, butt
 static void introDrawSwadgeTouchpad(int64_t elapsedUs, vec_t touchPoint, list_t* touchHist);
 static void introDrawSwadgeImu(int64_t elapsedUs);
 static void introDrawSwadgeSpeaker(int64_t elapsedUs);
-static void introDrawSwadgeMicrophone(int64_t elapsedUs, uint16_t* fuzzed_bins, uint16_t maxValue);
+static void introDrawSwadgeMicrophone(int64_t elapsedUs, uint16_t* fuzzed_bins, uint16_t numBins, uint16_t maxValue);
 
 #define ALL_BUTTONS  (PB_UP | PB_DOWN | PB_LEFT | PB_RIGHT | PB_A | PB_B | PB_START | PB_SELECT)
 #define DPAD_BUTTONS (PB_UP | PB_DOWN | PB_LEFT | PB_RIGHT)
@@ -363,6 +363,8 @@ typedef struct
     bool playingSound;
     bool introComplete;
     audioSamplePlayer_t samplePlayer;
+    int32_t splashTimer;
+    int32_t splashSoundEnd;
 #endif
 
     menu_t* bgMenu;
@@ -373,6 +375,7 @@ typedef struct
     dft32_data dd;
     embeddedNf_data end;
     embeddedOut_data eod;
+    bool ccReady; // false if InitColorChord() failed
     uint8_t samplesProcessed;
     uint16_t maxValue;
 
@@ -479,7 +482,7 @@ static void introEnterMode(void)
     loadMidiFile("hd_credits.mid", &iv->song, true);
 
     // Init CC
-    InitColorChord(&iv->end, &iv->dd);
+    iv->ccReady  = InitColorChord(&iv->end, &iv->dd);
     iv->maxValue = 1;
 }
 
@@ -509,6 +512,8 @@ static void introExitMode(void)
 
     unloadMidiFile(&iv->song);
 
+    DeinitColorChord(&iv->end, &iv->dd);
+
     heap_caps_free(iv);
 }
 
@@ -533,8 +538,6 @@ static void introMainLoop(int64_t elapsedUs)
             drawLineFast(i, 0, i, TFT_HEIGHT, bgLineColors[i % 2]);
         }
 
-        static int32_t timer = 0;
-
         const char mag[]  = "MA";
         const char fest[] = "GFest";
 
@@ -562,7 +565,7 @@ static void introMainLoop(int64_t elapsedUs)
 
     #ifdef STRIPE_TEXT
         paletteColor_t colors[] = {c003, c003, c034, c003, c003, c003, c034, c003};
-        int magColOffset        = ((timer % 400000) / 100000);
+        int magColOffset        = ((iv->splashTimer % 400000) / 100000);
         int festColOffset       = (magColOffset + (3 - magW % 4)) % 4;
         drawTextMulticolored(&iv->logoFont, mag, magX, titleY, colors + magColOffset, 4, magW);
         drawTextMulticolored(&iv->logoFont, fest, festX, titleY, colors + festColOffset, 4, festW);
@@ -574,7 +577,7 @@ static void introMainLoop(int64_t elapsedUs)
         drawText(&iv->logoFontOutline, outlineCol, fest, festX, titleY);
 
     #ifdef STRIPE_TEXT
-        int swColOffset   = 3 - ((timer % 600000) / 150000);
+        int swColOffset   = 3 - ((iv->splashTimer % 600000) / 150000);
         int adgeColOffset = (swColOffset + (3 - (subOneWidth + kernWA) % 4)) % 4;
         drawTextMulticolored(&iv->logoFont, sub, subX, subY, colors + swColOffset, 4, subOneWidth);
         drawTextMulticolored(&iv->logoFont, sub2, subX + subOneWidth + kernWA, subY, colors + adgeColOffset, 4,
@@ -586,7 +589,7 @@ static void introMainLoop(int64_t elapsedUs)
         drawText(&iv->logoFontOutline, outlineCol, sub, subX, subY);
         drawText(&iv->logoFontOutline, outlineCol, sub2, subX + subOneWidth + kernWA, subY);
 
-        timer += elapsedUs;
+        iv->splashTimer += elapsedUs;
 
         // Return early -- Don't do the rest of the stuff yet
         if (iv->playingSound)
@@ -595,14 +598,13 @@ static void introMainLoop(int64_t elapsedUs)
         }
         else
         {
-            static int postTimerStart = 0;
-            if (postTimerStart == 0)
+            if (iv->splashSoundEnd == 0)
             {
-                postTimerStart = timer;
+                iv->splashSoundEnd = iv->splashTimer;
             }
 
             // Wait 2 seconds after sound ending before continuing
-            if ((timer - postTimerStart) >= 2000000)
+            if ((iv->splashTimer - iv->splashSoundEnd) >= 2000000)
             {
                 iv->introComplete = true;
             }
@@ -669,9 +671,9 @@ static void introMainLoop(int64_t elapsedUs)
     // Values are roughly -256 to 256
     tutorialOnMotion(&iv->tut, a_x, a_y, a_z);
 
-    // Find the overall sound energy
+    // Find the overall sound energy. Without colorchord, there's no sound
     int32_t energy = 0;
-    for (uint16_t i = 0; i < FIX_BINS; i++)
+    for (uint16_t i = 0; iv->ccReady && i < iv->end.bins; i++)
     {
         // Find the max value
         if (iv->end.fuzzed_bins[i] > iv->maxValue)
@@ -731,7 +733,10 @@ static void introMainLoop(int64_t elapsedUs)
         }
         case DRAW_MIC:
         {
-            introDrawSwadgeMicrophone(elapsedUs, iv->end.fuzzed_bins, iv->maxValue);
+            if (iv->ccReady)
+            {
+                introDrawSwadgeMicrophone(elapsedUs, iv->end.fuzzed_bins, iv->end.bins, iv->maxValue);
+            }
             break;
         }
     }
@@ -753,14 +758,22 @@ static void introMainLoop(int64_t elapsedUs)
  */
 void introAudioCallback(uint16_t* samples, uint32_t sampleCnt)
 {
-    // For each sample
-    for (uint32_t idx = 0; idx < sampleCnt; idx++)
+    // Without colorchord, there's nothing to do with the samples
+    if (!iv->ccReady)
+    {
+        return;
+    }
+
+    // Push samples in blocks which end every 128 samples
+    uint32_t idx = 0;
+    while (idx < sampleCnt)
     {
-        // Push to test
-        PushSample32(&iv->dd, samples[idx]);
+        uint32_t blockLen = MIN(sampleCnt - idx, 128 - iv->samplesProcessed);
+        PushBlock32(&iv->dd, (const int16_t*)&samples[idx], blockLen);
+        idx += blockLen;
 
         // If 128 samples have been pushed
-        iv->samplesProcessed++;
+        iv->samplesProcessed += blockLen;
         if (iv->samplesProcessed >= 128)
         {
             // Update LEDs
@@ -1154,13 +1167,14 @@ static void introDrawSwadgeSpeaker(int64_t elapsedUs)
  *
  * @param elapsedUs
  * @param fuzzed_bins
+ * @param numBins The number of bins in fuzzed_bins
  * @param maxValue
  */
-static void introDrawSwadgeMicrophone(int64_t elapsedUs, uint16_t* fuzzed_bins, uint16_t maxValue)
+static void introDrawSwadgeMicrophone(int64_t elapsedUs, uint16_t* fuzzed_bins, uint16_t numBins, uint16_t maxValue)
 {
     // Draw the spectrum as a bar graph. Figure out bar and margin size
-    int16_t binWidth  = (TFT_WIDTH / FIX_BINS);
-    int16_t binMargin = (TFT_WIDTH - (binWidth * FIX_BINS)) / 2;
+    int16_t binWidth  = (TFT_WIDTH / numBins);
+    int16_t binMargin = (TFT_WIDTH - (binWidth * numBins)) / 2;
 
     int16_t barsTop    = MANIA_TITLE_HEIGHT;
     int16_t barsBottom = 176;
@@ -1168,7 +1182,7 @@ static void introDrawSwadgeMicrophone(int64_t elapsedUs, uint16_t* fuzzed_bins,
     int16_t barsHeight = barsBottom - barsTop;
 
     // Plot the bars
-    for (uint16_t i = 0; i < FIX_BINS; i++)
+    for (uint16_t i = 0; i < numBins; i++)
     {
         uint8_t height       = (barsHeight * fuzzed_bins[i]) / (2 * maxValue);
         height               = MAX(height, 1);
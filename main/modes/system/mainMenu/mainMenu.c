@@ -239,6 +239,8 @@ mainMenu->menu = endSubMenu(mainMenu->menu);
 
     // Initialize menu renderer
     mainMenu->renderer = initMenuManiaRenderer(NULL, NULL, NULL);
+    // The main menu is shown a lot, so spend the memory to draw it faster
+    setManiaStaticCache(mainMenu->renderer, true);
 }
 
 /**
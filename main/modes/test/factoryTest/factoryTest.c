@@ -86,6 +86,7 @@ typedef struct
     dft32_data dd;
     embeddedNf_data end;
     embeddedOut_data eod;
+    bool ccReady; // false if InitColorChord() failed
     uint8_t samplesProcessed;
     uint16_t maxValue;
     // Buzzers
@@ -164,7 +165,7 @@ void testEnterMode(void)
     test->lastTouchStateIdx = UINT8_MAX;
 
     // Init CC
-    InitColorChord(&test->end, &test->dd);
+    test->ccReady  = InitColorChord(&test->end, &test->dd);
     test->maxValue = 1;
 
     // Temporarily set the buzzer to full volume
@@ -201,6 +202,7 @@ void testExitMode(void)
     freeWsg(&test->kd_idle0);
     freeWsg(&test->kd_idle1);
     unloadMidiFile(&test->song);
+    DeinitColorChord(&test->end, &test->dd);
     heap_caps_free(test);
 }
 
@@ -244,36 +246,39 @@ void testMainLoop(int64_t elapsedUs __attribute__((unused)))
     // Clear everything
     clearPxTft();
 
-    // Draw the spectrum as a bar graph. Figure out bar and margin size
-    int16_t binWidth  = (TFT_WIDTH / FIX_BINS);
-    int16_t binMargin = (TFT_WIDTH - (binWidth * FIX_BINS)) / 2;
-
-    // Find the max value
-    for (uint16_t i = 0; i < FIX_BINS; i++)
+    if (test->ccReady)
     {
-        if (test->end.fuzzed_bins[i] > test->maxValue)
+        // Draw the spectrum as a bar graph. Figure out bar and margin size
+        int16_t binWidth  = (TFT_WIDTH / test->end.bins);
+        int16_t binMargin = (TFT_WIDTH - (binWidth * test->end.bins)) / 2;
+
+        // Find the max value
+        for (uint16_t i = 0; i < test->end.bins; i++)
         {
-            test->maxValue = test->end.fuzzed_bins[i];
+            if (test->end.fuzzed_bins[i] > test->maxValue)
+            {
+                test->maxValue = test->end.fuzzed_bins[i];
+            }
         }
-    }
 
-    // Plot the bars
-    int32_t energy = 0;
-    for (uint16_t i = 0; i < FIX_BINS; i++)
-    {
-        energy += test->end.fuzzed_bins[i];
-        uint8_t height       = ((TFT_HEIGHT / 2) * test->end.fuzzed_bins[i]) / test->maxValue;
-        paletteColor_t color = test->micPassed ? c050 : c500; // paletteHsvToHex((i * 256) / FIX_BINS, 255, 255);
-        int16_t x0           = binMargin + (i * binWidth);
-        int16_t x1           = binMargin + ((i + 1) * binWidth);
-        // Big enough, fill an area
-        fillDisplayArea(x0, TFT_HEIGHT - height, x1, TFT_HEIGHT, color);
-    }
+        // Plot the bars
+        int32_t energy = 0;
+        for (uint16_t i = 0; i < test->end.bins; i++)
+        {
+            energy += test->end.fuzzed_bins[i];
+            uint8_t height       = ((TFT_HEIGHT / 2) * test->end.fuzzed_bins[i]) / test->maxValue;
+            paletteColor_t color = test->micPassed ? c050 : c500; // paletteHsvToHex((i * 256) / FIX_BINS, 255, 255);
+            int16_t x0           = binMargin + (i * binWidth);
+            int16_t x1           = binMargin + ((i + 1) * binWidth);
+            // Big enough, fill an area
+            fillDisplayArea(x0, TFT_HEIGHT - height, x1, TFT_HEIGHT, color);
+        }
 
-    // Check for a pass
-    if (energy > 100000)
-    {
-        test->micPassed = true;
+        // Check for a pass
+        if (energy > 100000)
+        {
+            test->micPassed = true;
+        }
     }
 
     // Draw button states
@@ -749,14 +754,22 @@ void testReadAndValidateTouch(void)
  */
 void testAudioCb(uint16_t* samples, uint32_t sampleCnt)
 {
-    // For each sample
-    for (uint32_t idx = 0; idx < sampleCnt; idx++)
+    // Without colorchord, there's nothing to do with the samples
+    if (!test->ccReady)
+    {
+        return;
+    }
+
+    // Push samples in blocks which end every 128 samples
+    uint32_t idx = 0;
+    while (idx < sampleCnt)
     {
-        // Push to test
-        PushSample32(&test->dd, samples[idx]);
+        uint32_t blockLen = MIN(sampleCnt - idx, 128 - test->samplesProcessed);
+        PushBlock32(&test->dd, (const int16_t*)&samples[idx], blockLen);
+        idx += blockLen;
 
         // If 128 samples have been pushed
-        test->samplesProcessed++;
+        test->samplesProcessed += blockLen;
         if (test->samplesProcessed >= 128)
         {
             // Update LEDs
@@ -765,7 +778,7 @@ void testAudioCb(uint16_t* samples, uint32_t sampleCnt)
 
             // Keep track of max value for the spectrogram
             int16_t maxVal = 0;
-            for (uint16_t i = 0; i < FIX_BINS; i++)
+            for (uint16_t i = 0; i < test->end.bins; i++)
             {
                 if (test->end.fuzzed_bins[i] > maxVal)
                 {
@@ -233,9 +233,12 @@
 /// @brief The current Swadge mode
 static swadgeMode_t* cSwadgeMode = &mainMenuMode;
 
-/// @brief A pending Swadge mode to use after a deep sleep
+/// @brief A pending Swadge mode to switch to in place, or to use after a deep sleep
 static RTC_DATA_ATTR swadgeMode_t* pendingSwadgeMode = NULL;
 
+/// @brief The Swadge mode USB was initialized for. Switching to a mode which uses USB differently needs a restart
+static const swadgeMode_t* usbSwadgeMode = NULL;
+
 /// @brief Flag set if the quick settings should be shown synchronously
 static bool shouldShowQuickSettings = false;
 /// @brief Flag set if the quick settings should be hidden synchronously
@@ -245,9 +248,35 @@ static swadgeMode_t* modeBehindQuickSettings = NULL;
 
 /// 25 FPS by default
 static uint32_t frameRateUs = DEFAULT_FRAME_RATE_US;
+/// @brief The time since the TFT was last drawn, which hasn't reached frameRateUs yet
+static uint64_t tAccumDraw = 0;
 
 /// @brief Timer to return to the main menu
 static int64_t timeExitPressed = 0;
+/// @brief The state of all buttons, as of the last button event
+static uint16_t buttonState = 0;
+/// @brief Buttons which were held when the Swadge mode was switched. Their events are dropped until they are released
+static uint16_t ignoredButtons = 0;
+/// @brief The time the Swadge mode's main loop was last called, or 0 if it hasn't been called yet
+static uint64_t tLastMainLoopCall = 0;
+/// @brief The time which hasn't been stepped by the Swadge mode's fixed update yet
+static int64_t fixedUpdateAccumUs = 0;
+/// @brief How far the time is between the last fixed update and the next one
+static q24_8 fixedUpdateAlpha = 0;
+
+/// @brief true if the microphone or the speaker was initialized
+static bool audioInUse = false;
+/// @brief true if the microphone is running, false if the speaker and battery monitor are
+static bool micInUse = false;
+/// @brief The wifi mode ESP-NOW was initialized with, or ::NO_WIFI if it isn't running
+static wifiMode_t espNowInUse = NO_WIFI;
+/// @brief true if the accelerometer was initialized
+static bool accelInUse = false;
+/// @brief true if the temperature sensor was initialized
+static bool thermometerInUse = false;
+
+/// @brief The free internal memory and SPIRAM when the current Swadge mode was entered, to check for leaks
+static size_t freeAtModeEnter[2] = {0};
 
 //==============================================================================
 // Function declarations
@@ -258,6 +287,10 @@ static void swadgeModeEspNowRecvCb(const esp_now_recv_info_t* esp_now_info, cons
 static void swadgeModeEspNowSendCb(const uint8_t* mac_addr, esp_now_send_status_t status);
 static void setSwadgeMode(void* swadgeMode);
 static void initOptionalPeripherals(void);
+static bool swadgeModeNeedsRestart(const swadgeMode_t* nextMode);
+static void enterSwadgeMode(void);
+static void runFixedUpdates(int64_t elapsedUs);
+static void checkSwadgeModeLeaks(void);
 static void dacCallback(uint8_t* samples, int16_t len);
 
 //==============================================================================
@@ -329,6 +362,7 @@ void app_main(void)
 #endif
         );
     }
+    usbSwadgeMode = cSwadgeMode;
 
     // Check for prior crash info and install crash wrapper
     checkAndInstallCrashwrap();
@@ -387,6 +421,14 @@ void app_main(void)
 
     initLeds(GPIO_NUM_39, ledMirrorGpio, getLedBrightnessSetting());
 
+#if defined(CONFIG_FRAME_PROFILER_OVERLAY)
+    // Time the phases of the main loop, report them, and draw them on the display
+    setFrameProfilerFlags(FRAME_PROFILER_RECORD | FRAME_PROFILER_REPORT | FRAME_PROFILER_OVERLAY);
+#elif defined(CONFIG_FRAME_PROFILER)
+    // Time the phases of the main loop and report them
+    setFrameProfilerFlags(FRAME_PROFILER_RECORD | FRAME_PROFILER_REPORT);
+#endif
+
     // Initialize optional peripherals, depending on the mode's requests
     initOptionalPeripherals();
 
@@ -395,10 +437,9 @@ void app_main(void)
     tLastLoopUs                = esp_timer_get_time();
 
     // Initialize the swadge mode
-    if (NULL != cSwadgeMode->fnEnterMode)
-    {
-        cSwadgeMode->fnEnterMode();
-    }
+    dacLock();
+    enterSwadgeMode();
+    dacUnlock();
 
     // Run the main loop, forever
     while (true)
@@ -411,35 +452,24 @@ void app_main(void)
         // Process ADC samples
         if (NULL != cSwadgeMode->fnAudioCallback)
         {
-            // This must have the same number of elements as the bounds in mic_param
-            const uint16_t micGains[] = {
-                32, 45, 64, 90, 128, 181, 256, 362,
-            };
-
-            uint16_t micAmp = micGains[getMicGainSetting()];
+            framePhaseBegin(FRAME_PHASE_MIC);
+            uint8_t micGain = getMicGainSetting();
             uint16_t adcSamples[ADC_READ_LEN / SOC_ADC_DIGI_RESULT_BYTES];
             uint32_t sampleCnt = 0;
             while (0 < (sampleCnt = loopMic(adcSamples, ARRAY_SIZE(adcSamples))))
             {
-                // Run all samples through an IIR filter
-                for (uint32_t i = 0; i < sampleCnt; i++)
-                {
-                    static uint32_t samp_iir = 0;
-
-                    int32_t sample  = adcSamples[i];
-                    samp_iir        = samp_iir - (samp_iir >> 9) + sample;
-                    int32_t newSamp = (sample - (samp_iir >> 9));
-                    newSamp         = newSamp * micAmp;
-                    newSamp         = CLAMP(newSamp, -32768, 32767);
-                    adcSamples[i]   = newSamp;
-                }
-                cSwadgeMode->fnAudioCallback(adcSamples, sampleCnt);
+                // Filter the samples once into the mic ring, then give the mode the filtered block from the ring
+                int16_t* filtered = micRingPush(adcSamples, sampleCnt, micGain);
+                cSwadgeMode->fnAudioCallback((uint16_t*)filtered, sampleCnt);
             }
+            framePhaseEnd(FRAME_PHASE_MIC);
         }
 
 #if defined(CONFIG_SOUND_OUTPUT_SPEAKER)
-        // Check if a DAC buffer needs to be filled
+        // Samples are generated by the DAC's audio task, just check for underruns
+        framePhaseBegin(FRAME_PHASE_AUDIO);
         dacPoll();
+        framePhaseEnd(FRAME_PHASE_AUDIO);
 #elif defined(CONFIG_SOUND_OUTPUT_BUZZER)
         // Check for buzzer callback flags from the ISR
         bzrCheckSongDone();
@@ -447,30 +477,37 @@ void app_main(void)
 
         if (NO_WIFI != cSwadgeMode->wifiMode)
         {
+            framePhaseBegin(FRAME_PHASE_ESP_NOW);
             checkEspNowRxQueue();
+            framePhaseEnd(FRAME_PHASE_ESP_NOW);
         }
 
+        // Save settings to NVS once they stop changing
+        pollSettingsSave();
+
         // Only draw to the TFT every frameRateUs
-        static uint64_t tAccumDraw = 0;
         tAccumDraw += tElapsedUs;
         if (tAccumDraw >= frameRateUs)
         {
             // Decrement the accumulation
             tAccumDraw -= frameRateUs;
 
-            // Call the mode's main loop
-            if (NULL != cSwadgeMode->fnMainLoop)
+            // Keep track of the time between main loop calls
+            if (0 == tLastMainLoopCall)
             {
-                // Keep track of the time between main loop calls
-                static uint64_t tLastMainLoopCall = 0;
-                if (0 == tLastMainLoopCall)
-                {
-                    tLastMainLoopCall = tNowUs;
-                }
-
-                cSwadgeMode->fnMainLoop(tNowUs - tLastMainLoopCall);
                 tLastMainLoopCall = tNowUs;
             }
+            int64_t tMainLoopElapsedUs = tNowUs - tLastMainLoopCall;
+            tLastMainLoopCall          = tNowUs;
+
+            // Step the mode's simulation, then call the mode's main loop
+            framePhaseBegin(FRAME_PHASE_MAIN_LOOP);
+            runFixedUpdates(tMainLoopElapsedUs);
+            if (NULL != cSwadgeMode->fnMainLoop)
+            {
+                cSwadgeMode->fnMainLoop(tMainLoopElapsedUs);
+            }
+            framePhaseEnd(FRAME_PHASE_MAIN_LOOP);
 
             // If the menu button is being held
             if (0 != timeExitPressed)
@@ -499,112 +536,259 @@ void app_main(void)
                 // Lower the flag
                 shouldShowQuickSettings = false;
 
-                // Save the current mode
+                // Save the current mode and show the quick settings. Keep the audio task out while the modes change
+                dacLock();
                 modeBehindQuickSettings = cSwadgeMode;
                 cSwadgeMode             = &quickSettingsMode;
-                // Show the quick settings
                 quickSettingsMode.fnEnterMode();
+                dacUnlock();
             }
             else if (shouldHideQuickSettings)
             {
                 // Lower the flag
                 shouldHideQuickSettings = false;
-                // Hide the quick settings
+                // Hide the quick settings and restore the mode. Keep the audio task out while the modes change
+                dacLock();
                 quickSettingsMode.fnExitMode();
-                // Restore the mode
                 cSwadgeMode = modeBehindQuickSettings;
+                dacUnlock();
+                // Save what was changed
+                saveSettings();
             }
 
             // Draw to the TFT
+            drawFrameProfilerOverlay();
+            framePhaseBegin(FRAME_PHASE_DRAW);
             drawDisplayTft(cSwadgeMode->fnBackgroundDrawCallback);
+            framePhaseEnd(FRAME_PHASE_DRAW);
+            frameProfilerEndFrame();
         }
 
         // If the mode should be switched, do it now
         if (NULL != pendingSwadgeMode)
         {
-            // We have to do this otherwise the backlight can glitch
-            disableTFTBacklight();
+            if (!swadgeModeNeedsRestart(pendingSwadgeMode))
+            {
+                // Switch in place, only reinitializing the peripherals the modes use differently
+                softSwitchToPendingSwadge();
+            }
+            else
+            {
+                // We have to do this otherwise the backlight can glitch
+                disableTFTBacklight();
+
+                // Prevent bootloader on reboot if rebooting from originally bootloaded instance
+                REG_WRITE(RTC_CNTL_OPTION1_REG, 0);
 
-            // Prevent bootloader on reboot if rebooting from originally bootloaded instance
-            REG_WRITE(RTC_CNTL_OPTION1_REG, 0);
+                // Only an issue if originally coming from bootloader. This is actually a ROM function.
+                // It prevents the USB from glitching out on the reboot after the reboot after coming
+                // out of bootloader
+                chip_usb_set_persist_flags(USBDC_PERSIST_ENA);
 
-            // Only an issue if originally coming from bootloader. This is actually a ROM function.
-            // It prevents the USB from glitching out on the reboot after the reboot after coming
-            // out of bootloader
-            chip_usb_set_persist_flags(USBDC_PERSIST_ENA);
+                // Settings in RAM are lost when sleeping, so save them first
+                saveSettings();
 
-            // Go to sleep. pendingSwadgeMode will be used after waking up
-            esp_sleep_enable_timer_wakeup(1);
-            esp_deep_sleep_start();
+                // Go to sleep. pendingSwadgeMode will be used after waking up
+                esp_sleep_enable_timer_wakeup(1);
+                esp_deep_sleep_start();
+            }
         }
 
         // Yield to let the rest of the RTOS run
         taskYIELD();
     }
 
-    // Deinitialize the swadge mode
+    // Deinitialize the swadge mode. Stop LED animations first, they may use the mode's memory
+    ledAnimStop();
+    dacLock();
     if (NULL != cSwadgeMode->fnExitMode)
     {
         cSwadgeMode->fnExitMode();
     }
+    dacUnlock();
 
     deinitSystem();
 }
 
 /**
- * @brief Initialize optional hardware peripherals for this Swadge mode
+ * @brief Initialize the optional hardware peripherals this Swadge mode uses and deinitialize the ones it doesn't.
+ * Peripherals which are already running the way this mode needs them are left alone, so switching between similar
+ * modes is fast
  */
 static void initOptionalPeripherals(void)
 {
-    // Init mic if it is used by the mode
-    if (NULL != cSwadgeMode->fnAudioCallback)
+    // Use the mic if the mode has an audio callback, otherwise use the speaker and battery monitor. Modes may switch
+    // between these themselves, so compare against what is actually running
+    bool useMic = (NULL != cSwadgeMode->fnAudioCallback);
+    if (audioInUse && (useMic != micInUse))
+    {
+        if (useMic)
+        {
+            switchToMicrophone();
+        }
+        else
+        {
+            switchToSpeaker();
+        }
+    }
+    else if (!audioInUse && useMic)
     {
         setDacShutdown(true);
 
         // Initialize and start the mic as a continuous ADC
         initMic(GPIO_NUM_7);
         startMic();
+        micInUse = true;
     }
-    else
+    else if (!audioInUse)
     {
         setDacShutdown(false);
 
-        // Otherwise initialize the battery monitor as a oneshot ADC
+        // Initialize the battery monitor as a oneshot ADC
         initBattmon(GPIO_NUM_6);
 
         // Initialize sound output if there is no input
 #if defined(CONFIG_SOUND_OUTPUT_SPEAKER)
+        // Initialize the MIDI player first, the DAC's audio task starts requesting samples immediately
+        initGlobalMidiPlayer();
         // Initialize the speaker. The DAC uses the same DMA controller for continuous output,
         // so it can't be initialized at the same time as the microphone
         initDac(DAC_CHANNEL_MASK_CH0, // GPIO_NUM_17
                 GPIO_NUM_18, dacCallback);
         dacStart();
-        initGlobalMidiPlayer();
 #elif defined(CONFIG_SOUND_OUTPUT_BUZZER)
     #error "Buzzer is no longer supported, get with the times!"
 #endif
+        micInUse = false;
+    }
+    else if (!useMic)
+    {
+        // The speaker is already running, but the last mode may have shut it down
+        setDacShutdown(false);
     }
+    audioInUse = true;
 
-    // Init esp-now if requested by the mode
-    if ((ESP_NOW == cSwadgeMode->wifiMode) || (ESP_NOW_IMMEDIATE == cSwadgeMode->wifiMode))
+    // Init esp-now if requested by the mode. Restart it if the mode wants packets delivered differently
+    wifiMode_t wifiMode = cSwadgeMode->wifiMode;
+    if ((ESP_NOW != wifiMode) && (ESP_NOW_IMMEDIATE != wifiMode))
+    {
+        wifiMode = NO_WIFI;
+    }
+    if (wifiMode != espNowInUse)
     {
-        initEspNow(&swadgeModeEspNowRecvCb, &swadgeModeEspNowSendCb, GPIO_NUM_NC, GPIO_NUM_NC, UART_NUM_MAX,
-                   cSwadgeMode->wifiMode);
+        if (NO_WIFI != espNowInUse)
+        {
+            deinitEspNow();
+        }
+        if (NO_WIFI != wifiMode)
+        {
+            initEspNow(&swadgeModeEspNowRecvCb, &swadgeModeEspNowSendCb, GPIO_NUM_NC, GPIO_NUM_NC, UART_NUM_MAX,
+                       wifiMode);
+        }
+        espNowInUse = wifiMode;
     }
 
     // Init accelerometer
-    if (cSwadgeMode->usesAccelerometer)
+    if (cSwadgeMode->usesAccelerometer && !accelInUse)
     {
         initAccelerometer(GPIO_NUM_3,  // SDA
                           GPIO_NUM_41, // SCL
                           GPIO_PULLUP_ENABLE);
         accelIntegrate();
+        accelInUse = true;
+    }
+    else if (!cSwadgeMode->usesAccelerometer && accelInUse)
+    {
+        deInitAccelerometer();
+        accelInUse = false;
     }
 
     // Init the temperature sensor
-    if (cSwadgeMode->usesThermometer)
+    if (cSwadgeMode->usesThermometer && !thermometerInUse)
     {
         initTemperatureSensor();
+        thermometerInUse = true;
+    }
+    else if (!cSwadgeMode->usesThermometer && thermometerInUse)
+    {
+        deinitTemperatureSensor();
+        thermometerInUse = false;
+    }
+}
+
+/**
+ * @brief Check if switching to a Swadge mode needs a restart, or if it can be done in place
+ *
+ * @param nextMode The Swadge mode which will be switched to
+ * @return true if the Swadge must restart into the next mode, false if it can switch in place
+ */
+static bool swadgeModeNeedsRestart(const swadgeMode_t* nextMode)
+{
+#ifdef CONFIG_SOFT_MODE_SWITCH
+    // USB is only initialized at boot, with the mode's advanced USB handler
+    return (usbSwadgeMode->overrideUsb != nextMode->overrideUsb) ||
+           (usbSwadgeMode->fnAdvancedUSB != nextMode->fnAdvancedUSB);
+#else
+    return true;
+#endif
+}
+
+/**
+ * @brief Enter the current Swadge mode, noting how much memory is free first to check for leaks when it exits
+ */
+static void enterSwadgeMode(void)
+{
+    freeAtModeEnter[0] = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    freeAtModeEnter[1] = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+
+    fixedUpdateAccumUs = 0;
+    fixedUpdateAlpha   = 0;
+
+    if (NULL != cSwadgeMode->fnEnterMode)
+    {
+        cSwadgeMode->fnEnterMode();
+    }
+}
+
+/**
+ * @brief Step the Swadge mode's simulation by its fixed update time until it has caught up with the time which passed,
+ * up to ::MAX_FIXED_UPDATES_PER_FRAME times
+ *
+ * @param elapsedUs The time since the last frame, in microseconds
+ */
+static void runFixedUpdates(int64_t elapsedUs)
+{
+    if (NULL == cSwadgeMode->fnFixedUpdate)
+    {
+        return;
+    }
+
+    uint32_t stepUs = cSwadgeMode->fixedUpdateUs ? cSwadgeMode->fixedUpdateUs : DEFAULT_FIXED_UPDATE_US;
+    fixedUpdateAccumUs += elapsedUs;
+    for (int32_t steps = 0; (fixedUpdateAccumUs >= stepUs) && (steps < MAX_FIXED_UPDATES_PER_FRAME); steps++)
+    {
+        cSwadgeMode->fnFixedUpdate(stepUs);
+        fixedUpdateAccumUs -= stepUs;
+    }
+
+    // If the simulation is still behind, drop the time it couldn't catch up on instead of falling further behind
+    fixedUpdateAccumUs %= stepUs;
+    fixedUpdateAlpha = (fixedUpdateAccumUs << FRAC_BITS) / stepUs;
+}
+
+/**
+ * @brief Warn if the Swadge mode which just exited left memory allocated. Memory used by other tasks, like WiFi, is
+ * counted too, so small differences may not be leaks
+ */
+static void checkSwadgeModeLeaks(void)
+{
+    size_t internalFree = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    size_t spiramFree   = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    if ((internalFree < freeAtModeEnter[0]) || (spiramFree < freeAtModeEnter[1]))
+    {
+        ESP_LOGW("SWADGE", "%s may have leaked %zu bytes of internal memory and %zu bytes of SPIRAM",
+                 cSwadgeMode->modeName, freeAtModeEnter[0] - MIN(internalFree, freeAtModeEnter[0]),
+                 freeAtModeEnter[1] - MIN(spiramFree, freeAtModeEnter[1]));
     }
 }
 
@@ -613,17 +797,24 @@ static void initOptionalPeripherals(void)
  */
 void deinitSystem(void)
 {
-    // Deinit the swadge mode
+    // Deinit the swadge mode. Keep the audio task out while it frees memory the audio task may use
+    ledAnimStop();
+    dacLock();
     if (NULL != cSwadgeMode->fnExitMode)
     {
         cSwadgeMode->fnExitMode();
     }
+    dacUnlock();
+
+    // Save any settings which changed before NVS is deinitialized
+    saveSettings();
 
     // Deinitialize everything
     deinitButtons();
 #if defined(CONFIG_SOUND_OUTPUT_SPEAKER)
-    deinitGlobalMidiPlayer();
+    // Stop the DAC's audio task before freeing the MIDI player it reads from
     deinitDac();
+    deinitGlobalMidiPlayer();
 #elif defined(CONFIG_SOUND_OUTPUT_BUZZER)
     deinitBuzzer();
 #endif
@@ -684,11 +875,16 @@ static void setSwadgeMode(void* swadgeMode)
         swadgeMode = &mainMenuMode;
     }
 
+    // This is called from the USB task, so keep the audio task out while the modes change
+    dacLock();
+
     // Stop the prior mode
+    ledAnimStop();
     if (cSwadgeMode->fnExitMode)
     {
         cSwadgeMode->fnExitMode();
     }
+    saveSettings();
 
     // Set and start the new mode
     cSwadgeMode = swadgeMode;
@@ -696,6 +892,8 @@ static void setSwadgeMode(void* swadgeMode)
     {
         cSwadgeMode->fnEnterMode();
     }
+
+    dacUnlock();
 }
 
 /**
@@ -712,20 +910,61 @@ void switchToSwadgeMode(swadgeMode_t* mode)
 }
 
 /**
- * @brief Switch to the pending Swadge mode without restarting the system
+ * @brief Get the Swadge mode which is running. While the quick settings are shown, this is the quick settings mode
+ *
+ * @return The current Swadge mode
+ */
+swadgeMode_t* getSwadgeMode(void)
+{
+    return cSwadgeMode;
+}
+
+/**
+ * @brief Switch to the pending Swadge mode without restarting the system. Only the peripherals which the old and new
+ * modes use differently are reinitialized
  */
 void softSwitchToPendingSwadge(void)
 {
     if (pendingSwadgeMode)
     {
+        // Pause the audio task until the next mode is entered, so it never calls into a mode which is exiting or
+        // reads music the exiting mode freed
+        dacLock();
+
+        // Stop the music before the mode frees it. This is safe even if the speaker isn't running
+        soundStop(true);
+
+        // If the quick settings are shown, hide them so the mode behind them is the one which exits
+        if (&quickSettingsMode == cSwadgeMode)
+        {
+            quickSettingsMode.fnExitMode();
+            cSwadgeMode = modeBehindQuickSettings;
+        }
+        shouldShowQuickSettings = false;
+        shouldHideQuickSettings = false;
+        timeExitPressed         = 0;
+
         // Exit the current mode
+        ledAnimStop();
         if (NULL != cSwadgeMode->fnExitMode)
         {
             cSwadgeMode->fnExitMode();
         }
+        saveSettings();
+        checkSwadgeModeLeaks();
 
-        // Stop the music
-        soundStop(true);
+        // Turn off the LEDs the last mode left on
+        led_t leds[CONFIG_NUM_LEDS] = {0};
+        setLeds(leds, CONFIG_NUM_LEDS);
+
+        // Drop the queued button events. The buttons which are still held, like the one which picked the next mode,
+        // are ignored until they are released
+        buttonEvt_t evt;
+        while (checkButtonQueue(&evt))
+        {
+            buttonState = evt.state;
+        }
+        ignoredButtons = buttonState;
 
         // Switch the mode pointer
         cSwadgeMode       = pendingSwadgeMode;
@@ -734,11 +973,12 @@ void softSwitchToPendingSwadge(void)
         // Initialize optional peripherals for this mode
         initOptionalPeripherals();
 
-        // Enter the next mode
-        if (NULL != cSwadgeMode->fnEnterMode)
-        {
-            cSwadgeMode->fnEnterMode();
-        }
+        // Enter the next mode. Its frame timing starts like it would after a restart
+        frameRateUs       = DEFAULT_FRAME_RATE_US;
+        tAccumDraw        = 0;
+        tLastMainLoopCall = 0;
+        enterSwadgeMode();
+        dacUnlock();
 
         // Reenable the TFT backlight
         enableTFTBacklight();
@@ -760,6 +1000,20 @@ bool checkButtonQueueWrapper(buttonEvt_t* evt)
     // Check the button queue
     bool retval = checkButtonQueue(evt);
 
+    // Drop the events of buttons which were held when the Swadge mode was switched, until they are released
+    while (retval && (ignoredButtons & evt->button))
+    {
+        if (!evt->down)
+        {
+            ignoredButtons &= ~evt->button;
+        }
+        retval = checkButtonQueue(evt);
+    }
+    if (retval)
+    {
+        buttonState = evt->state;
+    }
+
     // Check for intercept
     if (retval &&                            // If there was a button press
         (!cSwadgeMode->overrideSelectBtn) && // And PB_SELECT isn't overridden
@@ -823,10 +1077,23 @@ uint32_t getFrameRateUs(void)
 }
 
 /**
- * @brief
+ * @brief Get how far the time is between the Swadge mode's last ::swadgeMode_t.fnFixedUpdate call and the next one.
+ * This can be used in ::swadgeMode_t.fnMainLoop to draw objects between their last two simulated positions, which
+ * looks smoother when the frame rate and the fixed update rate don't match
+ *
+ * @return The fraction of a fixed update step, from 0 up to but not including 1, as a ::q24_8
+ */
+q24_8 getFixedUpdateAlpha(void)
+{
+    return fixedUpdateAlpha;
+}
+
+/**
+ * @brief Request samples from the Swadge mode or the global MIDI player. This is called from the DAC's audio task,
+ * not the main loop, while it holds the audio lock. See dacLock()
  *
- * @param samples
- * @param len
+ * @param samples A buffer to fill with 8 bit unsigned DAC samples
+ * @param len The length of the buffer to fill
  */
 void dacCallback(uint8_t* samples, int16_t len)
 {
@@ -852,14 +1119,15 @@ void switchToSpeaker(void)
     stopMic();
     deinitMic();
 
-    // Start the speaker
+    // Start the speaker, after the MIDI player it reads from
+    initGlobalMidiPlayer();
     initDac(DAC_CHANNEL_MASK_CH0, // GPIO_NUM_17
             GPIO_NUM_18, dacCallback);
     setDacShutdown(false);
-    initGlobalMidiPlayer();
 
     // Start battery monitoring
     initBattmon(GPIO_NUM_6);
+    micInUse = false;
 }
 
 /**
@@ -870,13 +1138,14 @@ void switchToMicrophone(void)
     // Stop battery monitoring
     deinitBattmon();
 
-    // Stop the speaker
-    globalMidiPlayerStop(true);
-    deinitGlobalMidiPlayer();
+    // Stop the speaker, then the MIDI player it reads from
     setDacShutdown(true);
     deinitDac();
+    globalMidiPlayerStop(true);
+    deinitGlobalMidiPlayer();
 
     // Initialize and start the mic as a continuous ADC
     initMic(GPIO_NUM_7);
     startMic();
+    micInUse = true;
 }
@@ -211,6 +211,7 @@
 // General utilities
 #include "linked_list.h"
 #include "macros.h"
+#include "fp_math.h"
 #include "trigonometry.h"
 #include "vector2d.h"
 #include "geometry.h"
@@ -218,15 +219,22 @@
 #include "touchUtils.h"
 #include "vectorFl2d.h"
 #include "geometryFl.h"
+#include "ledAnimation.h"
+#include "frameProfiler.h"
 
 // Sound utilities
 #include "soundFuncs.h"
+#include "micRing.h"
 #include "swSynth.h"
 #include "midiPlayer.h"
 
 #define EXIT_TIME_US 1000000
 /// @brief the default time between drawn frames, in microseconds (40FPS)
 #define DEFAULT_FRAME_RATE_US (1000000 / 40)
+/// @brief the default time between ::swadgeMode_t.fnFixedUpdate calls, in microseconds (60Hz)
+#define DEFAULT_FIXED_UPDATE_US (1000000 / 60)
+/// @brief the most times ::swadgeMode_t.fnFixedUpdate is called to catch up before a frame is drawn
+#define MAX_FIXED_UPDATES_PER_FRAME 4
 
 /**
  * @struct swadgeMode_t
@@ -272,13 +280,24 @@ typedef struct
      */
     bool overrideSelectBtn;
 
+    /**
+     * @brief This is a setting, not a function pointer. The time between fnFixedUpdate() calls, in microseconds. If
+     * this is 0, ::DEFAULT_FIXED_UPDATE_US is used.
+     */
+    uint32_t fixedUpdateUs;
+
     /**
      * @brief This function is called when this mode is started. It should initialize variables and start the mode.
+     *
+     * Swadge modes are usually switched in place, without a restart, so static variables may still hold values from
+     * the last time the mode ran. Initialize all of them here.
      */
     void (*fnEnterMode)(void);
 
     /**
      * @brief This function is called when the mode is exited. It should free any allocated memory.
+     *
+     * If less memory is free after this returns than before fnEnterMode() was called, a possible leak is logged.
      */
     void (*fnExitMode)(void);
 
@@ -290,11 +309,29 @@ typedef struct
      */
     void (*fnMainLoop)(int64_t elapsedUs);
 
+    /**
+     * @brief This function is called to step the mode's simulation, like physics and game logic, by a fixed amount of
+     * time. It is optional. If it is set, it is called every fixedUpdateUs on average, right before fnMainLoop().
+     *
+     * When drawing is slow, this is called up to ::MAX_FIXED_UPDATES_PER_FRAME times before one fnMainLoop() call to
+     * catch up, so the game doesn't slow down with the frame rate. If it's still behind after that, the time it
+     * couldn't catch up on is dropped. Because the step is always the same, the simulation is deterministic and
+     * replays play back exactly.
+     *
+     * fnMainLoop() should then only draw. It may call getFixedUpdateAlpha() to interpolate between the last two steps.
+     *
+     * @param stepUs The time to step the simulation by, which is always fixedUpdateUs
+     */
+    void (*fnFixedUpdate)(uint32_t stepUs);
+
     /**
      * @brief This function is called whenever audio samples are read from the microphone (ADC) and are ready for
      * processing. Samples are read at 8KHz. If this function is not NULL, then readBattmon() will not work
      *
-     * @param samples A pointer to 12 bit audio samples
+     * The samples have already been DC filtered and had the mic gain applied, so they are really signed 16 bit
+     * samples. They point straight into the mic ring (micRing.h), so they must not be modified.
+     *
+     * @param samples A pointer to filtered audio samples
      * @param sampleCnt The number of samples read
      */
     void (*fnAudioCallback)(uint16_t* samples, uint32_t sampleCnt);
@@ -353,12 +390,14 @@ bool checkButtonQueueWrapper(buttonEvt_t* evt);
 
 void switchToSwadgeMode(swadgeMode_t* mode);
 void softSwitchToPendingSwadge(void);
+swadgeMode_t* getSwadgeMode(void);
 
 void deinitSystem(void);
 
 void openQuickSettings(void);
 void setFrameRateUs(uint32_t newFrameRateUs);
 uint32_t getFrameRateUs(void);
+q24_8 getFixedUpdateAlpha(void);
 
 void switchToSpeaker(void);
 void switchToMicrophone(void);
@@ -0,0 +1,247 @@
+//==============================================================================
+// Includes
+//==============================================================================
+
+#include "dynArray.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+
+//==============================================================================
+// Functions
+//==============================================================================
+
+/**
+ * @brief Initialize an empty dynamic array
+ *
+ * @param arr The array to initialize
+ * @param elemSize The size of each value
+ * @param initialCapacity The number of values to allocate room for right away. May be 0
+ * @param caps The MALLOC_CAP_* flags to allocate the values with
+ */
+void dynArrayInit(dynArray_t* arr, size_t elemSize, uint32_t initialCapacity, uint32_t caps)
+{
+    memset(arr, 0, sizeof(dynArray_t));
+    arr->elemSize = elemSize;
+    arr->caps     = caps;
+    dynArrayReserve(arr, initialCapacity);
+}
+
+/**
+ * @brief Free the values in a dynamic array
+ *
+ * @param arr The array to deinitialize
+ */
+void dynArrayDeinit(dynArray_t* arr)
+{
+    heap_caps_free(arr->data);
+    arr->data     = NULL;
+    arr->length   = 0;
+    arr->capacity = 0;
+}
+
+/**
+ * @brief Make sure a dynamic array has room for a number of values without growing again
+ *
+ * @param arr The array to make room in
+ * @param capacity The number of values to make room for
+ * @return true if there is room, false if the memory couldn't be allocated
+ */
+bool dynArrayReserve(dynArray_t* arr, uint32_t capacity)
+{
+    if (capacity <= arr->capacity)
+    {
+        return true;
+    }
+
+    uint8_t* newData = heap_caps_realloc(arr->data, capacity * arr->elemSize, arr->caps);
+    if (NULL == newData)
+    {
+        return false;
+    }
+    arr->data     = newData;
+    arr->capacity = capacity;
+    return true;
+}
+
+/**
+ * @brief Remove every value from a dynamic array, keeping its memory for the next values
+ *
+ * @param arr The array to clear
+ */
+void dynArrayClear(dynArray_t* arr)
+{
+    arr->length = 0;
+}
+
+/**
+ * @brief Add a value to the end of a dynamic array, growing it if it's full
+ *
+ * Runtime: O(1) on average
+ *
+ * @param arr The array to add to
+ * @param elem The value to copy into the array, or NULL to add a zeroed value
+ * @return A pointer to the added value, or NULL if the array couldn't grow
+ */
+void* dynArrayPush(dynArray_t* arr, const void* elem)
+{
+    return dynArrayInsert(arr, arr->length, elem);
+}
+
+/**
+ * @brief Remove the value at the end of a dynamic array
+ *
+ * @param arr The array to remove from
+ * @param[out] out Written with the removed value. May be NULL
+ * @return true if a value was removed, false if the array was empty
+ */
+bool dynArrayPop(dynArray_t* arr, void* out)
+{
+    if (0 == arr->length)
+    {
+        return false;
+    }
+    return dynArrayRemove(arr, arr->length - 1, out);
+}
+
+/**
+ * @brief Add a value at an index in a dynamic array, moving the values after it back
+ *
+ * Runtime: O(n)
+ *
+ * @param arr The array to add to
+ * @param idx The index to add the value at, up to the length
+ * @param elem The value to copy into the array, or NULL to add a zeroed value
+ * @return A pointer to the added value, or NULL if the index was invalid or the array couldn't grow
+ */
+void* dynArrayInsert(dynArray_t* arr, uint32_t idx, const void* elem)
+{
+    if (idx > arr->length)
+    {
+#ifdef CONFIG_CONTAINER_BOUNDS_CHECK
+        dynArrayBoundsFail(arr, idx, arr->elemSize);
+#endif
+        return NULL;
+    }
+
+    if (arr->length == arr->capacity && !dynArrayReserve(arr, arr->capacity ? arr->capacity * 2 : 4))
+    {
+        return NULL;
+    }
+
+    uint8_t* dest = arr->data + idx * arr->elemSize;
+    memmove(dest + arr->elemSize, dest, (arr->length - idx) * arr->elemSize);
+    if (NULL != elem)
+    {
+        memcpy(dest, elem, arr->elemSize);
+    }
+    else
+    {
+        memset(dest, 0, arr->elemSize);
+    }
+    arr->length++;
+    return dest;
+}
+
+/**
+ * @brief Remove the value at an index in a dynamic array, moving the values after it forward to keep the order
+ *
+ * Runtime: O(n)
+ *
+ * @param arr The array to remove from
+ * @param idx The index of the value to remove
+ * @param[out] out Written with the removed value. May be NULL
+ * @return true if a value was removed, false if the index was invalid
+ */
+bool dynArrayRemove(dynArray_t* arr, uint32_t idx, void* out)
+{
+    if (idx >= arr->length)
+    {
+#ifdef CONFIG_CONTAINER_BOUNDS_CHECK
+        dynArrayBoundsFail(arr, idx, arr->elemSize);
+#endif
+        return false;
+    }
+
+    uint8_t* src = arr->data + idx * arr->elemSize;
+    if (NULL != out)
+    {
+        memcpy(out, src, arr->elemSize);
+    }
+    arr->length--;
+    memmove(src, src + arr->elemSize, (arr->length - idx) * arr->elemSize);
+    return true;
+}
+
+/**
+ * @brief Remove the value at an index in a dynamic array by moving the last value into its place. This doesn't keep
+ * the order
+ *
+ * Runtime: O(1)
+ *
+ * @param arr The array to remove from
+ * @param idx The index of the value to remove
+ * @param[out] out Written with the removed value. May be NULL
+ * @return true if a value was removed, false if the index was invalid
+ */
+bool dynArraySwapRemove(dynArray_t* arr, uint32_t idx, void* out)
+{
+    if (idx >= arr->length)
+    {
+#ifdef CONFIG_CONTAINER_BOUNDS_CHECK
+        dynArrayBoundsFail(arr, idx, arr->elemSize);
+#endif
+        return false;
+    }
+
+    uint8_t* src = arr->data + idx * arr->elemSize;
+    if (NULL != out)
+    {
+        memcpy(out, src, arr->elemSize);
+    }
+    arr->length--;
+    if (idx != arr->length)
+    {
+        memcpy(src, arr->data + arr->length * arr->elemSize, arr->elemSize);
+    }
+    return true;
+}
+
+/**
+ * @brief Add a value to the end of a dynamic array, checking the type's size too. Use ::DYN_ARRAY_PUSH() instead of
+ * calling this directly
+ *
+ * @param arr The array to add to
+ * @param elem The value to copy into the array
+ * @param elemSize The size of the type the value is
+ * @return A pointer to the added value, or NULL if the array couldn't grow
+ */
+void* dynArrayPushTyped(dynArray_t* arr, const void* elem, size_t elemSize)
+{
+#ifdef CONFIG_CONTAINER_BOUNDS_CHECK
+    if (elemSize != arr->elemSize)
+    {
+        dynArrayBoundsFail(arr, arr->length, elemSize);
+    }
+#endif
+    return dynArrayPush(arr, elem);
+}
+
+/**
+ * @brief Log an invalid access to a dynamic array and abort. This is only called when \c CONFIG_CONTAINER_BOUNDS_CHECK
+ * is set
+ *
+ * @param arr The array which was accessed
+ * @param idx The index which was accessed
+ * @param elemSize The size of the type the value was accessed as
+ */
+void dynArrayBoundsFail(const dynArray_t* arr, uint32_t idx, size_t elemSize)
+{
+    ESP_LOGE("DynArray", "Invalid access to %p: index %" PRIu32 " of %" PRIu32 ", size %zu of %" PRIu32,
+             (const void*)arr, idx, arr->length, elemSize, arr->elemSize);
+    abort();
+}
@@ -0,0 +1,171 @@
+/*! \file dynArray.h
+ *
+ * \section dynArray_design Design Philosophy
+ *
+ * A ::list_t allocates a node for every value, and usually the value itself too, so walking a list chases pointers all
+ * over the heap. A dynamic array instead stores same-sized values back to back in one block of memory, like a normal
+ * array, and grows that block when it runs out of room. Values are copied in, so small values like coordinates don't
+ * need to be allocated on their own, and looping over the array reads memory in order.
+ *
+ * The capacity doubles whenever the array is full, so adding to the end is O(1) on average. Call dynArrayReserve()
+ * ahead of time to avoid growing during gameplay at all. Removing values never shrinks the capacity.
+ *
+ * Because the memory may move when the array grows, pointers to values are only valid until the next value is added.
+ *
+ * When \c CONFIG_CONTAINER_BOUNDS_CHECK is set, like it is in the emulator, every access is checked against the length
+ * and the typed macros check that the type is the right size. An invalid access is logged and aborts.
+ *
+ * \section dynArray_usage Usage
+ *
+ * dynArrayInit() sets up an empty array for values of a given size, and dynArrayDeinit() frees it.
+ *
+ * dynArrayPush() and dynArrayPop() add and remove values at the end. dynArrayInsert() and dynArrayRemove() add and
+ * remove values in the middle, keeping the order, and dynArraySwapRemove() removes a value in O(1) by moving the last
+ * value into its place.
+ *
+ * dynArrayAt() returns a pointer to a value. The ::DYN_ARRAY_AT() and ::DYN_ARRAY_PUSH() macros do the same with a
+ * type, so values can be read, written, and added without casting.
+ *
+ * \section dynArray_example Example
+ *
+ * \code{.c}
+ * typedef struct
+ * {
+ *     int16_t x;
+ *     int16_t y;
+ * } tilePos_t;
+ *
+ * dynArray_t toCheck;
+ * dynArrayInit(&toCheck, sizeof(tilePos_t), 64, MALLOC_CAP_8BIT);
+ *
+ * // Add some values, which are copied into the array
+ * DYN_ARRAY_PUSH(&toCheck, tilePos_t, .x = 3, .y = 4);
+ * DYN_ARRAY_PUSH(&toCheck, tilePos_t, .x = 5, .y = 6);
+ *
+ * // Loop over the values
+ * for (uint32_t i = 0; i < toCheck.length; i++)
+ * {
+ *     printf("%d, %d\n", DYN_ARRAY_AT(&toCheck, tilePos_t, i).x, DYN_ARRAY_AT(&toCheck, tilePos_t, i).y);
+ * }
+ *
+ * // Take the last value off
+ * tilePos_t pos;
+ * dynArrayPop(&toCheck, &pos);
+ *
+ * dynArrayDeinit(&toCheck);
+ * \endcode
+ */
+
+#ifndef _DYN_ARRAY_H_
+#define _DYN_ARRAY_H_
+
+//==============================================================================
+// Includes
+//==============================================================================
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+//==============================================================================
+// Defines
+//==============================================================================
+
+/**
+ * @brief Access the value at an index in a ::dynArray_t as the given type. This can be read or assigned
+ *
+ * @param arr A pointer to the array
+ * @param type The type of the values in the array
+ * @param idx The index of the value
+ */
+#define DYN_ARRAY_AT(arr, type, idx) (*(type*)dynArrayAtTyped((arr), (idx), sizeof(type)))
+
+/**
+ * @brief Add a value of the given type to the end of a ::dynArray_t. The value is given as an initializer, like \c 5
+ * or <tt>.x = 3, .y = 4</tt>
+ *
+ * @param arr A pointer to the array
+ * @param type The type of the values in the array
+ * @return A pointer to the added value, or NULL if the array couldn't grow
+ */
+#define DYN_ARRAY_PUSH(arr, type, ...) dynArrayPushTyped((arr), &(type){__VA_ARGS__}, sizeof(type))
+
+//==============================================================================
+// Structs
+//==============================================================================
+
+/**
+ * @brief An array of same-sized values which grows as values are added
+ */
+typedef struct
+{
+    uint8_t* data;     ///< The values, back to back
+    uint32_t length;   ///< The number of values in the array
+    uint32_t capacity; ///< The number of values the array has room for before it grows
+    uint32_t elemSize; ///< The size of each value
+    uint32_t caps;     ///< The MALLOC_CAP_* flags the values are allocated with
+} dynArray_t;
+
+//==============================================================================
+// Function Prototypes
+//==============================================================================
+
+void dynArrayInit(dynArray_t* arr, size_t elemSize, uint32_t initialCapacity, uint32_t caps);
+void dynArrayDeinit(dynArray_t* arr);
+bool dynArrayReserve(dynArray_t* arr, uint32_t capacity);
+void dynArrayClear(dynArray_t* arr);
+
+void* dynArrayPush(dynArray_t* arr, const void* elem);
+bool dynArrayPop(dynArray_t* arr, void* out);
+void* dynArrayInsert(dynArray_t* arr, uint32_t idx, const void* elem);
+bool dynArrayRemove(dynArray_t* arr, uint32_t idx, void* out);
+bool dynArraySwapRemove(dynArray_t* arr, uint32_t idx, void* out);
+
+void* dynArrayPushTyped(dynArray_t* arr, const void* elem, size_t elemSize);
+void dynArrayBoundsFail(const dynArray_t* arr, uint32_t idx, size_t elemSize);
+
+//==============================================================================
+// Inline Functions
+//==============================================================================
+
+/**
+ * @brief Get a pointer to the value at an index in an array
+ *
+ * @param arr The array
+ * @param idx The index of the value, which must be less than the length
+ * @return A pointer to the value, which is valid until the array grows
+ */
+static inline void* dynArrayAt(const dynArray_t* arr, uint32_t idx)
+{
+#ifdef CONFIG_CONTAINER_BOUNDS_CHECK
+    if (idx >= arr->length)
+    {
+        dynArrayBoundsFail(arr, idx, arr->elemSize);
+    }
+#endif
+    return arr->data + idx * arr->elemSize;
+}
+
+/**
+ * @brief Get a pointer to the value at an index in an array, checking the type's size too. Use ::DYN_ARRAY_AT()
+ * instead of calling this directly
+ *
+ * @param arr The array
+ * @param idx The index of the value, which must be less than the length
+ * @param elemSize The size of the type the value is accessed as
+ * @return A pointer to the value, which is valid until the array grows
+ */
+static inline void* dynArrayAtTyped(const dynArray_t* arr, uint32_t idx, size_t elemSize)
+{
+#ifdef CONFIG_CONTAINER_BOUNDS_CHECK
+    if (elemSize != arr->elemSize)
+    {
+        dynArrayBoundsFail(arr, idx, elemSize);
+    }
+#endif
+    return dynArrayAt(arr, idx);
+}
+
+#endif
@@ -0,0 +1,274 @@
+//==============================================================================
+// Includes
+//==============================================================================
+
+#include "frameProfiler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <esp_cpu.h>
+#include <esp_heap_caps.h>
+
+#include "hdw-tft.h"
+#include "fill.h"
+#include "font.h"
+#include "fs_font.h"
+#include "palette.h"
+#include "macros.h"
+
+//==============================================================================
+// Defines
+//==============================================================================
+
+/// The number of frames between updates of the stats drawn in the overlay
+#define FRAME_PROFILER_OVERLAY_FRAMES 16
+
+//==============================================================================
+// Function Prototypes
+//==============================================================================
+
+static int compareCycles(const void* a, const void* b);
+
+//==============================================================================
+// Constant Data
+//==============================================================================
+
+/// The name of each phase, for reports and the overlay
+static const char* const phaseNames[FRAME_PHASE_COUNT] = {
+    "Mic", "Audio", "ESP-NOW", "Main", "Draw",
+};
+
+//==============================================================================
+// Variables
+//==============================================================================
+
+/// The FRAME_PROFILER_* flags which are set
+static uint8_t profilerFlags = 0;
+
+/// The cycle count when each phase began
+static uint32_t phaseStart[FRAME_PHASE_COUNT];
+/// The cycles spent in each phase so far this frame
+static uint32_t phaseCycles[FRAME_PHASE_COUNT];
+
+/// The ring of cycles spent in each phase per frame, allocated while recording
+static uint32_t (*frameRing)[FRAME_PHASE_COUNT] = NULL;
+/// The index in the ring the next frame is written to
+static uint32_t ringIdx = 0;
+/// The number of frames in the ring
+static uint32_t ringCount = 0;
+
+/// The font for the overlay, loaded while the overlay is shown
+static font_t* overlayFont = NULL;
+/// The stats drawn in the overlay, updated every FRAME_PROFILER_OVERLAY_FRAMES frames
+static framePhaseStats_t overlayStats[FRAME_PHASE_COUNT];
+
+//==============================================================================
+// Functions
+//==============================================================================
+
+/**
+ * @brief Set what the frame profiler does. Turning off ::FRAME_PROFILER_RECORD clears the recorded frames
+ *
+ * @param flags A bitwise OR of ::FRAME_PROFILER_RECORD, ::FRAME_PROFILER_REPORT, and ::FRAME_PROFILER_OVERLAY.
+ * Reporting and the overlay turn on recording too
+ */
+void setFrameProfilerFlags(uint8_t flags)
+{
+    // Reporting and the overlay show what was recorded
+    if (flags)
+    {
+        flags |= FRAME_PROFILER_RECORD;
+    }
+
+    if ((flags & FRAME_PROFILER_RECORD) && NULL == frameRing)
+    {
+        frameRing = heap_caps_calloc(FRAME_PROFILER_FRAMES, sizeof(*frameRing), MALLOC_CAP_SPIRAM);
+        ringIdx   = 0;
+        ringCount = 0;
+        memset(phaseCycles, 0, sizeof(phaseCycles));
+        memset(overlayStats, 0, sizeof(overlayStats));
+    }
+    else if (!(flags & FRAME_PROFILER_RECORD) && NULL != frameRing)
+    {
+        heap_caps_free(frameRing);
+        frameRing = NULL;
+    }
+
+    if ((flags & FRAME_PROFILER_OVERLAY) && NULL == overlayFont)
+    {
+        overlayFont = heap_caps_calloc(1, sizeof(font_t), MALLOC_CAP_SPIRAM);
+        if (NULL != overlayFont && !loadFont("ibm_vga8.font", overlayFont, true))
+        {
+            heap_caps_free(overlayFont);
+            overlayFont = NULL;
+        }
+    }
+    else if (!(flags & FRAME_PROFILER_OVERLAY) && NULL != overlayFont)
+    {
+        freeFont(overlayFont);
+        heap_caps_free(overlayFont);
+        overlayFont = NULL;
+    }
+
+    // Nothing can be recorded if the ring couldn't be allocated
+    profilerFlags = (NULL != frameRing) ? flags : 0;
+}
+
+/**
+ * @brief Get what the frame profiler does
+ *
+ * @return A bitwise OR of the FRAME_PROFILER_* flags which are set
+ */
+uint8_t getFrameProfilerFlags(void)
+{
+    return profilerFlags;
+}
+
+/**
+ * @brief Start timing a phase of the main loop
+ *
+ * @param phase The phase which is starting
+ */
+void framePhaseBegin(framePhase_t phase)
+{
+    if (profilerFlags)
+    {
+        phaseStart[phase] = esp_cpu_get_cycle_count();
+    }
+}
+
+/**
+ * @brief Stop timing a phase of the main loop and add its cycles to the current frame
+ *
+ * @param phase The phase which ended
+ */
+void framePhaseEnd(framePhase_t phase)
+{
+    if (profilerFlags)
+    {
+        // Unsigned subtraction handles the cycle counter wrapping
+        phaseCycles[phase] += (uint32_t)esp_cpu_get_cycle_count() - phaseStart[phase];
+    }
+}
+
+/**
+ * @brief Store the cycles spent in each phase of the frame which was just drawn, and start counting the next frame
+ */
+void frameProfilerEndFrame(void)
+{
+    if (!profilerFlags)
+    {
+        return;
+    }
+
+    memcpy(frameRing[ringIdx], phaseCycles, sizeof(phaseCycles));
+    memset(phaseCycles, 0, sizeof(phaseCycles));
+    ringIdx   = (ringIdx + 1) % FRAME_PROFILER_FRAMES;
+    ringCount = MIN(ringCount + 1, FRAME_PROFILER_FRAMES);
+
+    if ((profilerFlags & FRAME_PROFILER_OVERLAY) && 0 == ringIdx % FRAME_PROFILER_OVERLAY_FRAMES)
+    {
+        for (framePhase_t phase = 0; phase < FRAME_PHASE_COUNT; phase++)
+        {
+            getFramePhaseStats(phase, &overlayStats[phase]);
+        }
+    }
+
+    if ((profilerFlags & FRAME_PROFILER_REPORT) && 0 == ringIdx)
+    {
+        printFrameProfile();
+    }
+}
+
+/**
+ * @brief Compute the stats for one phase over the frames in the ring
+ *
+ * @param phase The phase to compute stats for
+ * @param[out] stats Written with the stats
+ * @return true if the stats were computed, false if no frames were recorded
+ */
+bool getFramePhaseStats(framePhase_t phase, framePhaseStats_t* stats)
+{
+    memset(stats, 0, sizeof(framePhaseStats_t));
+    if (NULL == frameRing || 0 == ringCount)
+    {
+        return false;
+    }
+
+    uint32_t sorted[FRAME_PROFILER_FRAMES];
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < ringCount; i++)
+    {
+        sorted[i] = frameRing[i][phase];
+        total += sorted[i];
+    }
+    qsort(sorted, ringCount, sizeof(uint32_t), compareCycles);
+
+    stats->minCycles = sorted[0];
+    stats->avgCycles = total / ringCount;
+    stats->maxCycles = sorted[ringCount - 1];
+    // The smallest count which at least 99% of frames are at or under
+    stats->p99Cycles = sorted[(ringCount * 99 + 99) / 100 - 1];
+    stats->avgUs     = stats->avgCycles / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+    stats->maxUs     = stats->maxCycles / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+    return true;
+}
+
+/**
+ * @brief Print the stats for every phase with printf()
+ */
+void printFrameProfile(void)
+{
+    printf("Frame profile over %" PRIu32 " frames, in CPU cycles\n", ringCount);
+    printf("%-8s %10s %10s %10s %10s %8s\n", "Phase", "Min", "Avg", "Max", "P99", "Avg us");
+    for (framePhase_t phase = 0; phase < FRAME_PHASE_COUNT; phase++)
+    {
+        framePhaseStats_t stats;
+        getFramePhaseStats(phase, &stats);
+        printf("%-8s %10" PRIu32 " %10" PRIu32 " %10" PRIu32 " %10" PRIu32 " %8" PRIu32 "\n", phaseNames[phase],
+               stats.minCycles, stats.avgCycles, stats.maxCycles, stats.p99Cycles, stats.avgUs);
+    }
+}
+
+/**
+ * @brief Draw the average and maximum time for each phase over the top of the display, if the overlay is shown. This
+ * is called by the system right before the display is drawn
+ */
+void drawFrameProfilerOverlay(void)
+{
+    if (!(profilerFlags & FRAME_PROFILER_OVERLAY) || NULL == overlayFont)
+    {
+        return;
+    }
+
+    int16_t lineHeight = overlayFont->height + 2;
+    fillDisplayArea(0, 0, TFT_WIDTH, lineHeight * (FRAME_PHASE_COUNT + 1) + 2, c000);
+
+    int16_t yOff = 2;
+    drawText(overlayFont, c555, "Phase     Avg us  Max us", 2, yOff);
+    for (framePhase_t phase = 0; phase < FRAME_PHASE_COUNT; phase++)
+    {
+        yOff += lineHeight;
+        char line[32];
+        snprintf(line, sizeof(line), "%-8s %7" PRIu32 " %7" PRIu32, phaseNames[phase], overlayStats[phase].avgUs,
+                 overlayStats[phase].maxUs);
+        drawText(overlayFont, c555, line, 2, yOff);
+    }
+}
+
+/**
+ * @brief Compare two cycle counts for qsort()
+ *
+ * @param a A pointer to the first count
+ * @param b A pointer to the second count
+ * @return A negative number if a is less than b, 0 if they are equal, or a positive number if a is greater than b
+ */
+static int compareCycles(const void* a, const void* b)
+{
+    uint32_t cA = *(const uint32_t*)a;
+    uint32_t cB = *(const uint32_t*)b;
+    return (cA > cB) - (cA < cB);
+}
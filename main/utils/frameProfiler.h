@@ -0,0 +1,118 @@
+/*! \file frameProfiler.h
+ *
+ * \section frameProfiler_design Design Philosophy
+ *
+ * The system's main loop does a few different kinds of work for each frame. It processes microphone samples, checks
+ * the DAC for underruns, delivers received ESP-NOW packets, calls the Swadge mode's main loop, and draws the display.
+ * When a mode runs slowly, the frame profiler shows which of these phases the time is going to.
+ *
+ * Each phase is timed with the CPU's cycle counter, which is cheap enough to read around every phase on every loop.
+ * The main loop runs many times per frame, so cycles are added up for each phase until the frame is drawn. Then the
+ * totals are stored in a ring of the last ::FRAME_PROFILER_FRAMES frames. The minimum, average, maximum, and 99th
+ * percentile for each phase are computed from the ring.
+ *
+ * When recording is off, the profiler only checks a flag around each phase.
+ *
+ * \section frameProfiler_usage Usage
+ *
+ * The system times the phases of the main loop, so Swadge modes don't need to call anything. The profiler is
+ * controlled with setFrameProfilerFlags():
+ * - ::FRAME_PROFILER_RECORD records the cycles spent in each phase.
+ * - ::FRAME_PROFILER_REPORT prints the stats with printf() every ::FRAME_PROFILER_FRAMES frames. On a Swadge, this
+ *   goes out over USB.
+ * - ::FRAME_PROFILER_OVERLAY draws the average and maximum time for each phase over the top of the display.
+ *
+ * On a Swadge, enable \c CONFIG_FRAME_PROFILER in menuconfig to record and report from boot, and
+ * \c CONFIG_FRAME_PROFILER_OVERLAY to draw the overlay too. In the emulator, use the \c profile console command.
+ *
+ * getFramePhaseStats() may be called to get the stats for a phase directly, and printFrameProfile() prints them all.
+ *
+ * \section frameProfiler_example Example
+ *
+ * \code{.c}
+ * // Record each phase and draw the overlay
+ * setFrameProfilerFlags(FRAME_PROFILER_RECORD | FRAME_PROFILER_OVERLAY);
+ *
+ * // Check if the mode's main loop takes more than half the frame
+ * framePhaseStats_t stats;
+ * if (getFramePhaseStats(FRAME_PHASE_MAIN_LOOP, &stats) && stats.avgUs > getFrameRateUs() / 2)
+ * {
+ *     printf("The main loop is slow\n");
+ * }
+ * \endcode
+ */
+
+#ifndef _FRAME_PROFILER_H_
+#define _FRAME_PROFILER_H_
+
+//==============================================================================
+// Includes
+//==============================================================================
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//==============================================================================
+// Defines
+//==============================================================================
+
+/// The number of frames kept in the ring. Stats are computed over these frames
+#define FRAME_PROFILER_FRAMES 128
+
+/// Record the cycles spent in each phase
+#define FRAME_PROFILER_RECORD (1 << 0)
+/// printf() the stats every ::FRAME_PROFILER_FRAMES frames
+#define FRAME_PROFILER_REPORT (1 << 1)
+/// Draw the stats over the top of the display
+#define FRAME_PROFILER_OVERLAY (1 << 2)
+
+//==============================================================================
+// Enums
+//==============================================================================
+
+/**
+ * @brief The phases of the main loop which are timed
+ */
+typedef enum
+{
+    FRAME_PHASE_MIC,       ///< Filtering microphone samples and calling ::swadgeMode_t.fnAudioCallback
+    FRAME_PHASE_AUDIO,     ///< Checking the DAC for underruns
+    FRAME_PHASE_ESP_NOW,   ///< Delivering received ESP-NOW packets
+    FRAME_PHASE_MAIN_LOOP, ///< Calling ::swadgeMode_t.fnFixedUpdate and ::swadgeMode_t.fnMainLoop
+    FRAME_PHASE_DRAW,      ///< Drawing the display
+    FRAME_PHASE_COUNT,     ///< The number of phases
+} framePhase_t;
+
+//==============================================================================
+// Structs
+//==============================================================================
+
+/**
+ * @brief The stats for one phase over the frames in the ring
+ */
+typedef struct
+{
+    uint32_t minCycles; ///< The fewest cycles spent in this phase in one frame
+    uint32_t avgCycles; ///< The average cycles spent in this phase per frame
+    uint32_t maxCycles; ///< The most cycles spent in this phase in one frame
+    uint32_t p99Cycles; ///< 99% of frames spent this many cycles or fewer in this phase
+    uint32_t avgUs;     ///< The average time spent in this phase per frame, in microseconds
+    uint32_t maxUs;     ///< The most time spent in this phase in one frame, in microseconds
+} framePhaseStats_t;
+
+//==============================================================================
+// Function Prototypes
+//==============================================================================
+
+void setFrameProfilerFlags(uint8_t flags);
+uint8_t getFrameProfilerFlags(void);
+
+void framePhaseBegin(framePhase_t phase);
+void framePhaseEnd(framePhase_t phase);
+void frameProfilerEndFrame(void);
+
+bool getFramePhaseStats(framePhase_t phase, framePhaseStats_t* stats);
+void printFrameProfile(void);
+void drawFrameProfilerOverlay(void);
+
+#endif
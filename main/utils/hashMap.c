@@ -11,6 +11,8 @@
 #include <esp_log.h>
 #include <esp_heap_caps.h>
 
+#include "macros.h"
+
 //==============================================================================
 // Defines
 //==============================================================================
@@ -92,6 +94,8 @@ static hashNode_t* bucketPut(hashMap_t* map, hashBucket_t* bucket, const void* k
                              int* count);
 static hashNode_t bucketRemove(hashMap_t* map, hashBucket_t* bucket, hashNode_t* node, node_t* multiNode, int* count);
 static bool hashIterNext(const hashMap_t* map, hashIterator_t* iter);
+static void* hashAllocNode(const hashMap_t* map, size_t size);
+static void hashFreeNode(const hashMap_t* map, void* node);
 
 //==============================================================================
 // Functions
@@ -193,7 +197,8 @@ static hashNode_t* hashFindNode(hashMap_t* map, const void* key, uint32_t* hashO
 
     if (bucket->hasMulti)
     {
-        node = bucket->multi.first->val;
+        listNodeOut = bucket->multi.first;
+        node        = listNodeOut->val;
     }
     else
     {
@@ -204,7 +209,8 @@ static hashNode_t* hashFindNode(hashMap_t* map, const void* key, uint32_t* hashO
     if (node->key != NULL && (node->hash != hash || !eqFn(node->key, key)))
     {
         // Node doesn't match!
-        node = NULL;
+        node        = NULL;
+        listNodeOut = NULL;
 
         if (bucket->hasMulti)
         {
@@ -301,18 +307,20 @@ static hashNode_t* bucketPut(hashMap_t* map, hashBucket_t* bucket, const void* k
             HASH_LOG("Bucket collision; converting bucket to multi-value");
 
             // Copy the first node itself
-            newNode = heap_caps_malloc(sizeof(hashNode_t), MALLOC_CAP_8BIT);
+            newNode = hashAllocNode(map, sizeof(hashNode_t));
             memcpy(newNode, node, sizeof(hashNode_t));
 
             // Init the list data
             bucket->hasMulti = true;
             memset(&bucket->multi, 0, sizeof(list_t));
+            bucket->multi.pool = map->pool;
 
             // And add the new first node to the list
             push(&bucket->multi, newNode);
 
             // Now, we should also add an empty node
-            newNode = heap_caps_calloc(1, sizeof(hashNode_t), MALLOC_CAP_8BIT);
+            newNode = hashAllocNode(map, sizeof(hashNode_t));
+            memset(newNode, 0, sizeof(hashNode_t));
             push(&bucket->multi, newNode);
 
             if (count)
@@ -350,7 +358,8 @@ static hashNode_t* bucketPut(hashMap_t* map, hashBucket_t* bucket, const void* k
             if (node == NULL)
             {
                 // Gotta add one
-                node = heap_caps_calloc(1, sizeof(hashNode_t), MALLOC_CAP_8BIT);
+                node = hashAllocNode(map, sizeof(hashNode_t));
+                memset(node, 0, sizeof(hashNode_t));
                 push(&bucket->multi, node);
 
                 if (count)
@@ -407,7 +416,7 @@ static hashNode_t bucketRemove(hashMap_t* map, hashBucket_t* bucket, hashNode_t*
             }
             result = *value;
         }
-        heap_caps_free(value);
+        hashFreeNode(map, value);
         value = NULL;
 
         // Un-multi-ify the bucket if its list is empty
@@ -697,6 +706,7 @@ void hashInit(hashMap_t* map, int initialSize)
     map->values   = heap_caps_calloc(map->size, sizeof(hashBucket_t), MALLOC_CAP_8BIT);
     map->hashFunc = NULL;
     map->eqFunc   = NULL;
+    map->pool     = NULL;
 }
 
 /**
@@ -715,6 +725,34 @@ void hashInitBin(hashMap_t* map, int initialSize, hashFunction_t hashFunc, eqFun
     map->eqFunc   = eqFunc;
 }
 
+/**
+ * @brief Allocate the hash map's internal nodes from a pool instead of one at a time from the heap. This makes adding
+ * colliding keys and removing them not allocate from the heap once the pool is big enough.
+ *
+ * Iterator states are still allocated from the heap, because an iterator may be reset after its map is deinitialized.
+ *
+ * This must be called right after hashInit() or hashInitBin(), before anything is added. The pool is freed by
+ * hashDeinit().
+ *
+ * @param map The map to allocate nodes for from a pool
+ * @param chunkLen The number of nodes to allocate at once when the pool runs out
+ */
+void hashEnablePool(hashMap_t* map, uint16_t chunkLen)
+{
+    if (NULL != map->pool || 0 != map->count)
+    {
+        return;
+    }
+
+    map->pool = heap_caps_malloc(sizeof(nodePool_t), MALLOC_CAP_8BIT);
+    if (NULL != map->pool)
+    {
+        // Hash nodes and the list nodes holding them both come from the same pool
+        size_t nodeSize = MAX(sizeof(hashNode_t), sizeof(node_t));
+        nodePoolInit(map->pool, nodeSize, chunkLen, MALLOC_CAP_8BIT);
+    }
+}
+
 /**
  * @brief Deinitialize and free all memory associated with the given hash map
  *
@@ -722,7 +760,14 @@ void hashInitBin(hashMap_t* map, int initialSize, hashFunction_t hashFunc, eqFun
  */
 void hashDeinit(hashMap_t* map)
 {
-    if (map->count > 0)
+    if (NULL != map->pool)
+    {
+        // Every node is in the pool, so they're all freed at once
+        nodePoolDeinit(map->pool);
+        heap_caps_free(map->pool);
+        map->pool = NULL;
+    }
+    else if (map->count > 0)
     {
         for (hashBucket_t* bucket = map->values; bucket < (map->values + map->size); bucket++)
         {
@@ -958,6 +1003,40 @@ void hashIterReset(hashIterator_t* iterator)
     iterator->value  = NULL;
 }
 
+/**
+ * @brief Allocate one of the hash map's internal nodes, from its pool if it has one or from the heap if it doesn't
+ *
+ * @param map The hash map the node is for
+ * @param size The size of the node, which every node in the pool is big enough for
+ * @return The node, which is not initialized
+ */
+static void* hashAllocNode(const hashMap_t* map, size_t size)
+{
+    if (NULL != map->pool)
+    {
+        return nodePoolAlloc(map->pool);
+    }
+    return heap_caps_malloc(size, MALLOC_CAP_8BIT);
+}
+
+/**
+ * @brief Free one of the hash map's internal nodes, back to wherever hashAllocNode() got it from
+ *
+ * @param map The hash map the node was for
+ * @param node The node to free
+ */
+static void hashFreeNode(const hashMap_t* map, void* node)
+{
+    if (NULL != map->pool)
+    {
+        nodePoolFree(map->pool, node);
+    }
+    else
+    {
+        heap_caps_free(node);
+    }
+}
+
 /**
  * @brief Prints out a detailed report on the hash map state.
  *
@@ -44,6 +44,10 @@
  *
  * hashRemove() removes an entry from the map by its key.
  *
+ * hashEnablePool() may be called right after initializing a hash map to allocate its internal nodes from a
+ * ::nodePool_t instead of one at a time from the heap. This helps when colliding keys are added and removed every
+ * frame.
+ *
  * hashDeinit() deallocates a hash map and all its entries.
  *
  * hashIterate() can be used to loop over a hash map's entries.
@@ -426,6 +430,9 @@ typedef struct
 
     /// @brief The key equality function to use, or NULL to use strEq()
     eqFunction_t eqFunc;
+
+    /// @brief The pool to allocate internal nodes from, or NULL to allocate them from the heap. See hashEnablePool()
+    nodePool_t* pool;
 } hashMap_t;
 
 // Default hash functions
@@ -450,6 +457,7 @@ void* hashRemoveBin(hashMap_t* map, const void* key);
 
 void hashInit(hashMap_t* map, int initialSize);
 void hashInitBin(hashMap_t* map, int initialSize, hashFunction_t hashFunc, eqFunction_t eqFunc);
+void hashEnablePool(hashMap_t* map, uint16_t chunkLen);
 void hashDeinit(hashMap_t* map);
 
 bool hashIterate(const hashMap_t* map, hashIterator_t* iterator);
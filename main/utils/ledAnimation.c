@@ -0,0 +1,285 @@
+//==============================================================================
+// Includes
+//==============================================================================
+
+#include "ledAnimation.h"
+
+#include <string.h>
+
+#include <esp_timer.h>
+
+//==============================================================================
+// Enums
+//==============================================================================
+
+/**
+ * @brief The kind of animation being played
+ */
+typedef enum
+{
+    LED_ANIM_NONE,      ///< Nothing is playing
+    LED_ANIM_KEYFRAMES, ///< A keyframe program is playing
+    LED_ANIM_EFFECT,    ///< An effect program is playing
+} ledAnimType_t;
+
+//==============================================================================
+// Function Declarations
+//==============================================================================
+
+static void ledAnimStart(uint32_t periodUs);
+static void ledAnimTimerCb(void* arg);
+static bool ledAnimKeyframesAt(int64_t timeUs, led_t* leds);
+
+//==============================================================================
+// Variables
+//==============================================================================
+
+/// The timer which advances the animation, created the first time an animation is played
+static esp_timer_handle_t ledAnimTimer = NULL;
+
+/// The kind of animation being played
+static ledAnimType_t animType = LED_ANIM_NONE;
+/// The time the animation started, from esp_timer_get_time()
+static int64_t animStartUs = 0;
+
+/// The keyframe program being played
+static const ledKeyframe_t* animFrames = NULL;
+/// The number of keyframes in the program
+static uint16_t animNumFrames = 0;
+/// true if the keyframe program loops, false if it stops on the last keyframe
+static bool animLoop = false;
+/// The total length of the keyframe program, in microseconds
+static int64_t animTotalUs = 0;
+
+/// The effect program being played
+static ledEffectFn_t animEffect = NULL;
+/// The argument for the effect program
+static void* animArg = NULL;
+
+//==============================================================================
+// Functions
+//==============================================================================
+
+/**
+ * @brief Play a keyframe program. This replaces any animation which is already playing.
+ *
+ * @param frames The keyframes to play. These must stay valid until the animation is stopped
+ * @param numFrames The number of keyframes
+ * @param loop true to play the keyframes forever, false to stop on the last keyframe. When looping, the last keyframe
+ * fades into the first one
+ * @param periodUs The time between animation frames, in microseconds
+ */
+void ledAnimPlayKeyframes(const ledKeyframe_t* frames, uint16_t numFrames, bool loop, uint32_t periodUs)
+{
+    ledAnimStop();
+
+    if (0 == numFrames)
+    {
+        return;
+    }
+
+    // A callback which was already dispatched when the last animation stopped waits for this one to start
+    ledLock();
+
+    animFrames    = frames;
+    animNumFrames = numFrames;
+    animLoop      = loop;
+
+    // Add up the length of the program. A one-shot program never fades out of the last keyframe
+    animTotalUs = 0;
+    for (uint16_t i = 0; i < numFrames; i++)
+    {
+        animTotalUs += frames[i].holdUs;
+        if (loop || i < numFrames - 1)
+        {
+            animTotalUs += frames[i].fadeUs;
+        }
+    }
+
+    animType = LED_ANIM_KEYFRAMES;
+    ledAnimStart(periodUs);
+
+    ledUnlock();
+}
+
+/**
+ * @brief Play an effect program. This replaces any animation which is already playing.
+ *
+ * @param effect The function which computes the LEDs for each frame
+ * @param arg An argument passed to the effect function. This must stay valid until the animation is stopped
+ * @param periodUs The time between animation frames, in microseconds
+ */
+void ledAnimPlayEffect(ledEffectFn_t effect, void* arg, uint32_t periodUs)
+{
+    ledAnimStop();
+
+    if (NULL == effect)
+    {
+        return;
+    }
+
+    // A callback which was already dispatched when the last animation stopped waits for this one to start
+    ledLock();
+
+    animEffect = effect;
+    animArg    = arg;
+    animType   = LED_ANIM_EFFECT;
+    ledAnimStart(periodUs);
+
+    ledUnlock();
+}
+
+/**
+ * @brief Stop the animation. The LEDs keep showing the last frame. This is safe to call when nothing is playing.
+ *
+ * When this returns, the animation's callback isn't running and won't run again, so the keyframes or the effect's
+ * argument may be freed.
+ */
+void ledAnimStop(void)
+{
+    if (NULL != ledAnimTimer)
+    {
+        esp_timer_stop(ledAnimTimer);
+    }
+
+    // esp_timer_stop() doesn't wait for a callback which already started. The callback holds the LED lock, so taking it
+    // waits for the callback to finish. A callback which starts after this sees that nothing is playing
+    ledLock();
+    animType = LED_ANIM_NONE;
+    ledUnlock();
+}
+
+/**
+ * @brief Check if an animation is playing
+ *
+ * @return true if an animation is playing, false if it was stopped or a one-shot keyframe program finished
+ */
+bool ledAnimIsPlaying(void)
+{
+    return LED_ANIM_NONE != animType;
+}
+
+/**
+ * @brief Show the first frame of the animation and start the timer to advance it
+ *
+ * @param periodUs The time between animation frames, in microseconds
+ */
+static void ledAnimStart(uint32_t periodUs)
+{
+    if (NULL == ledAnimTimer)
+    {
+        esp_timer_create_args_t ledAnimTimerArgs = {
+            .callback              = ledAnimTimerCb,
+            .arg                   = NULL,
+            .dispatch_method       = ESP_TIMER_TASK,
+            .name                  = "ledAnim",
+            .skip_unhandled_events = true,
+        };
+        esp_timer_create(&ledAnimTimerArgs, &ledAnimTimer);
+    }
+
+    animStartUs = esp_timer_get_time();
+    ledAnimTimerCb(NULL);
+
+    // Only start the timer if the first frame didn't already finish the animation
+    if (LED_ANIM_NONE != animType)
+    {
+        esp_timer_start_periodic(ledAnimTimer, periodUs ? periodUs : LED_ANIM_DEFAULT_PERIOD_US);
+    }
+}
+
+/**
+ * @brief Timer callback which computes the current frame of the animation and sets the LEDs to it
+ *
+ * @param arg Unused
+ */
+static void ledAnimTimerCb(void* arg)
+{
+    // Hold the LED lock while the animation's data is used, so ledAnimStop() can wait for this to finish
+    ledLock();
+
+    led_t leds[CONFIG_NUM_LEDS];
+    int64_t timeUs = esp_timer_get_time() - animStartUs;
+
+    switch (animType)
+    {
+        case LED_ANIM_KEYFRAMES:
+        {
+            if (!ledAnimKeyframesAt(timeUs, leds))
+            {
+                // A one-shot program finished, show the last keyframe and stop
+                ledAnimStop();
+            }
+            break;
+        }
+        case LED_ANIM_EFFECT:
+        {
+            animEffect(leds, CONFIG_NUM_LEDS, (uint32_t)timeUs, animArg);
+            break;
+        }
+        case LED_ANIM_NONE:
+        default:
+        {
+            ledUnlock();
+            return;
+        }
+    }
+
+    // This only transmits if the LEDs changed
+    setLeds(leds, CONFIG_NUM_LEDS);
+    ledUnlock();
+}
+
+/**
+ * @brief Compute the LEDs for a point in time in the keyframe program
+ *
+ * @param timeUs The time since the program started, in microseconds
+ * @param[out] leds Written with the LEDs for this point in time
+ * @return true if the program is still playing, false if a one-shot program is past its end
+ */
+static bool ledAnimKeyframesAt(int64_t timeUs, led_t* leds)
+{
+    if (animLoop && animTotalUs > 0)
+    {
+        timeUs %= animTotalUs;
+    }
+
+    for (uint16_t i = 0; i < animNumFrames; i++)
+    {
+        const ledKeyframe_t* frame = &animFrames[i];
+        bool last                  = (i == animNumFrames - 1);
+
+        // Holding this keyframe
+        if (timeUs < frame->holdUs)
+        {
+            memcpy(leds, frame->leds, sizeof(frame->leds));
+            return true;
+        }
+        timeUs -= frame->holdUs;
+
+        // A one-shot program never fades out of the last keyframe
+        if (last && !animLoop)
+        {
+            break;
+        }
+
+        // Fading into the next keyframe
+        if (timeUs < frame->fadeUs)
+        {
+            const ledKeyframe_t* next = last ? &animFrames[0] : &animFrames[i + 1];
+            int32_t t                 = (timeUs * 256) / frame->fadeUs;
+            for (uint8_t l = 0; l < CONFIG_NUM_LEDS; l++)
+            {
+                leds[l].r = frame->leds[l].r + (((next->leds[l].r - frame->leds[l].r) * t) >> 8);
+                leds[l].g = frame->leds[l].g + (((next->leds[l].g - frame->leds[l].g) * t) >> 8);
+                leds[l].b = frame->leds[l].b + (((next->leds[l].b - frame->leds[l].b) * t) >> 8);
+            }
+            return true;
+        }
+        timeUs -= frame->fadeUs;
+    }
+
+    // Past the end of a one-shot program, stay on the last keyframe
+    memcpy(leds, animFrames[animNumFrames - 1].leds, sizeof(animFrames[0].leds));
+    return animLoop;
+}
@@ -0,0 +1,115 @@
+/*! \file ledAnimation.h
+ *
+ * \section ledAnimation_design Design Philosophy
+ *
+ * Swadge modes usually animate LEDs by computing and setting new values every frame in their main loop. This ties the
+ * animation to the frame rate, and a slow frame stutters the LEDs along with it.
+ *
+ * Instead, an LED animation can be given to this engine, which advances it on its own esp_timer. Each tick computes the
+ * frame from the time since the animation started, not from the number of ticks, so a late tick never slows the
+ * animation down. Each frame is passed to setLeds(), which only transmits it if the LEDs actually change.
+ *
+ * There are two kinds of animations:
+ * - A keyframe program is a precomputed array of ::ledKeyframe_t. Each keyframe is held for a time, then linearly faded
+ *   into the next keyframe. Keyframe programs may loop forever or play once and stop on the last keyframe.
+ * - An effect program is an ::ledEffectFn_t which computes the LEDs for any point in time.
+ *
+ * Only one animation plays at a time. Playing a new animation replaces the current one.
+ *
+ * \warning On the Swadge, animations are advanced from the esp_timer task, not the main loop. Each frame is computed
+ * and set while holding the LED lock, see ledLock(). setLeds() may still be called while an animation is playing, but
+ * the next animation frame will overwrite it. If the main loop changes data which an effect function reads, it should
+ * hold ledLock() while doing so. ledAnimStop() waits for a frame which is being computed, so the animation's data may
+ * be freed after it returns.
+ *
+ * \section ledAnimation_usage Usage
+ *
+ * Call ledAnimPlayKeyframes() to play a keyframe program or ledAnimPlayEffect() to play an effect program. The
+ * keyframes, or the effect's argument, must stay valid until the animation is stopped.
+ *
+ * Call ledAnimStop() to stop the animation. The LEDs keep showing the last frame. The system stops any animation before
+ * a Swadge mode exits.
+ *
+ * ledAnimIsPlaying() may be called to check if an animation is still playing, like a one-shot keyframe program.
+ *
+ * \section ledAnimation_example Example
+ *
+ * \code{.c}
+ * // Flash red, then fade to blue and back, forever
+ * static const ledKeyframe_t flash[] = {
+ *     {
+ *         .leds   = {[0 ... CONFIG_NUM_LEDS - 1] = {.r = 0xFF}},
+ *         .holdUs = 100000,
+ *         .fadeUs = 500000,
+ *     },
+ *     {
+ *         .leds   = {[0 ... CONFIG_NUM_LEDS - 1] = {.b = 0xFF}},
+ *         .holdUs = 0,
+ *         .fadeUs = 500000,
+ *     },
+ * };
+ * ledAnimPlayKeyframes(flash, ARRAY_SIZE(flash), true, LED_ANIM_DEFAULT_PERIOD_US);
+ *
+ * // A green light chasing around the Swadge
+ * static void chase(led_t* leds, uint8_t numLeds, uint32_t timeUs, void* arg)
+ * {
+ *     memset(leds, 0, numLeds * sizeof(led_t));
+ *     leds[(timeUs / 100000) % numLeds].g = 0xFF;
+ * }
+ * ledAnimPlayEffect(chase, NULL, LED_ANIM_DEFAULT_PERIOD_US);
+ * \endcode
+ */
+
+#ifndef _LED_ANIMATION_H_
+#define _LED_ANIMATION_H_
+
+//==============================================================================
+// Includes
+//==============================================================================
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hdw-led.h"
+
+//==============================================================================
+// Defines
+//==============================================================================
+
+/// The default time between animation frames, about 60 frames per second
+#define LED_ANIM_DEFAULT_PERIOD_US 16667
+
+//==============================================================================
+// Structs
+//==============================================================================
+
+/**
+ * @brief A function which computes the LEDs for a point in an effect program
+ *
+ * @param leds The LEDs to write
+ * @param numLeds The number of LEDs to write
+ * @param timeUs The time since the effect started playing, in microseconds
+ * @param arg The argument given to ledAnimPlayEffect()
+ */
+typedef void (*ledEffectFn_t)(led_t* leds, uint8_t numLeds, uint32_t timeUs, void* arg);
+
+/**
+ * @brief One frame of a keyframe program
+ */
+typedef struct
+{
+    led_t leds[CONFIG_NUM_LEDS]; ///< The LEDs to show for this keyframe
+    uint32_t holdUs;             ///< How long to show this keyframe, in microseconds
+    uint32_t fadeUs;             ///< How long to fade into the next keyframe after holding, in microseconds
+} ledKeyframe_t;
+
+//==============================================================================
+// Function Prototypes
+//==============================================================================
+
+void ledAnimPlayKeyframes(const ledKeyframe_t* frames, uint16_t numFrames, bool loop, uint32_t periodUs);
+void ledAnimPlayEffect(ledEffectFn_t effect, void* arg, uint32_t periodUs);
+void ledAnimStop(void);
+bool ledAnimIsPlaying(void);
+
+#endif
@@ -9,6 +9,9 @@
 #include <esp_log.h>
 #include <esp_random.h>
 #include <esp_heap_caps.h>
+#ifdef BENCHMARK_LIST
+    #include <esp_timer.h>
+#endif
 
 #include "linked_list.h"
 
@@ -22,10 +25,19 @@
     #define VALIDATE_LIST(func, line, nl, list, target)
 #endif
 
+#ifdef BENCHMARK_LIST
+    /// The number of frames listBenchmark() runs
+    #define LIST_BENCH_FRAMES 1000
+    /// The number of nodes listBenchmark() pushes and shifts each frame
+    #define LIST_BENCH_NODES 64
+#endif
+
 //==============================================================================
 // Function Prototypes
 //==============================================================================
 
+static node_t* allocNode(list_t* list);
+static void freeNode(list_t* list, node_t* node);
 #ifdef TEST_LIST
 static void validateList(const char* func, int line, bool nl, list_t* list, node_t* target);
 #endif
@@ -43,7 +55,7 @@ static void validateList(const char* func, int line, bool nl, list_t* list, node
 void push(list_t* list, void* val)
 {
     VALIDATE_LIST(__func__, __LINE__, true, list, val);
-    node_t* newLast = heap_caps_malloc(sizeof(node_t), MALLOC_CAP_8BIT);
+    node_t* newLast = allocNode(list);
     newLast->val    = val;
     newLast->next   = NULL;
     newLast->prev   = list->last;
@@ -94,7 +106,7 @@ void* pop(list_t* list)
 
         // Get the last node val, then free it and update length
         retval = target->val;
-        heap_caps_free(target);
+        freeNode(list, target);
         list->length--;
     }
 
@@ -111,7 +123,7 @@ void* pop(list_t* list)
 void unshift(list_t* list, void* val)
 {
     VALIDATE_LIST(__func__, __LINE__, true, list, val);
-    node_t* newFirst = heap_caps_malloc(sizeof(node_t), MALLOC_CAP_8BIT);
+    node_t* newFirst = allocNode(list);
     newFirst->val    = val;
     newFirst->next   = list->first;
     newFirst->prev   = NULL;
@@ -162,7 +174,7 @@ void* shift(list_t* list)
 
         // Get the first node val, then free it and update length
         retval = target->val;
-        heap_caps_free(target);
+        freeNode(list, target);
         list->length--;
     }
 
@@ -194,7 +206,7 @@ bool addIdx(list_t* list, void* val, uint16_t index)
     // Else if the index we're trying to add to is before the end of the list
     else if (index < list->length - 1)
     {
-        node_t* newNode = heap_caps_malloc(sizeof(node_t), MALLOC_CAP_8BIT);
+        node_t* newNode = allocNode(list);
         newNode->val    = val;
         newNode->next   = NULL;
         newNode->prev   = NULL;
@@ -249,7 +261,7 @@ void addBefore(list_t* list, void* val, node_t* entry)
     else
     {
         node_t* prev    = entry->prev;
-        node_t* newNode = heap_caps_malloc(sizeof(node_t), MALLOC_CAP_8BIT);
+        node_t* newNode = allocNode(list);
         newNode->val    = val;
         newNode->prev   = prev;
         newNode->next   = entry;
@@ -288,7 +300,7 @@ void addAfter(list_t* list, void* val, node_t* entry)
     else
     {
         node_t* next    = entry->next;
-        node_t* newNode = heap_caps_malloc(sizeof(node_t), MALLOC_CAP_8BIT);
+        node_t* newNode = allocNode(list);
         newNode->val    = val;
         newNode->prev   = entry;
         newNode->next   = next;
@@ -350,7 +362,7 @@ void* removeIdx(list_t* list, uint16_t index)
         current->next       = target->next;
         current->next->prev = current;
 
-        heap_caps_free(target);
+        freeNode(list, target);
         target = NULL;
 
         list->length--;
@@ -416,7 +428,7 @@ void* removeEntry(list_t* list, node_t* entry)
     VALIDATE_LIST(__func__, __LINE__, false, list, entry);
 
     // free the memory
-    heap_caps_free(entry);
+    freeNode(list, entry);
 
     // Return the value
     return retVal;
@@ -437,6 +449,39 @@ void clear(list_t* list)
     VALIDATE_LIST(__func__, __LINE__, false, list, NULL);
 }
 
+/**
+ * @brief Allocate a node for a list, from the list's pool if it has one or from the heap if it doesn't
+ *
+ * @param list The list the node is for
+ * @return The node, which is not initialized
+ */
+static node_t* allocNode(list_t* list)
+{
+    if (NULL != list->pool)
+    {
+        return nodePoolAlloc(list->pool);
+    }
+    return heap_caps_malloc(sizeof(node_t), MALLOC_CAP_8BIT);
+}
+
+/**
+ * @brief Free a node which was removed from a list, back to wherever allocNode() got it from
+ *
+ * @param list The list the node was in
+ * @param node The node to free
+ */
+static void freeNode(list_t* list, node_t* node)
+{
+    if (NULL != list->pool)
+    {
+        nodePoolFree(list->pool, node);
+    }
+    else
+    {
+        heap_caps_free(node);
+    }
+}
+
 #ifdef TEST_LIST
 
 /**
@@ -581,4 +626,47 @@ void listTester(void)
     ESP_LOGD("LV", "List validated");
 }
 
-#endif
\ No newline at end of file
+#endif
+
+#ifdef BENCHMARK_LIST
+
+/**
+ * @brief Time pushing and shifting nodes with and without a node pool, and print the results
+ *
+ * Each frame pushes a batch of nodes and then shifts them all off, like a per-frame collision or packet queue.
+ */
+void listBenchmark(void)
+{
+    nodePool_t pool;
+    nodePoolInit(&pool, sizeof(node_t), 32, MALLOC_CAP_8BIT);
+
+    for (int usePool = 0; usePool < 2; usePool++)
+    {
+        list_t benchList = {0};
+        benchList.pool   = usePool ? &pool : NULL;
+
+        int64_t tStart = esp_timer_get_time();
+        for (int frame = 0; frame < LIST_BENCH_FRAMES; frame++)
+        {
+            for (int i = 0; i < LIST_BENCH_NODES; i++)
+            {
+                push(&benchList, NULL);
+            }
+            while (benchList.length)
+            {
+                shift(&benchList);
+            }
+        }
+        int64_t tElapsed = esp_timer_get_time() - tStart;
+
+        // Without a pool, every push is a heap allocation
+        uint32_t heapAllocs = usePool ? pool.numHeapAllocs : (LIST_BENCH_FRAMES * LIST_BENCH_NODES);
+        printf("%s: %" PRIu32 " heap allocations, %.2f per frame, %" PRId64 " ns per push and shift\n",
+               usePool ? "Pool" : "Heap", heapAllocs, heapAllocs / (float)LIST_BENCH_FRAMES,
+               (tElapsed * 1000) / (LIST_BENCH_FRAMES * LIST_BENCH_NODES));
+    }
+
+    nodePoolDeinit(&pool);
+}
+
+#endif
@@ -21,6 +21,9 @@
  *
  * Links are allocated, so when done with a list, be sure to call clear() when done.
  *
+ * Links are allocated from the heap one at a time. If a list adds and removes a lot of values, like every frame, set
+ * ::list_t.pool to a ::nodePool_t before adding anything so that links are reused instead. See nodePool.h.
+ *
  * \section linked_list_example Example
  *
  * Creating an empty list:
@@ -69,6 +72,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "nodePool.h"
+
 /**
  * @brief A node in a doubly linked list with pointers to the previous and next values (which may be NULL), and a \c
  * void* to arbritray data
@@ -85,9 +90,10 @@ typedef struct node
  */
 typedef struct
 {
-    node_t* first; ///< The first node in the list
-    node_t* last;  ///< The last node in the list
-    int length;    ///< The number of nodes in the list
+    node_t* first;    ///< The first node in the list
+    node_t* last;     ///< The last node in the list
+    int length;       ///< The number of nodes in the list
+    nodePool_t* pool; ///< The pool to allocate nodes from, or NULL to allocate them from the heap
 } list_t;
 
 void push(list_t* list, void* val);
@@ -106,4 +112,9 @@ void clear(list_t* list);
 void listTester(void);
 #endif
 
+#ifdef BENCHMARK_LIST
+// Compare adding and removing nodes with and without a node pool
+void listBenchmark(void);
+#endif
+
 #endif
@@ -0,0 +1,147 @@
+//==============================================================================
+// Includes
+//==============================================================================
+
+#include "micRing.h"
+
+#include <string.h>
+
+#include "hdw-mic.h"
+#include "macros.h"
+
+//==============================================================================
+// Defines
+//==============================================================================
+
+#define MIC_RING_MASK (MIC_RING_SIZE - 1)
+
+//==============================================================================
+// Constant Data
+//==============================================================================
+
+/// The gain for each mic gain setting. This must have MAX_MIC_GAIN + 1 elements
+static const uint16_t micGains[] = {
+    32, 45, 64, 90, 128, 181, 256, 362,
+};
+
+//==============================================================================
+// Variables
+//==============================================================================
+
+/// The ring of filtered samples, stored twice back to back so any window of up to MIC_RING_SIZE is contiguous
+static int16_t micRing[MIC_RING_SIZE * 2];
+
+/// The total number of samples ever written to the ring. Only the low bits are an index
+static uint32_t micWritePos = 0;
+
+/// The state of the DC blocking IIR filter
+static uint32_t micIir = 0;
+
+//==============================================================================
+// Functions
+//==============================================================================
+
+/**
+ * @brief Filter a block of raw ADC samples, apply the gain, and store them in the ring. This is called by the system
+ * for every block read from the microphone.
+ *
+ * @param adcSamples The raw 12-bit samples read from the ADC
+ * @param count The number of samples, no more than ::MIC_RING_SIZE
+ * @param gainSetting The mic gain setting, 0 to ::MAX_MIC_GAIN
+ * @return A pointer to the filtered samples in the ring, valid until the next call
+ */
+int16_t* micRingPush(const uint16_t* adcSamples, uint32_t count, uint8_t gainSetting)
+{
+    int32_t gain   = micGains[MIN(gainSetting, MAX_MIC_GAIN)];
+    uint32_t iir   = micIir;
+    uint32_t start = micWritePos & MIC_RING_MASK;
+    int16_t* out   = &micRing[start];
+
+    // Run all samples through an IIR filter and apply the gain. The block may run past the first copy of the ring
+    // into the second, which is fine
+    for (uint32_t i = 0; i < count; i++)
+    {
+        int32_t sample  = adcSamples[i];
+        iir             = iir - (iir >> 9) + sample;
+        int32_t newSamp = (sample - (iir >> 9)) * gain;
+        out[i]          = CLAMP(newSamp, -32768, 32767);
+    }
+
+    // Mirror the block into the other copy of the ring
+    uint32_t firstLen = MIN(count, MIC_RING_SIZE - start);
+    memcpy(&micRing[start + MIC_RING_SIZE], out, firstLen * sizeof(int16_t));
+    if (count > firstLen)
+    {
+        memcpy(&micRing[0], &micRing[MIC_RING_SIZE], (count - firstLen) * sizeof(int16_t));
+    }
+
+    micIir = iir;
+    micWritePos += count;
+    return out;
+}
+
+/**
+ * @brief Get the total number of samples ever written to the ring
+ *
+ * @return The total number of samples, which wraps around at UINT32_MAX
+ */
+uint32_t micRingGetWritten(void)
+{
+    return micWritePos;
+}
+
+/**
+ * @brief Get the most recent samples in the ring, regardless of what any reader has read
+ *
+ * @param count The number of samples to get, no more than ::MIC_RING_SIZE
+ * @return A pointer to \c count contiguous samples, the last of which is the newest
+ */
+const int16_t* micRingGetWindow(uint32_t count)
+{
+    count = MIN(count, MIC_RING_SIZE);
+    return &micRing[(micWritePos - count) & MIC_RING_MASK];
+}
+
+/**
+ * @brief Initialize a reader to start reading from the next sample written to the ring
+ *
+ * @param reader The reader to initialize
+ */
+void micReaderInit(micReader_t* reader)
+{
+    reader->readPos  = micWritePos;
+    reader->overruns = 0;
+}
+
+/**
+ * @brief Get all of the samples a reader has not read yet. If the reader fell more than ::MIC_RING_SIZE samples behind,
+ * it skips ahead to the oldest sample in the ring and the skipped samples are added to ::micReader_t.overruns.
+ *
+ * @param reader The reader to get samples for
+ * @param[out] count Written with the number of unread samples
+ * @return A pointer to \c count contiguous unread samples, oldest first
+ */
+const int16_t* micReaderPeek(micReader_t* reader, uint32_t* count)
+{
+    uint32_t avail = micWritePos - reader->readPos;
+    if (avail > MIC_RING_SIZE)
+    {
+        reader->overruns += avail - MIC_RING_SIZE;
+        reader->readPos = micWritePos - MIC_RING_SIZE;
+        avail           = MIC_RING_SIZE;
+    }
+
+    *count = avail;
+    return &micRing[reader->readPos & MIC_RING_MASK];
+}
+
+/**
+ * @brief Mark samples as read after micReaderPeek()
+ *
+ * @param reader The reader which read the samples
+ * @param count The number of samples read. This is limited to the number of unread samples
+ */
+void micReaderConsume(micReader_t* reader, uint32_t count)
+{
+    reader->readPos += MIN(count, micWritePos - reader->readPos);
+}
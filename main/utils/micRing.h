@@ -0,0 +1,99 @@
+/*! \file micRing.h
+ *
+ * \section micRing_design Design Philosophy
+ *
+ * Microphone samples are read from the ADC by the system in the main loop. Each block of samples is run through a DC
+ * blocking IIR filter and the microphone gain setting once, then stored in a ring buffer of signed samples. The same
+ * filtered block is passed to ::swadgeMode_t.fnAudioCallback straight from the ring, without a copy.
+ *
+ * Any number of consumers, like a DFT, a level meter, and a recorder, may also read from the ring at their own pace.
+ * Each consumer has a ::micReader_t which tracks its own read position. Readers get a pointer into the ring rather
+ * than a copy of the samples. The ring is stored twice back to back, so any window of up to ::MIC_RING_SIZE samples is
+ * always contiguous.
+ *
+ * If a reader falls more than ::MIC_RING_SIZE samples behind, the oldest samples are skipped and counted in
+ * ::micReader_t.overruns. If the main loop itself falls behind the ADC, the samples the ADC dropped are counted by
+ * micGetOverruns().
+ *
+ * \warning Samples returned from the ring must not be modified, since other readers share them. They are only valid
+ * until the next time the main loop reads the microphone, which is after the Swadge mode's main loop returns.
+ *
+ * \section micRing_usage Usage
+ *
+ * The system calls micRingPush() for every block read from the microphone. The microphone is only sampled when the
+ * Swadge mode has a ::swadgeMode_t.fnAudioCallback.
+ *
+ * Call micReaderInit() to start reading from the newest sample. Then call micReaderPeek() to get the unread samples
+ * and micReaderConsume() when done with some or all of them.
+ *
+ * To just look at the most recent samples, like for an oscilloscope or level meter, call micRingGetWindow() instead.
+ *
+ * \section micRing_example Example
+ *
+ * \code{.c}
+ * static micReader_t levelReader;
+ *
+ * // When entering the mode
+ * micReaderInit(&levelReader);
+ *
+ * // In the main loop
+ * uint32_t count;
+ * const int16_t* samples = micReaderPeek(&levelReader, &count);
+ * for (uint32_t i = 0; i < count; i++)
+ * {
+ *     // Do something with samples[i]
+ * }
+ * micReaderConsume(&levelReader, count);
+ *
+ * if (levelReader.overruns)
+ * {
+ *     // This reader fell behind and missed some samples
+ * }
+ *
+ * // Get the most recent 256 samples, regardless of what has been read
+ * const int16_t* window = micRingGetWindow(256);
+ * \endcode
+ */
+
+#ifndef _MIC_RING_H_
+#define _MIC_RING_H_
+
+//==============================================================================
+// Includes
+//==============================================================================
+
+#include <stdint.h>
+
+//==============================================================================
+// Defines
+//==============================================================================
+
+/// The number of filtered samples kept in the ring, 128ms at 8KHz. Must be a power of two.
+#define MIC_RING_SIZE 1024
+
+//==============================================================================
+// Structs
+//==============================================================================
+
+/**
+ * @brief A consumer of microphone samples with its own read position in the ring
+ */
+typedef struct
+{
+    uint32_t readPos;  ///< The total sample count at this reader's next unread sample
+    uint32_t overruns; ///< The number of samples this reader missed because it fell too far behind
+} micReader_t;
+
+//==============================================================================
+// Function Prototypes
+//==============================================================================
+
+int16_t* micRingPush(const uint16_t* adcSamples, uint32_t count, uint8_t gainSetting);
+uint32_t micRingGetWritten(void);
+const int16_t* micRingGetWindow(uint32_t count);
+
+void micReaderInit(micReader_t* reader);
+const int16_t* micReaderPeek(micReader_t* reader, uint32_t* count);
+void micReaderConsume(micReader_t* reader, uint32_t count);
+
+#endif
@@ -0,0 +1,100 @@
+//==============================================================================
+// Includes
+//==============================================================================
+
+#include "nodePool.h"
+
+#include <string.h>
+
+#include <esp_heap_caps.h>
+
+//==============================================================================
+// Functions
+//==============================================================================
+
+/**
+ * @brief Initialize an empty node pool. Nothing is allocated until the first node is
+ *
+ * @param pool The pool to initialize
+ * @param nodeSize The size of each node, at least the size of a pointer
+ * @param chunkLen The number of nodes to allocate at once when the pool runs out
+ * @param caps The MALLOC_CAP_* flags to allocate chunks with
+ */
+void nodePoolInit(nodePool_t* pool, size_t nodeSize, uint16_t chunkLen, uint32_t caps)
+{
+    memset(pool, 0, sizeof(nodePool_t));
+    // Each free node holds a pointer to the next free node, and nodes must stay aligned
+    pool->nodeSize = (nodeSize + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+    pool->chunkLen = chunkLen ? chunkLen : 1;
+    pool->caps     = caps;
+}
+
+/**
+ * @brief Free every chunk in a node pool. Any nodes still allocated from the pool become invalid
+ *
+ * @param pool The pool to deinitialize
+ */
+void nodePoolDeinit(nodePool_t* pool)
+{
+    while (NULL != pool->chunks)
+    {
+        void* next = *(void**)pool->chunks;
+        heap_caps_free(pool->chunks);
+        pool->chunks = next;
+    }
+    pool->freeList = NULL;
+    pool->numInUse = 0;
+    pool->numNodes = 0;
+}
+
+/**
+ * @brief Allocate a node from a pool. If the pool has no free nodes, another chunk is allocated from the heap first
+ *
+ * @param pool The pool to allocate from
+ * @return The node, which is not zeroed, or NULL if a chunk couldn't be allocated
+ */
+void* nodePoolAlloc(nodePool_t* pool)
+{
+    if (NULL == pool->freeList)
+    {
+        // The first word of the chunk links it to the other chunks, and the nodes come after it
+        uint8_t* chunk = heap_caps_malloc(sizeof(void*) + pool->chunkLen * pool->nodeSize, pool->caps);
+        if (NULL == chunk)
+        {
+            return NULL;
+        }
+        *(void**)chunk = pool->chunks;
+        pool->chunks   = chunk;
+        pool->numHeapAllocs++;
+        pool->numNodes += pool->chunkLen;
+
+        // Put the new nodes on the free list, in order
+        uint8_t* node = chunk + sizeof(void*);
+        for (uint16_t i = 0; i < pool->chunkLen; i++, node += pool->nodeSize)
+        {
+            *(void**)node = (i + 1 < pool->chunkLen) ? node + pool->nodeSize : NULL;
+        }
+        pool->freeList = chunk + sizeof(void*);
+    }
+
+    void* node     = pool->freeList;
+    pool->freeList = *(void**)node;
+    pool->numInUse++;
+    return node;
+}
+
+/**
+ * @brief Return a node to the pool it was allocated from so it can be reused
+ *
+ * @param pool The pool the node was allocated from
+ * @param node The node to free. May be NULL
+ */
+void nodePoolFree(nodePool_t* pool, void* node)
+{
+    if (NULL != node)
+    {
+        *(void**)node  = pool->freeList;
+        pool->freeList = node;
+        pool->numInUse--;
+    }
+}
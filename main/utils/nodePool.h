@@ -0,0 +1,86 @@
+/*! \file nodePool.h
+ *
+ * \section nodePool_design Design Philosophy
+ *
+ * Linked lists and hash maps allocate a small node from the heap for every item added, and free it when the item is
+ * removed. When a Swadge mode adds and removes items every frame, like for collision checks, pathfinding, or packet
+ * queues, that is a lot of heap allocations, and each one has some overhead and fragments the heap.
+ *
+ * A node pool allocates nodes in chunks instead. Each chunk holds ::nodePool_t.chunkLen nodes of the same size. Freed
+ * nodes are put on a free list and reused by the next allocation, so after the pool has grown to the most nodes used
+ * at once, adding and removing items doesn't touch the heap at all. Chunks are only freed when the pool is deinitialized.
+ *
+ * A pool may be shared between any number of lists, as long as they are all used from the same task.
+ *
+ * \section nodePool_usage Usage
+ *
+ * To use a pool with a ::list_t, initialize a pool with nodePoolInit() for nodes of \c sizeof(node_t), then set
+ * ::list_t.pool before adding anything to the list. Lists without a pool allocate from the heap, like before.
+ *
+ * To use a pool with a ::hashMap_t, call hashEnablePool() right after hashInit() or hashInitBin(). The hash map owns
+ * that pool and deinitializes it in hashDeinit().
+ *
+ * nodePoolAlloc() and nodePoolFree() may be used directly for any other fixed-size allocations too.
+ *
+ * When done, call nodePoolDeinit() to free all of the chunks. Any nodes still in use become invalid, so clear lists
+ * using the pool first.
+ *
+ * \section nodePool_example Example
+ *
+ * \code{.c}
+ * static nodePool_t pool;
+ * static list_t collisions;
+ *
+ * // When entering the mode, grow the pool 32 nodes at a time
+ * nodePoolInit(&pool, sizeof(node_t), 32, MALLOC_CAP_8BIT);
+ * collisions.pool = &pool;
+ *
+ * // In the main loop, these don't allocate once the pool is big enough
+ * push(&collisions, obj);
+ * clear(&collisions);
+ *
+ * // When exiting the mode
+ * clear(&collisions);
+ * nodePoolDeinit(&pool);
+ * \endcode
+ */
+
+#ifndef _NODE_POOL_H_
+#define _NODE_POOL_H_
+
+//==============================================================================
+// Includes
+//==============================================================================
+
+#include <stddef.h>
+#include <stdint.h>
+
+//==============================================================================
+// Structs
+//==============================================================================
+
+/**
+ * @brief A pool of same-sized nodes, allocated from the heap in chunks
+ */
+typedef struct
+{
+    void* chunks;           ///< The chunks allocated from the heap, linked through each chunk's first word
+    void* freeList;         ///< The free nodes, linked through each node's first word
+    size_t nodeSize;        ///< The size of each node, rounded up to a multiple of the pointer size
+    uint16_t chunkLen;      ///< The number of nodes allocated at once when the pool runs out
+    uint32_t caps;          ///< The MALLOC_CAP_* flags chunks are allocated with
+    uint32_t numInUse;      ///< The number of nodes which are allocated from the pool
+    uint32_t numNodes;      ///< The number of nodes in all of the chunks
+    uint32_t numHeapAllocs; ///< The number of chunks allocated from the heap
+} nodePool_t;
+
+//==============================================================================
+// Function Prototypes
+//==============================================================================
+
+void nodePoolInit(nodePool_t* pool, size_t nodeSize, uint16_t chunkLen, uint32_t caps);
+void nodePoolDeinit(nodePool_t* pool);
+void* nodePoolAlloc(nodePool_t* pool);
+void nodePoolFree(nodePool_t* pool, void* node);
+
+#endif
@@ -0,0 +1,468 @@
+//==============================================================================
+// Includes
+//==============================================================================
+
+#include "openMap.h"
+
+#include <string.h>
+
+#include <esp_heap_caps.h>
+
+//==============================================================================
+// Defines
+//==============================================================================
+
+/// The smallest number of slots a map has
+#define OPEN_MAP_MIN_SIZE 8
+
+/// The number of old slots moved to the new array by each put or remove during an incremental resize
+#define OPEN_MAP_RESIZE_STEP 8
+
+//==============================================================================
+// Static Function Prototypes
+//==============================================================================
+
+static uint32_t openMapHash(const openMap_t* map, const void* key);
+static int findSlot(const openMap_t* map, const openMapSlot_t* slots, int size, const void* key, uint32_t hash);
+static void insertSlot(openMapSlot_t* slots, int size, openMapSlot_t item);
+static void removeSlot(openMapSlot_t* slots, int size, int idx);
+static bool openMapGrow(openMap_t* map);
+static void openMapMoveOld(openMap_t* map, int steps);
+
+//==============================================================================
+// Functions
+//==============================================================================
+
+/**
+ * @brief Initialize an open map for string keys
+ *
+ * @param map The map to initialize
+ * @param initialSize The initial number of slots, which is rounded up to a power of two
+ * @return true if the map was initialized, false if the slots couldn't be allocated. The map is still usable, and the
+ * next put tries to allocate them again
+ */
+bool openMapInit(openMap_t* map, int initialSize)
+{
+    int size = OPEN_MAP_MIN_SIZE;
+    while (size < initialSize)
+    {
+        size *= 2;
+    }
+
+    memset(map, 0, sizeof(openMap_t));
+    map->slots = heap_caps_calloc(size, sizeof(openMapSlot_t), MALLOC_CAP_8BIT);
+    if (NULL == map->slots)
+    {
+        return false;
+    }
+    map->size = size;
+    return true;
+}
+
+/**
+ * @brief Initialize an open map for non-string keys, using the given functions for hashing and comparison
+ *
+ * @param map The map to initialize
+ * @param initialSize The initial number of slots, which is rounded up to a power of two
+ * @param hashFunc The hash function to use for the key datatype
+ * @param eqFunc The comparison function to use for the key datatype
+ * @return true if the map was initialized, false if the slots couldn't be allocated. The map is still usable, and the
+ * next put tries to allocate them again
+ */
+bool openMapInitBin(openMap_t* map, int initialSize, hashFunction_t hashFunc, eqFunction_t eqFunc)
+{
+    bool ok       = openMapInit(map, initialSize);
+    map->hashFunc = hashFunc;
+    map->eqFunc   = eqFunc;
+    return ok;
+}
+
+/**
+ * @brief Free the memory used by an open map. The keys and values themselves are not freed
+ *
+ * @param map The map to deinitialize
+ */
+void openMapDeinit(openMap_t* map)
+{
+    heap_caps_free(map->slots);
+    heap_caps_free(map->oldSlots);
+    memset(map, 0, sizeof(openMap_t));
+}
+
+/**
+ * @brief Create or update a key-value pair in the map with a string key
+ *
+ * @warning A reference to the key will be stored in the map until the entry is removed
+ *
+ * @param map The map to update
+ * @param key The string key to associate the value with
+ * @param value The value to add to the map
+ * @return true if the value was stored, false if the map is full and couldn't grow
+ */
+bool openMapPut(openMap_t* map, const char* key, void* value)
+{
+    return openMapPutBin(map, key, value);
+}
+
+/**
+ * @brief Return the value in the map associated with the given string key
+ *
+ * @param map The map to search
+ * @param key The string key to retrieve the value for
+ * @return A pointer to the mapped value, or NULL if it was not found
+ */
+void* openMapGet(const openMap_t* map, const char* key)
+{
+    return openMapGetBin(map, key);
+}
+
+/**
+ * @brief Remove the value with a given string key from the map
+ *
+ * @param map The map to remove from
+ * @param key The string key to remove the value for
+ * @return The value that was removed, or NULL if no value was found for the given key
+ */
+void* openMapRemove(openMap_t* map, const char* key)
+{
+    return openMapRemoveBin(map, key);
+}
+
+/**
+ * @brief Create or update a key-value pair in the map with a non-string key
+ *
+ * Runtime: O(1) average case. O(n) when the map grows, unless ::openMap_t.incrementalResize is set
+ *
+ * @param map The map to update
+ * @param key The key to associate the value with
+ * @param value The value to add to the map
+ * @return true if the value was stored, false if the map is full and couldn't grow
+ */
+bool openMapPutBin(openMap_t* map, const void* key, void* value)
+{
+    openMapMoveOld(map, OPEN_MAP_RESIZE_STEP);
+
+    uint32_t hash = openMapHash(map, key);
+
+    // Update the value if the key is already in either array
+    int idx = findSlot(map, map->slots, map->size, key, hash);
+    if (0 <= idx)
+    {
+        map->slots[idx].value = value;
+        return true;
+    }
+    idx = findSlot(map, map->oldSlots, map->oldSize, key, hash);
+    if (0 <= idx)
+    {
+        map->oldSlots[idx].value = value;
+        return true;
+    }
+
+    // Grow once the map would become more than 75% full. If that fails, the map only gets slower until it's full, but
+    // then there's no slot for the key
+    if ((map->count + 1) * 4 > map->size * 3 && !openMapGrow(map) && map->count >= map->size)
+    {
+        return false;
+    }
+
+    openMapSlot_t item = {
+        .hash  = hash,
+        .key   = key,
+        .value = value,
+    };
+    insertSlot(map->slots, map->size, item);
+    map->count++;
+    return true;
+}
+
+/**
+ * @brief Return the value in the map associated with the given key
+ *
+ * Runtime: O(1) average case
+ *
+ * @param map The map to search
+ * @param key The key to retrieve the value for
+ * @return A pointer to the mapped value, or NULL if it was not found
+ */
+void* openMapGetBin(const openMap_t* map, const void* key)
+{
+    uint32_t hash = openMapHash(map, key);
+
+    int idx = findSlot(map, map->slots, map->size, key, hash);
+    if (0 <= idx)
+    {
+        return map->slots[idx].value;
+    }
+    idx = findSlot(map, map->oldSlots, map->oldSize, key, hash);
+    if (0 <= idx)
+    {
+        return map->oldSlots[idx].value;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Remove the value with a given non-string key from the map
+ *
+ * Runtime: O(1) average case
+ *
+ * @param map The map to remove from
+ * @param key The key to remove the value for
+ * @return The value that was removed, or NULL if no value was found for the given key
+ */
+void* openMapRemoveBin(openMap_t* map, const void* key)
+{
+    openMapMoveOld(map, OPEN_MAP_RESIZE_STEP);
+
+    uint32_t hash = openMapHash(map, key);
+    void* value   = NULL;
+
+    int idx = findSlot(map, map->slots, map->size, key, hash);
+    if (0 <= idx)
+    {
+        value = map->slots[idx].value;
+        removeSlot(map->slots, map->size, idx);
+        map->count--;
+        return value;
+    }
+    idx = findSlot(map, map->oldSlots, map->oldSize, key, hash);
+    if (0 <= idx)
+    {
+        value = map->oldSlots[idx].value;
+        removeSlot(map->oldSlots, map->oldSize, idx);
+        map->count--;
+    }
+    return value;
+}
+
+/**
+ * @brief Advance the given iterator to the next key-value pair, or return false if there are no more
+ *
+ * The iterator should be zeroed before iteration starts. Items are not returned in any particular order. If an
+ * incremental resize is in progress, it's finished first.
+ *
+ * @param map The map to iterate over
+ * @param iter The iterator to advance
+ * @return true if the iterator returned a key-value pair, false if iteration is complete
+ */
+bool openMapIterate(openMap_t* map, openMapIterator_t* iter)
+{
+    if (!iter->_started)
+    {
+        openMapMoveOld(map, INT32_MAX);
+
+        // Start right after an empty slot. Removing a key during iteration then only moves keys which haven't been
+        // returned yet, since no cluster of keys wraps around past where iteration started
+        iter->_started = true;
+        iter->_start   = 0;
+        while (iter->_start < map->size && NULL != map->slots[iter->_start].key)
+        {
+            iter->_start++;
+        }
+
+        // If every slot is full, there's no empty slot to skip, so start from slot 0 itself
+        iter->_next = (iter->_start == map->size) ? 0 : 1;
+    }
+
+    while (iter->_next < map->size)
+    {
+        const openMapSlot_t* slot = &map->slots[(iter->_start + iter->_next) & (map->size - 1)];
+        iter->_next++;
+        if (NULL != slot->key)
+        {
+            iter->key   = slot->key;
+            iter->value = slot->value;
+            return true;
+        }
+    }
+
+    iter->key   = NULL;
+    iter->value = NULL;
+    return false;
+}
+
+/**
+ * @brief Remove the key-value pair last returned by the iterator from the map. This is the only safe way to remove
+ * items during iteration. The next call to openMapIterate() continues with the next item
+ *
+ * @param map The map to remove the item from
+ * @param iter The iterator whose current item to remove
+ * @return true if the item was removed, false if the iterator had no current item
+ */
+bool openMapIterRemove(openMap_t* map, openMapIterator_t* iter)
+{
+    if (!iter->_started || NULL == iter->key)
+    {
+        return false;
+    }
+
+    // The next key in the cluster shifts back into this slot, so check this slot again next time
+    iter->_next--;
+    removeSlot(map->slots, map->size, (iter->_start + iter->_next) & (map->size - 1));
+    map->count--;
+
+    iter->key   = NULL;
+    iter->value = NULL;
+    return true;
+}
+
+/**
+ * @brief Hash a key with the map's hash function
+ *
+ * @param map The map the key is for
+ * @param key The key to hash
+ * @return The key's hash
+ */
+static uint32_t openMapHash(const openMap_t* map, const void* key)
+{
+    return map->hashFunc ? map->hashFunc(key) : hashString(key);
+}
+
+/**
+ * @brief Find the slot holding a key in an array of slots
+ *
+ * @param map The map the array is for
+ * @param slots The array to search. May be NULL
+ * @param size The number of slots in the array
+ * @param key The key to find
+ * @param hash The key's hash
+ * @return The index of the slot holding the key, or -1 if it isn't in the array
+ */
+static int findSlot(const openMap_t* map, const openMapSlot_t* slots, int size, const void* key, uint32_t hash)
+{
+    if (NULL == slots)
+    {
+        return -1;
+    }
+
+    eqFunction_t eqFn = map->eqFunc ? map->eqFunc : strEq;
+    int mask          = size - 1;
+    int idx           = hash & mask;
+    for (int dist = 0; dist < size; dist++, idx = (idx + 1) & mask)
+    {
+        const openMapSlot_t* slot = &slots[idx];
+        // The key would have taken the place of any key closer to its home slot, so it isn't in the array
+        if (NULL == slot->key || (int)((idx - slot->hash) & mask) < dist)
+        {
+            return -1;
+        }
+        if (slot->hash == hash && eqFn(slot->key, key))
+        {
+            return idx;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Add a key which isn't in an array of slots yet with Robin Hood probing. The array must have an empty slot
+ *
+ * @param slots The array to add to
+ * @param size The number of slots in the array
+ * @param item The key, hash, and value to add
+ */
+static void insertSlot(openMapSlot_t* slots, int size, openMapSlot_t item)
+{
+    int mask = size - 1;
+    int idx  = item.hash & mask;
+    int dist = 0;
+    while (NULL != slots[idx].key)
+    {
+        // Take the slot from a key which is closer to its home slot, then keep looking for a slot for that key
+        int slotDist = (idx - slots[idx].hash) & mask;
+        if (slotDist < dist)
+        {
+            openMapSlot_t tmp = slots[idx];
+            slots[idx]        = item;
+            item              = tmp;
+            dist              = slotDist;
+        }
+        idx = (idx + 1) & mask;
+        dist++;
+    }
+    slots[idx] = item;
+}
+
+/**
+ * @brief Remove the key in a slot by shifting the rest of its cluster back, so no tombstone is left behind
+ *
+ * @param slots The array to remove from
+ * @param size The number of slots in the array
+ * @param idx The index of the slot to empty
+ */
+static void removeSlot(openMapSlot_t* slots, int size, int idx)
+{
+    int mask = size - 1;
+    int next = (idx + 1) & mask;
+    // Keys which are already in their home slot stay put
+    while (NULL != slots[next].key && 0 != ((next - slots[next].hash) & mask))
+    {
+        slots[idx] = slots[next];
+        idx        = next;
+        next       = (next + 1) & mask;
+    }
+    memset(&slots[idx], 0, sizeof(openMapSlot_t));
+}
+
+/**
+ * @brief Double the number of slots in a map, or allocate the first ones if openMapInit() couldn't. The keys are moved
+ * to the new array all at once, or a few at a time by openMapMoveOld() if ::openMap_t.incrementalResize is set
+ *
+ * @param map The map to grow
+ * @return true if the map grew, false if the new array couldn't be allocated
+ */
+static bool openMapGrow(openMap_t* map)
+{
+    int newSize             = map->size ? map->size * 2 : OPEN_MAP_MIN_SIZE;
+    openMapSlot_t* newSlots = heap_caps_calloc(newSize, sizeof(openMapSlot_t), MALLOC_CAP_8BIT);
+    if (NULL == newSlots)
+    {
+        return false;
+    }
+
+    // Only one resize happens at a time
+    openMapMoveOld(map, INT32_MAX);
+
+    map->oldSlots = map->slots;
+    map->oldSize  = map->size;
+    map->oldIdx   = 0;
+    map->slots    = newSlots;
+    map->size     = newSize;
+
+    if (!map->incrementalResize)
+    {
+        openMapMoveOld(map, INT32_MAX);
+    }
+    return true;
+}
+
+/**
+ * @brief Move keys from the old array to the new one during a resize, and free the old array once it's empty
+ *
+ * @param map The map being resized
+ * @param steps The number of old slots to move
+ */
+static void openMapMoveOld(openMap_t* map, int steps)
+{
+    while (NULL != map->oldSlots && 0 < steps--)
+    {
+        if (map->oldIdx >= map->oldSize)
+        {
+            heap_caps_free(map->oldSlots);
+            map->oldSlots = NULL;
+            map->oldSize  = 0;
+        }
+        else if (NULL != map->oldSlots[map->oldIdx].key)
+        {
+            // Removing the key shifts the next one back into this slot, which is moved next. Slots before oldIdx are
+            // always empty, so keys never shift back behind it
+            openMapSlot_t item = map->oldSlots[map->oldIdx];
+            removeSlot(map->oldSlots, map->oldSize, map->oldIdx);
+            insertSlot(map->slots, map->size, item);
+        }
+        else
+        {
+            map->oldIdx++;
+        }
+    }
+}
@@ -0,0 +1,146 @@
+/*!
+ * \file openMap.h
+ * \brief A hash map which stores key-value pairs directly in a flat array, without allocating per item
+ *
+ * \section openMap_design Design Philosophy
+ *
+ * This is an alternative to hashMap.h with the same keys, hash functions, and equality functions. ::hashMap_t handles
+ * collisions by turning a bucket into a heap-allocated linked list, so a lookup in a crowded bucket follows pointers
+ * all over the heap, and adding or removing a colliding key allocates or frees memory. An ::openMap_t stores every
+ * key-value pair, along with the key's hash, directly in one array of slots instead. A key that collides goes in the
+ * next free slot, so a lookup reads a few neighboring slots, which are usually in the same cache line.
+ *
+ * Keys are placed with Robin Hood probing. When a key being added has traveled farther from its home slot than the
+ * key already in a slot, they swap, and the other key continues on. This keeps every key close to its home slot, and
+ * lets a lookup for a missing key stop as soon as it passes a key closer to home than itself.
+ *
+ * Removing a key shifts the following keys in its cluster back one slot, instead of leaving a tombstone behind. So
+ * lookups never slow down from keys which have already been removed, and the map never needs to be cleaned up.
+ *
+ * The array always has a power of two slots, and grows to twice the size once it becomes 75% full. By default, all
+ * the keys are moved to the new array at once, which takes O(n) time for that one put. If
+ * ::openMap_t.incrementalResize is set, the old array is kept instead, and each put or remove moves a few more keys
+ * from it until it is empty. Lookups check both arrays in the meantime. No single put pays for a full rehash, which
+ * keeps frame times smooth when a map grows during gameplay.
+ *
+ * \section openMap_caveats Caveats
+ *
+ * Like ::hashMap_t, the map keeps a reference to each key rather than a copy, and NULL can't be used as a key.
+ *
+ * Because removing a key moves other keys, values must not be looked up by pointers to slots. Adding keys during
+ * iteration is not allowed, though updating the value for a key which is already in the map is.
+ *
+ * If the map can't allocate a bigger array, it keeps working in the array it has. Once that array is full, a put of a
+ * new key returns false and the key isn't stored.
+ *
+ * \section openMap_usage Usage
+ *
+ * openMapInit() allocates a new map for use with string keys, and openMapInitBin() allocates one for other keys, with
+ * the same hash and equality functions as hashInitBin(). Set ::openMap_t.incrementalResize after initializing the map
+ * to spread out resizing.
+ *
+ * openMapPut(), openMapGet(), and openMapRemove() add or update, retrieve, and remove entries with string keys.
+ * openMapPutBin(), openMapGetBin(), and openMapRemoveBin() do the same for other keys.
+ *
+ * openMapIterate() loops over the entries, and openMapIterRemove() removes the current entry during iteration. The
+ * iterator doesn't allocate anything, so it may simply be abandoned when stopping early.
+ *
+ * openMapDeinit() frees the map.
+ *
+ * \section openMap_example Example
+ *
+ * \code{.c}
+ * openMap_t map;
+ * openMapInit(&map, 16);
+ * map.incrementalResize = true;
+ *
+ * openMapPut(&map, "greeting", "Hello");
+ * openMapPut(&map, "name", "Swadge");
+ *
+ * // Prints "Hello, Swadge!"
+ * printf("%s, %s!\n", (const char*)openMapGet(&map, "greeting"), (const char*)openMapGet(&map, "name"));
+ *
+ * openMapIterator_t iter = {0};
+ * while (openMapIterate(&map, &iter))
+ * {
+ *     printf("%s = %s\n", (const char*)iter.key, (const char*)iter.value);
+ * }
+ *
+ * openMapDeinit(&map);
+ * \endcode
+ */
+#ifndef _OPEN_MAP_H_
+#define _OPEN_MAP_H_
+
+//==============================================================================
+// Includes
+//==============================================================================
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hashMap.h"
+
+//==============================================================================
+// Structs
+//==============================================================================
+
+/**
+ * @brief One slot in an open map's array
+ */
+typedef struct
+{
+    uint32_t hash;   ///< The key's hash
+    const void* key; ///< The key, or NULL if this slot is empty
+    void* value;     ///< The value
+} openMapSlot_t;
+
+/**
+ * @brief A hash map which stores key-value pairs in a flat array
+ */
+typedef struct
+{
+    openMapSlot_t* slots;    ///< The array of slots, which new keys are added to
+    int size;                ///< The number of slots, always a power of two
+    int count;               ///< The number of key-value pairs in both arrays
+    openMapSlot_t* oldSlots; ///< The array being moved into slots during an incremental resize, or NULL
+    int oldSize;             ///< The number of slots in oldSlots
+    int oldIdx;              ///< The index in oldSlots of the next slot to move
+    bool incrementalResize;  ///< true to move keys to a bigger array a few at a time, false to move them all at once
+    hashFunction_t hashFunc; ///< The key hash function to use, or NULL to use hashString()
+    eqFunction_t eqFunc;     ///< The key equality function to use, or NULL to use strEq()
+} openMap_t;
+
+/**
+ * @brief An iterator over an open map. Zero it before iterating
+ */
+typedef struct
+{
+    const void* key; ///< The key of the current key-value pair
+    void* value;     ///< The value of the current key-value pair
+
+    bool _started; ///< @internal Whether iteration has started
+    int _start;    ///< @internal The empty slot iteration started after
+    int _next;     ///< @internal The number of slots after _start to check next
+} openMapIterator_t;
+
+//==============================================================================
+// Function Prototypes
+//==============================================================================
+
+bool openMapInit(openMap_t* map, int initialSize);
+bool openMapInitBin(openMap_t* map, int initialSize, hashFunction_t hashFunc, eqFunction_t eqFunc);
+void openMapDeinit(openMap_t* map);
+
+bool openMapPut(openMap_t* map, const char* key, void* value);
+void* openMapGet(const openMap_t* map, const char* key);
+void* openMapRemove(openMap_t* map, const char* key);
+
+bool openMapPutBin(openMap_t* map, const void* key, void* value);
+void* openMapGetBin(const openMap_t* map, const void* key);
+void* openMapRemoveBin(openMap_t* map, const void* key);
+
+bool openMapIterate(openMap_t* map, openMapIterator_t* iter);
+bool openMapIterRemove(openMap_t* map, openMapIterator_t* iter);
+
+#endif
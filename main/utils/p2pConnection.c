@@ -2,10 +2,12 @@
 // Includes
 //==============================================================================
 
+#include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 
+#include <esp_heap_caps.h>
 #include <esp_random.h>
 #include <esp_log.h>
 #include <esp_now.h>
@@ -26,6 +28,12 @@
 // (240 steps of rotation + (252/4) steps of decay) * 12ms
 #define FAILURE_RESTART_US 8000000
 
+// The time after which an unacknowledged windowed fragment is sent again
+#define WIN_RETRY_US 10000
+
+// The index of a windowed sequence number's slot. This works across wraparound because P2P_WIN_SIZE divides 65536
+#define WIN_IDX(seq) ((uint16_t)(seq) % P2P_WIN_SIZE)
+
 // #define P2P_DEBUG
 #ifdef P2P_DEBUG
 static const char* P2P_TAG = "P2P";
@@ -51,6 +59,10 @@ static void p2pSendMsgEx(p2pInfo* p2p, uint8_t* msg, uint16_t len, bool shouldAc
                          p2pAckFailureFn failure);
 static void p2pModeMsgSuccess(p2pInfo* p2p, const uint8_t* data, uint8_t dataLen);
 static void p2pModeMsgFailure(p2pInfo* p2p);
+static void p2pWinTransmit(p2pWinTxSlot_t* slot);
+static void p2pWinSendSack(p2pInfo* p2p);
+static void p2pWinDataRecv(p2pInfo* p2p, const p2pWinDataMsg_t* msg, uint8_t len);
+static void p2pWinSackRecv(p2pInfo* p2p, const p2pWinSackMsg_t* sack);
 
 //==============================================================================
 // Functions
@@ -209,6 +221,12 @@ void p2pDeinit(p2pInfo* p2p)
         esp_timer_delete(p2p->tmr.Connection);
     }
 
+    // Free the windowed transport, if it was enabled
+    if (NULL != p2p->win)
+    {
+        heap_caps_free(p2p->win);
+    }
+
     // Clear out for good measure
     memset(p2p, 0, sizeof(p2pInfo));
 }
@@ -494,6 +512,24 @@ void p2pRecvCb(p2pInfo* p2p, const uint8_t* mac_addr, const uint8_t* data, uint8
         return;
     }
 
+    // Windowed messages have their own sequence numbers and acknowledgements, so they skip the stop-and-wait handling
+    if (len >= sizeof(p2pCommonHeader_t)
+        && (P2P_MSG_WIN_DATA == p2pHdr->messageType || P2P_MSG_WIN_SACK == p2pHdr->messageType))
+    {
+        if (p2p->cnc.isConnected && NULL != p2p->win)
+        {
+            if (P2P_MSG_WIN_DATA == p2pHdr->messageType)
+            {
+                p2pWinDataRecv(p2p, (const p2pWinDataMsg_t*)data, len);
+            }
+            else if (sizeof(p2pWinSackMsg_t) == len)
+            {
+                p2pWinSackRecv(p2p, (const p2pWinSackMsg_t*)data);
+            }
+        }
+        return;
+    }
+
     // By here, we know the received message matches our message ID, either a
     // broadcast or for us. If this isn't an ack message, ack it
     if (len >= sizeof(p2pCommonHeader_t) && p2pHdr->messageType != P2P_MSG_ACK
@@ -805,6 +841,10 @@ static void p2pRestart(p2pInfo* p2p)
 
     uint8_t modeId         = p2p->modeId;
     uint8_t incomingModeId = p2p->incomingModeId;
+
+    // Keep the windowed transport's memory, since this may be called from a timer while the main loop is using it
+    p2pWindow_t* win = p2p->win;
+    p2p->win         = NULL;
     p2pDeinit(p2p);
     p2pInitialize(p2p, modeId, p2p->conCbFn, p2p->msgRxCbFn, p2p->connectionRssi);
 
@@ -812,6 +852,15 @@ static void p2pRestart(p2pInfo* p2p)
     {
         p2pSetAsymmetric(p2p, incomingModeId);
     }
+
+    // Keep the windowed transport enabled, but drop everything in flight
+    if (NULL != win)
+    {
+        p2pWinMsgRxCbFn winRxCbFn = win->msgRxCbFn;
+        memset(win, 0, sizeof(p2pWindow_t));
+        win->msgRxCbFn = winRxCbFn;
+        p2p->win       = win;
+    }
 }
 
 /**
@@ -904,3 +953,282 @@ void p2pSetPlayOrder(p2pInfo* p2p, playOrder_t order)
 {
     p2p->cnc.playOrder = order;
 }
+
+/**
+ * @brief Enable the windowed transport, which sends messages larger than one ESP-NOW frame with multiple fragments in
+ * flight. This must be called after p2pInitialize(), and the transport is freed by p2pDeinit().
+ *
+ * @param p2p The p2pInfo struct with all the state information
+ * @param msgRxCbFn A function pointer which will be called when a windowed message is received for the swadge mode
+ * @return true if the windowed transport was enabled, false if it couldn't be allocated
+ */
+bool p2pEnableWindow(p2pInfo* p2p, p2pWinMsgRxCbFn msgRxCbFn)
+{
+    if (NULL == p2p->win)
+    {
+        p2p->win = heap_caps_calloc(1, sizeof(p2pWindow_t), MALLOC_CAP_8BIT);
+        if (NULL == p2p->win)
+        {
+            return false;
+        }
+    }
+
+    p2p->win->msgRxCbFn = msgRxCbFn;
+    return true;
+}
+
+/**
+ * @brief Send a message from one Swadge to another with the windowed transport. This must not be called before the
+ * CON_ESTABLISHED event occurs. The message is split into fragments which are sent immediately, without waiting for
+ * earlier messages to be acknowledged
+ *
+ * @param p2p       The p2pInfo struct with all the state information
+ * @param payload   A byte array to be copied to the payload for this message
+ * @param len       The length of the byte array, up to ::P2P_WIN_MAX_MSG_LEN
+ * @param msgTxCbFn A callback function when all of this message's fragments are ACKed, or the message is dropped
+ * @return true if the message was sent, false if the windowed transport isn't enabled or the window doesn't have room
+ * for it
+ */
+bool p2pSendMsgWindowed(p2pInfo* p2p, const uint8_t* payload, uint16_t len, p2pMsgTxCbFn msgTxCbFn)
+{
+    P2P_LOG("%s", __func__);
+
+    p2pWindow_t* win = p2p->win;
+    if (NULL == win || !p2p->cnc.isConnected || NULL == payload || 0 == len || len > p2pGetWindowSpace(p2p))
+    {
+        return false;
+    }
+
+    bool wasIdle      = (win->txBase == win->txNext);
+    uint8_t fragCount = (len + P2P_WIN_FRAG_LEN - 1) / P2P_WIN_FRAG_LEN;
+
+    for (uint8_t fragIdx = 0; fragIdx < fragCount; fragIdx++)
+    {
+        p2pWinTxSlot_t* slot = &win->tx[WIN_IDX(win->txNext)];
+        uint16_t fragLen     = (fragIdx < fragCount - 1) ? P2P_WIN_FRAG_LEN : (len - fragIdx * P2P_WIN_FRAG_LEN);
+
+        // Build the fragment
+        slot->msg.hdr.startByte   = P2P_START_BYTE;
+        slot->msg.hdr.modeId      = p2p->modeId;
+        slot->msg.hdr.messageType = P2P_MSG_WIN_DATA;
+        slot->msg.hdr.seqNum      = 0;
+        memcpy(slot->msg.hdr.macAddr, p2p->cnc.otherMac, sizeof(slot->msg.hdr.macAddr));
+        slot->msg.winSeq    = win->txNext;
+        slot->msg.fragIdx   = fragIdx;
+        slot->msg.fragCount = fragCount;
+        memcpy(slot->msg.data, &payload[fragIdx * P2P_WIN_FRAG_LEN], fragLen);
+
+        slot->len       = offsetof(p2pWinDataMsg_t, data) + fragLen;
+        slot->acked     = false;
+        slot->msgTxCbFn = (fragIdx == fragCount - 1) ? msgTxCbFn : NULL;
+
+        // Send it
+        win->txNext++;
+        p2pWinTransmit(slot);
+    }
+
+    // The window starts moving forward when the first fragments go in flight
+    if (wasIdle)
+    {
+        win->txProgressUs = esp_timer_get_time();
+    }
+    return true;
+}
+
+/**
+ * @brief Get the number of bytes which may be sent with p2pSendMsgWindowed() right now
+ *
+ * @param p2p The p2pInfo struct with all the state information
+ * @return The number of bytes which fit in the free part of the window, or 0 if the windowed transport isn't enabled
+ */
+uint16_t p2pGetWindowSpace(p2pInfo* p2p)
+{
+    if (NULL == p2p->win)
+    {
+        return 0;
+    }
+    uint16_t inFlight = p2p->win->txNext - p2p->win->txBase;
+    return (P2P_WIN_SIZE - inFlight) * P2P_WIN_FRAG_LEN;
+}
+
+/**
+ * @brief Resend windowed fragments which haven't been acknowledged in a while, or give up if the window hasn't moved
+ * forward for RETRY_TIME_US. This must be called from the Swadge mode's main loop while the windowed transport is
+ * enabled, so retries never touch the window while the main loop is sending or receiving on it
+ *
+ * @param p2p The p2pInfo struct with all the state information
+ */
+void p2pWinPoll(p2pInfo* p2p)
+{
+    p2pWindow_t* win = p2p->win;
+    int64_t nowUs    = esp_timer_get_time();
+
+    if (NULL == win || win->txBase == win->txNext)
+    {
+        return;
+    }
+
+    if (nowUs - win->txProgressUs > RETRY_TIME_US)
+    {
+        P2P_LOG("Windowed message totally failed");
+
+        // Fail every message still in flight. The receiver can't skip the missing fragment, so restart the connection
+        for (uint16_t seq = win->txBase; seq != win->txNext; seq++)
+        {
+            if (NULL != win->tx[WIN_IDX(seq)].msgTxCbFn)
+            {
+                win->tx[WIN_IDX(seq)].msgTxCbFn(p2p, MSG_FAILED, NULL, 0);
+            }
+        }
+        p2pRestart(p2p);
+        return;
+    }
+
+    for (uint16_t seq = win->txBase; seq != win->txNext; seq++)
+    {
+        p2pWinTxSlot_t* slot = &win->tx[WIN_IDX(seq)];
+        if (!slot->acked && nowUs - slot->lastSentUs >= WIN_RETRY_US)
+        {
+            P2P_LOG("Retrying fragment %" PRIu16, seq);
+            p2pWinTransmit(slot);
+        }
+    }
+}
+
+/**
+ * @brief Transmit a windowed fragment and note when it was sent
+ *
+ * @param slot The slot holding the fragment to transmit
+ */
+static void p2pWinTransmit(p2pWinTxSlot_t* slot)
+{
+    slot->lastSentUs = esp_timer_get_time();
+    espNowSend((const char*)&slot->msg, slot->len);
+}
+
+/**
+ * @brief Send a selective acknowledge for every windowed fragment which was received
+ *
+ * @param p2p The p2pInfo struct with all the state information
+ */
+static void p2pWinSendSack(p2pInfo* p2p)
+{
+    p2pWindow_t* win     = p2p->win;
+    p2pWinSackMsg_t sack = {0};
+
+    sack.hdr.startByte   = P2P_START_BYTE;
+    sack.hdr.modeId      = p2p->modeId;
+    sack.hdr.messageType = P2P_MSG_WIN_SACK;
+    sack.hdr.seqNum      = 0;
+    memcpy(sack.hdr.macAddr, p2p->cnc.otherMac, sizeof(sack.hdr.macAddr));
+    sack.cumAck = win->rxNext;
+
+    // Everything before rxNext was reassembled, so only the fragments after it may be waiting out of order
+    for (uint8_t i = 0; i < P2P_WIN_SIZE - 1; i++)
+    {
+        if (win->rx[WIN_IDX(win->rxNext + 1 + i)].received)
+        {
+            sack.sackBits |= (1 << i);
+        }
+    }
+
+    espNowSend((const char*)&sack, sizeof(sack));
+}
+
+/**
+ * @brief Store a received windowed fragment, deliver any messages which are now complete and in order, and
+ * acknowledge it
+ *
+ * @param p2p The p2pInfo struct with all the state information
+ * @param msg The received fragment
+ * @param len The length of the received fragment
+ */
+static void p2pWinDataRecv(p2pInfo* p2p, const p2pWinDataMsg_t* msg, uint8_t len)
+{
+    p2pWindow_t* win = p2p->win;
+
+    if (len <= offsetof(p2pWinDataMsg_t, data))
+    {
+        return;
+    }
+
+    // Only store fragments inside the receive window. Anything before it is a duplicate, which still gets a SACK in
+    // case the last one was lost
+    uint16_t ahead = msg->winSeq - win->rxNext;
+    if (ahead < P2P_WIN_SIZE)
+    {
+        p2pWinRxSlot_t* slot = &win->rx[WIN_IDX(msg->winSeq)];
+        if (!slot->received)
+        {
+            slot->received  = true;
+            slot->len       = len - offsetof(p2pWinDataMsg_t, data);
+            slot->fragIdx   = msg->fragIdx;
+            slot->fragCount = msg->fragCount;
+            memcpy(slot->data, msg->data, slot->len);
+        }
+    }
+
+    // Acknowledge before delivering, since the mode may take a while with the message
+    p2pWinSendSack(p2p);
+
+    // Reassemble fragments in order
+    while (win->rx[WIN_IDX(win->rxNext)].received)
+    {
+        p2pWinRxSlot_t* slot = &win->rx[WIN_IDX(win->rxNext)];
+        slot->received       = false;
+        win->rxNext++;
+
+        if (0 == slot->fragIdx)
+        {
+            win->rxMsgLen = 0;
+        }
+        if (win->rxMsgLen + slot->len <= P2P_WIN_MAX_MSG_LEN)
+        {
+            memcpy(&win->rxMsg[win->rxMsgLen], slot->data, slot->len);
+            win->rxMsgLen += slot->len;
+        }
+
+        // Deliver the message on its last fragment
+        if (slot->fragIdx == slot->fragCount - 1 && NULL != win->msgRxCbFn)
+        {
+            win->msgRxCbFn(p2p, win->rxMsg, win->rxMsgLen);
+        }
+    }
+}
+
+/**
+ * @brief Mark windowed fragments as acknowledged, slide the window past every acknowledged fragment, and notify the
+ * mode of every message which was completely acknowledged
+ *
+ * @param p2p The p2pInfo struct with all the state information
+ * @param sack The received selective acknowledge
+ */
+static void p2pWinSackRecv(p2pInfo* p2p, const p2pWinSackMsg_t* sack)
+{
+    p2pWindow_t* win = p2p->win;
+
+    for (uint16_t seq = win->txBase; seq != win->txNext; seq++)
+    {
+        // Fragments before cumAck were all received, fragments after it may be selectively acknowledged
+        uint16_t behind = sack->cumAck - seq - 1;
+        uint16_t ahead  = seq - sack->cumAck - 1;
+        if (behind < P2P_WIN_SIZE || (ahead < 32 && (sack->sackBits & (1u << ahead))))
+        {
+            win->tx[WIN_IDX(seq)].acked = true;
+        }
+    }
+
+    // Slide the window forward
+    while (win->txBase != win->txNext && win->tx[WIN_IDX(win->txBase)].acked)
+    {
+        p2pMsgTxCbFn msgTxCbFn = win->tx[WIN_IDX(win->txBase)].msgTxCbFn;
+        win->txBase++;
+        win->txProgressUs = esp_timer_get_time();
+
+        // The whole message was acknowledged. The mode may send another message from this callback
+        if (NULL != msgTxCbFn)
+        {
+            msgTxCbFn(p2p, MSG_ACKED, NULL, 0);
+        }
+    }
+}
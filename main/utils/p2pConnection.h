@@ -89,6 +89,26 @@
  * message will retry until it receives the acknowledge. p2pClearDataInAck() can be called to clear the data to be sent
  * in the acknowledge.
  *
+ * \section p2p_window Windowed Transport
+ *
+ * p2pSendMsg() is stop-and-wait, so only one message of up to ::P2P_MAX_DATA_LEN bytes can be sent per round trip. To
+ * send larger messages or many messages quickly, like syncing a full game state, call p2pEnableWindow() after
+ * p2pInitialize() and send with p2pSendMsgWindowed() instead. Call p2pWinPoll() every frame from the Swadge mode's main
+ * loop, which resends fragments that weren't acknowledged. Use #ESP_NOW rather than #ESP_NOW_IMMEDIATE, so that
+ * received fragments are handled in the main loop too.
+ *
+ * Windowed messages are split into fragments which fill an ESP-NOW frame. Up to ::P2P_WIN_SIZE fragments may be in
+ * flight at once, each with its own sequence number. The receiver selectively acknowledges every fragment it has, so
+ * only missing fragments are retried, and reassembles the fragments into the original messages in the order they were
+ * sent. Messages of up to ::P2P_WIN_MAX_MSG_LEN bytes are delivered to the #p2pWinMsgRxCbFn given to p2pEnableWindow().
+ *
+ * p2pSendMsgWindowed() returns false if the window doesn't have room for the whole message. p2pGetWindowSpace() returns
+ * how many bytes can be sent right now. The #p2pMsgTxCbFn for a message is called when all of its fragments are
+ * acknowledged. If the window doesn't move forward for three seconds, all pending messages fail and the connection is
+ * restarted, since the receiver can't skip the missing fragments.
+ *
+ * Windowed and regular messages may be mixed, but are not ordered relative to each other.
+ *
  * \section p2p_tips Tips
  *
  * p2pConnection can be finicky to use, so here are a few tips to ensure consistent connections and data transfer.
@@ -122,8 +142,8 @@
  *
  * -# p2pSendMsg() does not queue messages, so if you try to send multiple messages without first receiving the transmit
  * callback (#p2pMsgTxCbFn), then only the last sent message will be sent successfully. Instead, you should either
- * combine data into a single packet (which is preferred, fewer larger packets tend to be faster) or wait for a
- * transmission to completely finish before starting the next.
+ * combine data into a single packet (which is preferred, fewer larger packets tend to be faster), wait for a
+ * transmission to completely finish before starting the next, or use p2pSendMsgWindowed().
  *
  * \section p2p_example Example
  *
@@ -197,6 +217,15 @@
 /// The maximum payload of a p2p packet is 245 bytes
 #define P2P_MAX_DATA_LEN 245
 
+/// The number of windowed fragments which may be in flight at once. Must be a power of two, no more than 32
+#define P2P_WIN_SIZE 8
+
+/// The payload of one windowed fragment, which fills a 250 byte ESP-NOW frame after the 14 byte fragment header
+#define P2P_WIN_FRAG_LEN 236
+
+/// The largest message which may be sent with p2pSendMsgWindowed()
+#define P2P_WIN_MAX_MSG_LEN (P2P_WIN_SIZE * P2P_WIN_FRAG_LEN)
+
 /// After connecting, one Swadge will be ::GOING_FIRST and one will be ::GOING_SECOND
 typedef enum
 {
@@ -241,6 +270,15 @@ typedef void (*p2pConCbFn)(p2pInfo* p2p, connectionEvt_t evt);
  */
 typedef void (*p2pMsgRxCbFn)(p2pInfo* p2p, const uint8_t* payload, uint8_t len);
 
+/**
+ * @brief This typedef is for the function callback which delivers reassembled windowed messages to the Swadge mode
+ *
+ * @param p2p The p2pInfo
+ * @param payload The message that was received
+ * @param len The length of the message that was received, up to ::P2P_WIN_MAX_MSG_LEN
+ */
+typedef void (*p2pWinMsgRxCbFn)(p2pInfo* p2p, const uint8_t* payload, uint16_t len);
+
 /**
  * @brief This typedef is for the function callback which delivers acknowledge status for transmitted messages to the
  * Swadge mode
@@ -273,7 +311,7 @@ typedef void (*p2pAckFailureFn)(p2pInfo* p2p);
 #define P2P_START_BYTE 'p'
 
 /**
- * @brief The five different types of p2p messages
+ * @brief The different types of p2p messages
  */
 typedef enum __attribute__((packed))
 {
@@ -281,7 +319,9 @@ typedef enum __attribute__((packed))
     P2P_MSG_START,    ///< The start message, used during connection
     P2P_MSG_ACK,      ///< An acknowledge message
     P2P_MSG_DATA_ACK, ///< An acknowledge message with extra data
-    P2P_MSG_DATA      ///< A data message
+    P2P_MSG_DATA,     ///< A data message
+    P2P_MSG_WIN_DATA, ///< A fragment of a windowed data message
+    P2P_MSG_WIN_SACK  ///< A selective acknowledge of windowed data fragments
 } p2pMsgType_t;
 
 /**
@@ -315,6 +355,68 @@ typedef struct
     uint8_t data[P2P_MAX_DATA_LEN]; ///< The data bytes sent or received
 } p2pDataMsg_t;
 
+/**
+ * @brief The byte format for one fragment of a windowed P2P message
+ */
+typedef struct __attribute__((packed))
+{
+    p2pCommonHeader_t hdr;          ///< The common header bytes for a P2P packet
+    uint16_t winSeq;                ///< The window sequence number of this fragment
+    uint8_t fragIdx;                ///< The index of this fragment in its message
+    uint8_t fragCount;              ///< The number of fragments in this fragment's message
+    uint8_t data[P2P_WIN_FRAG_LEN]; ///< The data bytes of this fragment
+} p2pWinDataMsg_t;
+
+/**
+ * @brief The byte format for a selective acknowledge of windowed P2P fragments
+ */
+typedef struct __attribute__((packed))
+{
+    p2pCommonHeader_t hdr; ///< The common header bytes for a P2P packet
+    uint16_t cumAck;       ///< Every fragment before this sequence number was received
+    uint32_t sackBits;     ///< Bit n is set if fragment (cumAck + 1 + n) was received
+} p2pWinSackMsg_t;
+
+/**
+ * @brief A windowed fragment which was transmitted and is waiting to be acknowledged
+ */
+typedef struct
+{
+    p2pWinDataMsg_t msg;    ///< The transmitted fragment, kept for retries
+    uint8_t len;            ///< The length of the transmitted fragment
+    bool acked;             ///< true if this fragment was acknowledged
+    int64_t lastSentUs;     ///< The time this fragment was last transmitted
+    p2pMsgTxCbFn msgTxCbFn; ///< For the last fragment of a message, the callback for when the message is acknowledged
+} p2pWinTxSlot_t;
+
+/**
+ * @brief A windowed fragment which was received, possibly out of order
+ */
+typedef struct
+{
+    bool received;                  ///< true if this slot holds a fragment which hasn't been reassembled yet
+    uint8_t len;                    ///< The length of the fragment's data
+    uint8_t fragIdx;                ///< The index of this fragment in its message
+    uint8_t fragCount;              ///< The number of fragments in this fragment's message
+    uint8_t data[P2P_WIN_FRAG_LEN]; ///< The data bytes of this fragment
+} p2pWinRxSlot_t;
+
+/**
+ * @brief The state for the windowed transport, allocated by p2pEnableWindow()
+ */
+typedef struct
+{
+    p2pWinTxSlot_t tx[P2P_WIN_SIZE];    ///< Fragments in flight, indexed by sequence number modulo ::P2P_WIN_SIZE
+    uint16_t txBase;                    ///< The oldest sequence number which hasn't been acknowledged
+    uint16_t txNext;                    ///< The sequence number of the next fragment to transmit
+    int64_t txProgressUs;               ///< The last time txBase moved forward
+    p2pWinRxSlot_t rx[P2P_WIN_SIZE];    ///< Received fragments, indexed by sequence number modulo ::P2P_WIN_SIZE
+    uint16_t rxNext;                    ///< The next sequence number to reassemble
+    uint16_t rxMsgLen;                  ///< The number of bytes reassembled so far
+    uint8_t rxMsg[P2P_WIN_MAX_MSG_LEN]; ///< The message being reassembled
+    p2pWinMsgRxCbFn msgRxCbFn;          ///< A callback function called when a windowed message is received
+} p2pWindow_t;
+
 /**
  * @brief All the state variables required for a P2P session with another Swadge
  */
@@ -377,6 +479,8 @@ typedef struct _p2pInfo
         esp_timer_handle_t Connection;   ///< A timer used to cancel a connection if the handshake fails
         esp_timer_handle_t Reinit;       ///< A timer used to restart P2P after any complete failures
     } tmr;
+
+    p2pWindow_t* win; ///< The windowed transport state, or NULL if p2pEnableWindow() wasn't called
 } p2pInfo;
 
 /**
@@ -402,6 +506,11 @@ void p2pRecvCb(p2pInfo* p2p, const uint8_t* mac_addr, const uint8_t* data, uint8
 void p2pSetDataInAck(p2pInfo* p2p, const uint8_t* ackData, uint8_t ackDataLen);
 void p2pClearDataInAck(p2pInfo* p2p);
 
+bool p2pEnableWindow(p2pInfo* p2p, p2pWinMsgRxCbFn msgRxCbFn);
+bool p2pSendMsgWindowed(p2pInfo* p2p, const uint8_t* payload, uint16_t len, p2pMsgTxCbFn msgTxCbFn);
+uint16_t p2pGetWindowSpace(p2pInfo* p2p);
+void p2pWinPoll(p2pInfo* p2p);
+
 playOrder_t p2pGetPlayOrder(p2pInfo* p2p);
 void p2pSetPlayOrder(p2pInfo* p2p, playOrder_t order);
 
@@ -0,0 +1,249 @@
+//==============================================================================
+// Includes
+//==============================================================================
+
+#include "ringBuf.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+
+//==============================================================================
+// Static Function Prototypes
+//==============================================================================
+
+static bool ringBufMakeRoom(ringBuf_t* rb);
+
+//==============================================================================
+// Functions
+//==============================================================================
+
+/**
+ * @brief Initialize an empty ring buffer. If the values fit in ::RING_BUF_INLINE_BYTES, nothing is allocated
+ *
+ * @param rb The ring buffer to initialize
+ * @param elemSize The size of each value
+ * @param capacity The number of values the ring buffer has room for. If it's growable and more values fit inline, this
+ * is raised to that many
+ * @param growable true to grow when full, false to fail to add values when full
+ * @param caps The MALLOC_CAP_* flags to allocate the values with
+ */
+void ringBufInit(ringBuf_t* rb, size_t elemSize, uint32_t capacity, bool growable, uint32_t caps)
+{
+    memset(rb, 0, sizeof(ringBuf_t));
+    rb->elemSize = elemSize;
+    rb->caps     = caps;
+    rb->growable = growable;
+
+    if (capacity * elemSize <= RING_BUF_INLINE_BYTES)
+    {
+        // A growable buffer uses all the room that's already there. A fixed one keeps the requested capacity
+        rb->capacity = growable ? (RING_BUF_INLINE_BYTES / elemSize) : capacity;
+    }
+    else
+    {
+        rb->data     = heap_caps_malloc(capacity * elemSize, caps);
+        rb->capacity = (NULL != rb->data) ? capacity : 0;
+    }
+}
+
+/**
+ * @brief Free the values in a ring buffer, if they were allocated
+ *
+ * @param rb The ring buffer to deinitialize
+ */
+void ringBufDeinit(ringBuf_t* rb)
+{
+    heap_caps_free(rb->data);
+    rb->data     = NULL;
+    rb->head     = 0;
+    rb->length   = 0;
+    rb->capacity = 0;
+}
+
+/**
+ * @brief Remove every value from a ring buffer, keeping its memory for the next values
+ *
+ * @param rb The ring buffer to clear
+ */
+void ringBufClear(ringBuf_t* rb)
+{
+    rb->head   = 0;
+    rb->length = 0;
+}
+
+/**
+ * @brief Add a value to the back of a ring buffer
+ *
+ * @param rb The ring buffer to add to
+ * @param elem The value to copy into the ring buffer, or NULL to add a zeroed value
+ * @return A pointer to the added value, or NULL if the ring buffer is full
+ */
+void* ringBufPushBack(ringBuf_t* rb, const void* elem)
+{
+    if (!ringBufMakeRoom(rb))
+    {
+        return NULL;
+    }
+
+    rb->length++;
+    void* dest = ringBufAt(rb, rb->length - 1);
+    if (NULL != elem)
+    {
+        memcpy(dest, elem, rb->elemSize);
+    }
+    else
+    {
+        memset(dest, 0, rb->elemSize);
+    }
+    return dest;
+}
+
+/**
+ * @brief Add a value to the front of a ring buffer
+ *
+ * @param rb The ring buffer to add to
+ * @param elem The value to copy into the ring buffer, or NULL to add a zeroed value
+ * @return A pointer to the added value, or NULL if the ring buffer is full
+ */
+void* ringBufPushFront(ringBuf_t* rb, const void* elem)
+{
+    if (!ringBufMakeRoom(rb))
+    {
+        return NULL;
+    }
+
+    rb->head = (0 == rb->head) ? rb->capacity - 1 : rb->head - 1;
+    rb->length++;
+    void* dest = ringBufAt(rb, 0);
+    if (NULL != elem)
+    {
+        memcpy(dest, elem, rb->elemSize);
+    }
+    else
+    {
+        memset(dest, 0, rb->elemSize);
+    }
+    return dest;
+}
+
+/**
+ * @brief Remove the value at the front of a ring buffer
+ *
+ * @param rb The ring buffer to remove from
+ * @param[out] out Written with the removed value. May be NULL
+ * @return true if a value was removed, false if the ring buffer was empty
+ */
+bool ringBufPopFront(ringBuf_t* rb, void* out)
+{
+    if (0 == rb->length)
+    {
+        return false;
+    }
+
+    if (NULL != out)
+    {
+        memcpy(out, ringBufAt(rb, 0), rb->elemSize);
+    }
+    rb->head = (rb->head + 1 == rb->capacity) ? 0 : rb->head + 1;
+    rb->length--;
+    return true;
+}
+
+/**
+ * @brief Remove the value at the back of a ring buffer
+ *
+ * @param rb The ring buffer to remove from
+ * @param[out] out Written with the removed value. May be NULL
+ * @return true if a value was removed, false if the ring buffer was empty
+ */
+bool ringBufPopBack(ringBuf_t* rb, void* out)
+{
+    if (0 == rb->length)
+    {
+        return false;
+    }
+
+    if (NULL != out)
+    {
+        memcpy(out, ringBufAt(rb, rb->length - 1), rb->elemSize);
+    }
+    rb->length--;
+    return true;
+}
+
+/**
+ * @brief Add a value to either end of a ring buffer, checking the type's size too. Use ::RING_BUF_PUSH_BACK() or
+ * ::RING_BUF_PUSH_FRONT() instead of calling this directly
+ *
+ * @param rb The ring buffer to add to
+ * @param elem The value to copy into the ring buffer
+ * @param elemSize The size of the type the value is
+ * @param front true to add to the front, false to add to the back
+ * @return A pointer to the added value, or NULL if the ring buffer is full
+ */
+void* ringBufPushTyped(ringBuf_t* rb, const void* elem, size_t elemSize, bool front)
+{
+#ifdef CONFIG_CONTAINER_BOUNDS_CHECK
+    if (elemSize != rb->elemSize)
+    {
+        ringBufBoundsFail(rb, rb->length, elemSize);
+    }
+#endif
+    return front ? ringBufPushFront(rb, elem) : ringBufPushBack(rb, elem);
+}
+
+/**
+ * @brief Log an invalid access to a ring buffer and abort. This is only called when \c CONFIG_CONTAINER_BOUNDS_CHECK
+ * is set
+ *
+ * @param rb The ring buffer which was accessed
+ * @param idx The index which was accessed
+ * @param elemSize The size of the type the value was accessed as
+ */
+void ringBufBoundsFail(const ringBuf_t* rb, uint32_t idx, size_t elemSize)
+{
+    ESP_LOGE("RingBuf", "Invalid access to %p: index %" PRIu32 " of %" PRIu32 ", size %zu of %" PRIu32,
+             (const void*)rb, idx, rb->length, elemSize, rb->elemSize);
+    abort();
+}
+
+/**
+ * @brief Make sure there's room to add one more value to a ring buffer, growing it if it's full and growable
+ *
+ * @param rb The ring buffer to make room in
+ * @return true if there's room, false if the ring buffer is full
+ */
+static bool ringBufMakeRoom(ringBuf_t* rb)
+{
+    if (rb->length < rb->capacity)
+    {
+        return true;
+    }
+    else if (!rb->growable)
+    {
+        return false;
+    }
+
+    uint32_t newCapacity = rb->capacity ? rb->capacity * 2 : 4;
+    uint8_t* newData     = heap_caps_malloc(newCapacity * rb->elemSize, rb->caps);
+    if (NULL == newData)
+    {
+        return false;
+    }
+
+    // Copy the values to the start of the new memory, in order
+    uint32_t firstLen = rb->capacity - rb->head;
+    uint8_t* oldData  = rb->data ? rb->data : (uint8_t*)rb->inlineData;
+    memcpy(newData, oldData + rb->head * rb->elemSize, firstLen * rb->elemSize);
+    memcpy(newData + firstLen * rb->elemSize, oldData, (rb->length - firstLen) * rb->elemSize);
+
+    heap_caps_free(rb->data);
+    rb->data     = newData;
+    rb->head     = 0;
+    rb->capacity = newCapacity;
+    return true;
+}
@@ -0,0 +1,193 @@
+/*! \file ringBuf.h
+ *
+ * \section ringBuf_design Design Philosophy
+ *
+ * A ring buffer is a queue of same-sized values stored in one block of memory. Values can be added and removed at
+ * both ends in O(1), so it works as a queue, a stack, or a double-ended queue, without allocating a ::node_t for every
+ * value like a ::list_t does. Values are copied in, so small values like coordinates don't need to be allocated on
+ * their own.
+ *
+ * A ring buffer either has a fixed capacity, where adding to a full buffer fails, or grows to twice its capacity when
+ * it's full. Fixed buffers are good for things like input histories or packet queues with a known limit.
+ *
+ * Small queues are stored inside the ::ringBuf_t itself, in ::RING_BUF_INLINE_BYTES bytes, so a queue which usually
+ * holds a few values never allocates anything. If a growable queue outgrows that space, it moves to the heap.
+ *
+ * When \c CONFIG_CONTAINER_BOUNDS_CHECK is set, like it is in the emulator, every access is checked against the length
+ * and the typed macros check that the type is the right size. An invalid access is logged and aborts.
+ *
+ * \section ringBuf_usage Usage
+ *
+ * ringBufInit() sets up an empty ring buffer for values of a given size, and ringBufDeinit() frees it.
+ *
+ * ringBufPushBack() and ringBufPopFront() use the buffer as a queue. ringBufPushFront() and ringBufPopBack() add and
+ * remove at the other ends.
+ *
+ * ringBufAt() returns a pointer to a value, counting from the front. The ::RING_BUF_AT(), ::RING_BUF_PUSH_BACK(), and
+ * ::RING_BUF_PUSH_FRONT() macros do the same with a type, so values can be read, written, and added without casting.
+ *
+ * \section ringBuf_example Example
+ *
+ * \code{.c}
+ * typedef struct
+ * {
+ *     int16_t x;
+ *     int16_t y;
+ * } tilePos_t;
+ *
+ * // A queue which grows as needed. The first few values are stored in the queue itself
+ * ringBuf_t toCrumble;
+ * ringBufInit(&toCrumble, sizeof(tilePos_t), 4, true, MALLOC_CAP_8BIT);
+ *
+ * RING_BUF_PUSH_BACK(&toCrumble, tilePos_t, .x = 3, .y = 4);
+ * RING_BUF_PUSH_BACK(&toCrumble, tilePos_t, .x = 5, .y = 6);
+ *
+ * // Look at the next value without removing it
+ * int16_t nextX = RING_BUF_AT(&toCrumble, tilePos_t, 0).x;
+ *
+ * // Handle the values in the order they were added
+ * tilePos_t pos;
+ * while (ringBufPopFront(&toCrumble, &pos))
+ * {
+ *     printf("%d, %d\n", pos.x, pos.y);
+ * }
+ *
+ * ringBufDeinit(&toCrumble);
+ * \endcode
+ */
+
+#ifndef _RING_BUF_H_
+#define _RING_BUF_H_
+
+//==============================================================================
+// Includes
+//==============================================================================
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+//==============================================================================
+// Defines
+//==============================================================================
+
+/// The number of bytes of values stored inside a ::ringBuf_t before it allocates memory
+#define RING_BUF_INLINE_BYTES 32
+
+/**
+ * @brief Access the value at an index in a ::ringBuf_t, counting from the front, as the given type. This can be read
+ * or assigned
+ *
+ * @param rb A pointer to the ring buffer
+ * @param type The type of the values in the ring buffer
+ * @param idx The index of the value
+ */
+#define RING_BUF_AT(rb, type, idx) (*(type*)ringBufAtTyped((rb), (idx), sizeof(type)))
+
+/**
+ * @brief Add a value of the given type to the back of a ::ringBuf_t. The value is given as an initializer, like \c 5
+ * or <tt>.x = 3, .y = 4</tt>
+ *
+ * @param rb A pointer to the ring buffer
+ * @param type The type of the values in the ring buffer
+ * @return A pointer to the added value, or NULL if the ring buffer is full
+ */
+#define RING_BUF_PUSH_BACK(rb, type, ...) ringBufPushTyped((rb), &(type){__VA_ARGS__}, sizeof(type), false)
+
+/**
+ * @brief Add a value of the given type to the front of a ::ringBuf_t. The value is given as an initializer, like \c 5
+ * or <tt>.x = 3, .y = 4</tt>
+ *
+ * @param rb A pointer to the ring buffer
+ * @param type The type of the values in the ring buffer
+ * @return A pointer to the added value, or NULL if the ring buffer is full
+ */
+#define RING_BUF_PUSH_FRONT(rb, type, ...) ringBufPushTyped((rb), &(type){__VA_ARGS__}, sizeof(type), true)
+
+//==============================================================================
+// Structs
+//==============================================================================
+
+/**
+ * @brief A queue of same-sized values which can be added and removed at both ends
+ */
+typedef struct
+{
+    uint8_t* data;     ///< The values, or NULL if they're stored in inlineData
+    uint32_t head;     ///< The index of the value at the front
+    uint32_t length;   ///< The number of values in the ring buffer
+    uint32_t capacity; ///< The number of values the ring buffer has room for
+    uint32_t elemSize; ///< The size of each value
+    uint32_t caps;     ///< The MALLOC_CAP_* flags the values are allocated with
+    bool growable;     ///< true to grow when full, false to fail to add values when full
+    /// The values, when there are few enough. This isn't pointed to by data so the struct may be copied
+    uint64_t inlineData[RING_BUF_INLINE_BYTES / sizeof(uint64_t)];
+} ringBuf_t;
+
+//==============================================================================
+// Function Prototypes
+//==============================================================================
+
+void ringBufInit(ringBuf_t* rb, size_t elemSize, uint32_t capacity, bool growable, uint32_t caps);
+void ringBufDeinit(ringBuf_t* rb);
+void ringBufClear(ringBuf_t* rb);
+
+void* ringBufPushBack(ringBuf_t* rb, const void* elem);
+void* ringBufPushFront(ringBuf_t* rb, const void* elem);
+bool ringBufPopFront(ringBuf_t* rb, void* out);
+bool ringBufPopBack(ringBuf_t* rb, void* out);
+
+void* ringBufPushTyped(ringBuf_t* rb, const void* elem, size_t elemSize, bool front);
+void ringBufBoundsFail(const ringBuf_t* rb, uint32_t idx, size_t elemSize);
+
+//==============================================================================
+// Inline Functions
+//==============================================================================
+
+/**
+ * @brief Get a pointer to the value at an index in a ring buffer, counting from the front
+ *
+ * @param rb The ring buffer
+ * @param idx The index of the value, which must be less than the length
+ * @return A pointer to the value, which is valid until a value is added or the front value is removed
+ */
+static inline void* ringBufAt(ringBuf_t* rb, uint32_t idx)
+{
+#ifdef CONFIG_CONTAINER_BOUNDS_CHECK
+    if (idx >= rb->length)
+    {
+        ringBufBoundsFail(rb, idx, rb->elemSize);
+    }
+#endif
+    uint32_t pos = rb->head + idx;
+    if (pos >= rb->capacity)
+    {
+        pos -= rb->capacity;
+    }
+    uint8_t* data = rb->data ? rb->data : (uint8_t*)rb->inlineData;
+    return data + pos * rb->elemSize;
+}
+
+/**
+ * @brief Get a pointer to the value at an index in a ring buffer, checking the type's size too. Use ::RING_BUF_AT()
+ * instead of calling this directly
+ *
+ * @param rb The ring buffer
+ * @param idx The index of the value, which must be less than the length
+ * @param elemSize The size of the type the value is accessed as
+ * @return A pointer to the value, which is valid until a value is added or the front value is removed
+ */
+static inline void* ringBufAtTyped(ringBuf_t* rb, uint32_t idx, size_t elemSize)
+{
+#ifdef CONFIG_CONTAINER_BOUNDS_CHECK
+    if (elemSize != rb->elemSize)
+    {
+        ringBufBoundsFail(rb, idx, elemSize);
+    }
+#endif
+    return ringBufAt(rb, idx);
+}
+
+#endif
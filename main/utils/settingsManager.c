@@ -2,6 +2,9 @@
 // Includes
 //==============================================================================
 
+#include <esp_timer.h>
+#include <esp_log.h>
+
 #include "hdw-nvs.h"
 #include "midiPlayer.h"
 #include "hdw-tft.h"
@@ -27,6 +30,9 @@ typedef struct
 // Defines
 //==============================================================================
 
+/// Changed settings are saved to NVS once no setting has changed for this long
+#define SETTINGS_SAVE_IDLE_US 1000000
+
 /**
  * @brief Helper macro to declare const parameters for settings, and the variable setting
  * @param NAME the key for this setting, also used in variable names
@@ -66,6 +72,29 @@ DECL_SETTING(gp_touch, GAMEPAD_TOUCH_MORE_BUTTONS_SETTING, GAMEPAD_TOUCH_R_STICK
              GAMEPAD_TOUCH_MORE_BUTTONS_SETTING);
 DECL_SETTING(show_secrets, SHOW_SECRETS, HIDE_SECRETS, HIDE_SECRETS);
 
+/// All settings. A setting's index in this array is its bit in the dirty mask
+static setting_t* const allSettings[] = {
+    &test_setting,
+    &tutorial_setting,
+#ifdef SW_VOL_CONTROL
+    &bgm_setting,
+    &sfx_setting,
+#endif
+    &tft_br_setting,
+    &led_br_setting,
+    &mic_setting,
+    &cc_mode_setting,
+    &scrn_sv_setting,
+    &gp_accel_setting,
+    &gp_touch_setting,
+    &show_secrets_setting,
+};
+
+/// A bit for each setting in allSettings which was changed in RAM but not saved to NVS yet
+static uint32_t dirtyMask = 0;
+/// The time the most recent setting was changed, from esp_timer_get_time()
+static int64_t lastChangeUs = 0;
+
 //==============================================================================
 // Static Function Prototypes
 //==============================================================================
@@ -74,6 +103,7 @@ static bool readSetting(setting_t* setting);
 static bool incSetting(setting_t* setting);
 static bool decSetting(setting_t* setting);
 static bool setSetting(setting_t* setting, uint32_t newVal);
+static void markSettingDirty(setting_t* setting);
 
 //==============================================================================
 // Static Functions
@@ -90,55 +120,137 @@ static bool readSetting(setting_t* setting)
     // Read the setting into val
     if (false == readNvs32(setting->param->key, &setting->val))
     {
-        // If the read failed, set val to default and write it
-        return setSetting(setting, setting->param->def);
+        // If the read failed, set val to default and save it later
+        setting->val = setting->param->def;
+        markSettingDirty(setting);
     }
     return true;
 }
 
 /**
- * @brief Internal helper function to increment a setting_t's value by one and write it to RAM and NVS.
+ * @brief Internal helper function to increment a setting_t's value by one in RAM. It is saved to NVS later.
  * This will not increment the value past the setting's max.
  *
  * @param setting The setting to increment by one
- * @return true if the setting was written, false if it was not
+ * @return true
  */
 static bool incSetting(setting_t* setting)
 {
-    setting->val = MIN(setting->val + 1, setting->param->max);
-    return writeNvs32(setting->param->key, setting->val);
+    return setSetting(setting, MIN(setting->val + 1, setting->param->max));
 }
 
 /**
- * @brief Internal helper function to decrement a setting_t's value by one and write it to RAM and NVS.
+ * @brief Internal helper function to decrement a setting_t's value by one in RAM. It is saved to NVS later.
  * This will not decrement the value past the setting's min.
  *
  * @param setting The setting to decrement by one
- * @return true if the setting was written, false if it was not
+ * @return true
  */
 static bool decSetting(setting_t* setting)
 {
-    setting->val = MAX(setting->val - 1, setting->param->min);
-    return writeNvs32(setting->param->key, setting->val);
+    return setSetting(setting, MAX(setting->val - 1, setting->param->min));
 }
 
 /**
- * @brief Internal helper function to set a setting_t's value and write it to RAM and NVS.
+ * @brief Internal helper function to set a setting_t's value in RAM. It is saved to NVS later.
  * This will not set the value past the setting's min or max.
  *
- * @param setting The setting to increment by one
- * @return true if the setting was written, false if it was not
+ * @param setting The setting to set
+ * @param newVal The new value for the setting
+ * @return true
  */
 static bool setSetting(setting_t* setting, uint32_t newVal)
 {
-    setting->val = CLAMP(newVal, setting->param->min, setting->param->max);
-    return writeNvs32(setting->param->key, setting->val);
+    int32_t clamped = CLAMP((int32_t)newVal, setting->param->min, setting->param->max);
+    if (clamped != setting->val)
+    {
+        setting->val = clamped;
+        markSettingDirty(setting);
+    }
+    return true;
+}
+
+/**
+ * @brief Internal helper function to note that a setting's value in RAM needs to be saved to NVS
+ *
+ * @param setting The setting which changed
+ */
+static void markSettingDirty(setting_t* setting)
+{
+    for (int32_t i = 0; i < ARRAY_SIZE(allSettings); i++)
+    {
+        if (allSettings[i] == setting)
+        {
+            dirtyMask |= (1 << i);
+            break;
+        }
+    }
+    lastChangeUs = esp_timer_get_time();
 }
 
 //==============================================================================
 // Functions
 //==============================================================================
 
+/**
+ * @brief Save every changed setting to NVS with a single commit. This is called when a Swadge mode exits and before
+ * the system sleeps, so nothing is lost. It does nothing if no settings changed.
+ *
+ * @return true if all changed settings were saved, false if they weren't. Unsaved settings are tried again later
+ */
+bool saveSettings(void)
+{
+    if (0 == dirtyMask)
+    {
+        return true;
+    }
+
+    nvsBatch_t batch;
+    nvsBatchBegin(&batch, NVS_NAMESPACE_NAME);
+    for (int32_t i = 0; i < ARRAY_SIZE(allSettings); i++)
+    {
+        if (dirtyMask & (1 << i))
+        {
+            nvsBatchWrite32(&batch, allSettings[i]->param->key, allSettings[i]->val);
+        }
+    }
+
+    if (nvsBatchCommit(&batch))
+    {
+        dirtyMask = 0;
+        return true;
+    }
+
+    // Wait for another idle period before trying again
+    ESP_LOGE("SET", "Couldn't save settings");
+    lastChangeUs = esp_timer_get_time();
+    return false;
+}
+
+/**
+ * @brief Save changed settings once no setting has changed for a while. This is called from the system's main loop, so
+ * a setting which changes quickly, like from a slider, is only written once it settles.
+ */
+void pollSettingsSave(void)
+{
+    if (0 != dirtyMask && (esp_timer_get_time() - lastChangeUs) >= SETTINGS_SAVE_IDLE_US)
+    {
+        saveSettings();
+    }
+}
+
+/**
+ * @brief Get the settings which were changed but not saved to NVS yet
+ *
+ * @return A bit mask of unsaved settings, where each bit is one setting. This is 0 if every setting is saved
+ */
+uint32_t getDirtySettingsMask(void)
+{
+    return dirtyMask;
+}
+
+//==============================================================================
+
 /**
  * @brief Read all settings from NVM and set the appropriate hardware peripherals, like TFT and LED brightness
  */
@@ -206,10 +318,10 @@ const settingParam_t* getBgmVolumeSettingBounds(void)
 }
 
 /**
- * @brief Set the current background music volume setting. This calls bzrSetBgmVolume() after writing to NVS.
+ * @brief Set the current background music volume setting. This calls bzrSetBgmVolume() after setting the value.
  *
  * @param vol The new volume setting, 0 to MAX_VOLUME
- * @return true if the setting was written, false if it wasn't
+ * @return true if the setting was set, false if it wasn't
  */
 bool setBgmVolumeSetting(uint16_t vol)
 {
@@ -244,10 +356,10 @@ const settingParam_t* getSfxVolumeSettingBounds(void)
 }
 
 /**
- * @brief Set the current sound effects volume setting. This calls bzrSetSfxVolume() after writing to NVS.
+ * @brief Set the current sound effects volume setting. This calls bzrSetSfxVolume() after setting the value.
  *
  * @param vol The new volume setting, 0 to MAX_VOLUME
- * @return true if the setting was written, false if it wasn't
+ * @return true if the setting was set, false if it wasn't
  */
 bool setSfxVolumeSetting(uint16_t vol)
 {
@@ -284,10 +396,10 @@ const settingParam_t* getTftBrightnessSettingBounds(void)
 }
 
 /**
- * @brief Set the current TFT brightness setting. This calls setTFTBacklightBrightness() after writing to NVS.
+ * @brief Set the current TFT brightness setting. This calls setTFTBacklightBrightness() after setting the value.
  *
  * @param newVal the new TFT brightness setting, 0 to MAX_TFT_BRIGHTNESS
- * @return true if the setting was written, false if it wasn't
+ * @return true if the setting was set, false if it wasn't
  */
 bool setTftBrightnessSetting(uint8_t newVal)
 {
@@ -322,10 +434,10 @@ const settingParam_t* getLedBrightnessSettingBounds(void)
 }
 
 /**
- * @brief Set the current LED brightness setting. This calls setLedBrightness() after writing to NVS.
+ * @brief Set the current LED brightness setting. This calls setLedBrightness() after setting the value.
  *
  * @param brightness The new LED brightness setting, 0 to MAX_LED_BRIGHTNESS
- * @return true if the setting was written, false if it was not
+ * @return true if the setting was set, false if it was not
  */
 bool setLedBrightnessSetting(uint8_t brightness)
 {
@@ -338,9 +450,9 @@ bool setLedBrightnessSetting(uint8_t brightness)
 }
 
 /**
- * @brief Increment the LED brightness setting by one. This calls setLedBrightness() after writing to NVS.
+ * @brief Increment the LED brightness setting by one. This calls setLedBrightness() after setting the value.
  *
- * @return true if the setting was written, false if it was not
+ * @return true if the setting was set, false if it was not
  */
 bool incLedBrightnessSetting(void)
 {
@@ -353,9 +465,9 @@ bool incLedBrightnessSetting(void)
 }
 
 /**
- * @brief Decrement the LED brightness setting by one. This calls setLedBrightness() after writing to NVS.
+ * @brief Decrement the LED brightness setting by one. This calls setLedBrightness() after setting the value.
  *
- * @return true if the setting was written, false if it was not
+ * @return true if the setting was set, false if it was not
  */
 bool decLedBrightnessSetting(void)
 {
@@ -393,7 +505,7 @@ const settingParam_t* getMicGainSettingBounds(void)
  * @brief Set the current microphone gain setting. The new value is immediately used when sampling the microphone.
  *
  * @param newGain The new microphone gain setting, 0 to MAX_MIC_GAIN
- * @return true if the setting was written, false if it wasn't
+ * @return true if the setting was set, false if it wasn't
  */
 bool setMicGainSetting(uint8_t newGain)
 {
@@ -403,7 +515,7 @@ bool setMicGainSetting(uint8_t newGain)
 /**
  * @brief Decrement the microphone gain setting by one. The new value is immediately used when sampling the microphone.
  *
- * @return true if the setting was written, false if it was not
+ * @return true if the setting was set, false if it was not
  */
 bool decMicGainSetting(void)
 {
@@ -413,7 +525,7 @@ bool decMicGainSetting(void)
 /**
  * @brief Decrement the microphone gain setting by one. The new value is immediately used when sampling the microphone.
  *
- * @return true if the setting was written, false if it was not
+ * @return true if the setting was set, false if it was not
  */
 bool incMicGainSetting(void)
 {
@@ -446,7 +558,7 @@ const settingParam_t* getScreensaverTimeSettingBounds(void)
  * @brief Set the current screensaver timeout setting. The new value is immediately used for the screensaver timeout.
  *
  * @param val The new screensaver timeout setting
- * @return true if the setting was written, false if it wasn't
+ * @return true if the setting was set, false if it wasn't
  */
 bool setScreensaverTimeSetting(uint16_t val)
 {
@@ -470,7 +582,7 @@ colorchordMode_t getColorchordModeSetting(void)
  * @brief Set the current Colorchord LED output setting. The new value is immediately used when sampling the microphone.
  *
  * @param newMode The new Colorchord LED output setting
- * @return true if the setting was written, false if it wasn't
+ * @return true if the setting was set, false if it wasn't
  */
 bool setColorchordModeSetting(colorchordMode_t newMode)
 {
@@ -493,7 +605,7 @@ bool getTestModePassedSetting(void)
  * @brief Set the current test mode passed setting.
  *
  * @param status The new test mode passed setting
- * @return true if the setting was written, false if it wasn't
+ * @return true if the setting was set, false if it wasn't
  */
 bool setTestModePassedSetting(bool status)
 {
@@ -514,7 +626,7 @@ bool getTutorialCompletedSetting(void)
  * @brief Set the current tutorial completed setting.
  *
  * @param status The new tutorial completed setting
- * @return true if the setting was written, false if it wasn't
+ * @return true if the setting was set, false if it wasn't
  */
 bool setTutorialCompletedSetting(bool status)
 {
@@ -545,7 +657,7 @@ const settingParam_t* getGamepadAccelSettingBounds(void)
  * @brief Set the current Gamepad accel setting.
  *
  * @param status The new Gamepad accel setting
- * @return true if the setting was written, false if it wasn't
+ * @return true if the setting was set, false if it wasn't
  */
 bool setGamepadAccelSetting(bool status)
 {
@@ -576,7 +688,7 @@ const settingParam_t* getGamepadTouchSettingBounds(void)
  * @brief Set the current Gamepad touch setting.
  *
  * @param status The new Gamepad touch setting
- * @return true if the setting was written, false if it wasn't
+ * @return true if the setting was set, false if it wasn't
  */
 bool setGamepadTouchSetting(gamepadTouch_t status)
 {
@@ -608,7 +720,7 @@ const settingParam_t* getShowSecretsMenuSettingBounds(void)
  * @brief Set the current setting to show Secrets menu on the main menu.
  *
  * @param status The new setting to show Secrets menu on the main menu
- * @return true if the setting was written, false if it wasn't
+ * @return true if the setting was set, false if it wasn't
  */
 bool setShowSecretsMenuSetting(showSecrets_t status)
 {
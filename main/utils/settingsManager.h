@@ -18,6 +18,12 @@
  *
  * Settings rely heavily on, and can be thought of a wrapper around, hdw-nvs.h.
  *
+ * The value in RAM is the authoritative copy. Changing a setting only changes RAM and marks the setting dirty, so
+ * adjusting a setting quickly, like with a slider in the quick settings, costs no flash writes. pollSettingsSave() is
+ * called from the system's main loop and saves all dirty settings with a single NVS commit once no setting has changed
+ * for a second. saveSettings() saves them right away, and is called by the system when a Swadge mode exits and before
+ * it sleeps. getDirtySettingsMask() returns which settings haven't been saved yet.
+ *
  * Settings can be easily added to menus with the function addSettingsItemToMenu(). Be sure to set the setting in the
  * ::menuCb callback according to the new \c value.
  *
@@ -37,6 +43,8 @@
  * readAllSettings() is called during system initialization to read all settings into RAM and set hardware peripherals
  * accordingly.
  *
+ * New settings must also be added to \c allSettings in settingsManager.c so they are saved.
+ *
  * \section settingsManager_example Example
  *
  * Adding a setting to a menu:
@@ -109,6 +117,9 @@ typedef struct
 //==============================================================================
 
 void readAllSettings(void);
+bool saveSettings(void);
+void pollSettingsSave(void);
+uint32_t getDirtySettingsMask(void);
 
 #ifdef SW_VOL_CONTROL
 uint16_t getBgmVolumeSetting(void);
@@ -11,6 +11,8 @@ else
     echo
     echo "Converts any audio or video file to the appropriate format for the Swadge DAC"
     echo " Note: Requires ffmpeg / libavcodec and sox"
+    echo " Set RATE to store the sample at a lower rate, like RATE=8192 $0 <input-file>."
+    echo " Sample timbres are resampled at playback, so the timbre's .rate must match."
     exit 0
 fi
 
@@ -31,8 +33,9 @@ if ! sox --version >/dev/null 2>&1; then
 fi
 
 OUTFILE="${1%.*}.raw"
+RATE="${RATE:-32768}"
 
-if $FFMPEG -hide_banner -loglevel warning -i "$1" -f wav - | sox -t wav - -t raw -r 32768 -b 8 -c 1 -e unsigned-integer "$OUTFILE" $TRIM ; then
+if $FFMPEG -hide_banner -loglevel warning -i "$1" -f wav - | sox -t wav - -t raw -r "$RATE" -b 8 -c 1 -e unsigned-integer "$OUTFILE" $TRIM ; then
     echo "Converted output saved to $OUTFILE"
 else
     CODE=$?
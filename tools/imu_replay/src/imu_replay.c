@@ -0,0 +1,487 @@
+//==============================================================================
+// Includes
+//==============================================================================
+
+#include <getopt.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hdw-imu.h"
+#include "imuFusion.h"
+#include "quaternions.h"
+
+//==============================================================================
+// Defines
+//==============================================================================
+
+#define DEFAULT_ODR_HZ        208.0f
+#define DEFAULT_BATCH_SAMPLES 16
+#define DEFAULT_SECONDS       60
+#define DEFAULT_MAX_DPS       1000.0f
+#define DEFAULT_NOISE_COUNTS  2.0f
+
+/// Raw accelerometer counts per g at 16 g full-scale
+#define ACCEL_COUNTS_PER_G 2048
+
+#define RAD_TO_DEG (180.0 / M_PI)
+
+//==============================================================================
+// Structs
+//==============================================================================
+
+/**
+ * @brief The floating point fusion the fixed point fusion replaced, with the same per-ODR scaling
+ */
+typedef struct
+{
+    float quat[4];
+    float bias[3]; ///< Bias in raw gyro counts
+    float gyroScale;
+    float biasDrift;
+    float correctiveForce;
+    uint32_t sampCount;
+} floatFusion_t;
+
+/**
+ * @brief A source of raw FIFO samples, either a CSV file or synthetic motion with a known orientation
+ */
+typedef struct
+{
+    FILE* csv;
+    float odrHz;
+    uint32_t samplesLeft;
+    double maxRadPerSec;
+    double noiseCounts;
+    double t;
+    double truth[4];
+} sampleSource_t;
+
+/**
+ * @brief Running maximum and RMS of an angle
+ */
+typedef struct
+{
+    double max;
+    double sumSq;
+    uint32_t count;
+} angleStats_t;
+
+//==============================================================================
+// Function Declarations
+//==============================================================================
+
+static void printUsage(void);
+static void floatFusionReset(floatFusion_t* ff, float odrHz);
+static void floatFusionSample(floatFusion_t* ff, const int16_t* euler_deltas, const int16_t* accel_data);
+static void floatFusionEndBatch(floatFusion_t* ff);
+static float signedSqrtf(float x);
+static double gaussian(void);
+static bool nextSample(sampleSource_t* src, int16_t* sample);
+static double quatAngle(const float* a, const double* b);
+static double upAngle(const float* qa, const double* qb);
+static void addAngle(angleStats_t* stats, double rad);
+static void printAngle(const char* label, const angleStats_t* stats);
+
+//==============================================================================
+// Functions
+//==============================================================================
+
+/**
+ * @brief Print how to use this program
+ */
+static void printUsage(void)
+{
+    printf("Usage:\n"
+           "  imu_replay\n"
+           "    [-i CSV_FILE]       Raw FIFO samples to replay, one \"gx,gy,gz,ax,ay,az\" per line. If omitted,\n"
+           "                        motion with a known orientation is synthesized\n"
+           "    [-r ODR_HZ]         The output data rate the samples were taken at (default %g)\n"
+           "    [-b BATCH_SAMPLES]  How many samples to fuse between normalizing and comparing (default %d)\n"
+           "    [-t SECONDS]        How long to synthesize motion for (default %d)\n"
+           "    [-w MAX_DPS]        The peak synthesized rotation speed, in degrees per second (default %g)\n"
+           "    [-n NOISE_COUNTS]   The standard deviation of synthesized gyro noise, in raw counts (default %g)\n",
+           DEFAULT_ODR_HZ, DEFAULT_BATCH_SAMPLES, DEFAULT_SECONDS, DEFAULT_MAX_DPS, DEFAULT_NOISE_COUNTS);
+}
+
+/**
+ * @brief Reset the floating point fusion and scale it to an output data rate, like imuFusionReset()
+ *
+ * @param ff The floating point fusion state
+ * @param odrHz The output data rate, in Hz
+ */
+static void floatFusionReset(floatFusion_t* ff, float odrHz)
+{
+    memset(ff, 0, sizeof(*ff));
+    ff->quat[0]         = 1;
+    ff->gyroScale       = GYRO_RAD_PER_COUNT_SEC / odrHz;
+    ff->biasDrift       = GYRO_BIAS_DRIFT_208 / GYRO_SCALE_208 * (208.0 / odrHz);
+    ff->correctiveForce = CORRECTIVE_FORCE_208 * (208.0 / odrHz);
+}
+
+/**
+ * @brief Fuse one sample in floating point, the same way imuFusionSample() does in fixed point
+ *
+ * @param ff The floating point fusion state
+ * @param euler_deltas Three raw gyro values
+ * @param accel_data Three raw accelerometer values
+ */
+static void floatFusionSample(floatFusion_t* ff, const int16_t* euler_deltas, const int16_t* accel_data)
+{
+    float fEulers[3] = {
+        (-euler_deltas[0] + ff->bias[0]) * ff->gyroScale,
+        (euler_deltas[1] + ff->bias[1]) * ff->gyroScale,
+        (-euler_deltas[2] + ff->bias[2]) * ff->gyroScale,
+    };
+    float qDelta[4];
+    mathEulerToQuat(qDelta, fEulers);
+    mathQuatApply(ff->quat, ff->quat, qDelta);
+
+    float accel_up[3] = {-accel_data[0], accel_data[1], -accel_data[2]};
+    float accel_magsq = accel_up[0] * accel_up[0] + accel_up[1] * accel_up[1] + accel_up[2] * accel_up[2];
+    if (0 == accel_magsq)
+    {
+        return;
+    }
+    float accel_inverse_mag = 1.0f / sqrtf(accel_magsq);
+    accel_up[0] *= accel_inverse_mag;
+    accel_up[1] *= accel_inverse_mag;
+    accel_up[2] *= accel_inverse_mag;
+
+    if (ff->sampCount++ == 0)
+    {
+        float ideal_up[3] = {0, 1, 0};
+        mathQuatFromTwoVectors(ff->quat, ideal_up, accel_up);
+    }
+    else
+    {
+        float what_we_think_is_up[3] = {0, 1, 0};
+        mathRotateVectorByInverseOfQuaternion(what_we_think_is_up, ff->quat, what_we_think_is_up);
+
+        float corrective_quaternion[4];
+        mathCrossProduct(corrective_quaternion + 1, accel_up, what_we_think_is_up);
+
+        ff->bias[0] += signedSqrtf(corrective_quaternion[1]) * ff->biasDrift;
+        ff->bias[1] += signedSqrtf(corrective_quaternion[2]) * ff->biasDrift;
+        ff->bias[2] += signedSqrtf(corrective_quaternion[3]) * ff->biasDrift;
+
+        corrective_quaternion[1] *= ff->correctiveForce;
+        corrective_quaternion[2] *= ff->correctiveForce;
+        corrective_quaternion[3] *= ff->correctiveForce;
+        corrective_quaternion[0] = sqrtf(1 - corrective_quaternion[1] * corrective_quaternion[1]
+                                         - corrective_quaternion[2] * corrective_quaternion[2]
+                                         - corrective_quaternion[3] * corrective_quaternion[3]);
+
+        mathQuatApply(ff->quat, ff->quat, corrective_quaternion);
+    }
+}
+
+/**
+ * @brief Normalize the floating point orientation after a batch of samples
+ *
+ * @param ff The floating point fusion state
+ */
+static void floatFusionEndBatch(floatFusion_t* ff)
+{
+    mathQuatNormalize(ff->quat, ff->quat);
+}
+
+/**
+ * @brief Take the square root of the magnitude of a number, keeping its sign. This matches the fixed point fusion,
+ * unlike mathsqrtf(), which never returns less than 0.0001.
+ *
+ * @param x A number
+ * @return sqrt(|x|) with the sign of x
+ */
+static float signedSqrtf(float x)
+{
+    return (x < 0) ? -sqrtf(-x) : sqrtf(x);
+}
+
+/**
+ * @brief Get a normally distributed random number
+ *
+ * @return A random number with a mean of 0 and a standard deviation of 1
+ */
+static double gaussian(void)
+{
+    double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    double u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+/**
+ * @brief Get the next raw FIFO sample. Synthetic motion also advances the true orientation.
+ *
+ * @param src The sample source
+ * @param sample Six raw values are written here, three gyro then three accelerometer
+ * @return true if a sample was read, false if there are no more
+ */
+static bool nextSample(sampleSource_t* src, int16_t* sample)
+{
+    if (src->csv)
+    {
+        char line[256];
+        while (fgets(line, sizeof(line), src->csv))
+        {
+            int v[6];
+            if ('#' != line[0]
+                && 6 == sscanf(line, "%d,%d,%d,%d,%d,%d", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5]))
+            {
+                for (int i = 0; i < 6; i++)
+                {
+                    sample[i] = v[i];
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    if (0 == src->samplesLeft)
+    {
+        return false;
+    }
+    src->samplesLeft--;
+
+    // Each axis swings back and forth at its own rate, so every kind of turn happens eventually
+    double dt          = 1.0 / src->odrHz;
+    double radPerCount = GYRO_RAD_PER_COUNT_SEC / src->odrHz;
+    double eulers[3] = {
+        src->maxRadPerSec * dt * sin(2 * M_PI * 0.13 * src->t),
+        src->maxRadPerSec * dt * sin(2 * M_PI * 0.21 * src->t),
+        src->maxRadPerSec * dt * sin(2 * M_PI * 0.34 * src->t + 1),
+    };
+    src->t += dt;
+
+    // The fusion negates X and Z, so the gyro counts do too
+    double counts[3] = {-eulers[0] / radPerCount, eulers[1] / radPerCount, -eulers[2] / radPerCount};
+    for (int i = 0; i < 3; i++)
+    {
+        double c  = round(counts[i] + src->noiseCounts * gaussian());
+        sample[i] = (c > INT16_MAX) ? INT16_MAX : (c < INT16_MIN) ? INT16_MIN : c;
+    }
+
+    // Advance the true orientation, the same way mathEulerToQuat() and mathQuatApply() do, in double precision
+    double cr = cos(eulers[0] / 2), sr = sin(eulers[0] / 2);
+    double cp = cos(eulers[1] / 2), sp = sin(eulers[1] / 2);
+    double cy = cos(eulers[2] / 2), sy = sin(eulers[2] / 2);
+    double d[4] = {
+        cr * cp * cy + sr * sp * sy,
+        sr * cp * cy - cr * sp * sy,
+        cr * sp * cy + sr * cp * sy,
+        cr * cp * sy - sr * sp * cy,
+    };
+    double* q  = src->truth;
+    double w   = q[0] * d[0] - q[1] * d[1] - q[2] * d[2] - q[3] * d[3];
+    double x   = q[0] * d[1] + q[1] * d[0] + q[2] * d[3] - q[3] * d[2];
+    double y   = q[0] * d[2] - q[1] * d[3] + q[2] * d[0] + q[3] * d[1];
+    double z   = q[0] * d[3] + q[1] * d[2] - q[2] * d[1] + q[3] * d[0];
+    double mag = sqrt(w * w + x * x + y * y + z * z);
+    q[0]       = w / mag;
+    q[1]       = x / mag;
+    q[2]       = y / mag;
+    q[3]       = z / mag;
+
+    // The accelerometer sees world "up" from the controller's point of view
+    float fq[4] = {q[0], q[1], q[2], q[3]};
+    float up[3] = {0, 1, 0};
+    mathRotateVectorByInverseOfQuaternion(up, fq, up);
+    sample[3] = lround(-up[0] * ACCEL_COUNTS_PER_G);
+    sample[4] = lround(up[1] * ACCEL_COUNTS_PER_G);
+    sample[5] = lround(-up[2] * ACCEL_COUNTS_PER_G);
+    return true;
+}
+
+/**
+ * @brief Get the angle of the rotation between two orientations
+ *
+ * @param a One orientation
+ * @param b The other orientation
+ * @return The angle between them, in radians
+ */
+static double quatAngle(const float* a, const double* b)
+{
+    double dot  = fabs(a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3]);
+    double magA = sqrt((double)a[0] * a[0] + (double)a[1] * a[1] + (double)a[2] * a[2] + (double)a[3] * a[3]);
+    double magB = sqrt(b[0] * b[0] + b[1] * b[1] + b[2] * b[2] + b[3] * b[3]);
+    dot /= magA * magB;
+    return 2 * acos((dot > 1) ? 1 : dot);
+}
+
+/**
+ * @brief Get the angle between the "up" vectors of two orientations. Unlike quatAngle(), this ignores yaw, which the
+ * accelerometer can't correct.
+ *
+ * @param qa One orientation
+ * @param qb The other orientation
+ * @return The angle between their "up" vectors, in radians
+ */
+static double upAngle(const float* qa, const double* qb)
+{
+    float fqb[4] = {qb[0], qb[1], qb[2], qb[3]};
+    float upA[3] = {0, 1, 0};
+    float upB[3] = {0, 1, 0};
+    mathRotateVectorByInverseOfQuaternion(upA, qa, upA);
+    mathRotateVectorByInverseOfQuaternion(upB, fqb, upB);
+    double dot = ((double)upA[0] * upB[0] + (double)upA[1] * upB[1] + (double)upA[2] * upB[2])
+                 / sqrt(((double)upA[0] * upA[0] + (double)upA[1] * upA[1] + (double)upA[2] * upA[2])
+                        * ((double)upB[0] * upB[0] + (double)upB[1] * upB[1] + (double)upB[2] * upB[2]));
+    return acos((dot > 1) ? 1 : (dot < -1) ? -1 : dot);
+}
+
+/**
+ * @brief Add an angle to the running statistics
+ *
+ * @param stats The statistics
+ * @param rad The angle, in radians
+ */
+static void addAngle(angleStats_t* stats, double rad)
+{
+    if (rad > stats->max)
+    {
+        stats->max = rad;
+    }
+    stats->sumSq += rad * rad;
+    stats->count++;
+}
+
+/**
+ * @brief Print the maximum and RMS of an angle, in degrees
+ *
+ * @param label What the angle is
+ * @param stats The statistics
+ */
+static void printAngle(const char* label, const angleStats_t* stats)
+{
+    printf("%-32s max %9.5f deg, RMS %9.5f deg\n", label, stats->max * RAD_TO_DEG,
+           stats->count ? sqrt(stats->sumSq / stats->count) * RAD_TO_DEG : 0);
+}
+
+/**
+ * @brief Replay raw IMU samples through the fixed point and floating point fusion and compare them
+ *
+ * @param argc The number of arguments
+ * @param argv The arguments
+ * @return 0 on success, 1 on failure
+ */
+int main(int argc, char** argv)
+{
+    const char* csvName = NULL;
+    float odrHz         = DEFAULT_ODR_HZ;
+    int batchSamples    = DEFAULT_BATCH_SAMPLES;
+    float seconds       = DEFAULT_SECONDS;
+    float maxDps        = DEFAULT_MAX_DPS;
+    float noiseCounts   = DEFAULT_NOISE_COUNTS;
+
+    int opt;
+    while (-1 != (opt = getopt(argc, argv, "i:r:b:t:w:n:h")))
+    {
+        switch (opt)
+        {
+            case 'i':
+                csvName = optarg;
+                break;
+            case 'r':
+                odrHz = atof(optarg);
+                break;
+            case 'b':
+                batchSamples = atoi(optarg);
+                break;
+            case 't':
+                seconds = atof(optarg);
+                break;
+            case 'w':
+                maxDps = atof(optarg);
+                break;
+            case 'n':
+                noiseCounts = atof(optarg);
+                break;
+            default:
+                printUsage();
+                return 1;
+        }
+    }
+
+    if (odrHz <= 0 || batchSamples <= 0)
+    {
+        printUsage();
+        return 1;
+    }
+
+    sampleSource_t src = {
+        .odrHz        = odrHz,
+        .samplesLeft  = seconds * odrHz,
+        .maxRadPerSec = maxDps / RAD_TO_DEG,
+        .noiseCounts  = noiseCounts,
+        .truth        = {1, 0, 0, 0},
+    };
+    if (csvName)
+    {
+        src.csv = fopen(csvName, "r");
+        if (NULL == src.csv)
+        {
+            fprintf(stderr, "Couldn't open %s\n", csvName);
+            return 1;
+        }
+    }
+    srand(1);
+
+    LSM6DSLData fixed = {0};
+    imuFusionReset(&fixed, odrHz);
+    imuFusionBiasFromFloat(&fixed);
+
+    floatFusion_t ref;
+    floatFusionReset(&ref, odrHz);
+
+    angleStats_t fixedVsFloat = {0};
+    angleStats_t fixedTilt    = {0};
+    angleStats_t floatTilt    = {0};
+    uint32_t samples          = 0;
+
+    int16_t sample[6];
+    bool more = true;
+    while (more)
+    {
+        int inBatch = 0;
+        while (inBatch < batchSamples && (more = nextSample(&src, sample)))
+        {
+            imuFusionSample(&fixed, sample, sample + 3);
+            floatFusionSample(&ref, sample, sample + 3);
+            inBatch++;
+        }
+        if (0 == inBatch)
+        {
+            break;
+        }
+        samples += inBatch;
+
+        imuFusionEndBatch(&fixed);
+        floatFusionEndBatch(&ref);
+
+        double refQuat[4] = {ref.quat[0], ref.quat[1], ref.quat[2], ref.quat[3]};
+        addAngle(&fixedVsFloat, quatAngle(fixed.fqQuat, refQuat));
+        if (NULL == src.csv)
+        {
+            addAngle(&fixedTilt, upAngle(fixed.fqQuat, src.truth));
+            addAngle(&floatTilt, upAngle(ref.quat, src.truth));
+        }
+    }
+
+    if (src.csv)
+    {
+        fclose(src.csv);
+    }
+
+    printf("%u samples at %g Hz, %d per batch\n", samples, odrHz, batchSamples);
+    printAngle("Fixed vs float orientation", &fixedVsFloat);
+    if (NULL == csvName)
+    {
+        printAngle("Fixed point tilt vs truth", &fixedTilt);
+        printAngle("Floating point tilt vs truth", &floatTilt);
+    }
+    return 0;
+}
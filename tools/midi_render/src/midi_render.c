@@ -0,0 +1,357 @@
+//==============================================================================
+// Includes
+//==============================================================================
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "esp_heap_caps.h"
+#include "hdw-dac.h"
+#include "midiPlayer.h"
+#include "midiFileParser.h"
+#include "cnfs.h"
+#include "render_cnfs.h"
+
+//==============================================================================
+// Defines
+//==============================================================================
+
+#define DEFAULT_ASSET_DIR   "../../assets"
+#define DEFAULT_MAX_SECONDS 600
+
+//==============================================================================
+// Structs
+//==============================================================================
+
+/**
+ * @brief Statistics collected while rendering
+ */
+typedef struct
+{
+    uint64_t samples;
+    uint8_t peakPoolVoices;
+    uint8_t peakPercVoices;
+    double wallSeconds;
+} renderStats_t;
+
+//==============================================================================
+// Function Declarations
+//==============================================================================
+
+static void printUsage(void);
+static void songDoneCb(void);
+static double nowSeconds(void);
+static void countVoices(const midiPlayer_t* player, renderStats_t* stats);
+static void writeLe16(FILE* fp, uint16_t val);
+static void writeLe32(FILE* fp, uint32_t val);
+static bool writeWav(const char* fname, const uint8_t* samples, uint32_t len);
+
+//==============================================================================
+// Variables
+//==============================================================================
+
+static bool songDone = false;
+
+//==============================================================================
+// Functions
+//==============================================================================
+
+/**
+ * @brief Print how to use this program
+ */
+static void printUsage(void)
+{
+    printf("Usage:\n"
+           "  midi_render\n"
+           "    -i MIDI_FILE_NAME   The name of the song to render, like ode.mid\n"
+           "    [-a ASSET_DIR]      The directory to search for assets in (default " DEFAULT_ASSET_DIR ")\n"
+           "    [-o OUTPUT_WAV]     The WAV file to write. If omitted, only the benchmark is run\n"
+           "    [-t MAX_SECONDS]    Stop rendering after this many seconds of audio (default %d)\n"
+           "    [-m]                Render through the global BGM and SFX players with midiPlayerFillBufferMulti()\n",
+           DEFAULT_MAX_SECONDS);
+}
+
+/**
+ * @brief Called by the MIDI player when the song finishes
+ */
+static void songDoneCb(void)
+{
+    songDone = true;
+}
+
+/**
+ * @brief Get a monotonic timestamp
+ *
+ * @return double The current time, in seconds
+ */
+static double nowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Record the number of voices currently in use by a player, if it's a new peak
+ *
+ * @param player The MIDI player to check
+ * @param stats The stats to update
+ */
+static void countVoices(const midiPlayer_t* player, renderStats_t* stats)
+{
+    const voiceStates_t* pool = &player->poolVoiceStates;
+    uint8_t poolVoices        = __builtin_popcount(pool->on | pool->held | pool->sustenuto | pool->attack
+                                                   | pool->decay | pool->sustain | pool->release);
+    uint8_t percVoices        = __builtin_popcount(player->percVoiceStates.on);
+
+    if (poolVoices > stats->peakPoolVoices)
+    {
+        stats->peakPoolVoices = poolVoices;
+    }
+
+    if (percVoices > stats->peakPercVoices)
+    {
+        stats->peakPercVoices = percVoices;
+    }
+}
+
+/**
+ * @brief Write a little-endian 16 bit value to a file
+ *
+ * @param fp The file to write to
+ * @param val The value to write
+ */
+static void writeLe16(FILE* fp, uint16_t val)
+{
+    uint8_t bytes[] = {val & 0xFF, (val >> 8) & 0xFF};
+    fwrite(bytes, 1, sizeof(bytes), fp);
+}
+
+/**
+ * @brief Write a little-endian 32 bit value to a file
+ *
+ * @param fp The file to write to
+ * @param val The value to write
+ */
+static void writeLe32(FILE* fp, uint32_t val)
+{
+    uint8_t bytes[] = {val & 0xFF, (val >> 8) & 0xFF, (val >> 16) & 0xFF, (val >> 24) & 0xFF};
+    fwrite(bytes, 1, sizeof(bytes), fp);
+}
+
+/**
+ * @brief Write unsigned 8-bit mono samples at ::DAC_SAMPLE_RATE_HZ to a WAV file. These are exactly the samples
+ * which would be sent to the DAC.
+ *
+ * @param fname The name of the file to write
+ * @param samples The samples to write
+ * @param len The number of samples
+ * @return true if the file was written, false if it was not
+ */
+static bool writeWav(const char* fname, const uint8_t* samples, uint32_t len)
+{
+    FILE* fp = fopen(fname, "wb");
+    if (NULL == fp)
+    {
+        fprintf(stderr, "Could not open %s for writing\n", fname);
+        return false;
+    }
+
+    // RIFF header
+    fwrite("RIFF", 1, 4, fp);
+    writeLe32(fp, 36 + len);
+    fwrite("WAVE", 1, 4, fp);
+
+    // Format chunk, 8-bit unsigned PCM
+    fwrite("fmt ", 1, 4, fp);
+    writeLe32(fp, 16);
+    writeLe16(fp, 1);
+    writeLe16(fp, 1);
+    writeLe32(fp, DAC_SAMPLE_RATE_HZ);
+    writeLe32(fp, DAC_SAMPLE_RATE_HZ);
+    writeLe16(fp, 1);
+    writeLe16(fp, 8);
+
+    // Data chunk
+    fwrite("data", 1, 4, fp);
+    writeLe32(fp, len);
+    bool ok = (len == fwrite(samples, 1, len, fp));
+
+    fclose(fp);
+    return ok;
+}
+
+/**
+ * @brief Render a MIDI file to a WAV as fast as possible and report the synthesizer's performance
+ *
+ * @param argc The number of arguments
+ * @param argv The arguments
+ * @return int 0 on success, nonzero on failure
+ */
+int main(int argc, char** argv)
+{
+    const char* songName = NULL;
+    const char* assetDir = DEFAULT_ASSET_DIR;
+    const char* outName  = NULL;
+    int32_t maxSeconds   = DEFAULT_MAX_SECONDS;
+    bool multi           = false;
+
+    int c;
+    while ((c = getopt(argc, argv, "i:a:o:t:m")) != -1)
+    {
+        switch (c)
+        {
+            case 'i':
+            {
+                songName = optarg;
+                break;
+            }
+            case 'a':
+            {
+                assetDir = optarg;
+                break;
+            }
+            case 'o':
+            {
+                outName = optarg;
+                break;
+            }
+            case 't':
+            {
+                maxSeconds = atoi(optarg);
+                break;
+            }
+            case 'm':
+            {
+                multi = true;
+                break;
+            }
+            default:
+            {
+                printUsage();
+                return 1;
+            }
+        }
+    }
+
+    if (NULL == songName || maxSeconds <= 0)
+    {
+        printUsage();
+        return 1;
+    }
+
+    renderCnfsSetDir(assetDir);
+    initCnfs();
+
+    midiFile_t song;
+    if (!loadMidiFile(songName, &song, true))
+    {
+        fprintf(stderr, "Could not load %s from %s\n", songName, assetDir);
+        return 1;
+    }
+
+    uint32_t maxSamples = (uint32_t)maxSeconds * DAC_SAMPLE_RATE_HZ;
+    uint8_t* output     = malloc(maxSamples);
+    if (NULL == output)
+    {
+        fprintf(stderr, "Could not allocate %" PRIu32 " samples\n", maxSamples);
+        unloadMidiFile(&song);
+        return 1;
+    }
+
+    midiPlayer_t* player = NULL;
+    if (multi)
+    {
+        // Exactly the same path as the firmware's DAC callback
+        initGlobalMidiPlayer();
+        globalMidiPlayerPlaySongCb(&song, MIDI_BGM, songDoneCb);
+        player = globalMidiPlayerGet(MIDI_BGM);
+    }
+    else
+    {
+        player = heap_caps_calloc(1, sizeof(midiPlayer_t), MALLOC_CAP_8BIT);
+        midiPlayerInit(player);
+        player->songFinishedCallback = songDoneCb;
+        midiSetFile(player, &song);
+        midiPause(player, false);
+    }
+
+    renderStats_t stats = {0};
+    double start        = nowSeconds();
+    while (!songDone && stats.samples < maxSamples)
+    {
+        int16_t len = DAC_BUF_SIZE;
+        if (stats.samples + len > maxSamples)
+        {
+            len = maxSamples - stats.samples;
+        }
+
+        if (multi)
+        {
+            globalMidiPlayerFillBuffer(&output[stats.samples], len);
+            for (int i = 0; i < NUM_GLOBAL_PLAYERS; i++)
+            {
+                countVoices(globalMidiPlayerGet(i), &stats);
+            }
+        }
+        else
+        {
+            midiPlayerFillBuffer(player, &output[stats.samples], len);
+            countVoices(player, &stats);
+        }
+
+        stats.samples += len;
+    }
+    stats.wallSeconds = nowSeconds() - start;
+
+    double audioSeconds = (double)stats.samples / DAC_SAMPLE_RATE_HZ;
+    printf("Rendered:        %s\n", songName);
+    printf("Samples:         %" PRIu64 " (%.2fs at %dHz)%s\n", stats.samples, audioSeconds, DAC_SAMPLE_RATE_HZ,
+           songDone ? "" : ", song did not finish");
+    printf("Render time:     %.3fs\n", stats.wallSeconds);
+    printf("Real-time x:     %.1f\n", stats.wallSeconds > 0 ? audioSeconds / stats.wallSeconds : 0);
+    printf("ns per sample:   %.1f\n", stats.samples ? stats.wallSeconds * 1e9 / stats.samples : 0);
+    if (multi)
+    {
+        printf("Clipped samples: not tracked by midiPlayerFillBufferMulti()\n");
+    }
+    else
+    {
+        printf("Clipped samples: %" PRIu32 "\n", player->clipped);
+    }
+    printf("Peak voices:     %" PRIu8 "/%d melodic, %" PRIu8 "/%d percussion\n", stats.peakPoolVoices,
+           POOL_VOICE_COUNT, stats.peakPercVoices, PERCUSSION_VOICES);
+
+    int ret = 0;
+    if (NULL != outName)
+    {
+        if (writeWav(outName, output, stats.samples))
+        {
+            printf("Wrote:           %s\n", outName);
+        }
+        else
+        {
+            ret = 1;
+        }
+    }
+
+    if (multi)
+    {
+        deinitGlobalMidiPlayer();
+    }
+    else
+    {
+        midiPlayerReset(player);
+        heap_caps_free(player);
+    }
+    unloadMidiFile(&song);
+    free(output);
+    deinitCnfs();
+
+    return ret;
+}
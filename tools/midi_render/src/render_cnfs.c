@@ -0,0 +1,235 @@
+//==============================================================================
+// Includes
+//==============================================================================
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "cnfs.h"
+#include "hdw-nvs.h"
+#include "render_cnfs.h"
+
+//==============================================================================
+// Defines
+//==============================================================================
+
+#define MAX_PATH_LEN    1024
+#define MAX_FILES_CACHE 64
+
+//==============================================================================
+// Structs
+//==============================================================================
+
+/**
+ * @brief A file read from disk by cnfsGetFile(), which must stay loaded until exit
+ */
+typedef struct
+{
+    char* name;
+    uint8_t* data;
+    size_t len;
+} cachedFile_t;
+
+//==============================================================================
+// Variables
+//==============================================================================
+
+static const char* assetDir = NULL;
+
+static cachedFile_t fileCache[MAX_FILES_CACHE];
+static int fileCacheCount = 0;
+
+//==============================================================================
+// Function Declarations
+//==============================================================================
+
+static bool findAsset(const char* dir, const char* fname, char* out, size_t outLen);
+static uint8_t* readWholeFile(const char* path, size_t* outsize);
+
+//==============================================================================
+// Functions
+//==============================================================================
+
+/**
+ * @brief Set the directory which will be searched recursively for files, in place of the CNFS image
+ *
+ * @param dir The asset directory, like \c assets/ or \c assets_image/
+ */
+void renderCnfsSetDir(const char* dir)
+{
+    assetDir = dir;
+}
+
+/**
+ * @brief Free every file which was loaded with cnfsGetFile()
+ */
+void renderCnfsFreeAll(void)
+{
+    for (int i = 0; i < fileCacheCount; i++)
+    {
+        free(fileCache[i].name);
+        free(fileCache[i].data);
+    }
+    fileCacheCount = 0;
+}
+
+/**
+ * @brief Recursively search a directory for a file with the given name. CNFS has a flat namespace, so the first
+ * match in any subdirectory is used.
+ *
+ * @param dir The directory to search
+ * @param fname The file name to find
+ * @param out The buffer to write the full path to
+ * @param outLen The length of \c out
+ * @return true if the file was found, false if it was not
+ */
+static bool findAsset(const char* dir, const char* fname, char* out, size_t outLen)
+{
+    DIR* d = opendir(dir);
+    if (NULL == d)
+    {
+        return false;
+    }
+
+    bool found = false;
+    struct dirent* ent;
+    while (!found && NULL != (ent = readdir(d)))
+    {
+        if (0 == strcmp(ent->d_name, ".") || 0 == strcmp(ent->d_name, ".."))
+        {
+            continue;
+        }
+
+        char path[MAX_PATH_LEN];
+        snprintf(path, sizeof(path), "%s/%s", dir, ent->d_name);
+
+        struct stat st;
+        if (0 != stat(path, &st))
+        {
+            continue;
+        }
+
+        if (S_ISDIR(st.st_mode))
+        {
+            found = findAsset(path, fname, out, outLen);
+        }
+        else if (0 == strcmp(ent->d_name, fname))
+        {
+            snprintf(out, outLen, "%s", path);
+            found = true;
+        }
+    }
+
+    closedir(d);
+    return found;
+}
+
+/**
+ * @brief Read an entire file into a malloc()'d buffer
+ *
+ * @param path The path of the file to read
+ * @param outsize A pointer to a size_t to return how much data was read
+ * @return A pointer to the read data, or NULL if it could not be read
+ */
+static uint8_t* readWholeFile(const char* path, size_t* outsize)
+{
+    FILE* fp = fopen(path, "rb");
+    if (NULL == fp)
+    {
+        return NULL;
+    }
+
+    fseek(fp, 0L, SEEK_END);
+    long len = ftell(fp);
+    fseek(fp, 0L, SEEK_SET);
+
+    uint8_t* data = NULL;
+    if (len > 0)
+    {
+        data = malloc(len);
+        if (data && (size_t)len != fread(data, 1, len, fp))
+        {
+            free(data);
+            data = NULL;
+        }
+    }
+    fclose(fp);
+
+    *outsize = (NULL != data) ? (size_t)len : 0;
+    return data;
+}
+
+bool initCnfs(void)
+{
+    return NULL != assetDir;
+}
+
+bool deinitCnfs(void)
+{
+    renderCnfsFreeAll();
+    return true;
+}
+
+const uint8_t* cnfsGetFile(const char* fname, size_t* flen)
+{
+    for (int i = 0; i < fileCacheCount; i++)
+    {
+        if (0 == strcmp(fileCache[i].name, fname))
+        {
+            *flen = fileCache[i].len;
+            return fileCache[i].data;
+        }
+    }
+
+    char path[MAX_PATH_LEN];
+    if (NULL == assetDir || fileCacheCount >= MAX_FILES_CACHE || !findAsset(assetDir, fname, path, sizeof(path)))
+    {
+        ESP_LOGE("CNFS", "Failed to open file %s", fname);
+        *flen = 0;
+        return NULL;
+    }
+
+    uint8_t* data = readWholeFile(path, flen);
+    if (NULL != data)
+    {
+        fileCache[fileCacheCount].name = strdup(fname);
+        fileCache[fileCacheCount].data = data;
+        fileCache[fileCacheCount].len  = *flen;
+        fileCacheCount++;
+    }
+    return data;
+}
+
+uint8_t* cnfsReadFile(const char* fname, size_t* outsize, bool readToSpiRam)
+{
+    size_t len;
+    const uint8_t* src = cnfsGetFile(fname, &len);
+    if (NULL == src)
+    {
+        *outsize = 0;
+        return NULL;
+    }
+
+    uint8_t* data = heap_caps_malloc(len, readToSpiRam ? MALLOC_CAP_SPIRAM : MALLOC_CAP_8BIT);
+    if (NULL != data)
+    {
+        memcpy(data, src, len);
+        *outsize = len;
+    }
+    return data;
+}
+
+/**
+ * @brief There is no NVS when rendering offline, so nothing can be read from it
+ */
+bool readNamespaceNvsBlob(const char* namespace, const char* key, void* out_value, size_t* length)
+{
+    return false;
+}
@@ -0,0 +1,4 @@
+#pragma once
+
+void renderCnfsSetDir(const char* dir);
+void renderCnfsFreeAll(void);
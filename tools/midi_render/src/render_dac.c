@@ -0,0 +1,24 @@
+//==============================================================================
+// Includes
+//==============================================================================
+
+#include "hdw-dac.h"
+
+//==============================================================================
+// Functions
+//==============================================================================
+
+/**
+ * @brief Take the audio lock. midi_render generates samples on the same thread that drives the MIDI player, so there
+ * is nothing to lock out
+ */
+void dacLock(void)
+{
+}
+
+/**
+ * @brief Release the audio lock taken by dacLock()
+ */
+void dacUnlock(void)
+{
+}
@@ -46,7 +46,8 @@ def handle_msg(addr, message):
 
         line = f"{pretty_macstr(from_mac)} > "
 
-        rest = message[len(ESPNOW_HEADER) + struct.calcsize("!12s") + 1:]
+        # Skip the MAC and the sender's packet sequence number, which the emulator's network simulator uses
+        rest = message[len(ESPNOW_HEADER) + struct.calcsize("!12sx8s") + 1:]
 
         if rest[0] == ord('p'):
             # P2P message